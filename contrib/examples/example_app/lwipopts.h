@@ -154,6 +154,11 @@ a lot of data that needs to be copied, this should be set high. */
    src/api/tcpip.c. */
 #define MEMP_NUM_TCPIP_MSG_API   16
 #define MEMP_NUM_TCPIP_MSG_INPKT 16
+/* Let drivers pass all frames read in one wakeup with one message
+   (tapif does), MEMP_NUM_TCPIP_MSG_INPKT_BATCH messages of up to
+   TCPIP_INPUT_BATCH_SIZE frames each. */
+#define LWIP_TCPIP_INPUT_BATCH         1
+#define MEMP_NUM_TCPIP_MSG_INPKT_BATCH 4
 
 
 /* ---------- Pbuf options ---------- */
@@ -204,6 +209,18 @@ a lot of data that needs to be copied, this should be set high. */
 /* TCP receive window. */
 #define TCP_WND                 (20 * 1024)
 
+/* Send runs of segments as one super-segment, tapif cuts them in
+   software (start with TAPIF_GSO=0 to compare). */
+#define LWIP_TCP_GSO            1
+/* Merge received in-order segments before tcp_input(), the tcpip thread
+   ends a batch when its mailbox runs empty. */
+#define LWIP_TCP_GRO            1
+/* Allow spreading segments over time (tcp_set_pacing_rate(),
+   SO_MAX_PACING_RATE), pacing is off per connection by default. */
+#define LWIP_TCP_PACING         1
+/* Only run the TCP timers of connections that have a timer expiring. */
+#define LWIP_TCP_TIMER_WHEEL    1
+
 /* Maximum number of retransmissions of data segments. */
 #define TCP_MAXRTX              12
 
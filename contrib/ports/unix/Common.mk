@@ -33,6 +33,7 @@
 LWIPARCH?=$(CONTRIBDIR)/ports/unix/port
 SYSARCH?=$(LWIPARCH)/sys_arch.c
 ARCHFILES=$(LWIPARCH)/perf.c \
+  $(LWIPARCH)/chksum.c \
   $(SYSARCH) \
 	$(LWIPARCH)/netif/tapif.c \
 	$(LWIPARCH)/netif/list.c \
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Micro benchmark of the Internet checksum routines: the one of the core
+ * (lwip_standard_chksum, LWIP_CHKSUM_ALGORITHM as configured) and all
+ * implementations of the unix port supported by this CPU.
+ *
+ * Usage: chksum_bench [bytes per measurement, default 64M]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "arch/chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* not in a header: the core only uses it via LWIP_CHKSUM */
+u16_t lwip_standard_chksum(const void *dataptr, int len);
+
+static u16_t
+core_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  /* what LWIP_CHKSUM_COPY_ALGORITHM 1 does */
+  MEMCPY(dst, src, len);
+  return lwip_standard_chksum(dst, len);
+}
+
+static int
+core_supported(void)
+{
+  return 1;
+}
+
+static const struct lwip_unix_chksum_impl core_impl = {
+  "core", core_supported, lwip_standard_chksum, core_chksum_copy
+};
+
+static const int sizes[] = { 20, 40, 64, 128, 256, 576, 1460, 1500, 4096, 9000, 16384, 65535 };
+static const int offsets[] = { 0, 1, 2, 4 };
+
+#define BENCH_MAXLEN 65535
+#define BENCH_BUFSIZE (BENCH_MAXLEN + 64)
+
+static u8_t src_buf[BENCH_BUFSIZE];
+static u8_t dst_buf[BENCH_BUFSIZE];
+
+/* keep the compiler from optimizing the checksum calls away */
+static volatile u16_t sink;
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** check every implementation against the core for all sizes and offsets */
+static int
+verify(const struct lwip_unix_chksum_impl *impl)
+{
+  int len, off, errors = 0;
+  u16_t expected, got;
+
+  for (off = 0; off < 8; off++) {
+    for (len = 0; len <= 2048; len++) {
+      expected = lwip_standard_chksum(&src_buf[off], len);
+      got = impl->chksum(&src_buf[off], len);
+      if (got != expected) {
+        printf("%s: chksum mismatch len %d offset %d: 0x%04x != 0x%04x\n", impl->name, len, off, got, expected);
+        errors++;
+      }
+      got = impl->chksum_copy(&dst_buf[7 - off], &src_buf[off], (u16_t)len);
+      if ((got != expected) || memcmp(&dst_buf[7 - off], &src_buf[off], (size_t)len)) {
+        printf("%s: chksum_copy mismatch len %d offset %d\n", impl->name, len, off);
+        errors++;
+      }
+    }
+  }
+  if (impl->chksum(&src_buf[1], BENCH_MAXLEN) != lwip_standard_chksum(&src_buf[1], BENCH_MAXLEN)) {
+    printf("%s: chksum mismatch len %d\n", impl->name, BENCH_MAXLEN);
+    errors++;
+  }
+  return errors;
+}
+
+/** @return nanoseconds per call */
+static double
+bench_one(const struct lwip_unix_chksum_impl *impl, int copy, int len, int off, double bytes)
+{
+  long i, iterations = (long)(bytes / len);
+  double start;
+  u16_t acc = 0;
+
+  if (iterations < 1000) {
+    iterations = 1000;
+  }
+  /* warm up caches and branch predictors */
+  for (i = 0; i < 100; i++) {
+    acc = (u16_t)(acc + impl->chksum(&src_buf[off], len));
+  }
+  start = now_ns();
+  if (copy) {
+    for (i = 0; i < iterations; i++) {
+      acc = (u16_t)(acc + impl->chksum_copy(&dst_buf[off], &src_buf[off], (u16_t)len));
+    }
+  } else {
+    for (i = 0; i < iterations; i++) {
+      acc = (u16_t)(acc + impl->chksum(&src_buf[off], len));
+    }
+  }
+  sink = acc;
+  return (now_ns() - start) / (double)iterations;
+}
+
+static void
+bench_all(const struct lwip_unix_chksum_impl **impls, int num, int copy, double bytes)
+{
+  size_t s, o;
+  int i;
+  double ns;
+
+  printf("\n%s (ns per call / GB/s)\n", copy ? "copy and checksum" : "checksum");
+  printf("%6s %4s", "size", "off");
+  for (i = 0; i < num; i++) {
+    printf(" %20s", impls[i]->name);
+  }
+  printf("\n");
+  for (s = 0; s < LWIP_ARRAYSIZE(sizes); s++) {
+    for (o = 0; o < LWIP_ARRAYSIZE(offsets); o++) {
+      printf("%6d %4d", sizes[s], offsets[o]);
+      for (i = 0; i < num; i++) {
+        ns = bench_one(impls[i], copy, sizes[s], offsets[o], bytes);
+        printf(" %11.1f / %6.2f", ns, (double)sizes[s] / ns);
+      }
+      printf("\n");
+    }
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  const struct lwip_unix_chksum_impl *impls[8];
+  const struct lwip_unix_chksum_impl *impl;
+  int num = 0, errors = 0;
+  double bytes = 64.0 * 1024 * 1024;
+  size_t i;
+  u32_t x = 0x12345678;
+
+  if (argc > 1) {
+    bytes = atof(argv[1]);
+  }
+  for (i = 0; i < sizeof(src_buf); i++) {
+    x = x * 1103515245UL + 12345UL;
+    src_buf[i] = (u8_t)(x >> 16);
+  }
+
+  impls[num++] = &core_impl;
+  for (impl = lwip_unix_chksum_impls; (impl->name != NULL) && (num < (int)LWIP_ARRAYSIZE(impls)); impl++) {
+    if (impl->supported()) {
+      impls[num++] = impl;
+    } else {
+      printf("%s: not supported by this CPU\n", impl->name);
+    }
+  }
+  printf("core: LWIP_CHKSUM_ALGORITHM %d, port selects: %s\n", LWIP_CHKSUM_ALGORITHM, lwip_unix_chksum_name());
+
+  for (i = 1; i < (size_t)num; i++) {
+    errors += verify(impls[i]);
+  }
+  if (errors) {
+    printf("%d errors, not benchmarking\n", errors);
+    return 1;
+  }
+
+  bench_all(impls, num, 0, bytes);
+  bench_all(impls, num, 1, bytes);
+  return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Readiness notification with many idle sockets: NUM_IDLE UDP sockets that
+ * never receive anything and NUM_ACTIVE UDP sockets that get one datagram
+ * each per round (sent over the loopback netif by a sender thread). The main
+ * thread waits for and reads all datagrams of a round with lwip_poll() over
+ * all sockets, and with lwip_epoll_wait() (level- and edge-triggered) on an
+ * epoll instance with all sockets in its interest set.
+ *
+ * Usage: epoll_bench [rounds, default 2000]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_IDLE     10000
+#define NUM_ACTIVE   8
+#define NUM_FDS      (NUM_IDLE + NUM_ACTIVE)
+#define BENCH_PORT   5001
+
+static int fds[NUM_FDS];
+static struct pollfd pollfds[NUM_FDS];
+static struct epoll_event events[NUM_ACTIVE];
+static int sender;
+static int rounds;
+/* signalled by the main thread to start a round, and by the sender when it is done */
+static sys_sem_t round_sem;
+static sys_sem_t sent_sem;
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void
+sender_thread(void *arg)
+{
+  struct sockaddr_in addr;
+  u8_t buf[32];
+  int i;
+  LWIP_UNUSED_ARG(arg);
+
+  memset(buf, 0, sizeof(buf));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  for (;;) {
+    sys_arch_sem_wait(&round_sem, 0);
+    for (i = 0; i < NUM_ACTIVE; i++) {
+      addr.sin_port = lwip_htons((u16_t)(BENCH_PORT + i));
+      if (lwip_sendto(sender, buf, sizeof(buf), 0, (struct sockaddr *)&addr, sizeof(addr)) != sizeof(buf)) {
+        printf("sendto failed\n");
+        exit(1);
+      }
+    }
+    sys_sem_signal(&sent_sem);
+  }
+}
+
+/* read one datagram from a socket that was reported readable */
+static int
+read_one(int s)
+{
+  u8_t buf[32];
+  return lwip_recv(s, buf, sizeof(buf), MSG_DONTWAIT) > 0;
+}
+
+/* one round with lwip_poll(): returns the number of lwip_poll() calls */
+static int
+round_poll(void)
+{
+  int received = 0, calls = 0, n, i;
+
+  while (received < NUM_ACTIVE) {
+    n = lwip_poll(pollfds, NUM_FDS, -1);
+    calls++;
+    for (i = 0; (i < NUM_FDS) && (n > 0); i++) {
+      if (pollfds[i].revents & POLLIN) {
+        n--;
+        received += read_one(pollfds[i].fd);
+      }
+    }
+  }
+  return calls;
+}
+
+/* one round with lwip_epoll_wait(): returns the number of lwip_epoll_wait() calls */
+static int
+round_epoll(int ep, int et)
+{
+  int received = 0, calls = 0, n, i;
+
+  while (received < NUM_ACTIVE) {
+    n = lwip_epoll_wait(ep, events, NUM_ACTIVE, -1);
+    calls++;
+    for (i = 0; i < n; i++) {
+      if (et) {
+        /* edge-triggered: read until there is nothing left */
+        while (read_one(events[i].data.fd)) {
+          received++;
+        }
+      } else {
+        received += read_one(events[i].data.fd);
+      }
+    }
+  }
+  return calls;
+}
+
+static void
+bench_run(const char *name, int ep, int et)
+{
+  struct epoll_event ev;
+  long calls = 0;
+  double start, ns;
+  int i;
+
+  if (ep >= 0) {
+    for (i = 0; i < NUM_FDS; i++) {
+      ev.events = EPOLLIN | (et ? EPOLLET : 0);
+      ev.data.fd = fds[i];
+      if (lwip_epoll_ctl(ep, EPOLL_CTL_ADD, fds[i], &ev) != 0) {
+        printf("%s: epoll_ctl failed\n", name);
+        exit(1);
+      }
+    }
+  }
+
+  start = now_ns();
+  for (i = 0; i < rounds; i++) {
+    sys_sem_signal(&round_sem);
+    calls += (ep >= 0) ? round_epoll(ep, et) : round_poll();
+    sys_arch_sem_wait(&sent_sem, 0);
+  }
+  ns = now_ns() - start;
+
+  if (ep >= 0) {
+    for (i = 0; i < NUM_FDS; i++) {
+      lwip_epoll_ctl(ep, EPOLL_CTL_DEL, fds[i], NULL);
+    }
+  }
+  printf("%-10s %8d %10.2f %10.2f\n", name, rounds, ns / rounds / 1e3, (double)calls / rounds);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  int ep, i, j;
+
+  rounds = 2000;
+  if (argc > 1) {
+    rounds = atoi(argv[1]);
+  }
+
+  sys_sem_new(&round_sem, 0);
+  sys_sem_new(&sent_sem, 0);
+  tcpip_init(NULL, NULL);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  for (i = 0; i < NUM_FDS; i++) {
+    fds[i] = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    if (fds[i] < 0) {
+      printf("socket %d failed\n", i);
+      return 1;
+    }
+    /* the active sockets are spread among the idle ones */
+    if ((i % (NUM_FDS / NUM_ACTIVE)) == 0) {
+      j = i / (NUM_FDS / NUM_ACTIVE);
+      addr.sin_port = lwip_htons((u16_t)(BENCH_PORT + j));
+      if (lwip_bind(fds[i], (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("bind failed\n");
+        return 1;
+      }
+    }
+    pollfds[i].fd = fds[i];
+    pollfds[i].events = POLLIN;
+  }
+  sender = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  ep = lwip_epoll_create(1);
+  if ((sender < 0) || (ep < 0)) {
+    printf("socket/epoll_create failed\n");
+    return 1;
+  }
+  sys_thread_new("sender", sender_thread, NULL, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+
+  printf("UDP over loopback, %d idle and %d active sockets, 1 datagram per active socket and round\n",
+         NUM_IDLE, NUM_ACTIVE);
+  printf("%-10s %8s %10s %10s\n", "mode", "rounds", "us/round", "waits/rnd");
+  for (i = 0; i < 3; i++) {
+    bench_run("poll", -1, 0);
+    bench_run("epoll", ep, 0);
+    bench_run("epoll-et", ep, 1);
+  }
+  lwip_close(ep);
+  return 0;
+}
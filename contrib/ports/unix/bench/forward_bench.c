@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Forward path of a TCP proxy over the loopback netif: a source thread
+ * (netconn) sends to the proxy (sockets, main thread), which forwards the
+ * data unchanged to a sink thread (netconn, checks the data). The proxy
+ * receives with lwip_recv() into a buffer ("copy") or with
+ * lwip_recvmsg_zerocopy() and lwip_recvmsg_release() ("loan"), and sends
+ * the buffer or the loaned iovecs with lwip_send()/lwip_sendmsg().
+ * Time is measured until the sink has got all data. The CPU time of the
+ * proxy thread is printed in total and for its receive calls alone; it
+ * includes the TCP output of the sends (core locking) but not the input
+ * processing in tcpip_thread.
+ *
+ * Usage: forward_bench [megabytes per run, default 256]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/api.h"
+#include "lwip/pbuf.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROXY_PORT   5001
+#define SINK_PORT    5002
+#define CHUNK_SIZE   (16 * 1024)
+#define COPY_SIZE    (64 * 1024)
+/* enough for 64KB of full-sized segments */
+#define NUM_IOV      64
+
+static u8_t chunk[CHUNK_SIZE];
+static u8_t copy_buf[COPY_SIZE];
+static u32_t total_bytes;
+/* signalled by the main thread to start the source */
+static sys_sem_t source_sem;
+/* signalled by the sink when it has got all data and when the connection is closed */
+static sys_sem_t sink_sem;
+static long rx_errors;
+
+static double
+now_ns(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* byte i of the stream: every chunk is the same */
+static u8_t
+stream_byte(u32_t i)
+{
+  return (u8_t)(i % 251);
+}
+
+static void
+source_thread(void *arg)
+{
+  struct netconn *conn;
+  ip_addr_t addr;
+  u32_t sent;
+  LWIP_UNUSED_ARG(arg);
+
+  ip_addr_set_loopback(0, &addr);
+  for (;;) {
+    sys_arch_sem_wait(&source_sem, 0);
+    conn = netconn_new(NETCONN_TCP);
+    if ((conn == NULL) || (netconn_connect(conn, &addr, PROXY_PORT) != ERR_OK)) {
+      printf("source: connect failed\n");
+      exit(1);
+    }
+    for (sent = 0; sent < total_bytes; sent += CHUNK_SIZE) {
+      if (netconn_write(conn, chunk, CHUNK_SIZE, NETCONN_NOCOPY) != ERR_OK) {
+        printf("source: write failed\n");
+        exit(1);
+      }
+    }
+    netconn_close(conn);
+    netconn_delete(conn);
+  }
+}
+
+static void
+sink_thread(void *arg)
+{
+  struct netconn *listener = (struct netconn *)arg;
+  struct netconn *conn;
+  struct pbuf *p, *q;
+  u32_t received;
+  u16_t i;
+
+  for (;;) {
+    if (netconn_accept(listener, &conn) != ERR_OK) {
+      return;
+    }
+    received = 0;
+    while (netconn_recv_tcp_pbuf(conn, &p) == ERR_OK) {
+      for (q = p; q != NULL; q = q->next) {
+        /* spot check to keep the sink cheap */
+        for (i = 0; i < q->len; i += 509) {
+          if (((u8_t *)q->payload)[i] != stream_byte((received + i) % CHUNK_SIZE)) {
+            rx_errors++;
+          }
+        }
+        received += q->len;
+      }
+      pbuf_free(p);
+      if (received == total_bytes) {
+        sys_sem_signal(&sink_sem);
+      }
+    }
+    netconn_delete(conn);
+    if (received != total_bytes) {
+      printf("sink: received %u of %u bytes\n", (unsigned)received, (unsigned)total_bytes);
+      rx_errors++;
+    }
+    sys_sem_signal(&sink_sem);
+  }
+}
+
+/* forward everything from 'in' to 'out', returns the CPU time of the receive calls */
+static double
+forward(int in, int out, int loan)
+{
+  struct iovec iov[NUM_IOV];
+  struct msghdr msg;
+  double rx_ns = 0, t;
+  ssize_t len;
+  void *buf;
+
+  for (;;) {
+    t = now_ns(CLOCK_THREAD_CPUTIME_ID);
+    if (loan) {
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = NUM_IOV;
+      len = lwip_recvmsg_zerocopy(in, &msg, 0, &buf);
+    } else {
+      len = lwip_recv(in, copy_buf, sizeof(copy_buf), 0);
+    }
+    rx_ns += now_ns(CLOCK_THREAD_CPUTIME_ID) - t;
+    if (len <= 0) {
+      break;
+    }
+    if ((loan ? lwip_sendmsg(out, &msg, 0) : lwip_send(out, copy_buf, (size_t)len, 0)) != len) {
+      len = -1;
+      break;
+    }
+    if (loan) {
+      t = now_ns(CLOCK_THREAD_CPUTIME_ID);
+      lwip_recvmsg_release(in, buf);
+      rx_ns += now_ns(CLOCK_THREAD_CPUTIME_ID) - t;
+    }
+  }
+  if (len < 0) {
+    printf("forward failed\n");
+    exit(1);
+  }
+  return rx_ns;
+}
+
+static void
+bench_run(const char *name, int listener, int loan)
+{
+  struct sockaddr_in addr;
+  int in, out;
+  double start, ns, cpu_start, cpu_ns, rx_ns, mb;
+
+  out = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = PP_HTONS(SINK_PORT);
+  addr.sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  if (lwip_connect(out, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    printf("%s: connect failed\n", name);
+    exit(1);
+  }
+  sys_sem_signal(&source_sem);
+  in = lwip_accept(listener, NULL, NULL);
+  if (in < 0) {
+    printf("%s: accept failed\n", name);
+    exit(1);
+  }
+
+  start = now_ns(CLOCK_MONOTONIC);
+  cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+  rx_ns = forward(in, out, loan);
+  cpu_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+  sys_arch_sem_wait(&sink_sem, 0);
+  ns = now_ns(CLOCK_MONOTONIC) - start;
+  lwip_close(in);
+  lwip_close(out);
+  sys_arch_sem_wait(&sink_sem, 0);
+
+  mb = (double)total_bytes / (1024 * 1024);
+  printf("%-8s %10u %8.1f %10.1f %10.1f\n", name, (unsigned)total_bytes, (double)total_bytes * 1e3 / ns,
+         cpu_ns / 1e3 / mb, rx_ns / 1e3 / mb);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  struct netconn *sink_listener;
+  int listener, i;
+
+  total_bytes = 256 * 1024 * 1024;
+  if (argc > 1) {
+    total_bytes = (u32_t)atoi(argv[1]) * 1024 * 1024;
+  }
+  total_bytes -= total_bytes % CHUNK_SIZE;
+  for (i = 0; i < CHUNK_SIZE; i++) {
+    chunk[i] = stream_byte((u32_t)i);
+  }
+
+  sys_sem_new(&source_sem, 0);
+  sys_sem_new(&sink_sem, 0);
+  tcpip_init(NULL, NULL);
+
+  sink_listener = netconn_new(NETCONN_TCP);
+  netconn_bind(sink_listener, IP4_ADDR_ANY, SINK_PORT);
+  netconn_listen(sink_listener);
+  sys_thread_new("sink", sink_thread, sink_listener, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+  sys_thread_new("source", source_thread, NULL, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+
+  listener = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = PP_HTONS(PROXY_PORT);
+  if ((lwip_bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (lwip_listen(listener, 1) != 0)) {
+    printf("listen failed\n");
+    return 1;
+  }
+
+  printf("TCP forwarding over loopback, %d byte writes by the source\n", CHUNK_SIZE);
+  printf("%-8s %10s %8s %10s %10s\n", "proxy", "bytes", "MB/s", "cpu us/MB", "recv us/MB");
+  for (i = 0; i < 3; i++) {
+    bench_run("copy", listener, 0);
+    bench_run("loan", listener, 1);
+  }
+  if (rx_errors) {
+    printf("%ld receive errors\n", rx_errors);
+  }
+  return rx_errors != 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * TCP bulk transfer between two netifs in one process, with and without
+ * LWIP_TCP_GSO: the sender's netif either gets every segment from
+ * tcp_output() or super-segments that it cuts with tcp_gso_segment().
+ * Every wire frame is copied out and into a new pbuf, like a driver would.
+ * The time spent in the sender (processing ACKs and sending) and in the
+ * receiver is measured separately. Frames are received in batches of up to
+ * BENCH_BATCH, which end with tcp_gro_flush() if LWIP_TCP_GRO is enabled
+ * (gso_bench_gro).
+ *
+ * Usage: gso_bench [MBytes per run, default 256]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/init.h"
+#include "lwip/ip.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CHUNK      (16 * 1024)
+#define BENCH_RING_SIZE  1024
+#define BENCH_BATCH      64
+
+static u8_t tx_buf[BENCH_CHUNK];
+static u8_t frame[1514];
+
+static struct netif netif_tx, netif_rx;
+
+/* frames on the wire, in both directions */
+static struct {
+  struct pbuf *p;
+  struct netif *to;
+} ring[BENCH_RING_SIZE];
+static u32_t ring_head, ring_tail;
+
+static u32_t ip_outputs, frames;
+static u64_t bytes_left, bytes_received;
+static u32_t rnd_state = 0x12345678;
+
+u32_t
+sys_now(void)
+{
+  return 0;
+}
+
+/* LWIP_RAND() of the unix port, normally in sys_arch.c */
+unsigned int
+lwip_port_rand(void)
+{
+  rnd_state = rnd_state * 1103515245UL + 12345UL;
+  return rnd_state >> 8;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** the driver: copy the frame out and into a new pbuf for the other netif */
+static err_t
+bench_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  struct pbuf *q;
+
+  LWIP_ASSERT("ring full", ring_head - ring_tail < BENCH_RING_SIZE);
+  LWIP_ASSERT("frame too long", p->tot_len <= sizeof(frame));
+  pbuf_copy_partial(p, frame, p->tot_len, 0);
+  q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  if (q == NULL) {
+    return ERR_MEM;
+  }
+  memcpy(q->payload, frame, p->tot_len);
+  ring[ring_head % BENCH_RING_SIZE].p = q;
+  ring[ring_head % BENCH_RING_SIZE].to = (struct netif *)netif->state;
+  ring_head++;
+  frames++;
+  return ERR_OK;
+}
+
+static err_t
+bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(ipaddr);
+  if (netif == &netif_tx) {
+    ip_outputs++;
+  }
+  if (pbuf_is_gso(p)) {
+    return tcp_gso_segment(netif, p, 0, bench_linkoutput);
+  }
+  return bench_linkoutput(netif, p);
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->output = bench_output;
+  netif->linkoutput = bench_linkoutput;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+bench_fill(struct tcp_pcb *pcb)
+{
+  while ((bytes_left > 0) && (tcp_sndbuf(pcb) >= BENCH_CHUNK) &&
+         (tcp_sndqueuelen(pcb) + BENCH_CHUNK / TCP_MSS + 2 < TCP_SND_QUEUELEN)) {
+    u16_t len = (u16_t)LWIP_MIN(bytes_left, BENCH_CHUNK);
+    if (tcp_write(pcb, tx_buf, len, 0) != ERR_OK) {
+      break;
+    }
+    bytes_left -= len;
+  }
+  tcp_output(pcb);
+}
+
+static err_t
+bench_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(len);
+  bench_fill(pcb);
+  return ERR_OK;
+}
+
+static err_t
+bench_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  tcp_sent(pcb, bench_sent);
+  bench_fill(pcb);
+  return ERR_OK;
+}
+
+static err_t
+bench_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p != NULL) {
+    bytes_received += p->tot_len;
+    tcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+  }
+  return ERR_OK;
+}
+
+static err_t
+bench_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(err);
+  *(struct tcp_pcb **)arg = pcb;
+  tcp_arg(pcb, NULL);
+  tcp_recv(pcb, bench_recv);
+  return ERR_OK;
+}
+
+static void
+bench_run(int gso, u64_t bytes, u16_t port)
+{
+  struct tcp_pcb *lpcb, *tx_pcb, *rx_pcb = NULL;
+  struct netif *to;
+  double start, t_tx = 0, t_rx = 0, t;
+  u32_t segs, n;
+
+  if (gso) {
+    netif_tx.flags |= NETIF_FLAG_GSO;
+    netif_tx.gso_max_size = 0xffff;
+  } else {
+    netif_tx.flags &= (u8_t)~NETIF_FLAG_GSO;
+  }
+  ip_outputs = frames = 0;
+  bytes_left = bytes;
+  bytes_received = 0;
+
+  lpcb = tcp_new();
+  tcp_bind_netif(lpcb, &netif_rx);
+  tcp_bind(lpcb, netif_ip_addr4(&netif_rx), port);
+  lpcb = tcp_listen(lpcb);
+  tcp_arg(lpcb, &rx_pcb);
+  tcp_accept(lpcb, bench_accept);
+
+  tx_pcb = tcp_new();
+  tcp_bind_netif(tx_pcb, &netif_tx);
+  tcp_nagle_disable(tx_pcb);
+  tcp_connect(tx_pcb, netif_ip_addr4(&netif_rx), port, bench_connected);
+
+  while (bytes_received < bytes) {
+    if (ring_tail == ring_head) {
+      /* flush delayed ACKs */
+      tcp_fasttmr();
+      if (ring_tail == ring_head) {
+        printf("stalled after %u bytes\n", (unsigned)bytes_received);
+        break;
+      }
+    }
+    /* receive the frames waiting for one netif in one batch */
+    to = ring[ring_tail % BENCH_RING_SIZE].to;
+    start = now_ns();
+    for (n = 0; (n < BENCH_BATCH) && (ring_tail != ring_head) &&
+         (ring[ring_tail % BENCH_RING_SIZE].to == to); n++, ring_tail++) {
+      to->input(ring[ring_tail % BENCH_RING_SIZE].p, to);
+    }
+#if LWIP_TCP_GRO
+    tcp_gro_flush(to);
+#endif /* LWIP_TCP_GRO */
+    t = now_ns() - start;
+    if (to == &netif_tx) {
+      t_tx += t;
+    } else {
+      t_rx += t;
+    }
+  }
+
+  segs = (u32_t)(bytes / tx_pcb->mss);
+  printf("%4s %10.1f %12.1f %12.1f %10u %10u\n", gso ? "on" : "off",
+         bytes / ((t_tx + t_rx) / 1e9) / (1024 * 1024),
+         t_tx / segs, t_rx / segs, (unsigned)ip_outputs, (unsigned)frames);
+
+  tcp_abort(tx_pcb);
+  if (rx_pcb != NULL) {
+    tcp_abort(rx_pcb);
+  }
+  tcp_close(lpcb);
+  while (ring_tail != ring_head) {
+    pbuf_free(ring[ring_tail % BENCH_RING_SIZE].p);
+    ring_tail++;
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  ip4_addr_t addr, mask;
+  u64_t bytes = 256 * 1024 * 1024;
+
+  if (argc > 1) {
+    bytes = (u64_t)atoi(argv[1]) * 1024 * 1024;
+  }
+  lwip_init();
+
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&addr, 10, 0, 1, 1);
+  netif_add(&netif_tx, &addr, &mask, IP4_ADDR_ANY4, &netif_rx, bench_netif_init, ip_input);
+  netif_set_up(&netif_tx);
+  IP4_ADDR(&addr, 10, 0, 2, 1);
+  netif_add(&netif_rx, &addr, &mask, IP4_ADDR_ANY4, &netif_tx, bench_netif_init, ip_input);
+  netif_set_up(&netif_rx);
+
+  printf("TCP_MSS %u, TCP_SND_BUF %u, %u MByte per run\n", (unsigned)TCP_MSS, (unsigned)TCP_SND_BUF,
+         (unsigned)(bytes / (1024 * 1024)));
+  printf("%4s %10s %12s %12s %10s %10s\n", "GSO", "MByte/s", "tx ns/seg", "rx ns/seg", "ip_output", "frames");
+  bench_run(0, bytes, 5001);
+  bench_run(1, bytes, 5002);
+  bench_run(0, bytes, 5003);
+  bench_run(1, bytes, 5004);
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_LWIPOPTS_H
+#define LWIP_HDR_LWIPOPTS_H
+
+#ifdef LWIP_BENCH_SYS_ARCH
+/* mbox_bench, memp_bench: the port's sys_arch.c with threads, but only
+   parts of the core */
+#define NO_SYS                          0
+#define LWIP_TCPIP_CORE_LOCKING         0
+#define MEMP_NUM_PBUF                   1024
+#define PBUF_POOL_SIZE                  1024
+void sys_check_core_locking(void);
+#define LWIP_ASSERT_CORE_LOCKED()       sys_check_core_locking()
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+#elif defined LWIP_BENCH_SOCKETS
+/* zerocopy_bench, epoll_bench, mmsg_bench, ring_bench, forward_bench: the whole stack with tcpip_thread, sockets and loopif */
+#define NO_SYS                          0
+void sys_check_core_locking(void);
+#define LWIP_ASSERT_CORE_LOCKED()       sys_check_core_locking()
+#define LWIP_NETCONN                    1
+#define LWIP_SOCKET                     1
+#define LWIP_SO_ZEROCOPY                1
+#define LWIP_NETIF_LOOPBACK             1
+#define LWIP_STATS                      0
+#define MEM_SIZE                        (512 * 1024)
+#define MEMP_NUM_PBUF                   512
+#define PBUF_POOL_SIZE                  64
+#define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+#define TCP_MSS                         1460
+#define TCP_WND                         (44 * TCP_MSS)
+#define TCP_SND_BUF                     (44 * TCP_MSS)
+#define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF / TCP_MSS)
+#define TCPIP_MBOX_SIZE                 256
+#define DEFAULT_TCP_RECVMBOX_SIZE       256
+#define DEFAULT_ACCEPTMBOX_SIZE         4
+/* like with checksum offloading */
+#define CHECKSUM_GEN_TCP                0
+#define CHECKSUM_CHECK_TCP              0
+#else /* LWIP_BENCH_SYS_ARCH */
+/* The other benchmarks call into the core directly, no OS needed */
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            0
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+#endif /* LWIP_BENCH_SYS_ARCH */
+
+/* Use the checksum of the core (LWIP_CHKSUM_ALGORITHM is set by CMakeLists.txt),
+   the routines of the unix port are called directly */
+#define LWIP_UNIX_CHKSUM                0
+#define LWIP_CHECKSUM_ON_COPY           1
+
+#ifdef LWIP_BENCH_GSO
+/* gso_bench: raw TCP between two netifs, large send buffer */
+#define LWIP_TCP_GSO                    1
+#define LWIP_STATS                      0
+#define MEM_SIZE                        (1024 * 1024)
+#define MEMP_NUM_PBUF                   1024
+#define PBUF_POOL_SIZE                  64
+#define TCP_MSS                         1460
+#define TCP_WND                         (44 * TCP_MSS)
+#define TCP_SND_BUF                     (44 * TCP_MSS)
+#define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF / TCP_MSS)
+#define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+#endif /* LWIP_BENCH_GSO */
+
+#ifdef LWIP_BENCH_EPOLL
+/* epoll_bench: sockets as for zerocopy_bench, 10000 of them idle (too many
+   for the fd_set of the C library, so no select) */
+#define LWIP_SOCKET_EPOLL               1
+#define LWIP_SOCKET_SELECT              0
+#define MEMP_NUM_NETCONN                10020
+#define MEMP_NUM_UDP_PCB                10020
+#define MEMP_NUM_NETBUF                 64
+#endif /* LWIP_BENCH_EPOLL */
+
+#ifdef LWIP_BENCH_MMSG
+/* mmsg_bench: sockets as for zerocopy_bench, room for a batch of datagrams
+   in the receive mbox */
+#define LWIP_SOCKET_MMSG                1
+#define MEMP_NUM_NETBUF                 64
+#define DEFAULT_UDP_RECVMBOX_SIZE       64
+#endif /* LWIP_BENCH_MMSG */
+
+#ifdef LWIP_BENCH_RING
+/* ring_bench: sockets as for zerocopy_bench, netconn_ring and 64 client and
+   64 server connections */
+#define LWIP_NETCONN_RING               1
+#define MEMP_NUM_NETCONN                150
+#define MEMP_NUM_TCP_PCB                150
+#endif /* LWIP_BENCH_RING */
+
+#ifdef LWIP_BENCH_FORWARD
+/* forward_bench: sockets as for zerocopy_bench, loaned receive buffers and
+   two connections per run (plus the ones in TIME_WAIT) */
+#define LWIP_SOCKET_ZEROCOPY_RECV       1
+#define MEMP_NUM_NETCONN                16
+#define MEMP_NUM_TCP_PCB                16
+#endif /* LWIP_BENCH_FORWARD */
+
+#ifdef LWIP_BENCH_UDP_GSO
+/* udp_gso_bench: raw UDP to a static ARP entry */
+#define LWIP_UDP_GSO                    1
+#define ETHARP_SUPPORT_STATIC_ENTRIES   1
+#define LWIP_STATS                      0
+#define MEMP_NUM_PBUF                   256
+/* like with checksum offloading */
+#define CHECKSUM_GEN_UDP                0
+#endif /* LWIP_BENCH_UDP_GSO */
+
+#ifdef LWIP_BENCH_PORTS
+/* port_bench: 30000 connections in SYN_SENT, twice the default local port
+   range (LWIP_PORT_BITMAP is set by CMakeLists.txt) */
+#define LWIP_STATS                      0
+/* the SYNs are allocated from the C library heap: the first fit search of
+   mem_malloc() would dominate the reconnects */
+#define MEM_LIBC_MALLOC                 1
+#define MEMP_NUM_TCP_PCB                30100
+#define MEMP_NUM_TCP_SEG                30100
+#define TCP_LOCAL_PORT_RANGE_START      0x8000
+#define TCP_LOCAL_PORT_RANGE_END        0xffff
+#define TCP_ENSURE_LOCAL_PORT_RANGE(port) ((u16_t)(((port) & (u16_t)~TCP_LOCAL_PORT_RANGE_START) + TCP_LOCAL_PORT_RANGE_START))
+#endif /* LWIP_BENCH_PORTS */
+
+/* timers_bench: room for many timeouts (LWIP_TIMERS_WHEEL is set by CMakeLists.txt) */
+#define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 20000)
+#define SYS_TIMEOUT_HASH_SIZE           4096
+
+#endif /* LWIP_HDR_LWIPOPTS_H */
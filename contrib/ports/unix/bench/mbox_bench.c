@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Throughput benchmark of the mailboxes of the unix port (sys_mbox_post and
+ * sys_arch_mbox_fetch in port/sys_arch.c) with 1, 4 and 16 threads posting
+ * to one thread fetching, like drivers and applications posting to
+ * tcpip_thread. Built once per implementation: mbox_bench_mutex
+ * (LWIP_UNIX_MBOX_LOCKFREE 0) and mbox_bench_lockfree (1).
+ * Also checks that the messages of each poster arrive in order.
+ *
+ * Usage: mbox_bench [messages per run, default 4M]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/sys.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAX_POSTERS 16
+
+static const int posters[] = { 1, 4, 16 };
+
+static sys_mbox_t mbox;
+static long msgs_per_poster;
+
+struct poster {
+  pthread_t thread;
+  /* messages encode poster and sequence number; 0 is never posted */
+  mem_ptr_t base;
+};
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void *
+poster_thread(void *arg)
+{
+  struct poster *p = (struct poster *)arg;
+  long i;
+
+  for (i = 1; i <= msgs_per_poster; i++) {
+    sys_mbox_post(&mbox, (void *)(p->base + (mem_ptr_t)i));
+  }
+  return NULL;
+}
+
+static int
+bench_run(int num_posters, long total)
+{
+  static struct poster p[MAX_POSTERS];
+  long next[MAX_POSTERS];
+  long received, errors = 0;
+  double start, ns;
+  void *msg;
+  int i;
+
+  msgs_per_poster = total / num_posters;
+  total = msgs_per_poster * num_posters;
+  if (sys_mbox_new(&mbox, 0) != ERR_OK) {
+    printf("sys_mbox_new failed\n");
+    return 1;
+  }
+
+  start = now_ns();
+  for (i = 0; i < num_posters; i++) {
+    next[i] = 1;
+    p[i].base = ((mem_ptr_t)(i + 1)) << 24;
+    pthread_create(&p[i].thread, NULL, poster_thread, &p[i]);
+  }
+  for (received = 0; received < total; received++) {
+    mem_ptr_t m;
+    sys_arch_mbox_fetch(&mbox, &msg, 0);
+    m = (mem_ptr_t)msg;
+    i = (int)(m >> 24) - 1;
+    if ((i < 0) || (i >= num_posters) || ((long)(m & 0xffffff) != next[i])) {
+      errors++;
+    } else {
+      next[i]++;
+    }
+  }
+  ns = now_ns() - start;
+  for (i = 0; i < num_posters; i++) {
+    pthread_join(p[i].thread, NULL);
+  }
+  if (sys_arch_mbox_tryfetch(&mbox, &msg) != SYS_MBOX_EMPTY) {
+    errors++;
+  }
+  sys_mbox_free(&mbox);
+
+  printf("%8d %12ld %12.1f %12.2f %8ld\n", num_posters, total, ns / (double)total,
+         (double)total * 1e3 / ns, errors);
+  return errors != 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  long total = 4 * 1024 * 1024;
+  size_t i;
+  int errors = 0;
+
+  if (argc > 1) {
+    total = atol(argv[1]);
+  }
+  if (total > 0xffffff) {
+    /* sequence numbers have 24 bits */
+    total = 0xffffff;
+  }
+  sys_init();
+
+  printf("LWIP_UNIX_MBOX_LOCKFREE %d\n", LWIP_UNIX_MBOX_LOCKFREE);
+  printf("%8s %12s %12s %12s %8s\n", "posters", "messages", "ns/msg", "Mmsg/s", "errors");
+  for (i = 0; i < LWIP_ARRAYSIZE(posters); i++) {
+    errors += bench_run(posters[i], total);
+  }
+  return errors != 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Multi-threaded benchmark of memp_malloc()/memp_free() with 1, 2, 4 and 8
+ * threads allocating and freeing pbuf structs and PBUF_POOL buffers in
+ * bursts, like application threads using the socket API. Built without
+ * (memp_bench_cache0) and with (memp_bench_cache1) MEMP_THREAD_CACHE, using
+ * SYS_ARCH_PROTECT of the unix port (a global mutex).
+ * Also checks that no element is handed out twice and that the pool
+ * statistics are back to 0 when all threads have flushed their caches.
+ *
+ * Usage: memp_bench [alloc/free pairs per thread and pool, default 1M]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAX_THREADS 8
+#define BURST       8
+
+static const int threads[] = { 1, 2, 4, 8 };
+static const memp_t pools[] = { MEMP_PBUF, MEMP_PBUF_POOL };
+
+static long pairs_per_thread;
+
+struct bench_thread {
+  pthread_t thread;
+  u32_t id;
+  long errors;
+};
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void *
+bench_thread_fn(void *arg)
+{
+  struct bench_thread *t = (struct bench_thread *)arg;
+  u32_t *elem[BURST];
+  long n;
+  size_t p;
+  int i;
+
+  for (n = 0; n < pairs_per_thread; n += BURST) {
+    for (p = 0; p < LWIP_ARRAYSIZE(pools); p++) {
+      for (i = 0; i < BURST; i++) {
+        elem[i] = (u32_t *)memp_malloc(pools[p]);
+        if (elem[i] == NULL) {
+          t->errors++;
+          continue;
+        }
+        /* mark as ours: if another thread got it too, it overwrites this */
+        *elem[i] = t->id;
+      }
+      for (i = 0; i < BURST; i++) {
+        if (elem[i] != NULL) {
+          if (*elem[i] != t->id) {
+            t->errors++;
+          }
+          memp_free(pools[p], elem[i]);
+        }
+      }
+    }
+  }
+#if MEMP_THREAD_CACHE
+  memp_thread_cache_flush();
+#endif /* MEMP_THREAD_CACHE */
+  return NULL;
+}
+
+static long
+bench_run(int num_threads)
+{
+  static struct bench_thread t[MAX_THREADS];
+  long errors = 0;
+  double start, ns, ops;
+  size_t p;
+  int i;
+
+  start = now_ns();
+  for (i = 0; i < num_threads; i++) {
+    t[i].id = (u32_t)(i + 1) * 0x01010101UL;
+    t[i].errors = 0;
+    pthread_create(&t[i].thread, NULL, bench_thread_fn, &t[i]);
+  }
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(t[i].thread, NULL);
+    errors += t[i].errors;
+  }
+  ns = now_ns() - start;
+  for (p = 0; p < LWIP_ARRAYSIZE(pools); p++) {
+    if (MEMP_STATS_GET(used, pools[p]) != 0) {
+      printf("pool %d: %d elements still used\n", (int)pools[p], (int)MEMP_STATS_GET(used, pools[p]));
+      errors++;
+    }
+  }
+
+  ops = (double)pairs_per_thread * num_threads * LWIP_ARRAYSIZE(pools);
+  printf("%8d %14.0f %12.1f %12.2f %8ld\n", num_threads, ops, ns / ops, ops * 1e3 / ns, errors);
+  return errors;
+}
+
+int
+main(int argc, char **argv)
+{
+  size_t i;
+  long errors = 0;
+
+  pairs_per_thread = 1024 * 1024;
+  if (argc > 1) {
+    pairs_per_thread = atol(argv[1]);
+  }
+  sys_init();
+  stats_init();
+  memp_init();
+
+  printf("MEMP_THREAD_CACHE %d (size %d)\n", MEMP_THREAD_CACHE, MEMP_THREAD_CACHE_SIZE);
+  printf("%8s %14s %12s %12s %8s\n", "threads", "alloc+free", "ns/pair", "Mpairs/s", "errors");
+  for (i = 0; i < LWIP_ARRAYSIZE(threads); i++) {
+    errors += bench_run(threads[i]);
+  }
+  return errors != 0;
+}
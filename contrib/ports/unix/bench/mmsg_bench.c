@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Batched datagram socket calls: BATCH UDP datagrams are sent over the
+ * loopback netif and read back, with one lwip_sendto()/lwip_recvfrom() per
+ * datagram and with one lwip_sendmmsg()/lwip_recvmmsg() per batch.
+ *
+ * Usage: mmsg_bench [rounds, default 20000]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BATCH        32
+#define DGRAM_SIZE   64
+#define BENCH_PORT   5001
+
+static int rx, tx;
+static struct sockaddr_in addr;
+static u8_t bufs[BATCH][DGRAM_SIZE];
+static struct iovec iovs[BATCH];
+static struct mmsghdr msgs[BATCH];
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void
+fail(const char *what)
+{
+  printf("%s failed\n", what);
+  exit(1);
+}
+
+static void
+send_single(void)
+{
+  int i;
+  for (i = 0; i < BATCH; i++) {
+    if (lwip_sendto(tx, bufs[i], DGRAM_SIZE, 0, (struct sockaddr *)&addr, sizeof(addr)) != DGRAM_SIZE) {
+      fail("sendto");
+    }
+  }
+}
+
+static void
+recv_single(void)
+{
+  int i;
+  for (i = 0; i < BATCH; i++) {
+    if (lwip_recvfrom(rx, bufs[i], DGRAM_SIZE, 0, NULL, NULL) != DGRAM_SIZE) {
+      fail("recvfrom");
+    }
+  }
+}
+
+static void
+send_multi(void)
+{
+  int i;
+  for (i = 0; i < BATCH; i++) {
+    msgs[i].msg_hdr.msg_name = &addr;
+    msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+  }
+  if (lwip_sendmmsg(tx, msgs, BATCH, 0) != BATCH) {
+    fail("sendmmsg");
+  }
+}
+
+static void
+recv_multi(void)
+{
+  int i, n = 0;
+  for (i = 0; i < BATCH; i++) {
+    msgs[i].msg_hdr.msg_name = NULL;
+    msgs[i].msg_hdr.msg_namelen = 0;
+  }
+  /* blocks until the whole batch is there */
+  n = lwip_recvmmsg(rx, msgs, BATCH, 0, NULL);
+  if (n != BATCH) {
+    fail("recvmmsg");
+  }
+}
+
+static void
+bench_run(const char *name, int rounds, void (*send_fn)(void), void (*recv_fn)(void))
+{
+  double tx_ns = 0, rx_ns = 0, t0, t1, t2;
+  int i;
+
+  for (i = 0; i < rounds; i++) {
+    t0 = now_ns();
+    send_fn();
+    t1 = now_ns();
+    recv_fn();
+    t2 = now_ns();
+    tx_ns += t1 - t0;
+    rx_ns += t2 - t1;
+  }
+  printf("%-10s %8d %12.1f %12.1f\n", name, rounds,
+         tx_ns / ((double)rounds * BATCH), rx_ns / ((double)rounds * BATCH));
+}
+
+int
+main(int argc, char **argv)
+{
+  int rounds, i;
+
+  rounds = 20000;
+  if (argc > 1) {
+    rounds = atoi(argv[1]);
+  }
+
+  tcpip_init(NULL, NULL);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  addr.sin_port = lwip_htons(BENCH_PORT);
+  rx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  tx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  if ((rx < 0) || (tx < 0)) {
+    fail("socket");
+  }
+  if (lwip_bind(rx, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    fail("bind");
+  }
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < BATCH; i++) {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len = DGRAM_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  printf("UDP over loopback, batches of %d datagrams of %d bytes\n", BATCH, DGRAM_SIZE);
+  printf("%-10s %8s %12s %12s\n", "mode", "rounds", "send ns/dg", "recv ns/dg");
+  for (i = 0; i < 3; i++) {
+    bench_run("single", rounds, send_single, recv_single);
+    bench_run("mmsg", rounds, send_multi, recv_multi);
+  }
+  lwip_close(rx);
+  lwip_close(tx);
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Allocation of ephemeral ports for outbound TCP connections: opens up to
+ * 30000 connections (tcp_connect() with local port 0) and measures the time
+ * per tcp_connect() while the table fills, then closes and reopens random
+ * connections with the table full (connection churn, only the connects are
+ * timed). SYNs are dropped by
+ * the netif, so the connections stay in SYN_SENT. Every run checks that no
+ * local port is handed out twice.
+ * Built once per implementation: port_bench_list (LWIP_PORT_BITMAP 0,
+ * tcp_new_port() walks all pcbs) and port_bench_bitmap (LWIP_PORT_BITMAP 1).
+ *
+ * Usage: port_bench [reconnects with the table full, default 10000]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/init.h"
+#include "lwip/ip.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_PCBS  30000
+#define BENCH_STEP      1000
+
+static const u32_t counts[] = { 1000, 10000, 20000, BENCH_MAX_PCBS };
+
+static struct tcp_pcb *pcbs[BENCH_MAX_PCBS];
+static u8_t port_used[0x10000];
+static struct netif netif;
+static ip_addr_t remote_ip;
+static u32_t rnd_state = 0x12345678;
+
+u32_t
+sys_now(void)
+{
+  return 0;
+}
+
+/* LWIP_RAND() of the unix port, normally in sys_arch.c */
+unsigned int
+lwip_port_rand(void)
+{
+  rnd_state = rnd_state * 1103515245UL + 12345UL;
+  return rnd_state >> 8;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** the SYNs are lost on the way */
+static err_t
+bench_output(struct netif *nif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(nif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *nif)
+{
+  nif->output = bench_output;
+  nif->mtu = 1500;
+  nif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+bench_connect(u32_t i)
+{
+  err_t err;
+
+  pcbs[i] = tcp_new();
+  if (pcbs[i] == NULL) {
+    printf("tcp_new failed at %u\n", (unsigned)i);
+    exit(1);
+  }
+  err = tcp_connect(pcbs[i], &remote_ip, 80, NULL);
+  if (err != ERR_OK) {
+    printf("tcp_connect failed at %u: %d\n", (unsigned)i, (int)err);
+    exit(1);
+  }
+  if (port_used[pcbs[i]->local_port]) {
+    printf("local port %u handed out twice\n", (unsigned)pcbs[i]->local_port);
+    exit(1);
+  }
+  port_used[pcbs[i]->local_port] = 1;
+}
+
+static void
+bench_close(u32_t i)
+{
+  port_used[pcbs[i]->local_port] = 0;
+  tcp_abort(pcbs[i]);
+  pcbs[i] = NULL;
+}
+
+static void
+bench_run(u32_t num, u32_t reconnects)
+{
+  double start, t_fill, t_last = 0, t_churn = 0;
+  u32_t i;
+
+  start = now_ns();
+  for (i = 0; i < num; i++) {
+    if (i == num - BENCH_STEP) {
+      t_last = now_ns();
+    }
+    bench_connect(i);
+  }
+  t_fill = now_ns();
+  t_last = t_fill - t_last;
+  t_fill -= start;
+
+  /* only tcp_connect() is timed: removing an active pcb walks the list */
+  for (i = 0; i < reconnects; i++) {
+    u32_t idx = lwip_port_rand() % num;
+    bench_close(idx);
+    start = now_ns();
+    bench_connect(idx);
+    t_churn += now_ns() - start;
+  }
+
+  printf("%8u %12.1f %12.1f %12.1f\n", (unsigned)num, t_fill / num,
+         t_last / BENCH_STEP, t_churn / reconnects);
+
+  for (i = 0; i < num; i++) {
+    bench_close(i);
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  ip4_addr_t addr, mask;
+  u32_t reconnects = 10000;
+  size_t i;
+
+  if (argc > 1) {
+    reconnects = (u32_t)atoi(argv[1]);
+  }
+  lwip_init();
+
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  netif_add(&netif, &addr, &mask, IP4_ADDR_ANY4, NULL, bench_netif_init, ip_input);
+  netif_set_up(&netif);
+  netif_set_default(&netif);
+  IP_ADDR4(&remote_ip, 10, 0, 0, 2);
+
+  printf("LWIP_PORT_BITMAP %d, %u reconnects per run\n", LWIP_PORT_BITMAP, (unsigned)reconnects);
+  printf("%8s %12s %12s %12s\n", "pcbs", "fill ns", "last ns", "churn ns");
+  for (i = 0; i < LWIP_ARRAYSIZE(counts); i++) {
+    bench_run(counts[i], reconnects);
+  }
+  return 0;
+}
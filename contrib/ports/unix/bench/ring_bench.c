@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Echo server driving many TCP connections from one thread: NUM_CONNS
+ * clients (netconns, in the main thread) send a message each per round over
+ * the loopback netif and wait for their echoes. The server is a poll() loop
+ * with lwip_recv()/lwip_send() per message, or a netconn_ring with a RECV or
+ * SEND queued per connection (LWIP_NETCONN_RING). Only one of the servers
+ * runs per process: with both sets of connections open, whichever runs second
+ * is measured slower.
+ *
+ * Usage: ring_bench [rounds, default 2000] [sockets|ring, default ring]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/api.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_CONNS    64
+#define MSG_SIZE     64
+#define RING_ENTRIES 128
+#define SOCKETS_PORT 5001
+#define RING_PORT    5002
+
+static int rounds;
+/* API calls of the servers: socket calls or netconn_ring_submit/reap/wait */
+static volatile long server_calls;
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void
+sockets_server(void *arg)
+{
+  struct pollfd fds[NUM_CONNS + 1];
+  struct sockaddr_in addr;
+  u8_t buf[MSG_SIZE];
+  int nfds = 1, n, i, len;
+  LWIP_UNUSED_ARG(arg);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = lwip_htons(SOCKETS_PORT);
+  fds[0].fd = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  fds[0].events = POLLIN;
+  if ((lwip_bind(fds[0].fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+      (lwip_listen(fds[0].fd, NUM_CONNS) != 0)) {
+    printf("sockets server: listen failed\n");
+    exit(1);
+  }
+  for (;;) {
+    n = lwip_poll(fds, (nfds_t)nfds, -1);
+    server_calls++;
+    for (i = 0; (i < nfds) && (n > 0); i++) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      n--;
+      if (i == 0) {
+        fds[nfds].fd = lwip_accept(fds[0].fd, NULL, NULL);
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        nfds++;
+        server_calls++;
+        continue;
+      }
+      len = lwip_recv(fds[i].fd, buf, sizeof(buf), MSG_DONTWAIT);
+      server_calls++;
+      if (len > 0) {
+        lwip_send(fds[i].fd, buf, (size_t)len, 0);
+        server_calls++;
+      }
+    }
+  }
+}
+
+struct ring_conn {
+  struct netconn *conn;
+  u8_t buf[MSG_SIZE];
+};
+static struct ring_conn ring_conns[NUM_CONNS];
+
+static void
+ring_queue(struct netconn_ring *ring, u8_t opcode, struct netconn *conn, struct ring_conn *rc, size_t len)
+{
+  struct netconn_ring_sqe *sqe = netconn_ring_get_sqe(ring);
+  if (sqe == NULL) {
+    printf("ring server: ring full\n");
+    exit(1);
+  }
+  sqe->opcode = opcode;
+  sqe->conn = conn;
+  sqe->user_data = rc;
+  if (rc != NULL) {
+    sqe->buf = rc->buf;
+    sqe->len = len;
+  }
+}
+
+static void
+ring_server(void *arg)
+{
+  struct netconn_ring_cqe cqes[RING_ENTRIES];
+  struct netconn_ring *ring;
+  struct netconn *listener;
+  struct ring_conn *rc;
+  int accepted = 0;
+  u16_t n, i;
+  LWIP_UNUSED_ARG(arg);
+
+  ring = netconn_ring_new(RING_ENTRIES);
+  listener = netconn_new_with_callback(NETCONN_TCP, netconn_ring_callback);
+  if ((ring == NULL) || (listener == NULL) ||
+      (netconn_bind(listener, IP4_ADDR_ANY, RING_PORT) != ERR_OK) ||
+      (netconn_listen_with_backlog(listener, NUM_CONNS) != ERR_OK)) {
+    printf("ring server: listen failed\n");
+    exit(1);
+  }
+  ring_queue(ring, NETCONN_RING_ACCEPT, listener, NULL, 0);
+  netconn_ring_submit(ring);
+  for (;;) {
+    netconn_ring_wait(ring, 0);
+    n = netconn_ring_reap(ring, cqes, RING_ENTRIES);
+    server_calls += 2;
+    for (i = 0; i < n; i++) {
+      rc = (struct ring_conn *)cqes[i].user_data;
+      if (cqes[i].err != ERR_OK) {
+        printf("ring server: operation %d failed: %d\n", cqes[i].opcode, cqes[i].err);
+        exit(1);
+      }
+      switch (cqes[i].opcode) {
+        case NETCONN_RING_ACCEPT:
+          rc = &ring_conns[accepted++];
+          rc->conn = cqes[i].conn;
+          ring_queue(ring, NETCONN_RING_RECV, rc->conn, rc, MSG_SIZE);
+          if (accepted < NUM_CONNS) {
+            ring_queue(ring, NETCONN_RING_ACCEPT, listener, NULL, 0);
+          }
+          break;
+        case NETCONN_RING_RECV:
+          ring_queue(ring, NETCONN_RING_SEND, rc->conn, rc, cqes[i].len);
+          break;
+        case NETCONN_RING_SEND:
+          ring_queue(ring, NETCONN_RING_RECV, rc->conn, rc, MSG_SIZE);
+          break;
+        default:
+          break;
+      }
+    }
+    netconn_ring_submit(ring);
+    server_calls++;
+  }
+}
+
+/* the clients are netconns without callback: unlike sockets, their events
+   do not make event_callback() check the poll() of the sockets server */
+static void
+connect_clients(struct netconn **conns, u16_t port)
+{
+  ip_addr_t addr;
+  int i;
+
+  ip_addr_set_loopback(0, &addr);
+  for (i = 0; i < NUM_CONNS; i++) {
+    conns[i] = netconn_new(NETCONN_TCP);
+    if ((conns[i] == NULL) || (netconn_connect(conns[i], &addr, port) != ERR_OK)) {
+      printf("connect to port %d failed\n", port);
+      exit(1);
+    }
+  }
+}
+
+static void
+bench_run(const char *name, struct netconn **conns)
+{
+  u8_t buf[MSG_SIZE];
+  struct pbuf *p;
+  double start, ns;
+  long calls;
+  int i, j, got, len;
+
+  memset(buf, 0x55, sizeof(buf));
+
+  calls = server_calls;
+  start = now_ns();
+  for (i = 0; i < rounds; i++) {
+    for (j = 0; j < NUM_CONNS; j++) {
+      if (netconn_write(conns[j], buf, sizeof(buf), NETCONN_COPY) != ERR_OK) {
+        printf("%s: send failed\n", name);
+        exit(1);
+      }
+    }
+    for (j = 0; j < NUM_CONNS; j++) {
+      for (got = 0; got < MSG_SIZE; got += len) {
+        if (netconn_recv_tcp_pbuf(conns[j], &p) != ERR_OK) {
+          printf("%s: recv failed\n", name);
+          exit(1);
+        }
+        len = p->tot_len;
+        pbuf_free(p);
+      }
+    }
+  }
+  ns = now_ns() - start;
+  calls = server_calls - calls;
+
+  printf("%-8s %8d %10.2f %10.2f\n", name, rounds, ns / ((double)rounds * NUM_CONNS),
+         (double)calls / ((double)rounds * NUM_CONNS));
+}
+
+int
+main(int argc, char **argv)
+{
+  static struct netconn *clients[NUM_CONNS];
+  const char *mode = "ring";
+  int i;
+
+  rounds = 2000;
+  if (argc > 1) {
+    rounds = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    mode = argv[2];
+  }
+
+  tcpip_init(NULL, NULL);
+  if (!strcmp(mode, "sockets")) {
+    sys_thread_new("sockets", sockets_server, NULL, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+    sys_msleep(100);
+    connect_clients(clients, SOCKETS_PORT);
+  } else if (!strcmp(mode, "ring")) {
+    sys_thread_new("ring", ring_server, NULL, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+    sys_msleep(100);
+    connect_clients(clients, RING_PORT);
+  } else {
+    printf("unknown server %s\n", mode);
+    return 1;
+  }
+
+  printf("TCP echo over loopback, %d connections, %d byte messages, one server thread\n",
+         NUM_CONNS, MSG_SIZE);
+  printf("%-8s %8s %10s %10s\n", "server", "rounds", "ns/echo", "calls/echo");
+  for (i = 0; i < 3; i++) {
+    bench_run(mode, clients);
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Stress benchmark of the timeouts (sys_timeout, sys_untimeout,
+ * sys_check_timeouts and sys_timeouts_sleeptime) with many timeouts
+ * active at once, e.g. one retransmission timer per TCP connection.
+ * Built once per backend: timers_bench_list (LWIP_TIMERS_WHEEL 0) and
+ * timers_bench_wheel (LWIP_TIMERS_WHEEL 1).
+ *
+ * Usage: timers_bench [simulated seconds per run, default 10]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/init.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* timeouts are spread over [1, MAX_DELAY] ms, like TCP retransmission timers */
+#define MAX_DELAY 60000
+
+static const u32_t counts[] = { 100, 1000, 5000, 10000, 20000 };
+
+#define MAX_TIMEOUTS 20000
+
+static u32_t bench_now;
+static u32_t rnd_state = 0x12345678;
+static u32_t fired;
+/* the timeouts' args: one per timeout so that sys_untimeout() finds it */
+static u8_t args[MAX_TIMEOUTS];
+
+u32_t
+sys_now(void)
+{
+  return bench_now;
+}
+
+static u32_t
+rnd(void)
+{
+  rnd_state = rnd_state * 1103515245UL + 12345UL;
+  return rnd_state >> 8;
+}
+
+/* LWIP_RAND() of the unix port, normally in sys_arch.c */
+unsigned int
+lwip_port_rand(void)
+{
+  return (unsigned int)rnd();
+}
+
+static u32_t
+rnd_delay(void)
+{
+  return 1 + rnd() % MAX_DELAY;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** re-arms itself like a timer that keeps expiring */
+static void
+bench_handler(void *arg)
+{
+  fired++;
+  sys_timeout(rnd_delay(), bench_handler, arg);
+}
+
+static void
+bench_run(u32_t num, u32_t seconds)
+{
+  u32_t i, ms, sleeptime;
+  double start, t_insert, t_rearm, t_run;
+
+  /* insert */
+  start = now_ns();
+  for (i = 0; i < num; i++) {
+    sys_timeout(rnd_delay(), bench_handler, &args[i]);
+  }
+  t_insert = now_ns() - start;
+
+  /* cancel and restart a random timeout, e.g. on every received ACK */
+  start = now_ns();
+  for (i = 0; i < num; i++) {
+    u8_t *arg = &args[rnd() % num];
+    sys_untimeout(bench_handler, arg);
+    sys_timeout(rnd_delay(), bench_handler, arg);
+  }
+  t_rearm = now_ns() - start;
+
+  /* let time pass in 1ms ticks, as a main loop would */
+  fired = 0;
+  start = now_ns();
+  for (ms = 0; ms < seconds * 1000; ms++) {
+    bench_now++;
+    sleeptime = sys_timeouts_sleeptime();
+    if (sleeptime == 0) {
+      sys_check_timeouts();
+    }
+  }
+  t_run = now_ns() - start;
+
+  printf("%8u %12.1f %12.1f %12.1f %12.1f %10u\n", (unsigned)num,
+         t_insert / num, t_rearm / num, t_run / (seconds * 1000.0),
+         fired ? t_run / fired : 0.0, (unsigned)fired);
+
+  for (i = 0; i < num; i++) {
+    sys_untimeout(bench_handler, &args[i]);
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  u32_t seconds = 10;
+  size_t i;
+
+  if (argc > 1) {
+    seconds = (u32_t)atoi(argv[1]);
+  }
+  bench_now = 0xffffffffUL - 5000; /* include a sys_now() wraparound */
+  lwip_init();
+
+  printf("LWIP_TIMERS_WHEEL %d, %u simulated seconds per run\n", LWIP_TIMERS_WHEEL, (unsigned)seconds);
+  printf("%8s %12s %12s %12s %12s %10s\n", "timeouts", "insert ns", "rearm ns", "tick ns", "ns/expiry", "expired");
+  for (i = 0; i < LWIP_ARRAYSIZE(counts); i++) {
+    bench_run(counts[i], seconds);
+  }
+  return 0;
+}
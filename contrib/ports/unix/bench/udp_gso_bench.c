@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Trains of TRAIN datagrams of SEG_SIZE bytes to one destination, sent with
+ * one udp_sendto() per datagram and with one udp_sendto() of the whole train
+ * on a pcb with udp_set_gso_size(). The netif is an ethernet netif with a
+ * static ARP entry for the destination, its driver copies every frame out.
+ *
+ * Usage: udp_gso_bench [trains per run, default 20000]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/init.h"
+#include "lwip/ip.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/udp.h"
+#include "lwip/etharp.h"
+#include "netif/ethernet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SEG_SIZE   1400
+#define TRAIN      46
+
+static u8_t tx_buf[SEG_SIZE * TRAIN];
+static u8_t frame[1514];
+static struct netif netif;
+static u32_t frames;
+static u32_t rnd_state = 0x12345678;
+
+u32_t
+sys_now(void)
+{
+  return 0;
+}
+
+/* LWIP_RAND() of the unix port, normally in sys_arch.c */
+unsigned int
+lwip_port_rand(void)
+{
+  rnd_state = rnd_state * 1103515245UL + 12345UL;
+  return rnd_state >> 8;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** the driver: copy the frame out */
+static err_t
+bench_linkoutput(struct netif *n, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(n);
+  LWIP_ASSERT("frame too long", p->tot_len <= sizeof(frame));
+  pbuf_copy_partial(p, frame, p->tot_len, 0);
+  frames++;
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *n)
+{
+  n->output = etharp_output;
+  n->linkoutput = bench_linkoutput;
+  n->mtu = 1500;
+  n->hwaddr_len = ETH_HWADDR_LEN;
+  memset(n->hwaddr, 0x02, ETH_HWADDR_LEN);
+  n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static err_t
+send_train(struct udp_pcb *pcb, const ip_addr_t *dst, int gso)
+{
+  struct pbuf *p;
+  err_t err = ERR_OK;
+  int i;
+
+  if (gso) {
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      return ERR_MEM;
+    }
+    p->payload = tx_buf;
+    p->len = p->tot_len = sizeof(tx_buf);
+    err = udp_sendto(pcb, p, dst, 5001);
+    pbuf_free(p);
+    return err;
+  }
+  for (i = 0; (i < TRAIN) && (err == ERR_OK); i++) {
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      return ERR_MEM;
+    }
+    p->payload = &tx_buf[i * SEG_SIZE];
+    p->len = p->tot_len = SEG_SIZE;
+    err = udp_sendto(pcb, p, dst, 5001);
+    pbuf_free(p);
+  }
+  return err;
+}
+
+static void
+bench_run(struct udp_pcb *pcb, const ip_addr_t *dst, int gso, int trains)
+{
+  double start, ns;
+  int i;
+
+  udp_set_gso_size(pcb, gso ? SEG_SIZE : 0);
+  frames = 0;
+  start = now_ns();
+  for (i = 0; i < trains; i++) {
+    if (send_train(pcb, dst, gso) != ERR_OK) {
+      printf("send failed\n");
+      exit(1);
+    }
+  }
+  ns = now_ns() - start;
+  if (frames != (u32_t)trains * TRAIN) {
+    printf("%u frames sent, expected %u\n", (unsigned)frames, (unsigned)(trains * TRAIN));
+    exit(1);
+  }
+  printf("%-8s %8d %12.1f\n", gso ? "gso" : "sendto", trains, ns / ((double)trains * TRAIN));
+}
+
+int
+main(int argc, char **argv)
+{
+  ip4_addr_t addr, mask;
+  ip_addr_t dst;
+  struct eth_addr dst_mac = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x02}};
+  struct udp_pcb *pcb;
+  int trains = 20000, i;
+
+  if (argc > 1) {
+    trains = atoi(argv[1]);
+  }
+  lwip_init();
+
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&addr, 10, 0, 1, 1);
+  netif_add(&netif, &addr, &mask, IP4_ADDR_ANY4, NULL, bench_netif_init, ethernet_input);
+  netif_set_up(&netif);
+  IP_ADDR4(&dst, 10, 0, 1, 2);
+  etharp_add_static_entry(ip_2_ip4(&dst), &dst_mac);
+
+  pcb = udp_new();
+  if ((pcb == NULL) || (udp_bind(pcb, IP4_ADDR_ANY, 5000) != ERR_OK)) {
+    printf("udp_new/udp_bind failed\n");
+    return 1;
+  }
+
+  printf("UDP, trains of %d datagrams of %d bytes\n", TRAIN, SEG_SIZE);
+  printf("%-8s %8s %12s\n", "mode", "trains", "ns/dgram");
+  for (i = 0; i < 3; i++) {
+    bench_run(pcb, &dst, 0, trains);
+    bench_run(pcb, &dst, 1, trains);
+  }
+  udp_remove(pcb);
+  return 0;
+}
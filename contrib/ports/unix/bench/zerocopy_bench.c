@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+
+/*
+ * Throughput of TCP over the loopback netif with the socket API: send()
+ * copying the data into the stack versus send(MSG_ZEROCOPY) referencing it
+ * until it is acknowledged. The zero-copy sender cycles through a set of
+ * buffers and only reuses a buffer after its send was reported completed
+ * (recvmsg(MSG_ERRQUEUE)). The receiver uses netconn_recv_tcp_pbuf() to not
+ * copy on its side. The data is checked for corruption at the receiver.
+ * Time is measured until the receiver has got all data.
+ *
+ * Usage: zerocopy_bench [megabytes per run, default 256]
+ */
+
+#include "lwip/opt.h"
+#include "lwip/api.h"
+#include "lwip/pbuf.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_PORT   5001
+#define CHUNK_SIZE   (16 * 1024)
+/* enough buffers to cover more than TCP_SND_BUF: reusing the oldest one
+   should (almost) never have to wait */
+#define NUM_BUFFERS  ((2 * TCP_SND_BUF + CHUNK_SIZE - 1) / CHUNK_SIZE + 1)
+
+static u8_t buffers[NUM_BUFFERS][CHUNK_SIZE];
+static u32_t total_bytes;
+/* signalled by the receiver when it has got all data and when the connection is closed */
+static sys_sem_t sem;
+static long rx_errors;
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* byte i of the stream: buffers are filled so that the stream repeats */
+static u8_t
+stream_byte(u32_t i)
+{
+  return (u8_t)((i % CHUNK_SIZE) + (i / CHUNK_SIZE) % NUM_BUFFERS);
+}
+
+static void
+receiver_thread(void *arg)
+{
+  struct netconn *listener = (struct netconn *)arg;
+  struct netconn *conn;
+  struct pbuf *p, *q;
+  u32_t received;
+  u16_t i;
+
+  for (;;) {
+    if (netconn_accept(listener, &conn) != ERR_OK) {
+      return;
+    }
+    received = 0;
+    while (netconn_recv_tcp_pbuf(conn, &p) == ERR_OK) {
+      for (q = p; q != NULL; q = q->next) {
+        /* spot check to keep the receiver cheap */
+        for (i = 0; i < q->len; i += 509) {
+          if (((u8_t *)q->payload)[i] != stream_byte(received + i)) {
+            rx_errors++;
+          }
+        }
+        received += q->len;
+      }
+      pbuf_free(p);
+      if (received == total_bytes) {
+        sys_sem_signal(&sem);
+      }
+    }
+    netconn_delete(conn);
+    if (received != total_bytes) {
+      printf("received %u of %u bytes\n", (unsigned)received, (unsigned)total_bytes);
+      rx_errors++;
+    }
+    sys_sem_signal(&sem);
+  }
+}
+
+/** wait until send number 'id' is completed */
+static int
+wait_completed(int s, u32_t id, u32_t *completed)
+{
+  struct msghdr msg;
+  struct sock_extended_err *serr;
+  u8_t cmsg_buf[CMSG_SPACE(sizeof(struct sock_extended_err))];
+  int waits = 0;
+
+  while ((s32_t)(id - *completed) >= 0) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+    if (lwip_recvmsg(s, &msg, MSG_ERRQUEUE) == 0) {
+      serr = (struct sock_extended_err *)CMSG_DATA(CMSG_FIRSTHDR(&msg));
+      *completed = serr->ee_data + 1;
+    } else {
+      waits++;
+      sys_msleep(1);
+    }
+  }
+  return waits;
+}
+
+static void
+bench_run(const char *name, int zerocopy)
+{
+  struct sockaddr_in addr;
+  u32_t sent = 0, id = 0, completed = 0, len;
+  long waits = 0;
+  int s, opt = 1;
+  u8_t *buf;
+  double start, ns;
+
+  s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = PP_HTONS(BENCH_PORT);
+  addr.sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  if (lwip_connect(s, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    printf("%s: connect failed\n", name);
+    exit(1);
+  }
+  if (zerocopy) {
+    lwip_setsockopt(s, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt));
+  }
+
+  start = now_ns();
+  while (sent < total_bytes) {
+    buf = buffers[id % NUM_BUFFERS];
+    if (zerocopy && (id >= NUM_BUFFERS)) {
+      waits += wait_completed(s, id - NUM_BUFFERS, &completed);
+    }
+    len = LWIP_MIN(CHUNK_SIZE, total_bytes - sent);
+    if (lwip_send(s, buf, len, zerocopy ? MSG_ZEROCOPY : 0) != (ssize_t)len) {
+      printf("%s: send failed\n", name);
+      exit(1);
+    }
+    sent += len;
+    id++;
+  }
+  sys_arch_sem_wait(&sem, 0);
+  ns = now_ns() - start;
+  if (zerocopy) {
+    /* not timed: the final ACK may be delayed */
+    wait_completed(s, id - 1, &completed);
+  }
+  lwip_close(s);
+  sys_arch_sem_wait(&sem, 0);
+
+  printf("%-10s %10u %10.1f %8ld\n", name, (unsigned)total_bytes, (double)total_bytes * 1e3 / ns, waits);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct netconn *listener;
+  int i, j;
+
+  total_bytes = 256 * 1024 * 1024;
+  if (argc > 1) {
+    total_bytes = (u32_t)atoi(argv[1]) * 1024 * 1024;
+  }
+  for (i = 0; i < NUM_BUFFERS; i++) {
+    for (j = 0; j < CHUNK_SIZE; j++) {
+      buffers[i][j] = stream_byte((u32_t)(i * CHUNK_SIZE + j));
+    }
+  }
+  /* every send must be a full chunk for stream_byte() to match */
+  total_bytes -= total_bytes % CHUNK_SIZE;
+
+  sys_sem_new(&sem, 0);
+  tcpip_init(NULL, NULL);
+
+  listener = netconn_new(NETCONN_TCP);
+  netconn_bind(listener, IP4_ADDR_ANY, BENCH_PORT);
+  netconn_listen(listener);
+  sys_thread_new("receiver", receiver_thread, listener, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+
+  printf("TCP over loopback, %d byte sends, %d buffers for MSG_ZEROCOPY\n", CHUNK_SIZE, NUM_BUFFERS);
+  printf("%-10s %10s %10s %8s\n", "mode", "bytes", "MB/s", "waits");
+  for (i = 0; i < 3; i++) {
+    bench_run("copy", 0);
+    bench_run("zerocopy", 1);
+  }
+  if (rx_errors) {
+    printf("%ld receive errors\n", rx_errors);
+  }
+  return rx_errors != 0;
+}
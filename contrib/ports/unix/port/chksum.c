@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Checksum routines for the unix port, to be used as LWIP_CHKSUM and
+ * LWIP_CHKSUM_COPY (define LWIP_UNIX_CHKSUM to 1 in lwipopts.h).
+ *
+ * The Internet checksum does not depend on byte order or on the word size it
+ * is computed with (RFC 1071), so the data is summed up in 32-bit words into
+ * 64-bit accumulators (which cannot overflow for any length we get passed)
+ * and folded down to 16 bits at the end. Since all words are at even offsets
+ * from the start of the buffer, no special treatment of odd start addresses
+ * is needed.
+ *
+ * On x86-64, SSE2 and AVX2 versions are provided as well. The fastest one the
+ * CPU supports is selected by lwip_unix_chksum_init() (called from sys_init())
+ * or on first use.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "arch/chksum.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LWIP_UNIX_CHKSUM_X86_64 1
+#include <immintrin.h>
+#else
+#define LWIP_UNIX_CHKSUM_X86_64 0
+#endif
+
+/** Fold a 64-bit sum of 32-bit words down to the 16-bit checksum */
+static u16_t
+chksum_fold(u64_t sum)
+{
+  u32_t acc;
+
+  sum = (u32_t)sum + (sum >> 32);
+  sum = (u32_t)sum + (sum >> 32);
+  acc = (u32_t)sum;
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)acc;
+}
+
+/** Add up 'len' bytes at 'p' to 'sum', 8 bytes at a time */
+static u64_t
+chksum_add(u64_t sum, const u8_t *p, int len)
+{
+  u64_t sum2 = 0;
+  u64_t w, w2;
+  u32_t l;
+  u16_t s, t;
+
+  while (len >= 16) {
+    memcpy(&w, p, sizeof(w));
+    memcpy(&w2, p + 8, sizeof(w2));
+    sum += (u32_t)w + (w >> 32);
+    sum2 += (u32_t)w2 + (w2 >> 32);
+    p += 16;
+    len -= 16;
+  }
+  sum += sum2;
+  if (len >= 8) {
+    memcpy(&w, p, sizeof(w));
+    sum += (u32_t)w + (w >> 32);
+    p += 8;
+    len -= 8;
+  }
+  if (len >= 4) {
+    memcpy(&l, p, sizeof(l));
+    sum += l;
+    p += 4;
+    len -= 4;
+  }
+  if (len >= 2) {
+    memcpy(&s, p, sizeof(s));
+    sum += s;
+    p += 2;
+    len -= 2;
+  }
+  if (len > 0) {
+    /* dangling tail byte is at an even offset */
+    t = 0;
+    ((u8_t *)&t)[0] = *p;
+    sum += t;
+  }
+  return sum;
+}
+
+static int
+chksum_always_supported(void)
+{
+  return 1;
+}
+
+static u16_t
+chksum_word(const void *dataptr, int len)
+{
+  if (len <= 0) {
+    return 0;
+  }
+  return chksum_fold(chksum_add(0, (const u8_t *)dataptr, len));
+}
+
+static u16_t
+chksum_copy_word(void *dst, const void *src, u16_t len)
+{
+  u8_t *d = (u8_t *)dst;
+  const u8_t *s = (const u8_t *)src;
+  int left = len;
+  u64_t sum = 0, w;
+
+  while (left >= 8) {
+    memcpy(&w, s, sizeof(w));
+    memcpy(d, &w, sizeof(w));
+    sum += (u32_t)w + (w >> 32);
+    s += 8;
+    d += 8;
+    left -= 8;
+  }
+  memcpy(d, s, (size_t)left);
+  return chksum_fold(chksum_add(sum, d, left));
+}
+
+#if LWIP_UNIX_CHKSUM_X86_64
+/* SSE2 is part of the x86-64 base instruction set */
+static u16_t
+chksum_sse2(const void *dataptr, int len)
+{
+  const u8_t *p = (const u8_t *)dataptr;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero, acc1 = zero, a, b;
+
+  if (len <= 0) {
+    return 0;
+  }
+  while (len >= 32) {
+    a = _mm_loadu_si128((const __m128i *)(const void *)p);
+    b = _mm_loadu_si128((const __m128i *)(const void *)(p + 16));
+    /* zero-extend the 32-bit words to 64 bits and add them up */
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(a, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(a, zero));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(b, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(b, zero));
+    p += 32;
+    len -= 32;
+  }
+  acc0 = _mm_add_epi64(acc0, acc1);
+  acc0 = _mm_add_epi64(acc0, _mm_unpackhi_epi64(acc0, acc0));
+  return chksum_fold(chksum_add((u64_t)_mm_cvtsi128_si64(acc0), p, len));
+}
+
+static u16_t
+chksum_copy_sse2(void *dst, const void *src, u16_t len)
+{
+  u8_t *d = (u8_t *)dst;
+  const u8_t *s = (const u8_t *)src;
+  int left = len;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero, acc1 = zero, a;
+
+  while (left >= 16) {
+    a = _mm_loadu_si128((const __m128i *)(const void *)s);
+    _mm_storeu_si128((__m128i *)(void *)d, a);
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(a, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(a, zero));
+    s += 16;
+    d += 16;
+    left -= 16;
+  }
+  acc0 = _mm_add_epi64(acc0, acc1);
+  acc0 = _mm_add_epi64(acc0, _mm_unpackhi_epi64(acc0, acc0));
+  memcpy(d, s, (size_t)left);
+  return chksum_fold(chksum_add((u64_t)_mm_cvtsi128_si64(acc0), d, left));
+}
+
+static int
+chksum_avx2_supported(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2"))) static u16_t
+chksum_avx2(const void *dataptr, int len)
+{
+  const u8_t *p = (const u8_t *)dataptr;
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero, acc1 = zero, a, b;
+  __m128i acc;
+  u64_t sum;
+
+  if (len < 128) {
+    /* not worth waking up the upper halves of the ymm registers */
+    return chksum_sse2(dataptr, len);
+  }
+  while (len >= 64) {
+    a = _mm256_loadu_si256((const __m256i *)(const void *)p);
+    b = _mm256_loadu_si256((const __m256i *)(const void *)(p + 32));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(b, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(b, zero));
+    p += 64;
+    len -= 64;
+  }
+  acc0 = _mm256_add_epi64(acc0, acc1);
+  acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  sum = (u64_t)_mm_cvtsi128_si64(acc);
+  /* avoid AVX-SSE transition penalties in the (non-VEX) tail code */
+  _mm256_zeroupper();
+  return chksum_fold(chksum_add(sum, p, len));
+}
+
+__attribute__((target("avx2"))) static u16_t
+chksum_copy_avx2(void *dst, const void *src, u16_t len)
+{
+  u8_t *d = (u8_t *)dst;
+  const u8_t *s = (const u8_t *)src;
+  int left = len;
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero, acc1 = zero, a;
+  __m128i acc;
+  u64_t sum;
+
+  if (len < 128) {
+    return chksum_copy_sse2(dst, src, len);
+  }
+  while (left >= 32) {
+    a = _mm256_loadu_si256((const __m256i *)(const void *)s);
+    _mm256_storeu_si256((__m256i *)(void *)d, a);
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+    s += 32;
+    d += 32;
+    left -= 32;
+  }
+  acc0 = _mm256_add_epi64(acc0, acc1);
+  acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  sum = (u64_t)_mm_cvtsi128_si64(acc);
+  _mm256_zeroupper();
+  memcpy(d, s, (size_t)left);
+  return chksum_fold(chksum_add(sum, d, left));
+}
+#endif /* LWIP_UNIX_CHKSUM_X86_64 */
+
+const struct lwip_unix_chksum_impl lwip_unix_chksum_impls[] = {
+#if LWIP_UNIX_CHKSUM_X86_64
+  { "avx2", chksum_avx2_supported, chksum_avx2, chksum_copy_avx2 },
+  { "sse2", chksum_always_supported, chksum_sse2, chksum_copy_sse2 },
+#endif /* LWIP_UNIX_CHKSUM_X86_64 */
+  { "word64", chksum_always_supported, chksum_word, chksum_copy_word },
+  { NULL, NULL, NULL, NULL }
+};
+
+static const struct lwip_unix_chksum_impl *chksum_impl;
+
+void
+lwip_unix_chksum_init(void)
+{
+  const struct lwip_unix_chksum_impl *impl;
+
+  for (impl = lwip_unix_chksum_impls; impl->name != NULL; impl++) {
+    if (impl->supported()) {
+      break;
+    }
+  }
+  LWIP_ASSERT("no checksum implementation", impl->name != NULL);
+  chksum_impl = impl;
+}
+
+const char *
+lwip_unix_chksum_name(void)
+{
+  if (chksum_impl == NULL) {
+    lwip_unix_chksum_init();
+  }
+  return chksum_impl->name;
+}
+
+u16_t
+lwip_unix_chksum(const void *dataptr, int len)
+{
+  if (chksum_impl == NULL) {
+    lwip_unix_chksum_init();
+  }
+  return chksum_impl->chksum(dataptr, len);
+}
+
+u16_t
+lwip_unix_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  if (chksum_impl == NULL) {
+    lwip_unix_chksum_init();
+  }
+  return chksum_impl->chksum_copy(dst, src, len);
+}
@@ -65,6 +65,16 @@ extern "C" {
 extern unsigned int lwip_port_rand(void);
 #define LWIP_RAND() (lwip_port_rand())
 
+/* Checksum routines of this port (port/chksum.c): word-at-a-time and
+   SSE2/AVX2 versions, picked at runtime by CPU features.
+   Enable them by defining LWIP_UNIX_CHKSUM to 1 in lwipopts.h */
+extern unsigned short lwip_unix_chksum(const void *dataptr, int len);
+extern unsigned short lwip_unix_chksum_copy(void *dst, const void *src, unsigned short len);
+#if defined(LWIP_UNIX_CHKSUM) && LWIP_UNIX_CHKSUM
+#define LWIP_CHKSUM lwip_unix_chksum
+#define LWIP_CHKSUM_COPY(dst, src, len) lwip_unix_chksum_copy(dst, src, len)
+#endif
+
 /* different handling for unit test, normally not needed */
 #ifdef LWIP_NOASSERT_ON_ERROR
 #define LWIP_ERROR(message, expression, handler) do { if (!(expression)) { \
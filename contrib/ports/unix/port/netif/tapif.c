@@ -41,6 +41,7 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
+#include <errno.h>
 
 #include "lwip/opt.h"
 
@@ -53,6 +54,8 @@
 #include "lwip/pbuf.h"
 #include "lwip/sys.h"
 #include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "lwip/tcp.h"
 #include "netif/etharp.h"
 #include "lwip/ethip6.h"
 
@@ -98,6 +101,17 @@
 #define TAPIF_DEBUG LWIP_DBG_OFF
 #endif
 
+#if !NO_SYS && LWIP_TCPIP_INPUT_BATCH
+/* tapif_thread reads up to this many frames per wakeup and passes them to
+   tcpip_thread with tcpip_input_batch() */
+#ifndef TAPIF_RX_BATCH
+#define TAPIF_RX_BATCH TCPIP_INPUT_BATCH_SIZE
+#endif
+#define TAPIF_USE_RX_BATCH 1
+#else
+#define TAPIF_USE_RX_BATCH 0
+#endif
+
 struct tapif {
   /* Add whatever per-interface state that is needed here. */
   int fd;
@@ -105,6 +119,9 @@ struct tapif {
 
 /* Forward declarations. */
 static void tapif_input(struct netif *netif);
+#if TAPIF_USE_RX_BATCH
+static void tapif_input_batch(struct netif *netif);
+#endif /* TAPIF_USE_RX_BATCH */
 #if !NO_SYS
 static void tapif_thread(void *arg);
 #endif /* !NO_SYS */
@@ -135,6 +152,14 @@ low_level_init(struct netif *netif)
 
   /* device capabilities */
   netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP;
+#if LWIP_TCP_GSO
+  /* TCP super-segments are cut by tapif_gso_output(), set TAPIF_GSO=0 in
+     the environment to compare against sending segment by segment */
+  if ((getenv("TAPIF_GSO") == NULL) || (atoi(getenv("TAPIF_GSO")) != 0)) {
+    netif->flags |= NETIF_FLAG_GSO;
+    netif->gso_max_size = 0xffff;
+  }
+#endif /* LWIP_TCP_GSO */
 
   tapif->fd = open(DEVTAP, O_RDWR);
   LWIP_DEBUGF(TAPIF_DEBUG, ("tapif_init: fd %d\n", tapif->fd));
@@ -167,6 +192,14 @@ low_level_init(struct netif *netif)
   }
 #endif /* LWIP_UNIX_LINUX */
 
+#if TAPIF_USE_RX_BATCH
+  /* tapif_thread waits in select() and then reads until no frame is left */
+  if (fcntl(tapif->fd, F_SETFL, fcntl(tapif->fd, F_GETFL) | O_NONBLOCK) < 0) {
+    perror("tapif_init: fcntl O_NONBLOCK");
+    exit(1);
+  }
+#endif /* TAPIF_USE_RX_BATCH */
+
   netif_set_link_up(netif);
 
   if (preconfigured_tapif == NULL) {
@@ -250,16 +283,37 @@ low_level_output(struct netif *netif, struct pbuf *p)
   }
 }
 /*-----------------------------------------------------------------------------------*/
+#if LWIP_TCP_GSO
+/*
+ * tapif_gso_output():
+ *
+ * Software GSO stage in front of low_level_output(): TCP super-segments
+ * are cut into frames that fit the MTU, everything else is passed on.
+ *
+ */
+/*-----------------------------------------------------------------------------------*/
+static err_t
+tapif_gso_output(struct netif *netif, struct pbuf *p)
+{
+  if (pbuf_is_gso(p)) {
+    return tcp_gso_segment(netif, p, SIZEOF_ETH_HDR, low_level_output);
+  }
+  return low_level_output(netif, p);
+}
+/*-----------------------------------------------------------------------------------*/
+#endif /* LWIP_TCP_GSO */
 /*
  * low_level_input():
  *
  * Should allocate a pbuf and transfer the bytes of the incoming
  * packet from the interface into the pbuf.
+ * If 'empty' is not NULL, it is set to 1 if there was no packet to read
+ * (only happens with a non-blocking fd), 0 otherwise.
  *
  */
 /*-----------------------------------------------------------------------------------*/
 static struct pbuf *
-low_level_input(struct netif *netif)
+low_level_input(struct netif *netif, int *empty)
 {
   struct pbuf *p;
   u16_t len;
@@ -270,6 +324,12 @@ low_level_input(struct netif *netif)
   /* Obtain the size of the packet and put it into the "len"
      variable. */
   readlen = read(tapif->fd, buf, sizeof(buf));
+  if (empty != NULL) {
+    *empty = (readlen < 0) && (errno == EAGAIN);
+    if (*empty) {
+      return NULL;
+    }
+  }
   if (readlen < 0) {
     perror("read returned -1");
     exit(1);
@@ -313,7 +373,7 @@ low_level_input(struct netif *netif)
 static void
 tapif_input(struct netif *netif)
 {
-  struct pbuf *p = low_level_input(netif);
+  struct pbuf *p = low_level_input(netif, NULL);
 
   if (p == NULL) {
 #if LINK_STATS
@@ -328,6 +388,62 @@ tapif_input(struct netif *netif)
     pbuf_free(p);
   }
 }
+
+#if TAPIF_USE_RX_BATCH
+/*-----------------------------------------------------------------------------------*/
+/*
+ * tapif_input_batch():
+ *
+ * Like tapif_input(), but reads all frames that are ready (up to
+ * TAPIF_RX_BATCH) and passes them on together.
+ *
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+tapif_input_batch(struct netif *netif)
+{
+  struct pbuf *pkts[TAPIF_RX_BATCH];
+  struct pbuf *p;
+  u16_t num = 0, i;
+  int empty;
+
+  while (num < TAPIF_RX_BATCH) {
+    p = low_level_input(netif, &empty);
+    if (empty) {
+      break;
+    }
+    if (p == NULL) {
+#if LINK_STATS
+      LINK_STATS_INC(link.recv);
+#endif /* LINK_STATS */
+      LWIP_DEBUGF(TAPIF_DEBUG, ("tapif_input_batch: low_level_input returned NULL\n"));
+      continue;
+    }
+    pkts[num++] = p;
+  }
+  if (num == 0) {
+    return;
+  }
+
+  if (netif->input == tcpip_input) {
+    if (tcpip_input_batch(pkts, num, netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input_batch: tcpip_input_batch error\n"));
+      for (i = 0; i < num; i++) {
+        if (pkts[i] != NULL) {
+          pbuf_free(pkts[i]);
+        }
+      }
+    }
+  } else {
+    for (i = 0; i < num; i++) {
+      if (netif->input(pkts[i], netif) != ERR_OK) {
+        LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input_batch: netif input error\n"));
+        pbuf_free(pkts[i]);
+      }
+    }
+  }
+}
+#endif /* TAPIF_USE_RX_BATCH */
 /*-----------------------------------------------------------------------------------*/
 /*
  * tapif_init():
@@ -358,7 +474,11 @@ tapif_init(struct netif *netif)
 #if LWIP_IPV6
   netif->output_ip6 = ethip6_output;
 #endif /* LWIP_IPV6 */
+#if LWIP_TCP_GSO
+  netif->linkoutput = tapif_gso_output;
+#else /* LWIP_TCP_GSO */
   netif->linkoutput = low_level_output;
+#endif /* LWIP_TCP_GSO */
   netif->mtu = 1500;
 
   low_level_init(netif);
@@ -421,8 +541,12 @@ tapif_thread(void *arg)
     ret = select(tapif->fd + 1, &fdset, NULL, NULL, NULL);
 
     if(ret == 1) {
-      /* Handle incoming packet. */
+      /* Handle incoming packet(s). */
+#if TAPIF_USE_RX_BATCH
+      tapif_input_batch(netif);
+#else /* TAPIF_USE_RX_BATCH */
       tapif_input(netif);
+#endif /* TAPIF_USE_RX_BATCH */
     } else if(ret == -1) {
       perror("tapif_thread: select");
     }
@@ -55,6 +55,10 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#if defined(LWIP_UNIX_MBOX_LOCKFREE) && LWIP_UNIX_MBOX_LOCKFREE && defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #include "lwip/def.h"
 
@@ -66,7 +70,9 @@
 #include "lwip/sys.h"
 #include "lwip/opt.h"
 #include "lwip/stats.h"
+#include "lwip/memp.h"
 #include "lwip/tcpip.h"
+#include "arch/chksum.h"
 
 #if LWIP_NETCONN_SEM_PER_THREAD
 /* pthread key to *our* thread local storage entry */
@@ -118,6 +124,64 @@ struct sys_mbox_msg {
 
 #define SYS_MBOX_SIZE 128
 
+#if defined(LWIP_UNIX_MBOX_LOCKFREE) && LWIP_UNIX_MBOX_LOCKFREE
+/* Lock-free mailboxes (define LWIP_UNIX_MBOX_LOCKFREE to 1 in lwipopts.h):
+ * a bounded ring where every slot carries a sequence number that tells
+ * whether it is free for the poster of a position or holds the message for
+ * the fetcher of that position, so posting and fetching only need one
+ * compare-and-swap each and any number of threads may post or fetch.
+ * A thread that has to wait spins for LWIP_UNIX_MBOX_SPIN rounds and then
+ * sleeps on an event (a futex on Linux, a binary semaphore elsewhere), which
+ * the other side only signals when someone is actually sleeping. */
+#ifndef LWIP_UNIX_MBOX_SPIN
+#define LWIP_UNIX_MBOX_SPIN 200
+#endif
+
+#if (SYS_MBOX_SIZE & (SYS_MBOX_SIZE - 1)) != 0
+#error "SYS_MBOX_SIZE must be a power of 2"
+#endif
+
+#if defined(__linux__)
+#define SYS_MBOX_FUTEX 1
+#else
+#define SYS_MBOX_FUTEX 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SYS_MBOX_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define SYS_MBOX_CPU_RELAX()
+#endif
+
+struct sys_mbox_slot {
+  unsigned int seq;
+  void *msg;
+};
+
+struct sys_mbox_event {
+#if SYS_MBOX_FUTEX
+  /** futex word, 1 if signalled */
+  int state;
+#else
+  struct sys_sem *sem;
+#endif
+  /** number of threads sleeping (or about to) on this event */
+  int waiters;
+};
+
+struct sys_mbox {
+  /** next position to post to */
+  unsigned int head;
+  /* keep posters and fetchers off each other's cache line */
+  char pad0[64 - sizeof(unsigned int)];
+  /** next position to fetch from */
+  unsigned int tail;
+  char pad1[64 - sizeof(unsigned int)];
+  struct sys_mbox_event not_empty;
+  struct sys_mbox_event not_full;
+  struct sys_mbox_slot slots[SYS_MBOX_SIZE];
+};
+#else /* LWIP_UNIX_MBOX_LOCKFREE */
 struct sys_mbox {
   int first, last;
   void *msgs[SYS_MBOX_SIZE];
@@ -126,6 +190,7 @@ struct sys_mbox {
   struct sys_sem *mutex;
   int wait_send;
 };
+#endif /* LWIP_UNIX_MBOX_LOCKFREE */
 
 struct sys_sem {
   unsigned int c;
@@ -183,6 +248,10 @@ thread_wrapper(void *arg)
   thread_data->function(thread_data->arg);
 
   /* we should never get here */
+#if MEMP_THREAD_CACHE
+  /* return the elements cached by this thread to the pools */
+  memp_thread_cache_flush();
+#endif /* MEMP_THREAD_CACHE */
   free(arg);
   return NULL;
 }
@@ -260,6 +329,331 @@ void sys_check_core_locking(void)
 
 /*-----------------------------------------------------------------------------------*/
 /* Mailbox */
+#if defined(LWIP_UNIX_MBOX_LOCKFREE) && LWIP_UNIX_MBOX_LOCKFREE
+
+/* no spinning on a single CPU: the other side can't run meanwhile */
+static int mbox_spin = LWIP_UNIX_MBOX_SPIN;
+
+static int
+mbox_ring_post(struct sys_mbox *mbox, void *msg)
+{
+  unsigned int pos = __atomic_load_n(&mbox->head, __ATOMIC_RELAXED);
+  struct sys_mbox_slot *slot;
+  int diff;
+
+  for (;;) {
+    slot = &mbox->slots[pos % SYS_MBOX_SIZE];
+    diff = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+    if (diff == 0) {
+      /* slot is free: claim the position */
+      if (__atomic_compare_exchange_n(&mbox->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        slot->msg = msg;
+        __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+        return 1;
+      }
+      /* another poster was faster, pos has been reloaded */
+    } else if (diff < 0) {
+      /* full: slot still holds the message of the last round */
+      return 0;
+    } else {
+      pos = __atomic_load_n(&mbox->head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static int
+mbox_ring_fetch(struct sys_mbox *mbox, void **msg)
+{
+  unsigned int pos = __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED);
+  struct sys_mbox_slot *slot;
+  int diff;
+
+  for (;;) {
+    slot = &mbox->slots[pos % SYS_MBOX_SIZE];
+    diff = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+    if (diff == 0) {
+      /* slot holds a message: claim the position */
+      if (__atomic_compare_exchange_n(&mbox->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        if (msg != NULL) {
+          *msg = slot->msg;
+        }
+        /* free the slot for the poster of the next round */
+        __atomic_store_n(&slot->seq, pos + SYS_MBOX_SIZE, __ATOMIC_RELEASE);
+        return 1;
+      }
+    } else if (diff < 0) {
+      /* empty */
+      return 0;
+    } else {
+      pos = __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static int
+mbox_ring_empty(struct sys_mbox *mbox)
+{
+  return __atomic_load_n(&mbox->head, __ATOMIC_RELAXED) == __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED);
+}
+
+static int
+mbox_ring_full(struct sys_mbox *mbox)
+{
+  return __atomic_load_n(&mbox->head, __ATOMIC_RELAXED) - __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED) >= SYS_MBOX_SIZE;
+}
+
+static err_t
+mbox_event_init(struct sys_mbox_event *ev)
+{
+  ev->waiters = 0;
+#if SYS_MBOX_FUTEX
+  ev->state = 0;
+#else
+  ev->sem = sys_sem_new_internal(0);
+  if (ev->sem == NULL) {
+    return ERR_MEM;
+  }
+#endif
+  return ERR_OK;
+}
+
+static void
+mbox_event_free(struct sys_mbox_event *ev)
+{
+#if SYS_MBOX_FUTEX
+  LWIP_UNUSED_ARG(ev);
+#else
+  if (ev->sem != NULL) {
+    sys_sem_free_internal(ev->sem);
+  }
+#endif
+}
+
+/** Wake up one sleeper (if any) after the ring has been changed */
+static void
+mbox_event_signal(struct sys_mbox_event *ev)
+{
+  /* order the ring update before reading 'waiters' (pairs with the fence
+     in mbox_event_prepare_wait) */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ev->waiters, __ATOMIC_RELAXED) == 0) {
+    return;
+  }
+#if SYS_MBOX_FUTEX
+  if (__atomic_exchange_n(&ev->state, 1, __ATOMIC_SEQ_CST) == 0) {
+    syscall(SYS_futex, &ev->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
+#else
+  sys_sem_signal(&ev->sem);
+#endif
+}
+
+/** Announce a sleeper: the caller must check the ring again before sleeping */
+static void
+mbox_event_prepare_wait(struct sys_mbox_event *ev)
+{
+  __atomic_fetch_add(&ev->waiters, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void
+mbox_event_cancel_wait(struct sys_mbox_event *ev)
+{
+  __atomic_fetch_sub(&ev->waiters, 1, __ATOMIC_RELAXED);
+}
+
+/** Sleep until signalled or timeout ms (0: forever) have passed
+ * @return SYS_ARCH_TIMEOUT on timeout, 0 otherwise */
+static u32_t
+mbox_event_wait(struct sys_mbox_event *ev, u32_t timeout)
+{
+  u32_t ret = 0;
+#if SYS_MBOX_FUTEX
+  struct timespec ts;
+
+  if (__atomic_exchange_n(&ev->state, 0, __ATOMIC_SEQ_CST) == 0) {
+    ts.tv_sec = timeout / 1000L;
+    ts.tv_nsec = (timeout % 1000L) * 1000000L;
+    if ((syscall(SYS_futex, &ev->state, FUTEX_WAIT_PRIVATE, 0, (timeout != 0) ? &ts : NULL, NULL, 0) < 0) &&
+        (errno == ETIMEDOUT)) {
+      ret = SYS_ARCH_TIMEOUT;
+    }
+    __atomic_store_n(&ev->state, 0, __ATOMIC_RELAXED);
+  }
+#else
+  if (sys_arch_sem_wait(&ev->sem, timeout) == SYS_ARCH_TIMEOUT) {
+    ret = SYS_ARCH_TIMEOUT;
+  }
+#endif
+  __atomic_fetch_sub(&ev->waiters, 1, __ATOMIC_RELAXED);
+  return ret;
+}
+
+static u32_t
+mbox_elapsed_ms(const struct timespec *start)
+{
+  struct timespec now;
+  get_monotonic_time(&now);
+  return (u32_t)((now.tv_sec - start->tv_sec) * 1000L + (now.tv_nsec - start->tv_nsec) / 1000000L);
+}
+
+err_t
+sys_mbox_new(struct sys_mbox **mb, int size)
+{
+  struct sys_mbox *mbox;
+  unsigned int i;
+  LWIP_UNUSED_ARG(size);
+
+  mbox = (struct sys_mbox *)calloc(1, sizeof(struct sys_mbox));
+  if (mbox == NULL) {
+    return ERR_MEM;
+  }
+  for (i = 0; i < SYS_MBOX_SIZE; i++) {
+    mbox->slots[i].seq = i;
+  }
+  if ((mbox_event_init(&mbox->not_empty) != ERR_OK) ||
+      (mbox_event_init(&mbox->not_full) != ERR_OK)) {
+    mbox_event_free(&mbox->not_empty);
+    mbox_event_free(&mbox->not_full);
+    free(mbox);
+    return ERR_MEM;
+  }
+
+  SYS_STATS_INC_USED(mbox);
+  *mb = mbox;
+  return ERR_OK;
+}
+
+void
+sys_mbox_free(struct sys_mbox **mb)
+{
+  if ((mb != NULL) && (*mb != SYS_MBOX_NULL)) {
+    struct sys_mbox *mbox = *mb;
+    SYS_STATS_DEC(mbox.used);
+    mbox_event_free(&mbox->not_empty);
+    mbox_event_free(&mbox->not_full);
+    free(mbox);
+  }
+}
+
+err_t
+sys_mbox_trypost(struct sys_mbox **mb, void *msg)
+{
+  struct sys_mbox *mbox;
+  LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
+  mbox = *mb;
+
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_trypost: mbox %p msg %p\n",
+                          (void *)mbox, (void *)msg));
+
+  if (!mbox_ring_post(mbox, msg)) {
+    return ERR_MEM;
+  }
+  mbox_event_signal(&mbox->not_empty);
+  return ERR_OK;
+}
+
+err_t
+sys_mbox_trypost_fromisr(sys_mbox_t *q, void *msg)
+{
+  return sys_mbox_trypost(q, msg);
+}
+
+void
+sys_mbox_post(struct sys_mbox **mb, void *msg)
+{
+  struct sys_mbox *mbox;
+  int i;
+  LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
+  mbox = *mb;
+
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_post: mbox %p msg %p\n", (void *)mbox, (void *)msg));
+
+  for (i = 0; !mbox_ring_post(mbox, msg); i++) {
+    if (i < mbox_spin) {
+      SYS_MBOX_CPU_RELAX();
+      continue;
+    }
+    mbox_event_prepare_wait(&mbox->not_full);
+    if (mbox_ring_post(mbox, msg)) {
+      mbox_event_cancel_wait(&mbox->not_full);
+      break;
+    }
+    mbox_event_wait(&mbox->not_full, 0);
+  }
+  if ((i > mbox_spin) && !mbox_ring_full(mbox)) {
+    /* the signal that woke us may have been meant for other posters, too */
+    mbox_event_signal(&mbox->not_full);
+  }
+  mbox_event_signal(&mbox->not_empty);
+}
+
+
+u32_t
+sys_arch_mbox_tryfetch(struct sys_mbox **mb, void **msg)
+{
+  struct sys_mbox *mbox;
+  LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
+  mbox = *mb;
+
+  if (!mbox_ring_fetch(mbox, msg)) {
+    return SYS_MBOX_EMPTY;
+  }
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_tryfetch: mbox %p msg %p\n", (void *)mbox, (msg != NULL) ? *msg : NULL));
+  mbox_event_signal(&mbox->not_full);
+  return 0;
+}
+
+u32_t
+sys_arch_mbox_fetch(struct sys_mbox **mb, void **msg, u32_t timeout)
+{
+  u32_t time_needed = 0;
+  struct sys_mbox *mbox;
+  struct timespec start;
+  int i, slept = 0;
+  LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
+  mbox = *mb;
+
+  for (i = 0; !mbox_ring_fetch(mbox, msg); i++) {
+    if (i < mbox_spin) {
+      SYS_MBOX_CPU_RELAX();
+      continue;
+    }
+    if (!slept) {
+      get_monotonic_time(&start);
+    } else {
+      time_needed = mbox_elapsed_ms(&start);
+      if ((timeout != 0) && (time_needed >= timeout)) {
+        return SYS_ARCH_TIMEOUT;
+      }
+    }
+    mbox_event_prepare_wait(&mbox->not_empty);
+    if (mbox_ring_fetch(mbox, msg)) {
+      mbox_event_cancel_wait(&mbox->not_empty);
+      break;
+    }
+    slept = 1;
+    if (mbox_event_wait(&mbox->not_empty, (timeout != 0) ? timeout - time_needed : 0) == SYS_ARCH_TIMEOUT) {
+      if (mbox_ring_fetch(mbox, msg)) {
+        break;
+      }
+      return SYS_ARCH_TIMEOUT;
+    }
+  }
+  if (slept) {
+    time_needed = mbox_elapsed_ms(&start);
+    if (!mbox_ring_empty(mbox)) {
+      /* the signal that woke us may have been meant for other fetchers, too */
+      mbox_event_signal(&mbox->not_empty);
+    }
+  }
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_fetch: mbox %p msg %p\n", (void *)mbox, (msg != NULL) ? *msg : NULL));
+  mbox_event_signal(&mbox->not_full);
+  return time_needed;
+}
+
+#else /* LWIP_UNIX_MBOX_LOCKFREE */
+
 err_t
 sys_mbox_new(struct sys_mbox **mb, int size)
 {
@@ -459,6 +853,7 @@ sys_arch_mbox_fetch(struct sys_mbox **mb, void **msg, u32_t timeout)
 
   return time_needed;
 }
+#endif /* LWIP_UNIX_MBOX_LOCKFREE */
 
 /*-----------------------------------------------------------------------------------*/
 /* Semaphore */
@@ -764,6 +1159,14 @@ sys_init(void)
 #if LWIP_NETCONN_SEM_PER_THREAD
   pthread_key_create(&sys_thread_sem_key, sys_thread_sem_free);
 #endif
+#if defined(LWIP_UNIX_CHKSUM) && LWIP_UNIX_CHKSUM
+  lwip_unix_chksum_init();
+#endif
+#if !NO_SYS && defined(LWIP_UNIX_MBOX_LOCKFREE) && LWIP_UNIX_MBOX_LOCKFREE
+  if (sysconf(_SC_NPROCESSORS_ONLN) <= 1) {
+    mbox_spin = 0;
+  }
+#endif
 }
 
 /*-----------------------------------------------------------------------------------*/
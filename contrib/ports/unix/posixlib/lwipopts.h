@@ -84,6 +84,7 @@
 
 /* Throughput settings */
 #define LWIP_CHECKSUM_ON_COPY   1
+#define LWIP_UNIX_CHKSUM        1
 
 /* Disable stats */
 #define LWIP_STATS          0
@@ -45,6 +45,7 @@ set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/memp.c
     ${LWIP_DIR}/src/core/netif.c
     ${LWIP_DIR}/src/core/pbuf.c
+    ${LWIP_DIR}/src/core/portmap.c
     ${LWIP_DIR}/src/core/raw.c
     ${LWIP_DIR}/src/core/stats.c
     ${LWIP_DIR}/src/core/sys.c
@@ -52,6 +53,9 @@ set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/altcp_alloc.c
     ${LWIP_DIR}/src/core/altcp_tcp.c
     ${LWIP_DIR}/src/core/tcp.c
+    ${LWIP_DIR}/src/core/tcp_cc.c
+    ${LWIP_DIR}/src/core/tcp_fastopen.c
+    ${LWIP_DIR}/src/core/tcp_syncookies.c
     ${LWIP_DIR}/src/core/tcp_in.c
     ${LWIP_DIR}/src/core/tcp_out.c
     ${LWIP_DIR}/src/core/timeouts.c
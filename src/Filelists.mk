@@ -39,6 +39,7 @@ COREFILES=$(LWIPDIR)/core/init.c \
 	$(LWIPDIR)/core/memp.c \
 	$(LWIPDIR)/core/netif.c \
 	$(LWIPDIR)/core/pbuf.c \
+	$(LWIPDIR)/core/portmap.c \
 	$(LWIPDIR)/core/raw.c \
 	$(LWIPDIR)/core/stats.c \
 	$(LWIPDIR)/core/sys.c \
@@ -46,6 +47,9 @@ COREFILES=$(LWIPDIR)/core/init.c \
 	$(LWIPDIR)/core/altcp_alloc.c \
 	$(LWIPDIR)/core/altcp_tcp.c \
 	$(LWIPDIR)/core/tcp.c \
+	$(LWIPDIR)/core/tcp_cc.c \
+	$(LWIPDIR)/core/tcp_fastopen.c \
+	$(LWIPDIR)/core/tcp_syncookies.c \
 	$(LWIPDIR)/core/tcp_in.c \
 	$(LWIPDIR)/core/tcp_out.c \
 	$(LWIPDIR)/core/timeouts.c \
@@ -847,6 +847,48 @@ netconn_recv_udp_raw_netbuf_flags(struct netconn *conn, struct netbuf **new_buf,
   return netconn_recv_data(conn, (void **)new_buf, apiflags);
 }
 
+/**
+ * @ingroup netconn_udp
+ * Receive up to 'num' netbufs from a UDP or RAW netconn with one call: waits
+ * for the first one (unless NETCONN_DONTBLOCK is passed or the netconn is
+ * nonblocking), the others are only taken if they are available already.
+ *
+ * @param conn the netconn from which to receive data
+ * @param bufs array where the netbufs received are stored
+ * @param num size of 'bufs'
+ * @param received number of netbufs received is stored here
+ * @param apiflags flags that control function behaviour. For now only:
+ * - NETCONN_DONTBLOCK: only read data that is available now, don't wait for more data
+ * @return ERR_OK if at least one netbuf has been received, an error code
+ *         otherwise (like for netconn_recv_udp_raw_netbuf_flags())
+ */
+err_t
+netconn_recv_udp_raw_multi(struct netconn *conn, struct netbuf **bufs, u16_t num,
+                           u16_t *received, u8_t apiflags)
+{
+  err_t err;
+  u16_t i;
+
+  LWIP_ERROR("netconn_recv_udp_raw_multi: invalid received", (received != NULL), return ERR_ARG;);
+  *received = 0;
+  LWIP_ERROR("netconn_recv_udp_raw_multi: invalid conn", (conn != NULL) &&
+             NETCONNTYPE_GROUP(netconn_type(conn)) != NETCONN_TCP, return ERR_ARG;);
+  LWIP_ERROR("netconn_recv_udp_raw_multi: invalid bufs", (bufs != NULL) && (num > 0), return ERR_ARG;);
+
+  err = netconn_recv_data(conn, (void **)&bufs[0], apiflags);
+  if (err != ERR_OK) {
+    return err;
+  }
+  for (i = 1; i < num; i++) {
+    if (netconn_recv_data(conn, (void **)&bufs[i], NETCONN_DONTBLOCK) != ERR_OK) {
+      /* errors are reported by the next call */
+      break;
+    }
+  }
+  *received = i;
+  return ERR_OK;
+}
+
 /**
  * @ingroup netconn_common
  * Receive data (in form of a netbuf containing a packet buffer) from a netconn
@@ -956,6 +998,46 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+/**
+ * @ingroup netconn_udp
+ * Send some netbufs over a UDP or RAW netconn with one call into the core
+ * (one API message or one acquisition of the core lock). A netbuf is sent to
+ * its address and port if it has one (see netconn_sendto()), else to the
+ * remote side the netconn is connected to.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs the netbufs to send
+ * @param num number of netbufs in 'bufs'
+ * @param sent number of netbufs sent is stored here (sending stops at the
+ *        first error)
+ * @return ERR_OK if all netbufs were sent, the error of the first one that
+ *         could not be sent else
+ */
+err_t
+netconn_send_multi(struct netconn *conn, struct netbuf **bufs, u16_t num, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  LWIP_ERROR("netconn_send_multi: invalid sent", (sent != NULL), return ERR_ARG;);
+  *sent = 0;
+  LWIP_ERROR("netconn_send_multi: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_multi: invalid bufs", (bufs != NULL) || (num == 0), return ERR_ARG;);
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_multi: sending %"U16_F" netbufs\n", num));
+
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).conn = conn;
+  API_MSG_VAR_REF(msg).msg.bm.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.bm.num = num;
+  API_MSG_VAR_REF(msg).msg.bm.sent = 0;
+  err = netconn_apimsg(lwip_netconn_do_send_multi, &API_MSG_VAR_REF(msg));
+  *sent = API_MSG_VAR_REF(msg).msg.bm.sent;
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+
 /**
  * @ingroup netconn_tcp
  * Send data over a TCP netconn.
@@ -967,6 +1049,8 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
  * - NETCONN_COPY: data will be copied into memory belonging to the stack
  * - NETCONN_MORE: for TCP connection, PSH flag will be set on last segment sent
  * - NETCONN_DONTBLOCK: only write the data if all data can be written at once
+ * - NETCONN_ZEROCOPY: (LWIP_SO_ZEROCOPY==1) data is referenced, not copied,
+ *   until the write is reported by netconn_zerocopy_completed()
  * @param bytes_written pointer to a location that receives the number of written bytes
  * @return ERR_OK if data was sent, any other err_t on error
  */
@@ -990,6 +1074,8 @@ netconn_write_partly(struct netconn *conn, const void *dataptr, size_t size,
  * - NETCONN_COPY: data will be copied into memory belonging to the stack
  * - NETCONN_MORE: for TCP connection, PSH flag will be set on last segment sent
  * - NETCONN_DONTBLOCK: only write the data if all data can be written at once
+ * - NETCONN_ZEROCOPY: (LWIP_SO_ZEROCOPY==1) data is referenced, not copied,
+ *   until the write is reported by netconn_zerocopy_completed()
  * @param bytes_written pointer to a location that receives the number of written bytes
  * @return ERR_OK if data was sent, any other err_t on error
  */
@@ -1005,6 +1091,11 @@ netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u1
 
   LWIP_ERROR("netconn_write: invalid conn",  (conn != NULL), return ERR_ARG;);
   LWIP_ERROR("netconn_write: invalid conn->type",  (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP), return ERR_VAL;);
+#if LWIP_SO_ZEROCOPY
+  if (apiflags & NETCONN_ZEROCOPY) {
+    apiflags &= (u8_t)~NETCONN_COPY;
+  }
+#endif /* LWIP_SO_ZEROCOPY */
   dontblock = netconn_is_nonblocking(conn) || (apiflags & NETCONN_DONTBLOCK);
 #if LWIP_SO_SNDTIMEO
   if (conn->send_timeout != 0) {
@@ -1077,6 +1168,43 @@ netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u1
   return err;
 }
 
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+/**
+ * @ingroup netconn_tcp
+ * Get the zero-copy writes (NETCONN_ZEROCOPY) of a TCP netconn that have been
+ * completed since the last call. Each write that passed at least one byte to
+ * the stack gets a number, counting from 0. A write is completed (i.e. its
+ * data may be changed or freed) when the remote side has acknowledged all of
+ * it or when the connection is gone. Writes complete in order.
+ *
+ * @param conn the TCP netconn
+ * @param lo receives the number of the first completed write
+ * @param hi receives the number of the last completed write
+ * @return ERR_OK if writes have been completed, ERR_WOULDBLOCK if there are none
+ */
+err_t
+netconn_zerocopy_completed(struct netconn *conn, u32_t *lo, u32_t *hi)
+{
+  err_t err = ERR_WOULDBLOCK;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("netconn_zerocopy_completed: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_zerocopy_completed: invalid conn->type", (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP), return ERR_VAL;);
+  LWIP_ERROR("netconn_zerocopy_completed: invalid lo/hi", (lo != NULL) && (hi != NULL), return ERR_ARG;);
+
+  /* 'done' is updated from tcpip_thread */
+  SYS_ARCH_PROTECT(lev);
+  if (conn->zerocopy.reported != conn->zerocopy.done) {
+    *lo = conn->zerocopy.reported;
+    *hi = conn->zerocopy.done - 1;
+    conn->zerocopy.reported = conn->zerocopy.done;
+    err = ERR_OK;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return err;
+}
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
+
 /**
  * @ingroup netconn_tcp
  * Close or shutdown a TCP netconn (doesn't delete it).
@@ -1165,6 +1293,215 @@ netconn_shutdown(struct netconn *conn, u8_t shut_rx, u8_t shut_tx)
   return netconn_close_shutdown(conn, (u8_t)((shut_rx ? NETCONN_SHUT_RD : 0) | (shut_tx ? NETCONN_SHUT_WR : 0)));
 }
 
+#if LWIP_TCP && LWIP_NETCONN_RING
+/**
+ * @ingroup netconn_tcp
+ * Create a ring to queue TCP netconn operations to: the application takes
+ * entries from the submission ring with @ref netconn_ring_get_sqe, fills them
+ * in and passes them to the stack with @ref netconn_ring_submit. The
+ * tcpip_thread (or the submitting thread under the core lock) processes all
+ * submitted entries at once. Operations that cannot complete immediately
+ * wait for their netconn and are completed from its callback (which must be
+ * @ref netconn_ring_callback). Results are collected with
+ * @ref netconn_ring_reap, @ref netconn_ring_wait waits for them.
+ *
+ * A ring is used by one application thread. The netconns it operates on
+ * must not be used with other netconn (or socket) functions at the same time.
+ *
+ * @param entries number of entries of the submission and completion ring
+ *        (a power of 2): at most this many operations are in flight
+ * @return the new ring or NULL on error
+ */
+struct netconn_ring *
+netconn_ring_new(u16_t entries)
+{
+  LWIP_ERROR("netconn_ring_new: entries must be a power of 2 up to 0x8000",
+             (entries != 0) && (entries <= 0x8000) && ((entries & (entries - 1)) == 0), return NULL;);
+
+  return netconn_ring_alloc(entries);
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Delete a ring: all of its operations must have been reaped (operations
+ * waiting for a netconn are completed by a CLOSE of it).
+ *
+ * @param ring the ring to delete
+ * @return ERR_OK if the ring has been deleted, ERR_INPROGRESS if operations
+ *         are still in flight, ERR_MEM if the tcpip_thread could not be
+ *         informed (try again later)
+ */
+err_t
+netconn_ring_delete(struct netconn_ring *ring)
+{
+#if !LWIP_TCPIP_CORE_LOCKING
+  u8_t scheduled;
+  SYS_ARCH_DECL_PROTECT(lev);
+#endif /* !LWIP_TCPIP_CORE_LOCKING */
+
+  LWIP_ERROR("netconn_ring_delete: invalid ring", (ring != NULL), return ERR_ARG;);
+
+  if (ring->inflight != 0) {
+    return ERR_INPROGRESS;
+  }
+  /* The last completion may have been reaped while the tcpip_thread is still
+     in netconn_ring_complete() (signalling cq_sem): the ring may only be
+     freed from the tcpip_thread's context. */
+#if LWIP_TCPIP_CORE_LOCKING
+  LOCK_TCPIP_CORE();
+  netconn_ring_free(ring);
+  UNLOCK_TCPIP_CORE();
+#else /* LWIP_TCPIP_CORE_LOCKING */
+  SYS_ARCH_PROTECT(lev);
+  scheduled = ring->scheduled;
+  ring->scheduled = 1;
+  ring->deleted = 1;
+  SYS_ARCH_UNPROTECT(lev);
+  if (!scheduled && (tcpip_callbackmsg_trycallback(ring->submit_msg) != ERR_OK)) {
+    SYS_ARCH_PROTECT(lev);
+    ring->scheduled = 0;
+    ring->deleted = 0;
+    SYS_ARCH_UNPROTECT(lev);
+    return ERR_MEM;
+  }
+  /* lwip_netconn_do_ring_submit() frees the ring when it is done */
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  return ERR_OK;
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Get the next free entry of the submission ring. It is zeroed and has to be
+ * filled in before the next call to @ref netconn_ring_submit.
+ *
+ * @param ring the ring
+ * @return the entry or NULL if the ring is full (reap completions first)
+ */
+struct netconn_ring_sqe *
+netconn_ring_get_sqe(struct netconn_ring *ring)
+{
+  struct netconn_ring_sqe *sqe;
+
+  LWIP_ERROR("netconn_ring_get_sqe: invalid ring", (ring != NULL), return NULL;);
+
+  if (ring->inflight == ring->entries) {
+    return NULL;
+  }
+  sqe = &ring->sq[(u16_t)(ring->sq_tail + ring->sq_pending) & (ring->entries - 1)];
+  ring->sq_pending++;
+  ring->inflight++;
+  memset(sqe, 0, sizeof(struct netconn_ring_sqe));
+  return sqe;
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Pass the entries filled in since the last call to the stack: one API call
+ * (core lock or message to the tcpip_thread) per batch.
+ *
+ * @param ring the ring
+ * @return ERR_OK, or ERR_MEM if the tcpip_thread could not be informed (the
+ *         entries stay queued for the next call)
+ */
+err_t
+netconn_ring_submit(struct netconn_ring *ring)
+{
+  u8_t schedule;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("netconn_ring_submit: invalid ring", (ring != NULL), return ERR_ARG;);
+
+  SYS_ARCH_PROTECT(lev);
+  ring->sq_tail = (u16_t)(ring->sq_tail + ring->sq_pending);
+  schedule = !ring->scheduled;
+  ring->scheduled = 1;
+  SYS_ARCH_UNPROTECT(lev);
+  ring->sq_pending = 0;
+
+  if (schedule) {
+#if LWIP_TCPIP_CORE_LOCKING
+    LOCK_TCPIP_CORE();
+    lwip_netconn_do_ring_submit(ring);
+    UNLOCK_TCPIP_CORE();
+#else /* LWIP_TCPIP_CORE_LOCKING */
+    if (tcpip_callbackmsg_trycallback(ring->submit_msg) != ERR_OK) {
+      SYS_ARCH_PROTECT(lev);
+      ring->scheduled = 0;
+      SYS_ARCH_UNPROTECT(lev);
+      return ERR_MEM;
+    }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  }
+  return ERR_OK;
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Take completed operations from the completion ring (does not block).
+ *
+ * @param ring the ring
+ * @param cqes array receiving the completions
+ * @param num number of entries of 'cqes'
+ * @return number of completions stored to 'cqes'
+ */
+u16_t
+netconn_ring_reap(struct netconn_ring *ring, struct netconn_ring_cqe *cqes, u16_t num)
+{
+  u16_t avail, i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("netconn_ring_reap: invalid ring", (ring != NULL), return 0;);
+  LWIP_ERROR("netconn_ring_reap: invalid cqes", (cqes != NULL) || (num == 0), return 0;);
+
+  SYS_ARCH_PROTECT(lev);
+  avail = (u16_t)(ring->cq_tail - ring->cq_head);
+  SYS_ARCH_UNPROTECT(lev);
+  avail = LWIP_MIN(avail, num);
+  for (i = 0; i < avail; i++) {
+    cqes[i] = ring->cq[(u16_t)(ring->cq_head + i) & (ring->entries - 1)];
+  }
+  ring->cq_head = (u16_t)(ring->cq_head + avail);
+  ring->inflight = (u16_t)(ring->inflight - avail);
+  return avail;
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Wait until the completion ring is not empty.
+ *
+ * @param ring the ring
+ * @param timeout timeout in milliseconds, 0 to wait forever
+ * @return ERR_OK if there are completions to reap, ERR_TIMEOUT if not
+ */
+err_t
+netconn_ring_wait(struct netconn_ring *ring, u32_t timeout)
+{
+  u8_t empty;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("netconn_ring_wait: invalid ring", (ring != NULL), return ERR_ARG;);
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    empty = (u8_t)(ring->cq_tail == ring->cq_head);
+    ring->waiting = empty;
+    SYS_ARCH_UNPROTECT(lev);
+    if (!empty) {
+      return ERR_OK;
+    }
+    if (sys_arch_sem_wait(&ring->cq_sem, timeout) == SYS_ARCH_TIMEOUT) {
+      SYS_ARCH_PROTECT(lev);
+      ring->waiting = 0;
+      empty = (u8_t)(ring->cq_tail == ring->cq_head);
+      SYS_ARCH_UNPROTECT(lev);
+      return empty ? ERR_TIMEOUT : ERR_OK;
+    }
+    /* the semaphore may have been signalled for completions reaped already:
+       check again */
+  }
+}
+#endif /* LWIP_TCP && LWIP_NETCONN_RING */
+
 #if LWIP_IGMP || (LWIP_IPV6 && LWIP_IPV6_MLD)
 /**
  * @ingroup netconn_udp
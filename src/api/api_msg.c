@@ -53,6 +53,9 @@
 #include "lwip/dns.h"
 #include "lwip/mld6.h"
 #include "lwip/priv/tcpip_priv.h"
+#if LWIP_SO_ZEROCOPY
+#include "lwip/priv/tcp_priv.h"
+#endif /* LWIP_SO_ZEROCOPY */
 
 #include <string.h>
 
@@ -82,6 +85,7 @@
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 static err_t lwip_netconn_do_writemore(struct netconn *conn  WRITE_DELAYED_PARAM);
 static err_t lwip_netconn_do_close_internal(struct netconn *conn  WRITE_DELAYED_PARAM);
+static void netconn_tcp_poll_update(struct netconn *conn);
 #endif
 
 static void netconn_drain(struct netconn *conn);
@@ -188,6 +192,9 @@ recv_raw(void *arg, struct raw_pcb *pcb, struct pbuf *p,
       buf->ptr = q;
       ip_addr_copy(buf->addr, *ip_current_src_addr());
       buf->port = pcb->protocol;
+#if LWIP_UDP_GSO
+      buf->gso_size = 0;
+#endif /* LWIP_UDP_GSO */
 
       len = q->tot_len;
       if (sys_mbox_trypost(&conn->recvmbox, buf) != ERR_OK) {
@@ -258,6 +265,9 @@ recv_udp(void *arg, struct udp_pcb *pcb, struct pbuf *p,
     buf->ptr = p;
     ip_addr_set(&buf->addr, addr);
     buf->port = port;
+#if LWIP_UDP_GSO
+    buf->gso_size = 0;
+#endif /* LWIP_UDP_GSO */
 #if LWIP_NETBUF_RECVINFO
     if (conn->flags & NETCONN_FLAG_PKTINFO) {
       /* get the UDP header - always in the first pbuf, ensured by udp_input */
@@ -386,19 +396,93 @@ poll_tcp(void *arg, struct tcp_pcb *pcb)
       API_EVENT(conn, NETCONN_EVT_SENDPLUS, 0);
     }
   }
+  netconn_tcp_poll_update(conn);
 
   return ERR_OK;
 }
 
+/**
+ * Hook poll_tcp to the pcb of a TCP netconn only while it has something to
+ * do: a write waiting for memory or a nonblocking writer waiting for write
+ * space. Idle connections are not polled, so tcp_slowtmr does not have to
+ * look at them every NETCONN_TCP_POLL_INTERVAL.
+ * A pcb being closed is left alone: lwip_netconn_do_close_internal sets up
+ * its own poll interval.
+ *
+ * @param conn the TCP netconn to check
+ */
+static void
+netconn_tcp_poll_update(struct netconn *conn)
+{
+  if ((conn->pcb.tcp == NULL) || (conn->state == NETCONN_CLOSE) ||
+      (conn->pcb.tcp->state == LISTEN)) {
+    return;
+  }
+  if ((conn->state == NETCONN_WRITE) || (conn->flags & NETCONN_FLAG_CHECK_WRITESPACE)) {
+    tcp_poll(conn->pcb.tcp, poll_tcp, NETCONN_TCP_POLL_INTERVAL);
+  } else {
+    /* keep the interval: tcp_output is still retried for unsent data */
+    tcp_poll(conn->pcb.tcp, NULL, NETCONN_TCP_POLL_INTERVAL);
+  }
+}
+
+#if LWIP_SO_ZEROCOPY
+/**
+ * A zero-copy write (NETCONN_ZEROCOPY) has passed data to tcp_write():
+ * it is completed when everything enqueued so far is acknowledged.
+ */
+static void
+lwip_netconn_zerocopy_written(struct netconn *conn)
+{
+  struct netconn_zerocopy *zc = &conn->zerocopy;
+  u8_t idx;
+
+  zc->next++;
+  if (zc->pending_num < LWIP_SO_ZEROCOPY_PENDING) {
+    idx = (u8_t)((zc->pending_first + zc->pending_num) % LWIP_SO_ZEROCOPY_PENDING);
+    zc->pending_num++;
+  } else {
+    /* no room: complete this write together with the newest pending one */
+    idx = (u8_t)((zc->pending_first + zc->pending_num - 1) % LWIP_SO_ZEROCOPY_PENDING);
+  }
+  zc->pending[idx].seqno = conn->pcb.tcp->snd_lbb;
+  zc->pending[idx].next = zc->next;
+}
+
+/**
+ * Data has been acknowledged: complete the zero-copy writes of that data.
+ */
+static void
+lwip_netconn_zerocopy_acked(struct netconn *conn, struct tcp_pcb *pcb)
+{
+  struct netconn_zerocopy *zc = &conn->zerocopy;
+  u32_t done = zc->done;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  /* TCP_SEQ_GEQ(pcb->lastack, seqno) */
+  while ((zc->pending_num > 0) && ((s32_t)(pcb->lastack - zc->pending[zc->pending_first].seqno) >= 0)) {
+    done = zc->pending[zc->pending_first].next;
+    zc->pending_first = (u8_t)((zc->pending_first + 1) % LWIP_SO_ZEROCOPY_PENDING);
+    zc->pending_num--;
+  }
+  if (done != zc->done) {
+    /* 'done' is read by netconn_zerocopy_completed() */
+    SYS_ARCH_PROTECT(lev);
+    zc->done = done;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+}
+#endif /* LWIP_SO_ZEROCOPY */
+
 /**
  * Sent callback function for TCP netconns.
  * Signals the conn->sem and calls API_EVENT.
  * netconn_write waits for conn->sem if send buffer is low.
  *
- * @see tcp.h (struct tcp_pcb.sent) for parameters and return value
+ * @see tcp.h (struct tcp_pcb.sent_ext) for parameters and return value
  */
 static err_t
-sent_tcp(void *arg, struct tcp_pcb *pcb, u16_t len)
+sent_tcp(void *arg, struct tcp_pcb *pcb, size_t len)
 {
   struct netconn *conn = (struct netconn *)arg;
 
@@ -406,6 +490,9 @@ sent_tcp(void *arg, struct tcp_pcb *pcb, u16_t len)
   LWIP_ASSERT("conn != NULL", (conn != NULL));
 
   if (conn) {
+#if LWIP_SO_ZEROCOPY
+    lwip_netconn_zerocopy_acked(conn, pcb);
+#endif /* LWIP_SO_ZEROCOPY */
     if (conn->state == NETCONN_WRITE) {
       lwip_netconn_do_writemore(conn  WRITE_DELAYED);
     } else if (conn->state == NETCONN_CLOSE) {
@@ -417,8 +504,9 @@ sent_tcp(void *arg, struct tcp_pcb *pcb, u16_t len)
     if ((conn->pcb.tcp != NULL) && (tcp_sndbuf(conn->pcb.tcp) > TCP_SNDLOWAT) &&
         (tcp_sndqueuelen(conn->pcb.tcp) < TCP_SNDQUEUELOWAT)) {
       netconn_clear_flags(conn, NETCONN_FLAG_CHECK_WRITESPACE);
-      API_EVENT(conn, NETCONN_EVT_SENDPLUS, len);
+      API_EVENT(conn, NETCONN_EVT_SENDPLUS, (u16_t)LWIP_MIN(len, 0xffff));
     }
+    netconn_tcp_poll_update(conn);
   }
 
   return ERR_OK;
@@ -450,6 +538,11 @@ err_tcp(void *arg, err_t err)
   conn->pending_err = err;
   /* prevent application threads from blocking on 'recvmbox'/'acceptmbox' */
   conn->flags |= NETCONN_FLAG_MBOXCLOSED;
+#if LWIP_SO_ZEROCOPY
+  /* the pcb has freed its segments: all zero-copy writes are completed */
+  conn->zerocopy.done = conn->zerocopy.next;
+  conn->zerocopy.pending_num = 0;
+#endif /* LWIP_SO_ZEROCOPY */
 
   /* reset conn->state now before waking up other threads */
   old_state = conn->state;
@@ -521,8 +614,9 @@ setup_tcp(struct netconn *conn)
   pcb = conn->pcb.tcp;
   tcp_arg(pcb, conn);
   tcp_recv(pcb, recv_tcp);
-  tcp_sent(pcb, sent_tcp);
-  tcp_poll(pcb, poll_tcp, NETCONN_TCP_POLL_INTERVAL);
+  tcp_sent_ext(pcb, sent_tcp);
+  /* poll_tcp is only hooked while there is something to do */
+  netconn_tcp_poll_update(conn);
   tcp_err(pcb, err_tcp);
 }
 
@@ -767,6 +861,17 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
   conn->callback     = callback;
 #if LWIP_TCP
   conn->current_msg  = NULL;
+#if LWIP_SO_ZEROCOPY
+  conn->zerocopy.next = 0;
+  conn->zerocopy.done = 0;
+  conn->zerocopy.reported = 0;
+  conn->zerocopy.pending_first = 0;
+  conn->zerocopy.pending_num = 0;
+#endif /* LWIP_SO_ZEROCOPY */
+#if LWIP_NETCONN_RING
+  conn->ring_ops = NULL;
+  conn->ring_lastdata = NULL;
+#endif /* LWIP_NETCONN_RING */
 #endif /* LWIP_TCP */
 #if LWIP_SO_SNDTIMEO
   conn->send_timeout = 0;
@@ -809,6 +914,13 @@ netconn_free(struct netconn *conn)
 #if LWIP_TCP
   LWIP_ASSERT("acceptmbox must be deallocated before calling this function",
               !sys_mbox_valid(&conn->acceptmbox));
+#if LWIP_NETCONN_RING
+  LWIP_ASSERT("netconn_ring operations must be completed before calling this function",
+              conn->ring_ops == NULL);
+  if (conn->ring_lastdata != NULL) {
+    pbuf_free(conn->ring_lastdata);
+  }
+#endif /* LWIP_NETCONN_RING */
 #endif /* LWIP_TCP */
 
 #if !LWIP_NETCONN_SEM_PER_THREAD
@@ -1007,7 +1119,15 @@ lwip_netconn_do_close_internal(struct netconn *conn  WRITE_DELAYED_PARAM)
     if ((err == ERR_OK) && (tpcb != NULL))
 #endif /* LWIP_SO_LINGER */
     {
-      err = tcp_close(tpcb);
+#if LWIP_SO_ZEROCOPY
+      /* the pcb outlives the netconn: stop referencing zero-copy data (if
+         memory is short, this is retried like a failing tcp_close) */
+      err = (conn->zerocopy.pending_num > 0) ? tcp_copy_rom_data(tpcb) : ERR_OK;
+      if (err == ERR_OK)
+#endif /* LWIP_SO_ZEROCOPY */
+      {
+        err = tcp_close(tpcb);
+      }
     }
   } else {
     err = tcp_shutdown(tpcb, shut_rx, shut_tx);
@@ -1065,6 +1185,15 @@ lwip_netconn_do_close_internal(struct netconn *conn  WRITE_DELAYED_PARAM)
     conn->state = NETCONN_NONE;
     if (err == ERR_OK) {
       if (shut_close) {
+#if LWIP_SO_ZEROCOPY
+        SYS_ARCH_DECL_PROTECT(lev);
+        /* the pcb does not reference zero-copy data any more (copied,
+           acknowledged or aborted): all writes are completed */
+        SYS_ARCH_PROTECT(lev);
+        conn->zerocopy.done = conn->zerocopy.next;
+        conn->zerocopy.pending_num = 0;
+        SYS_ARCH_UNPROTECT(lev);
+#endif /* LWIP_SO_ZEROCOPY */
         /* Set back some callback pointers as conn is going away */
         conn->pcb.tcp = NULL;
         /* Trigger select() in socket layer. Make sure everybody notices activity
@@ -1078,6 +1207,10 @@ lwip_netconn_do_close_internal(struct netconn *conn  WRITE_DELAYED_PARAM)
         API_EVENT(conn, NETCONN_EVT_SENDPLUS, 0);
       }
     }
+    if (!shut_close) {
+      /* the pcb stays: poll it only if there is still something to do */
+      netconn_tcp_poll_update(conn);
+    }
 #if LWIP_TCPIP_CORE_LOCKING
     if (delayed)
 #endif
@@ -1092,7 +1225,7 @@ lwip_netconn_do_close_internal(struct netconn *conn  WRITE_DELAYED_PARAM)
     /* Closing of listen pcb will never fail! */
     LWIP_ASSERT("Closing a listen pcb may not fail!", (tpcb->state != LISTEN));
     if (shut_tx) {
-      tcp_sent(tpcb, sent_tcp);
+      tcp_sent_ext(tpcb, sent_tcp);
     }
     /* when waiting for close, set up poll interval to 500ms */
     tcp_poll(tpcb, poll_tcp, 1);
@@ -1316,6 +1449,14 @@ lwip_netconn_do_connected(void *arg, struct tcp_pcb *pcb, err_t err)
     return ERR_VAL;
   }
 
+#if LWIP_TCP_FASTOPEN
+  if (conn->state != NETCONN_CONNECT) {
+    /* fast open: lwip_netconn_do_connect() reported the connection as
+       established when the SYN was held back for the first data */
+    return ERR_OK;
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+
   LWIP_ASSERT("conn->state == NETCONN_CONNECT", conn->state == NETCONN_CONNECT);
   LWIP_ASSERT("(conn->current_msg != NULL) || conn->in_non_blocking_connect",
               (conn->current_msg != NULL) || IN_NONBLOCKING_CONNECT(conn));
@@ -1384,6 +1525,14 @@ lwip_netconn_do_connect(void *m)
                             msg->msg.bc.port, lwip_netconn_do_connected);
           if (err == ERR_OK) {
             u8_t non_blocking = netconn_is_nonblocking(msg->conn);
+#if LWIP_TCP_FASTOPEN
+            if (msg->conn->pcb.tcp->fastopen & TCP_FASTOPEN_SYN_DATA) {
+              /* The SYN waits for the first data to carry (see tcp_fastopen()),
+                 so the netconn can be written to right away */
+              API_EVENT(msg->conn, NETCONN_EVT_SENDPLUS, 0);
+              break;
+            }
+#endif /* LWIP_TCP_FASTOPEN */
             msg->conn->state = NETCONN_CONNECT;
             SET_NONBLOCKING_CONNECT(msg->conn, non_blocking);
             if (non_blocking) {
@@ -1526,6 +1675,68 @@ lwip_netconn_do_listen(void *m)
 }
 #endif /* LWIP_TCP */
 
+/* Send a netbuf on the RAW or UDP pcb of a netconn */
+static err_t
+lwip_netconn_send_netbuf(struct netconn *conn, struct netbuf *buf)
+{
+  err_t err;
+#if LWIP_UDP && LWIP_UDP_GSO
+  u16_t gso_size = 0;
+#endif /* LWIP_UDP && LWIP_UDP_GSO */
+
+  if (conn->pcb.tcp != NULL) {
+    switch (NETCONNTYPE_GROUP(conn->type)) {
+#if LWIP_RAW
+      case NETCONN_RAW:
+        if (ip_addr_isany(&buf->addr) || IP_IS_ANY_TYPE_VAL(buf->addr)) {
+          err = raw_send(conn->pcb.raw, buf->p);
+        } else {
+          err = raw_sendto(conn->pcb.raw, buf->p, &buf->addr);
+        }
+        break;
+#endif
+#if LWIP_UDP
+      case NETCONN_UDP:
+#if LWIP_UDP_GSO
+        if (buf->gso_size != 0) {
+          /* the segment size of the netbuf applies to this send only */
+          gso_size = udp_get_gso_size(conn->pcb.udp);
+          udp_set_gso_size(conn->pcb.udp, buf->gso_size);
+        }
+#endif /* LWIP_UDP_GSO */
+#if LWIP_CHECKSUM_ON_COPY
+        if (ip_addr_isany(&buf->addr) || IP_IS_ANY_TYPE_VAL(buf->addr)) {
+          err = udp_send_chksum(conn->pcb.udp, buf->p,
+                                buf->flags & NETBUF_FLAG_CHKSUM, buf->toport_chksum);
+        } else {
+          err = udp_sendto_chksum(conn->pcb.udp, buf->p,
+                                  &buf->addr, buf->port,
+                                  buf->flags & NETBUF_FLAG_CHKSUM, buf->toport_chksum);
+        }
+#else /* LWIP_CHECKSUM_ON_COPY */
+        if (ip_addr_isany_val(buf->addr) || IP_IS_ANY_TYPE_VAL(buf->addr)) {
+          err = udp_send(conn->pcb.udp, buf->p);
+        } else {
+          err = udp_sendto(conn->pcb.udp, buf->p, &buf->addr, buf->port);
+        }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+#if LWIP_UDP_GSO
+        if (buf->gso_size != 0) {
+          udp_set_gso_size(conn->pcb.udp, gso_size);
+        }
+#endif /* LWIP_UDP_GSO */
+        break;
+#endif /* LWIP_UDP */
+      default:
+        err = ERR_CONN;
+        break;
+    }
+  } else {
+    err = ERR_CONN;
+  }
+  return err;
+}
+
 /**
  * Send some data on a RAW or UDP pcb contained in a netconn
  * Called from netconn_send
@@ -1539,43 +1750,29 @@ lwip_netconn_do_send(void *m)
 
   err_t err = netconn_err(msg->conn);
   if (err == ERR_OK) {
-    if (msg->conn->pcb.tcp != NULL) {
-      switch (NETCONNTYPE_GROUP(msg->conn->type)) {
-#if LWIP_RAW
-        case NETCONN_RAW:
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = raw_send(msg->conn->pcb.raw, msg->msg.b->p);
-          } else {
-            err = raw_sendto(msg->conn->pcb.raw, msg->msg.b->p, &msg->msg.b->addr);
-          }
-          break;
-#endif
-#if LWIP_UDP
-        case NETCONN_UDP:
-#if LWIP_CHECKSUM_ON_COPY
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                  msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-          } else {
-            err = udp_sendto_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                    &msg->msg.b->addr, msg->msg.b->port,
-                                    msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-          }
-#else /* LWIP_CHECKSUM_ON_COPY */
-          if (ip_addr_isany_val(msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send(msg->conn->pcb.udp, msg->msg.b->p);
-          } else {
-            err = udp_sendto(msg->conn->pcb.udp, msg->msg.b->p, &msg->msg.b->addr, msg->msg.b->port);
-          }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-          break;
-#endif /* LWIP_UDP */
-        default:
-          err = ERR_CONN;
-          break;
-      }
-    } else {
-      err = ERR_CONN;
+    err = lwip_netconn_send_netbuf(msg->conn, msg->msg.b);
+  }
+  msg->err = err;
+  TCPIP_APIMSG_ACK(msg);
+}
+
+/**
+ * Send some netbufs on a RAW or UDP pcb contained in a netconn, stopping at
+ * the first one that cannot be sent
+ * Called from netconn_send_multi
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_multi(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+
+  err_t err = netconn_err(msg->conn);
+  while ((err == ERR_OK) && (msg->msg.bm.sent < msg->msg.bm.num)) {
+    err = lwip_netconn_send_netbuf(msg->conn, msg->msg.bm.bufs[msg->msg.bm.sent]);
+    if (err == ERR_OK) {
+      msg->msg.bm.sent++;
     }
   }
   msg->err = err;
@@ -1597,12 +1794,7 @@ lwip_netconn_do_recv(void *m)
   msg->err = ERR_OK;
   if (msg->conn->pcb.tcp != NULL) {
     if (NETCONNTYPE_GROUP(msg->conn->type) == NETCONN_TCP) {
-      size_t remaining = msg->msg.r.len;
-      do {
-        u16_t recved = (u16_t)((remaining > 0xffff) ? 0xffff : remaining);
-        tcp_recved(msg->conn->pcb.tcp, recved);
-        remaining -= recved;
-      } while (remaining != 0);
+      tcp_recved_ext(msg->conn->pcb.tcp, msg->msg.r.len);
     }
   }
   TCPIP_APIMSG_ACK(msg);
@@ -1645,7 +1837,7 @@ lwip_netconn_do_writemore(struct netconn *conn  WRITE_DELAYED_PARAM)
 {
   err_t err;
   const void *dataptr;
-  u16_t len, available;
+  size_t len;
   u8_t write_finished = 0;
   size_t diff;
   u8_t dontblock;
@@ -1680,40 +1872,17 @@ lwip_netconn_do_writemore(struct netconn *conn  WRITE_DELAYED_PARAM)
     do {
       dataptr = (const u8_t *)conn->current_msg->msg.w.vector->ptr + conn->current_msg->msg.w.vector_off;
       diff = conn->current_msg->msg.w.vector->len - conn->current_msg->msg.w.vector_off;
-      if (diff > 0xffffUL) { /* max_u16_t */
-        len = 0xffff;
+      if (conn->current_msg->msg.w.vector_cnt > 1) {
         apiflags |= TCP_WRITE_FLAG_MORE;
-      } else {
-        len = (u16_t)diff;
-      }
-      available = tcp_sndbuf(conn->pcb.tcp);
-      if (available < len) {
-        /* don't try to write more than sendbuf */
-        len = available;
-        if (dontblock) {
-          if (!len) {
-            /* set error according to partial write or not */
-            err = (conn->current_msg->msg.w.offset == 0) ? ERR_WOULDBLOCK : ERR_OK;
-            goto err_mem;
-          }
-        } else {
-          apiflags |= TCP_WRITE_FLAG_MORE;
-        }
       }
+      /* enqueue as much of the current vector as fits into sendbuf and
+         the queue in one go (tcp_write_ext sets TCP_WRITE_FLAG_MORE itself
+         if it could not take everything) */
+      err = tcp_write_ext(conn->pcb.tcp, dataptr, diff, apiflags, &len);
       LWIP_ASSERT("lwip_netconn_do_writemore: invalid length!",
-                  ((conn->current_msg->msg.w.vector_off + len) <= conn->current_msg->msg.w.vector->len));
-      /* we should loop around for more sending in the following cases:
-           1) We couldn't finish the current vector because of 16-bit size limitations.
-              tcp_write() and tcp_sndbuf() both are limited to 16-bit sizes
-           2) We are sending the remainder of the current vector and have more */
-      if ((len == 0xffff && diff > 0xffffUL) ||
-          (len == (u16_t)diff && conn->current_msg->msg.w.vector_cnt > 1)) {
-        write_more = 1;
-        apiflags |= TCP_WRITE_FLAG_MORE;
-      } else {
-        write_more = 0;
-      }
-      err = tcp_write(conn->pcb.tcp, dataptr, len, apiflags);
+                  (err != ERR_OK) || (len <= diff));
+      /* loop around for the next vector if the current one is done */
+      write_more = (u8_t)((err == ERR_OK) && (len == diff) && (conn->current_msg->msg.w.vector_cnt > 1));
       if (err == ERR_OK) {
         conn->current_msg->msg.w.offset += len;
         conn->current_msg->msg.w.vector_off += len;
@@ -1730,7 +1899,6 @@ lwip_netconn_do_writemore(struct netconn *conn  WRITE_DELAYED_PARAM)
     } while (write_more && err == ERR_OK);
     /* if OK or memory error, check available space */
     if ((err == ERR_OK) || (err == ERR_MEM)) {
-err_mem:
       if (dontblock && (conn->current_msg->msg.w.offset < conn->current_msg->msg.w.len)) {
         /* non-blocking write did not write everything: mark the pcb non-writable
            and let poll_tcp check writable space to mark the pcb writable again */
@@ -1788,6 +1956,12 @@ err_mem:
     /* everything was written: set back connection state
        and back to application task */
     sys_sem_t *op_completed_sem = LWIP_API_MSG_SEM(conn->current_msg);
+#if LWIP_SO_ZEROCOPY
+    if ((apiflags & NETCONN_ZEROCOPY) && (conn->current_msg->msg.w.offset > 0) &&
+        (conn->pcb.tcp != NULL)) {
+      lwip_netconn_zerocopy_written(conn);
+    }
+#endif /* LWIP_SO_ZEROCOPY */
     conn->current_msg->err = err;
     conn->current_msg = NULL;
     conn->state = NETCONN_NONE;
@@ -1798,8 +1972,9 @@ err_mem:
       sys_sem_signal(op_completed_sem);
     }
   }
+  netconn_tcp_poll_update(conn);
 #if LWIP_TCPIP_CORE_LOCKING
-  else {
+  if (!write_finished) {
     return ERR_MEM;
   }
 #endif
@@ -2174,4 +2349,440 @@ lwip_netconn_do_gethostbyname(void *arg)
 }
 #endif /* LWIP_DNS */
 
+#if LWIP_TCP && LWIP_NETCONN_RING
+/**
+ * Allocate a netconn_ring with its submission and completion rings.
+ * Called from netconn_ring_new.
+ *
+ * @param entries number of entries of each ring (a power of 2)
+ * @return the new ring or NULL on memory error
+ */
+struct netconn_ring *
+netconn_ring_alloc(u16_t entries)
+{
+  struct netconn_ring *ring;
+  struct netconn_ring_op *ops;
+  size_t size;
+  u16_t i;
+
+  size = LWIP_MEM_ALIGN_SIZE(sizeof(struct netconn_ring)) +
+         entries * (sizeof(struct netconn_ring_op) + sizeof(struct netconn_ring_sqe) +
+                    sizeof(struct netconn_ring_cqe));
+  if ((size_t)(mem_size_t)size != size) {
+    return NULL;
+  }
+  ring = (struct netconn_ring *)mem_malloc((mem_size_t)size);
+  if (ring == NULL) {
+    return NULL;
+  }
+  memset(ring, 0, sizeof(struct netconn_ring));
+  ops = (struct netconn_ring_op *)(void *)((u8_t *)ring + LWIP_MEM_ALIGN_SIZE(sizeof(struct netconn_ring)));
+  ring->sq = (struct netconn_ring_sqe *)(void *)&ops[entries];
+  ring->cq = (struct netconn_ring_cqe *)(void *)&ring->sq[entries];
+  ring->entries = entries;
+  for (i = 0; i < entries; i++) {
+    ops[i].next = ring->free_ops;
+    ring->free_ops = &ops[i];
+  }
+  if (sys_sem_new(&ring->cq_sem, 0) != ERR_OK) {
+    mem_free(ring);
+    return NULL;
+  }
+#if !LWIP_TCPIP_CORE_LOCKING
+  ring->submit_msg = tcpip_callbackmsg_new(lwip_netconn_do_ring_submit, ring);
+  if (ring->submit_msg == NULL) {
+    sys_sem_free(&ring->cq_sem);
+    mem_free(ring);
+    return NULL;
+  }
+#endif /* !LWIP_TCPIP_CORE_LOCKING */
+  return ring;
+}
+
+/**
+ * Free a netconn_ring: the submission ring must not be processed any more.
+ *
+ * @param ring the ring to free
+ */
+void
+netconn_ring_free(struct netconn_ring *ring)
+{
+#if !LWIP_TCPIP_CORE_LOCKING
+  tcpip_callbackmsg_delete(ring->submit_msg);
+#endif /* !LWIP_TCPIP_CORE_LOCKING */
+  sys_sem_free(&ring->cq_sem);
+  mem_free(ring);
+}
+
+/** Add the result of an operation to the completion ring of its netconn_ring */
+static void
+netconn_ring_complete(struct netconn_ring_op *op, err_t err)
+{
+  struct netconn_ring *ring = op->ring;
+  struct netconn_ring_cqe *cqe = &ring->cq[ring->cq_tail & (ring->entries - 1)];
+  u8_t wakeup;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  cqe->user_data = op->sqe.user_data;
+  cqe->conn = (op->newconn != NULL) ? op->newconn : op->sqe.conn;
+  cqe->len = op->done;
+  cqe->err = err;
+  cqe->opcode = op->sqe.opcode;
+
+  op->next = ring->free_ops;
+  ring->free_ops = op;
+
+  SYS_ARCH_PROTECT(lev);
+  ring->cq_tail++;
+  wakeup = ring->waiting;
+  ring->waiting = 0;
+  SYS_ARCH_UNPROTECT(lev);
+  if (wakeup) {
+    sys_sem_signal(&ring->cq_sem);
+  }
+}
+
+/** The error an operation on a netconn without pcb completes with */
+static err_t
+netconn_ring_conn_err(struct netconn *conn)
+{
+  return (conn->pending_err != ERR_OK) ? conn->pending_err : ERR_CLSD;
+}
+
+static err_t
+netconn_ring_accept(struct netconn *conn, struct netconn_ring_op *op)
+{
+  void *msg;
+  err_t err;
+
+  if (!sys_mbox_valid(&conn->acceptmbox)) {
+    return ERR_CLSD;
+  }
+  if (sys_mbox_tryfetch(&conn->acceptmbox, &msg) == SYS_MBOX_EMPTY) {
+    if ((conn->flags & NETCONN_FLAG_MBOXCLOSED) || (conn->pcb.tcp == NULL)) {
+      return netconn_ring_conn_err(conn);
+    }
+    return ERR_INPROGRESS;
+  }
+  if (lwip_netconn_is_err_msg(msg, &err)) {
+    return err;
+  }
+  if (msg == NULL) {
+    return ERR_CLSD;
+  }
+  op->newconn = (struct netconn *)msg;
+  if (op->newconn->pcb.tcp != NULL) {
+    tcp_backlog_accepted(op->newconn->pcb.tcp);
+  }
+  return ERR_OK;
+}
+
+static err_t
+netconn_ring_connect(struct netconn *conn, struct netconn_ring_op *op)
+{
+  err_t err;
+
+  if (op->started) {
+    /* lwip_netconn_do_connected() or err_tcp() reset the state */
+    if (conn->state == NETCONN_CONNECT) {
+      return ERR_INPROGRESS;
+    }
+    return (conn->pcb.tcp != NULL) ? ERR_OK : netconn_ring_conn_err(conn);
+  }
+  if (conn->pcb.tcp == NULL) {
+    return ERR_CLSD;
+  }
+  if (conn->state == NETCONN_CONNECT) {
+    return ERR_ALREADY;
+  } else if (conn->state != NETCONN_NONE) {
+    return ERR_ISCONN;
+  }
+  setup_tcp(conn);
+  err = tcp_connect(conn->pcb.tcp, &op->sqe.addr, op->sqe.port, lwip_netconn_do_connected);
+  if (err != ERR_OK) {
+    return err;
+  }
+#if LWIP_TCP_FASTOPEN
+  if (conn->pcb.tcp->fastopen & TCP_FASTOPEN_SYN_DATA) {
+    /* the SYN waits for the first data to carry */
+    return ERR_OK;
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+  conn->state = NETCONN_CONNECT;
+  SET_NONBLOCKING_CONNECT(conn, 1);
+  op->started = 1;
+  return ERR_INPROGRESS;
+}
+
+static err_t
+netconn_ring_recv(struct netconn *conn, struct netconn_ring_op *op)
+{
+  struct pbuf *p = conn->ring_lastdata;
+  u16_t len;
+
+  if (p == NULL) {
+    void *msg;
+    err_t err;
+
+    if (!sys_mbox_valid(&conn->recvmbox)) {
+      return ERR_CONN;
+    }
+    if (sys_mbox_tryfetch(&conn->recvmbox, &msg) == SYS_MBOX_EMPTY) {
+      if ((conn->flags & NETCONN_FLAG_MBOXCLOSED) || (conn->pcb.tcp == NULL)) {
+        /* closed by the remote side (0 bytes) or failed */
+        return conn->pending_err;
+      }
+      return ERR_INPROGRESS;
+    }
+    if (lwip_netconn_is_err_msg(msg, &err)) {
+      /* remember that nothing more is coming */
+      netconn_set_flags(conn, NETCONN_FLAG_MBOXCLOSED);
+      return (err == ERR_CLSD) ? ERR_OK : err;
+    }
+    p = (struct pbuf *)msg;
+#if LWIP_SO_RCVBUF
+    SYS_ARCH_DEC(conn->recv_avail, p->tot_len);
+#endif /* LWIP_SO_RCVBUF */
+  }
+  len = (u16_t)LWIP_MIN(op->sqe.len, p->tot_len);
+  pbuf_copy_partial(p, op->sqe.buf, len, 0);
+  conn->ring_lastdata = pbuf_free_header(p, len);
+  op->done = len;
+  if (conn->pcb.tcp != NULL) {
+    tcp_recved(conn->pcb.tcp, len);
+  }
+  return ERR_OK;
+}
+
+static err_t
+netconn_ring_send(struct netconn *conn, struct netconn_ring_op *op)
+{
+  struct tcp_pcb *pcb = conn->pcb.tcp;
+  const u8_t *data = (const u8_t *)op->sqe.buf;
+  size_t start = op->done;
+  size_t left, avail;
+  u16_t len;
+  err_t err = ERR_OK;
+
+  if (pcb == NULL) {
+    return netconn_ring_conn_err(conn);
+  }
+  if (conn->state == NETCONN_CONNECT) {
+    return ERR_INPROGRESS;
+  }
+  while (op->done < op->sqe.len) {
+    left = op->sqe.len - op->done;
+    avail = LWIP_MIN(left, tcp_sndbuf(pcb));
+    if (avail == 0) {
+      break;
+    }
+    /* tcp_write() takes at most 0xffff bytes: cap before the cast, the
+       rest follows with TCP_WRITE_FLAG_MORE set */
+    len = (u16_t)LWIP_MIN(avail, 0xffff);
+    err = tcp_write(pcb, data + op->done, len,
+                    (u8_t)(TCP_WRITE_FLAG_COPY | ((len < left) ? TCP_WRITE_FLAG_MORE : 0)));
+    if (err != ERR_OK) {
+      break;
+    }
+    op->done += len;
+  }
+  if (op->done != start) {
+    tcp_output(pcb);
+  }
+  if ((err != ERR_OK) && (err != ERR_MEM)) {
+    return err;
+  }
+  if (op->done < op->sqe.len) {
+    /* sent_tcp() or poll_tcp() report when there is space again */
+    netconn_set_flags(conn, NETCONN_FLAG_CHECK_WRITESPACE);
+    netconn_tcp_poll_update(conn);
+    return ERR_INPROGRESS;
+  }
+  return ERR_OK;
+}
+
+/**
+ * Go on with the netconn_ring operations waiting for a netconn. Operations
+ * are completed in order for each direction: receiving (ACCEPT, RECV) and
+ * sending (CONNECT, SEND).
+ */
+static void
+netconn_ring_progress(struct netconn *conn)
+{
+  struct netconn_ring_op **pop = &conn->ring_ops;
+  struct netconn_ring_op *op;
+  u8_t blocked = 0;
+  u8_t dir;
+  err_t err;
+
+  while ((op = *pop) != NULL) {
+    if ((op->sqe.opcode == NETCONN_RING_ACCEPT) || (op->sqe.opcode == NETCONN_RING_RECV)) {
+      dir = NETCONN_SHUT_RD;
+    } else {
+      dir = NETCONN_SHUT_WR;
+    }
+    if ((blocked & dir) == 0) {
+      switch (op->sqe.opcode) {
+        case NETCONN_RING_ACCEPT:
+          err = netconn_ring_accept(conn, op);
+          break;
+        case NETCONN_RING_CONNECT:
+          err = netconn_ring_connect(conn, op);
+          break;
+        case NETCONN_RING_RECV:
+          err = netconn_ring_recv(conn, op);
+          break;
+        case NETCONN_RING_SEND:
+          err = netconn_ring_send(conn, op);
+          break;
+        default:
+          err = ERR_ARG;
+          break;
+      }
+      if (err != ERR_INPROGRESS) {
+        *pop = op->next;
+        netconn_ring_complete(op, err);
+        continue;
+      }
+      blocked |= dir;
+    }
+    pop = &op->next;
+  }
+}
+
+/** Close and free a netconn for a netconn_ring CLOSE (like netconn_delete,
+    but without waiting: if there is no memory for the FIN, the connection
+    is reset). The operations still waiting for it complete with ERR_CLSD. */
+static err_t
+netconn_ring_close(struct netconn *conn)
+{
+  struct tcp_pcb *tpcb = conn->pcb.tcp;
+  struct netconn_ring_op *op;
+
+  if ((conn->state != NETCONN_NONE) && (conn->state != NETCONN_LISTEN) &&
+      ((conn->state != NETCONN_CONNECT) || !IN_NONBLOCKING_CONNECT(conn))) {
+    /* a blocking netconn call is running for this netconn */
+    return ERR_INPROGRESS;
+  }
+  while (conn->ring_ops != NULL) {
+    op = conn->ring_ops;
+    conn->ring_ops = op->next;
+    netconn_ring_complete(op, ERR_CLSD);
+  }
+#if LWIP_NETCONN_FULLDUPLEX
+  /* netconn_free() drains the mboxes */
+  netconn_mark_mbox_invalid(conn);
+#else /* LWIP_NETCONN_FULLDUPLEX */
+  netconn_drain(conn);
+#endif /* LWIP_NETCONN_FULLDUPLEX */
+  if (tpcb != NULL) {
+    conn->pcb.tcp = NULL;
+    tcp_arg(tpcb, NULL);
+    if (tpcb->state == LISTEN) {
+      tcp_accept(tpcb, NULL);
+      tcp_close(tpcb);
+    } else {
+      tcp_recv(tpcb, NULL);
+      tcp_sent(tpcb, NULL);
+      tcp_poll(tpcb, NULL, 0);
+      tcp_err(tpcb, NULL);
+      if (tcp_close(tpcb) != ERR_OK) {
+        tcp_abort(tpcb);
+      }
+    }
+  }
+  netconn_free(conn);
+  return ERR_OK;
+}
+
+/** Start an operation taken from the submission ring */
+static void
+netconn_ring_start(struct netconn_ring *ring, const struct netconn_ring_sqe *sqe)
+{
+  struct netconn_ring_op *op = ring->free_ops;
+  struct netconn_ring_op **tail;
+  struct netconn *conn = sqe->conn;
+
+  LWIP_ASSERT("no free netconn_ring_op", op != NULL);
+  ring->free_ops = op->next;
+  op->next = NULL;
+  op->ring = ring;
+  op->sqe = *sqe;
+  op->done = 0;
+  op->newconn = NULL;
+  op->started = 0;
+
+  if ((conn == NULL) || (NETCONNTYPE_GROUP(conn->type) != NETCONN_TCP) ||
+      (conn->callback != netconn_ring_callback) ||
+      ((op->sqe.opcode == NETCONN_RING_RECV) && ((op->sqe.buf == NULL) || (op->sqe.len == 0))) ||
+      ((op->sqe.opcode == NETCONN_RING_SEND) && (op->sqe.buf == NULL) && (op->sqe.len != 0))) {
+    netconn_ring_complete(op, ERR_ARG);
+    return;
+  }
+  if (op->sqe.opcode == NETCONN_RING_CLOSE) {
+    netconn_ring_complete(op, netconn_ring_close(conn));
+    return;
+  }
+  tail = &conn->ring_ops;
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+  *tail = op;
+  netconn_ring_progress(conn);
+}
+
+/**
+ * Process the submission ring of a netconn_ring.
+ * Called from netconn_ring_submit (through submit_msg if not core locking).
+ *
+ * @param arg the netconn_ring
+ */
+void
+lwip_netconn_do_ring_submit(void *arg)
+{
+  struct netconn_ring *ring = (struct netconn_ring *)arg;
+  u16_t tail;
+  u8_t deleted;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    tail = ring->sq_tail;
+    if (tail == ring->sq_head) {
+      ring->scheduled = 0;
+      deleted = ring->deleted;
+      SYS_ARCH_UNPROTECT(lev);
+      if (deleted) {
+        netconn_ring_free(ring);
+      }
+      return;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    while (ring->sq_head != tail) {
+      netconn_ring_start(ring, &ring->sq[ring->sq_head & (ring->entries - 1)]);
+      ring->sq_head++;
+    }
+  }
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Callback to create the TCP netconns used with a netconn_ring with (see
+ * @ref netconn_new_with_callback): it goes on with the operations waiting for
+ * the netconn. Netconns accepted by a netconn_ring ACCEPT inherit it.
+ */
+void
+netconn_ring_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
+{
+  LWIP_UNUSED_ARG(len);
+
+  /* only the tcpip_thread reports data, send space or errors ('MINUS' events
+     may come from application threads) */
+  if (((evt == NETCONN_EVT_RCVPLUS) || (evt == NETCONN_EVT_SENDPLUS) ||
+       (evt == NETCONN_EVT_ERROR)) && (conn->ring_ops != NULL)) {
+    netconn_ring_progress(conn);
+  }
+}
+#endif /* LWIP_TCP && LWIP_NETCONN_RING */
+
 #endif /* LWIP_NETCONN */
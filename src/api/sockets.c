@@ -322,6 +322,12 @@ static volatile int select_cb_ctr;
 static struct lwip_select_cb *select_cb_list;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** The epoll instances, their file descriptors follow those of the sockets */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_NUM];
+#define LWIP_EPOLL_FD_OFFSET  (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+#endif /* LWIP_SOCKET_EPOLL */
+
 /* Forward declaration of some functions */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 static void event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
@@ -330,6 +336,12 @@ static void select_check_waiters(int s, int has_recvevent, int has_sendevent, in
 #else
 #define DEFAULT_SOCKET_EVENTCB NULL
 #endif
+#if LWIP_SOCKET_EPOLL
+static struct lwip_epoll *get_epoll(int epfd);
+static void lwip_epoll_close(struct lwip_epoll *ep);
+static void lwip_epoll_sock_detach(struct lwip_sock *sock);
+static void lwip_epoll_sock_event(struct lwip_sock *sock, u32_t event);
+#endif /* LWIP_SOCKET_EPOLL */
 #if !LWIP_TCPIP_CORE_LOCKING
 static void lwip_getsockopt_callback(void *arg);
 static void lwip_setsockopt_callback(void *arg);
@@ -561,6 +573,9 @@ alloc_socket(struct netconn *newconn, int accepted)
          after having marked it as used. */
       SYS_ARCH_UNPROTECT(lev);
       sockets[i].lastdata.pbuf = NULL;
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+      sockets[i].zerocopy = 0;
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
       LWIP_ASSERT("sockets[i].select_waiting == 0", sockets[i].select_waiting == 0);
       sockets[i].rcvevent   = 0;
@@ -569,6 +584,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
       sockets[i].errevent   = 0;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+      LWIP_ASSERT("sockets[i].epoll_items == NULL", sockets[i].epoll_items == NULL);
+#endif /* LWIP_SOCKET_EPOLL */
       return i + LWIP_SOCKET_OFFSET;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -817,6 +835,18 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (s >= LWIP_EPOLL_FD_OFFSET) {
+    struct lwip_epoll *ep = get_epoll(s);
+    if (ep == NULL) {
+      return -1;
+    }
+    lwip_epoll_close(ep);
+    set_errno(0);
+    return 0;
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -844,6 +874,11 @@ lwip_close(int s)
     return -1;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* remove the socket from all interest sets */
+  lwip_epoll_sock_detach(sock);
+#endif /* LWIP_SOCKET_EPOLL */
+
   free_socket(sock, is_tcp);
   set_errno(0);
   return 0;
@@ -1121,43 +1156,18 @@ lwip_recv_tcp_from(struct lwip_sock *sock, struct sockaddr *from, socklen_t *fro
 }
 #endif
 
-/* Helper function to receive a netbuf from a udp or raw netconn.
- * Keeps sock->lastdata for peeking.
+/* Helper function to copy a received netbuf into a msghdr (data, source
+ * address and packet info).
+ * @return the length of the datagram
  */
-static err_t
-lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16_t *datagram_len, int dbg_s)
+static u16_t
+lwip_recvfrom_udp_raw_copy(struct lwip_sock *sock, struct netbuf *buf, struct msghdr *msg, int dbg_s)
 {
-  struct netbuf *buf;
-  u8_t apiflags;
-  err_t err;
   u16_t buflen, copylen, copied;
   msg_iovlen_t i;
 
   LWIP_UNUSED_ARG(dbg_s);
-  LWIP_ERROR("lwip_recvfrom_udp_raw: invalid arguments", (msg->msg_iov != NULL) || (msg->msg_iovlen <= 0), return ERR_ARG;);
-
-  if (flags & MSG_DONTWAIT) {
-    apiflags = NETCONN_DONTBLOCK;
-  } else {
-    apiflags = 0;
-  }
-
-  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw[UDP/RAW]: top sock->lastdata=%p\n", (void *)sock->lastdata.netbuf));
-  /* Check if there is data left from the last recv operation. */
-  buf = sock->lastdata.netbuf;
-  if (buf == NULL) {
-    /* No data was left from the previous operation, so we try to get
-        some from the network. */
-    err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, apiflags);
-    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw[UDP/RAW]: netconn_recv err=%d, netbuf=%p\n",
-                                err, (void *)buf));
 
-    if (err != ERR_OK) {
-      return err;
-    }
-    LWIP_ASSERT("buf != NULL", buf != NULL);
-    sock->lastdata.netbuf = buf;
-  }
   buflen = buf->p->tot_len;
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw: buflen=%"U16_F"\n", buflen));
 
@@ -1223,6 +1233,45 @@ lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16
       msg->msg_controllen = 0;
     }
   }
+  return buflen;
+}
+
+/* Helper function to receive a netbuf from a udp or raw netconn.
+ * Keeps sock->lastdata for peeking.
+ */
+static err_t
+lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16_t *datagram_len, int dbg_s)
+{
+  struct netbuf *buf;
+  u8_t apiflags;
+  err_t err;
+  u16_t buflen;
+
+  LWIP_ERROR("lwip_recvfrom_udp_raw: invalid arguments", (msg->msg_iov != NULL) || (msg->msg_iovlen <= 0), return ERR_ARG;);
+
+  if (flags & MSG_DONTWAIT) {
+    apiflags = NETCONN_DONTBLOCK;
+  } else {
+    apiflags = 0;
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw[UDP/RAW]: top sock->lastdata=%p\n", (void *)sock->lastdata.netbuf));
+  /* Check if there is data left from the last recv operation. */
+  buf = sock->lastdata.netbuf;
+  if (buf == NULL) {
+    /* No data was left from the previous operation, so we try to get
+        some from the network. */
+    err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, apiflags);
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw[UDP/RAW]: netconn_recv err=%d, netbuf=%p\n",
+                                err, (void *)buf));
+
+    if (err != ERR_OK) {
+      return err;
+    }
+    LWIP_ASSERT("buf != NULL", buf != NULL);
+    sock->lastdata.netbuf = buf;
+  }
+  buflen = lwip_recvfrom_udp_raw_copy(sock, buf, msg, dbg_s);
 
   /* If we don't peek the incoming message: zero lastdata pointer and free the netbuf */
   if ((flags & MSG_PEEK) == 0) {
@@ -1317,6 +1366,90 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+/** recvmsg(MSG_ERRQUEUE): report completed zero-copy sends like Linux does,
+ * in a struct sock_extended_err (cmsg IP_RECVERR or IPV6_RECVERR).
+ * Never blocks and never receives data.
+ */
+static ssize_t
+lwip_recvmsg_errqueue(int s, struct msghdr *message)
+{
+  struct lwip_sock *sock;
+  struct cmsghdr *chdr;
+  struct sock_extended_err *serr;
+  u32_t lo, hi;
+  err_t err;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP) {
+    /* nothing is ever queued */
+    set_errno(EAGAIN);
+    done_socket(sock);
+    return -1;
+  }
+  if ((message->msg_control == NULL) ||
+      (message->msg_controllen < CMSG_SPACE(sizeof(struct sock_extended_err)))) {
+    /* check before netconn_zerocopy_completed() to not lose completions */
+    set_errno(EINVAL);
+    done_socket(sock);
+    return -1;
+  }
+  err = netconn_zerocopy_completed(sock->conn, &lo, &hi);
+  if (err != ERR_OK) {
+    set_errno(err_to_errno(err));
+    done_socket(sock);
+    return -1;
+  }
+
+  chdr = CMSG_FIRSTHDR(message);
+#if LWIP_IPV6
+  if (NETCONNTYPE_ISIPV6(netconn_type(sock->conn))) {
+    chdr->cmsg_level = IPPROTO_IPV6;
+    chdr->cmsg_type = IPV6_RECVERR;
+  } else
+#endif /* LWIP_IPV6 */
+  {
+    chdr->cmsg_level = IPPROTO_IP;
+    chdr->cmsg_type = IP_RECVERR;
+  }
+  chdr->cmsg_len = CMSG_LEN(sizeof(struct sock_extended_err));
+  serr = (struct sock_extended_err *)CMSG_DATA(chdr);
+  memset(serr, 0, sizeof(struct sock_extended_err));
+  serr->ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+  serr->ee_info = lo;
+  serr->ee_data = hi;
+  message->msg_controllen = CMSG_SPACE(sizeof(struct sock_extended_err));
+  message->msg_flags = 0;
+
+  set_errno(0);
+  done_socket(sock);
+  return 0;
+}
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
+
+/* Helper function to check the receive vectors of a msghdr.
+ * @return the sum of the vector lengths, -1 if the vectors are invalid
+ */
+static ssize_t
+lwip_recvmsg_iov_len(const struct msghdr *message)
+{
+  msg_iovlen_t i;
+  ssize_t buflen = 0;
+
+  for (i = 0; i < message->msg_iovlen; i++) {
+    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
+        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
+        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
+      return -1;
+    }
+    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  }
+  return buflen;
+}
+
 ssize_t
 lwip_recvmsg(int s, struct msghdr *message, int flags)
 {
@@ -1326,6 +1459,11 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg(%d, message=%p, flags=0x%x)\n", s, (void *)message, flags));
   LWIP_ERROR("lwip_recvmsg: invalid message pointer", message != NULL, return ERR_ARG;);
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+  if (flags & MSG_ERRQUEUE) {
+    return lwip_recvmsg_errqueue(s, message);
+  }
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
   LWIP_ERROR("lwip_recvmsg: unsupported flags", (flags & ~(MSG_PEEK|MSG_DONTWAIT)) == 0,
              set_errno(EOPNOTSUPP); return -1;);
 
@@ -1340,16 +1478,11 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
   }
 
   /* check for valid vectors */
-  buflen = 0;
-  for (i = 0; i < message->msg_iovlen; i++) {
-    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
-        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
-        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
-      set_errno(err_to_errno(ERR_VAL));
-      done_socket(sock);
-      return -1;
-    }
-    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  buflen = lwip_recvmsg_iov_len(message);
+  if (buflen < 0) {
+    set_errno(err_to_errno(ERR_VAL));
+    done_socket(sock);
+    return -1;
   }
 
   if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
@@ -1418,6 +1551,330 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
 #endif /* LWIP_UDP || LWIP_RAW */
 }
 
+#if LWIP_SOCKET_MMSG
+/**
+ * Receive up to 'vlen' messages with one call. TCP sockets are read like with
+ * one lwip_recvmsg() per message. For UDP and RAW, the datagrams after the
+ * first one are fetched from the netconn in batches of LWIP_SOCKET_MMSG_BATCH.
+ * MSG_PEEK only returns the first datagram. A timeout is not supported (pass
+ * NULL, use SO_RCVTIMEO instead).
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout)
+{
+  struct lwip_sock *sock;
+  unsigned int i, n;
+  ssize_t buflen;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_recvmmsg: unsupported flags", (flags & ~(MSG_PEEK | MSG_DONTWAIT | MSG_WAITFORONE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: timeout not supported", timeout == NULL,
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    ssize_t ret = 0;
+    done_socket(sock);
+    for (n = 0; n < vlen; n++) {
+      ret = lwip_recvmsg(s, &msgvec[n].msg_hdr, flags & (MSG_PEEK | MSG_DONTWAIT));
+      if (ret <= 0) {
+        break;
+      }
+      msgvec[n].msg_len = (unsigned int)ret;
+      if (flags & MSG_WAITFORONE) {
+        flags |= MSG_DONTWAIT;
+      }
+    }
+    if ((n == 0) && (ret < 0)) {
+      return -1;
+    }
+    set_errno(0);
+    return (int)n;
+  }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  /* check for valid vectors */
+  for (i = 0; i < vlen; i++) {
+    if ((msgvec[i].msg_hdr.msg_iov == NULL) || (msgvec[i].msg_hdr.msg_iovlen <= 0) ||
+        (msgvec[i].msg_hdr.msg_iovlen > IOV_MAX)) {
+      set_errno(EMSGSIZE);
+      done_socket(sock);
+      return -1;
+    }
+    if (lwip_recvmsg_iov_len(&msgvec[i].msg_hdr) < 0) {
+      set_errno(err_to_errno(ERR_VAL));
+      done_socket(sock);
+      return -1;
+    }
+  }
+  if (vlen == 0) {
+    done_socket(sock);
+    return 0;
+  }
+
+  {
+    u16_t datagram_len = 0;
+    err_t err;
+    u8_t apiflags;
+
+    /* the first datagram is received (and peeked) like by lwip_recvmsg() */
+    err = lwip_recvfrom_udp_raw(sock, flags & (MSG_PEEK | MSG_DONTWAIT), &msgvec[0].msg_hdr, &datagram_len, s);
+    if (err != ERR_OK) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg[UDP/RAW](%d): buf == NULL, error is \"%s\"!\n",
+                                  s, lwip_strerr(err)));
+      set_errno(err_to_errno(err));
+      done_socket(sock);
+      return -1;
+    }
+    n = 0;
+    buflen = lwip_recvmsg_iov_len(&msgvec[n].msg_hdr);
+    if (datagram_len > buflen) {
+      msgvec[n].msg_hdr.msg_flags |= MSG_TRUNC;
+    }
+    msgvec[n].msg_len = datagram_len;
+    n++;
+
+    apiflags = (flags & (MSG_DONTWAIT | MSG_WAITFORONE)) ? NETCONN_DONTBLOCK : 0;
+    while (((flags & MSG_PEEK) == 0) && (n < vlen)) {
+      struct netbuf *bufs[LWIP_SOCKET_MMSG_BATCH];
+      u16_t num, received, j;
+
+      num = (u16_t)LWIP_MIN(vlen - n, LWIP_SOCKET_MMSG_BATCH);
+      err = netconn_recv_udp_raw_multi(sock->conn, bufs, num, &received, apiflags);
+      if (err != ERR_OK) {
+        /* we have received something: the error is reported by the next call */
+        break;
+      }
+      for (j = 0; j < received; j++, n++) {
+        datagram_len = lwip_recvfrom_udp_raw_copy(sock, bufs[j], &msgvec[n].msg_hdr, s);
+        netbuf_delete(bufs[j]);
+        buflen = lwip_recvmsg_iov_len(&msgvec[n].msg_hdr);
+        if (datagram_len > buflen) {
+          msgvec[n].msg_hdr.msg_flags |= MSG_TRUNC;
+        }
+        msgvec[n].msg_len = datagram_len;
+      }
+      if ((apiflags & NETCONN_DONTBLOCK) && (received < num)) {
+        break;
+      }
+    }
+  }
+
+  set_errno(0);
+  done_socket(sock);
+  return (int)n;
+#else /* LWIP_UDP || LWIP_RAW */
+  LWIP_UNUSED_ARG(i);
+  LWIP_UNUSED_ARG(buflen);
+  set_errno(err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+#endif /* LWIP_SOCKET_MMSG */
+
+#if LWIP_SOCKET_ZEROCOPY_RECV
+/* Point the iovecs of 'msg' at the pbufs of 'p' (one per pbuf, at most
+ * msg_iovlen) and cut the chain after the last pbuf that got one.
+ * @return the rest of the chain (NULL if all of it fit)
+ */
+static struct pbuf *
+lwip_recvmsg_zerocopy_iov(struct pbuf *p, struct msghdr *msg)
+{
+  struct pbuf *q, *last = NULL, *rest;
+  msg_iovlen_t i = 0;
+
+  for (q = p; (q != NULL) && (i < msg->msg_iovlen); q = q->next) {
+    msg->msg_iov[i].iov_base = q->payload;
+    msg->msg_iov[i].iov_len = q->len;
+    i++;
+    last = q;
+  }
+  msg->msg_iovlen = i;
+  LWIP_ASSERT("last != NULL", last != NULL);
+  rest = last->next;
+  if (rest != NULL) {
+    /* the reference of the rest is passed from 'last' to the caller */
+    last->next = NULL;
+    for (q = p; q != NULL; q = q->next) {
+      q->tot_len = (u16_t)(q->tot_len - rest->tot_len);
+    }
+  }
+  return rest;
+}
+
+/**
+ * Receive without copying: instead of filling the buffers of message->msg_iov,
+ * point its entries at the data in the stack's buffers (one entry per pbuf,
+ * message->msg_iovlen is updated to the number used). The data is loaned to
+ * the application until it passes '*loan' to lwip_recvmsg_release(), it must
+ * not be written to.
+ *
+ * TCP: the data received so far is returned, up to msg_iovlen pbufs (and
+ * 64KB) of it; the rest is returned by the next call. This waits for data
+ * like lwip_recv() does. The receive window is only opened again when the
+ * data is released.
+ * UDP/RAW: one datagram, msg_name is filled like by lwip_recvmsg(). If it has
+ * more than msg_iovlen pbufs, the rest is discarded and MSG_TRUNC is set.
+ * Ancillary data is not supported (msg_controllen is set to 0).
+ *
+ * Only MSG_DONTWAIT is supported.
+ *
+ * @return the number of bytes loaned, 0 at the end of a TCP stream, -1 on error
+ */
+ssize_t
+lwip_recvmsg_zerocopy(int s, struct msghdr *message, int flags, void **loan)
+{
+  struct lwip_sock *sock;
+  struct pbuf *p;
+  u8_t apiflags = 0;
+  err_t err;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zerocopy(%d, message=%p, flags=0x%x)\n", s, (void *)message, flags));
+  LWIP_ERROR("lwip_recvmsg_zerocopy: unsupported flags", (flags & ~MSG_DONTWAIT) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  LWIP_ERROR("lwip_recvmsg_zerocopy: invalid arguments", (message != NULL) && (loan != NULL),
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_recvmsg_zerocopy: invalid iov", (message->msg_iov != NULL) && (message->msg_iovlen > 0),
+             set_errno(EMSGSIZE); return -1;);
+
+  *loan = NULL;
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  if (flags & MSG_DONTWAIT) {
+    apiflags = NETCONN_DONTBLOCK;
+  }
+  message->msg_flags = 0;
+  message->msg_controllen = 0;
+
+#if LWIP_TCP
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    struct pbuf *next;
+    u16_t clen;
+
+    p = sock->lastdata.pbuf;
+    sock->lastdata.pbuf = NULL;
+    if (p == NULL) {
+      err = netconn_recv_tcp_pbuf_flags(sock->conn, &p, (u8_t)(apiflags | NETCONN_NOAUTORCVD));
+      if (err != ERR_OK) {
+        LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zerocopy[TCP](%d): error is \"%s\"!\n", s, lwip_strerr(err)));
+        set_errno(err_to_errno(err));
+        done_socket(sock);
+        return (err == ERR_CLSD) ? 0 : -1;
+      }
+    }
+    /* add what is queued already as long as it fits into the iovecs (a
+       chain that does not fit is left for the next call) */
+    clen = pbuf_clen(p);
+    while (clen < message->msg_iovlen) {
+      if (netconn_recv_tcp_pbuf_flags(sock->conn, &next, NETCONN_DONTBLOCK | NETCONN_NOAUTORCVD | NETCONN_NOFIN) != ERR_OK) {
+        break;
+      }
+      if ((clen + pbuf_clen(next) > message->msg_iovlen) || (p->tot_len > 0xFFFF - next->tot_len)) {
+        sock->lastdata.pbuf = next;
+        break;
+      }
+      clen = (u16_t)(clen + pbuf_clen(next));
+      pbuf_cat(p, next);
+    }
+    /* msg_name is ignored like by lwip_recvmsg() */
+    next = lwip_recvmsg_zerocopy_iov(p, message);
+    if (next != NULL) {
+      /* only the first chain can be too long */
+      LWIP_ASSERT("lastdata == NULL", sock->lastdata.pbuf == NULL);
+      sock->lastdata.pbuf = next;
+    }
+  } else
+#endif /* LWIP_TCP */
+  {
+#if LWIP_UDP || LWIP_RAW
+    struct netbuf *buf = sock->lastdata.netbuf;
+    struct pbuf *rest;
+
+    if (buf == NULL) {
+      err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, apiflags);
+      if (err != ERR_OK) {
+        LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zerocopy[UDP/RAW](%d): error is \"%s\"!\n", s, lwip_strerr(err)));
+        set_errno(err_to_errno(err));
+        done_socket(sock);
+        return -1;
+      }
+    }
+    sock->lastdata.netbuf = NULL;
+    if (message->msg_name && message->msg_namelen) {
+      lwip_sock_make_addr(sock->conn, netbuf_fromaddr(buf), netbuf_fromport(buf),
+                          (struct sockaddr *)message->msg_name, &message->msg_namelen);
+    }
+    /* only the pbufs are loaned, the netbuf is not needed any more */
+    p = buf->p;
+    buf->p = buf->ptr = NULL;
+    netbuf_delete(buf);
+    rest = lwip_recvmsg_zerocopy_iov(p, message);
+    if (rest != NULL) {
+      pbuf_free(rest);
+      message->msg_flags |= MSG_TRUNC;
+    }
+#else /* LWIP_UDP || LWIP_RAW */
+    set_errno(err_to_errno(ERR_ARG));
+    done_socket(sock);
+    return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+  }
+
+  *loan = p;
+  set_errno(0);
+  done_socket(sock);
+  return p->tot_len;
+}
+
+/**
+ * Give back data loaned by lwip_recvmsg_zerocopy(). For TCP, this opens the
+ * receive window by the amount released. The data is freed even if the
+ * socket has been closed in the meantime (-1 is returned then).
+ *
+ * @param s the socket the data was received from
+ * @param loan the value lwip_recvmsg_zerocopy() returned in '*loan'
+ */
+int
+lwip_recvmsg_release(int s, void *loan)
+{
+  struct lwip_sock *sock;
+  struct pbuf *p = (struct pbuf *)loan;
+  u16_t len;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_release(%d, loan=%p)\n", s, loan));
+  LWIP_ERROR("lwip_recvmsg_release: invalid loan", p != NULL,
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+
+  len = p->tot_len;
+  pbuf_free(p);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+#if LWIP_TCP
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    netconn_tcp_recvd(sock->conn, len);
+  }
+#else /* LWIP_TCP */
+  LWIP_UNUSED_ARG(len);
+#endif /* LWIP_TCP */
+  set_errno(0);
+  done_socket(sock);
+  return 0;
+}
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
+
 ssize_t
 lwip_send(int s, const void *data, size_t size, int flags)
 {
@@ -1448,6 +1905,12 @@ lwip_send(int s, const void *data, size_t size, int flags)
   write_flags = (u8_t)(NETCONN_COPY |
                        ((flags & MSG_MORE)     ? NETCONN_MORE      : 0) |
                        ((flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0));
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+  if ((flags & MSG_ZEROCOPY) && sock->zerocopy) {
+    /* overrides NETCONN_COPY */
+    write_flags |= NETCONN_ZEROCOPY;
+  }
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
   written = 0;
   err = netconn_write_partly(sock->conn, data, size, write_flags, &written);
 
@@ -1458,6 +1921,126 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (ssize_t)written : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/* Helper function to build the netbuf for sending a msghdr on a udp or raw
+ * netconn (destination address and data, referencing the IO vectors unless
+ * LWIP_NETIF_TX_SINGLE_PBUF is enabled).
+ * @return 0 on success (chain_buf must be freed by the caller), an errno
+ *         value on error (chain_buf is freed already)
+ */
+static int
+lwip_sendmsg_udp_raw_netbuf(const struct msghdr *msg, struct netbuf *chain_buf)
+{
+  msg_iovlen_t i;
+  err_t err = ERR_OK;
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  ssize_t size = 0;
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+
+  /* initialize chain buffer with destination */
+  memset(chain_buf, 0, sizeof(struct netbuf));
+  LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
+             IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
+             return err_to_errno(ERR_ARG););
+  if (msg->msg_name) {
+    u16_t remote_port;
+    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf->addr, remote_port);
+    netbuf_fromport(chain_buf) = remote_port;
+  }
+#if LWIP_UDP && LWIP_UDP_GSO
+  if (msg->msg_control != NULL) {
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+      if ((cmsg->cmsg_level == IPPROTO_UDP) && (cmsg->cmsg_type == UDP_SEGMENT)) {
+        u16_t gso_size;
+        LWIP_ERROR("lwip_sendmsg: invalid UDP_SEGMENT cmsg", cmsg->cmsg_len == CMSG_LEN(sizeof(u16_t)),
+                   return err_to_errno(ERR_ARG););
+        MEMCPY(&gso_size, CMSG_DATA(cmsg), sizeof(u16_t));
+        netbuf_set_gso_size(chain_buf, gso_size);
+      }
+    }
+  }
+#endif /* LWIP_UDP && LWIP_UDP_GSO */
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    size += msg->msg_iov[i].iov_len;
+    if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
+      /* overflow */
+      goto sendmsg_emsgsize;
+    }
+  }
+  if (size > 0xFFFF) {
+    /* overflow */
+    goto sendmsg_emsgsize;
+  }
+  /* Allocate a new netbuf and copy the data into it. */
+  if (netbuf_alloc(chain_buf, (u16_t)size) == NULL) {
+    err = ERR_MEM;
+  } else {
+    /* flatten the IO vectors */
+    size_t offset = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      MEMCPY(&((u8_t *)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      offset += msg->msg_iov[i].iov_len;
+    }
+#if LWIP_CHECKSUM_ON_COPY
+    {
+      /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
+      u16_t chksum = ~inet_chksum_pbuf(chain_buf->p);
+      netbuf_set_chksum(chain_buf, chksum);
+    }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
+     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p;
+    if (msg->msg_iov[i].iov_len > 0xFFFF) {
+      /* overflow */
+      goto sendmsg_emsgsize;
+    }
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      err = ERR_MEM; /* let netbuf_free() cleanup chain_buf */
+      break;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    /* netbuf empty, add new pbuf */
+    if (chain_buf->p == NULL) {
+      chain_buf->p = chain_buf->ptr = p;
+      /* add pbuf to existing pbuf chain */
+    } else {
+      if (chain_buf->p->tot_len + p->len > 0xffff) {
+        /* overflow */
+        pbuf_free(p);
+        goto sendmsg_emsgsize;
+      }
+      pbuf_cat(chain_buf->p, p);
+    }
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+
+  if (err != ERR_OK) {
+    netbuf_free(chain_buf);
+    return err_to_errno(err);
+  }
+#if LWIP_IPV4 && LWIP_IPV6
+  /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
+  if (IP_IS_V6_VAL(chain_buf->addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf->addr))) {
+    unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf->addr), ip_2_ip6(&chain_buf->addr));
+    IP_SET_TYPE_VAL(chain_buf->addr, IPADDR_TYPE_V4);
+  }
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+  return 0;
+
+sendmsg_emsgsize:
+  netbuf_free(chain_buf);
+  return EMSGSIZE;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
 ssize_t
 lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 {
@@ -1479,7 +2062,7 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
              set_errno(err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
   LWIP_ERROR("lwip_sendmsg: maximum iovs exceeded", (msg->msg_iovlen > 0) && (msg->msg_iovlen <= IOV_MAX),
              set_errno(EMSGSIZE); done_socket(sock); return -1;);
-  LWIP_ERROR("lwip_sendmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+  LWIP_ERROR("lwip_sendmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE | MSG_ZEROCOPY)) == 0,
              set_errno(EOPNOTSUPP); done_socket(sock); return -1;);
 
   LWIP_UNUSED_ARG(msg->msg_control);
@@ -1491,6 +2074,12 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
     write_flags = (u8_t)(NETCONN_COPY |
                          ((flags & MSG_MORE)     ? NETCONN_MORE      : 0) |
                          ((flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0));
+#if LWIP_SO_ZEROCOPY
+    if ((flags & MSG_ZEROCOPY) && sock->zerocopy) {
+      /* overrides NETCONN_COPY */
+      write_flags |= NETCONN_ZEROCOPY;
+    }
+#endif /* LWIP_SO_ZEROCOPY */
 
     written = 0;
     err = netconn_write_vectors_partly(sock->conn, (struct netvector *)msg->msg_iov, (u16_t)msg->msg_iovlen, write_flags, &written);
@@ -1508,118 +2097,129 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 #if LWIP_UDP || LWIP_RAW
   {
     struct netbuf chain_buf;
-    msg_iovlen_t i;
-    ssize_t size = 0;
+    ssize_t size;
+    int ret;
 
     LWIP_UNUSED_ARG(flags);
-    LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
-               IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
-               set_errno(err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
-
-    /* initialize chain buffer with destination */
-    memset(&chain_buf, 0, sizeof(struct netbuf));
-    if (msg->msg_name) {
-      u16_t remote_port;
-      SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf.addr, remote_port);
-      netbuf_fromport(&chain_buf) = remote_port;
+    ret = lwip_sendmsg_udp_raw_netbuf(msg, &chain_buf);
+    if (ret != 0) {
+      set_errno(ret);
+      done_socket(sock);
+      return -1;
     }
-#if LWIP_NETIF_TX_SINGLE_PBUF
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      size += msg->msg_iov[i].iov_len;
-      if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
-        /* overflow */
-        goto sendmsg_emsgsize;
+    size = netbuf_len(&chain_buf);
+
+    /* send the data */
+    err = netconn_send(sock->conn, &chain_buf);
+
+    /* deallocated the buffer */
+    netbuf_free(&chain_buf);
+
+    set_errno(err_to_errno(err));
+    done_socket(sock);
+    return (err == ERR_OK ? size : -1);
+  }
+#else /* LWIP_UDP || LWIP_RAW */
+  set_errno(err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+#if LWIP_SOCKET_MMSG
+/**
+ * Send up to 'vlen' messages with one call. TCP sockets are written like with
+ * one lwip_sendmsg() per message. For UDP and RAW, the datagrams are passed to
+ * the tcpip thread in batches of LWIP_SOCKET_MMSG_BATCH (one API message or
+ * core lock per batch). Sending stops at the first error.
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int n;
+  int ret = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    ssize_t written = 0;
+    done_socket(sock);
+    for (n = 0; n < vlen; n++) {
+      written = lwip_sendmsg(s, &msgvec[n].msg_hdr, flags);
+      if (written < 0) {
+        break;
       }
+      msgvec[n].msg_len = (unsigned int)written;
     }
-    if (size > 0xFFFF) {
-      /* overflow */
-      goto sendmsg_emsgsize;
-    }
-    /* Allocate a new netbuf and copy the data into it. */
-    if (netbuf_alloc(&chain_buf, (u16_t)size) == NULL) {
-      err = ERR_MEM;
-    } else {
-      /* flatten the IO vectors */
-      size_t offset = 0;
-      for (i = 0; i < msg->msg_iovlen; i++) {
-        MEMCPY(&((u8_t *)chain_buf.p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
-        offset += msg->msg_iov[i].iov_len;
-      }
-#if LWIP_CHECKSUM_ON_COPY
-      {
-        /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-        u16_t chksum = ~inet_chksum_pbuf(chain_buf.p);
-        netbuf_set_chksum(&chain_buf, chksum);
-      }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-      err = ERR_OK;
+    if ((n == 0) && (written < 0)) {
+      return -1;
     }
-#else /* LWIP_NETIF_TX_SINGLE_PBUF */
-    /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
-       manually to avoid having to allocate, chain, and delete a netbuf for each iov */
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      struct pbuf *p;
-      if (msg->msg_iov[i].iov_len > 0xFFFF) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
-      p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
-      if (p == NULL) {
-        err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
+    set_errno(0);
+    return (int)n;
+  }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  LWIP_ERROR("lwip_sendmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+             set_errno(EOPNOTSUPP); done_socket(sock); return -1;);
+
+  n = 0;
+  while ((ret == 0) && (n < vlen)) {
+    struct netbuf bufs[LWIP_SOCKET_MMSG_BATCH];
+    struct netbuf *pbufs[LWIP_SOCKET_MMSG_BATCH];
+    u16_t num, built, sent, i;
+    err_t err;
+
+    num = (u16_t)LWIP_MIN(vlen - n, LWIP_SOCKET_MMSG_BATCH);
+    for (built = 0; built < num; built++) {
+      struct mmsghdr *mmsg = &msgvec[n + built];
+      if ((mmsg->msg_hdr.msg_iov == NULL) || (mmsg->msg_hdr.msg_iovlen <= 0) ||
+          (mmsg->msg_hdr.msg_iovlen > IOV_MAX)) {
+        ret = EMSGSIZE;
         break;
       }
-      p->payload = msg->msg_iov[i].iov_base;
-      p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
-      /* netbuf empty, add new pbuf */
-      if (chain_buf.p == NULL) {
-        chain_buf.p = chain_buf.ptr = p;
-        /* add pbuf to existing pbuf chain */
-      } else {
-        if (chain_buf.p->tot_len + p->len > 0xffff) {
-          /* overflow */
-          pbuf_free(p);
-          goto sendmsg_emsgsize;
-        }
-        pbuf_cat(chain_buf.p, p);
+      ret = lwip_sendmsg_udp_raw_netbuf(&mmsg->msg_hdr, &bufs[built]);
+      if (ret != 0) {
+        break;
       }
+      mmsg->msg_len = netbuf_len(&bufs[built]);
+      pbufs[built] = &bufs[built];
     }
-    /* save size of total chain */
-    if (err == ERR_OK) {
-      size = netbuf_len(&chain_buf);
-    }
-#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
-    if (err == ERR_OK) {
-#if LWIP_IPV4 && LWIP_IPV6
-      /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
-      if (IP_IS_V6_VAL(chain_buf.addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf.addr))) {
-        unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf.addr), ip_2_ip6(&chain_buf.addr));
-        IP_SET_TYPE_VAL(chain_buf.addr, IPADDR_TYPE_V4);
+    if (built > 0) {
+      err = netconn_send_multi(sock->conn, pbufs, built, &sent);
+      for (i = 0; i < built; i++) {
+        netbuf_free(&bufs[i]);
+      }
+      n += sent;
+      if (err != ERR_OK) {
+        ret = err_to_errno(err);
       }
-#endif /* LWIP_IPV4 && LWIP_IPV6 */
-
-      /* send the data */
-      err = netconn_send(sock->conn, &chain_buf);
     }
+  }
 
-    /* deallocated the buffer */
-    netbuf_free(&chain_buf);
-
-    set_errno(err_to_errno(err));
-    done_socket(sock);
-    return (err == ERR_OK ? size : -1);
-sendmsg_emsgsize:
-    set_errno(EMSGSIZE);
-    netbuf_free(&chain_buf);
+  if ((n == 0) && (ret != 0)) {
+    set_errno(ret);
     done_socket(sock);
     return -1;
   }
+  set_errno(0);
+  done_socket(sock);
+  return (int)n;
 #else /* LWIP_UDP || LWIP_RAW */
+  LWIP_UNUSED_ARG(ret);
   set_errno(err_to_errno(ERR_ARG));
   done_socket(sock);
   return -1;
 #endif /* LWIP_UDP || LWIP_RAW */
 }
+#endif /* LWIP_SOCKET_MMSG */
 
 ssize_t
 lwip_sendto(int s, const void *data, size_t size, int flags,
@@ -1639,6 +2239,18 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
 #if LWIP_TCP
     done_socket(sock);
+#if LWIP_TCP_FASTOPEN
+    if ((flags & MSG_FASTOPEN) && (to != NULL)) {
+      /* connect with the data in the SYN if a cookie of the server is known
+         (connect() returns at once then), else ask for a cookie */
+      int on = 1;
+      if ((lwip_setsockopt(s, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) != 0) ||
+          (lwip_connect(s, to, tolen) != 0)) {
+        return -1;
+      }
+      flags &= ~MSG_FASTOPEN;
+    }
+#endif /* LWIP_TCP_FASTOPEN */
     return lwip_send(s, data, size, flags);
 #else /* LWIP_TCP */
     LWIP_UNUSED_ARG(flags);
@@ -1666,6 +2278,9 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
 #if LWIP_CHECKSUM_ON_COPY
   buf.flags = 0;
 #endif /* LWIP_CHECKSUM_ON_COPY */
+#if LWIP_UDP_GSO
+  buf.gso_size = 0;
+#endif /* LWIP_UDP_GSO */
   if (to) {
     SOCKADDR_TO_IPADDR_PORT(to, &buf.addr, remote_port);
   } else {
@@ -2507,6 +3122,413 @@ lwip_poll_should_wake(const struct lwip_select_cb *scb, int fd, int has_recveven
 }
 #endif /* LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/* Translate an epoll file descriptor into a pointer */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  int i = epfd - LWIP_EPOLL_FD_OFFSET;
+  if ((i < 0) || (i >= LWIP_SOCKET_EPOLL_NUM) || !epolls[i].used) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_epoll(%d): invalid\n", epfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  return &epolls[i];
+}
+
+/* Events pending on a socket (called under SYS_ARCH_PROTECT) */
+static u32_t
+lwip_epoll_sock_events(const struct lwip_sock *sock)
+{
+  u32_t events = 0;
+  if ((sock->lastdata.pbuf != NULL) || (sock->rcvevent > 0)) {
+    events |= EPOLLIN;
+  }
+  if (sock->sendevent != 0) {
+    events |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    events |= EPOLLERR;
+  }
+  return events;
+}
+
+/* Append an item to the ready list of its epoll instance (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_append_ready(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  if (!item->ready) {
+    item->ready = 1;
+    item->ready_next = NULL;
+    item->ready_prev = ep->ready_tail;
+    if (ep->ready_tail != NULL) {
+      ep->ready_tail->ready_next = item;
+    } else {
+      ep->ready_head = item;
+    }
+    ep->ready_tail = item;
+  }
+}
+
+/* Remove an item from the ready list of its epoll instance (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_remove_ready(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  if (item->ready) {
+    if (item->ready_prev != NULL) {
+      item->ready_prev->ready_next = item->ready_next;
+    } else {
+      ep->ready_head = item->ready_next;
+    }
+    if (item->ready_next != NULL) {
+      item->ready_next->ready_prev = item->ready_prev;
+    } else {
+      ep->ready_tail = item->ready_prev;
+    }
+    item->ready = 0;
+  }
+}
+
+/* Put an item on the ready list and wake up a task waiting in epoll_wait
+   (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_set_ready(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  lwip_epoll_append_ready(item);
+  if (ep->waiting && !ep->sem_signalled) {
+    ep->sem_signalled = 1;
+    /* As in select_check_waiters(), signal before SYS_ARCH_UNPROTECT() */
+    sys_sem_signal(&ep->sem);
+  }
+}
+
+/* Remove an item from its epoll instance and its socket, the caller frees it
+   (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_unlink(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+  struct lwip_epoll_item **pitem;
+
+  lwip_epoll_remove_ready(item);
+  if (item->ep_prev != NULL) {
+    item->ep_prev->ep_next = item->ep_next;
+  } else {
+    ep->items = item->ep_next;
+  }
+  if (item->ep_next != NULL) {
+    item->ep_next->ep_prev = item->ep_prev;
+  }
+  for (pitem = &item->sock->epoll_items; *pitem != NULL; pitem = &(*pitem)->sock_next) {
+    if (*pitem == item) {
+      *pitem = item->sock_next;
+      break;
+    }
+  }
+}
+
+/**
+ * Called by event_callback() (under SYS_ARCH_PROTECT) when an event is
+ * signalled for a socket: this only touches the epoll instances interested
+ * in the socket.
+ *
+ * @param sock the socket
+ * @param event EPOLLIN, EPOLLOUT or EPOLLERR
+ */
+static void
+lwip_epoll_sock_event(struct lwip_sock *sock, u32_t event)
+{
+  struct lwip_epoll_item *item;
+
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    if ((item->events & event) != 0) {
+      lwip_epoll_set_ready(item);
+    }
+  }
+}
+
+/* Remove a socket that is closed from all interest sets */
+static void
+lwip_epoll_sock_detach(struct lwip_sock *sock)
+{
+  struct lwip_epoll_item *item;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  while ((item = sock->epoll_items) != NULL) {
+    lwip_epoll_unlink(item);
+    SYS_ARCH_UNPROTECT(lev);
+    memp_free(MEMP_EPOLL_ITEM, item);
+    SYS_ARCH_PROTECT(lev);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/* Free an epoll instance and its interest set (called by lwip_close) */
+static void
+lwip_epoll_close(struct lwip_epoll *ep)
+{
+  struct lwip_epoll_item *item;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  while ((item = ep->items) != NULL) {
+    lwip_epoll_unlink(item);
+    SYS_ARCH_UNPROTECT(lev);
+    memp_free(MEMP_EPOLL_ITEM, item);
+    SYS_ARCH_PROTECT(lev);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  LWIP_ASSERT("ep->waiting == 0", ep->waiting == 0);
+  sys_sem_free(&ep->sem);
+  ep->used = 0;
+}
+
+/**
+ * Report the items on the ready list that really are ready (called under
+ * SYS_ARCH_PROTECT). Items that are not ready any more and edge-triggered
+ * items are removed from the list, level-triggered items that are reported
+ * are moved to its end, so that the next call checks them again (after the
+ * others, in case maxevents is too small for all of them).
+ */
+static int
+lwip_epoll_harvest(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  int nready = 0;
+  struct lwip_epoll_item *item, *next;
+  struct lwip_epoll_item *last = ep->ready_tail;
+
+  for (item = ep->ready_head; (item != NULL) && (nready < maxevents); item = next) {
+    u32_t revents = lwip_epoll_sock_events(item->sock) & item->events;
+    next = item->ready_next;
+
+    lwip_epoll_remove_ready(item);
+    if (revents != 0) {
+      events[nready].events = revents;
+      events[nready].data = item->data;
+      nready++;
+      if ((item->events & EPOLLONESHOT) != 0) {
+        /* disabled until the next EPOLL_CTL_MOD */
+        item->events &= (EPOLLET | EPOLLONESHOT);
+      } else if ((item->events & EPOLLET) == 0) {
+        lwip_epoll_append_ready(item);
+      }
+    }
+    if (item == last) {
+      break;
+    }
+  }
+  return nready;
+}
+
+/**
+ * @ingroup socket
+ * Create an epoll instance. Close it with lwip_close().
+ *
+ * @param size ignored, but must be greater than 0
+ * @return the file descriptor of the epoll instance; -1 on error
+ */
+int
+lwip_epoll_create(int size)
+{
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("lwip_epoll_create: invalid size", size > 0, set_errno(EINVAL); return -1;);
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_NUM; i++) {
+    SYS_ARCH_PROTECT(lev);
+    if (!epolls[i].used) {
+      epolls[i].used = 1;
+      epolls[i].sem_signalled = 0;
+      epolls[i].waiting = 0;
+      epolls[i].items = NULL;
+      epolls[i].ready_head = NULL;
+      epolls[i].ready_tail = NULL;
+      SYS_ARCH_UNPROTECT(lev);
+      if (sys_sem_new(&epolls[i].sem, 0) != ERR_OK) {
+        epolls[i].used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+      set_errno(0);
+      return i + LWIP_EPOLL_FD_OFFSET;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  set_errno(EMFILE);
+  return -1;
+}
+
+/**
+ * @ingroup socket
+ * Add a socket to the interest set of an epoll instance (EPOLL_CTL_ADD),
+ * change its events (EPOLL_CTL_MOD) or remove it (EPOLL_CTL_DEL). Closed
+ * sockets are removed automatically.
+ *
+ * Events are EPOLLIN, EPOLLOUT and EPOLLERR (always reported), optionally
+ * with EPOLLET (edge-triggered: a socket is reported once per new event)
+ * and EPOLLONESHOT (disabled after it has been reported).
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  struct lwip_epoll_item *item, *free_item = NULL;
+  int err = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_epoll_ctl: invalid event", (op == EPOLL_CTL_DEL) || (event != NULL),
+             set_errno(EINVAL); return -1;);
+  sock = get_socket(fd);
+  if (!sock) {
+    return -1;
+  }
+  if (op == EPOLL_CTL_ADD) {
+    free_item = (struct lwip_epoll_item *)memp_malloc(MEMP_EPOLL_ITEM);
+    if (free_item == NULL) {
+      set_errno(ENOMEM);
+      done_socket(sock);
+      return -1;
+    }
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    if (item->ep == ep) {
+      break;
+    }
+  }
+  switch (op) {
+    case EPOLL_CTL_ADD:
+      if (item != NULL) {
+        err = EEXIST;
+        break;
+      }
+      item = free_item;
+      free_item = NULL;
+      item->ep = ep;
+      item->sock = sock;
+      item->fd = fd;
+      item->ready = 0;
+      item->sock_next = sock->epoll_items;
+      sock->epoll_items = item;
+      item->ep_prev = NULL;
+      item->ep_next = ep->items;
+      if (ep->items != NULL) {
+        ep->items->ep_prev = item;
+      }
+      ep->items = item;
+      break;
+    case EPOLL_CTL_MOD:
+      if (item == NULL) {
+        err = ENOENT;
+      }
+      break;
+    case EPOLL_CTL_DEL:
+      if (item == NULL) {
+        err = ENOENT;
+      } else {
+        lwip_epoll_unlink(item);
+        free_item = item;
+      }
+      break;
+    default:
+      err = EINVAL;
+      break;
+  }
+  if ((err == 0) && (op != EPOLL_CTL_DEL)) {
+    item->events = event->events | EPOLLERR;
+    item->data = event->data;
+    /* events that are pending already are reported, too */
+    if ((lwip_epoll_sock_events(sock) & item->events) != 0) {
+      lwip_epoll_set_ready(item);
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (free_item != NULL) {
+    memp_free(MEMP_EPOLL_ITEM, free_item);
+  }
+  done_socket(sock);
+  if (err != 0) {
+    set_errno(err);
+    return -1;
+  }
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * @ingroup socket
+ * Wait for events on the sockets in the interest set of an epoll instance.
+ * Only the sockets an event has been signalled for are checked.
+ *
+ * @param epfd the epoll instance
+ * @param events receives the events and the data passed to epoll_ctl
+ * @param maxevents size of 'events'
+ * @param timeout in milliseconds, -1 waits forever, 0 does not wait
+ * @return the number of entries written to 'events'; -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  int nready;
+  u32_t waitres;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_epoll_wait: invalid events", (events != NULL) && (maxevents > 0),
+             set_errno(EINVAL); return -1;);
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    nready = lwip_epoll_harvest(ep, events, maxevents);
+    if ((nready != 0) || (timeout == 0)) {
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+    }
+    /* Nothing ready: wait to be woken by lwip_epoll_set_ready() */
+    ep->waiting++;
+    SYS_ARCH_UNPROTECT(lev);
+
+    waitres = sys_arch_sem_wait(&ep->sem, (timeout < 0) ? 0 : (u32_t)timeout);
+
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting--;
+    ep->sem_signalled = 0;
+    SYS_ARCH_UNPROTECT(lev);
+    if (timeout > 0) {
+      /* check once more when the time is up, wait for the rest of it else */
+      if ((waitres == SYS_ARCH_TIMEOUT) || (waitres >= (u32_t)timeout)) {
+        timeout = 0;
+      } else {
+        timeout -= (int)waitres;
+      }
+    }
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d): nready=%d\n", epfd, nready));
+  set_errno(0);
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 /**
  * Callback registered in the netconn layer for each socket-netconn.
@@ -2592,6 +3614,20 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  if (sock->epoll_items != NULL) {
+    /* Tell the epoll instances interested in this socket (also for an
+       event that was pending already: edge-triggered waiters see it again) */
+    if (evt == NETCONN_EVT_RCVPLUS) {
+      lwip_epoll_sock_event(sock, EPOLLIN);
+    } else if (evt == NETCONN_EVT_SENDPLUS) {
+      lwip_epoll_sock_event(sock, EPOLLOUT);
+    } else if (evt == NETCONN_EVT_ERROR) {
+      lwip_epoll_sock_event(sock, EPOLLERR);
+    }
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting && check_waiters) {
     /* Save which events are active */
     int has_recvevent, has_sendevent, has_errevent;
@@ -3088,6 +4124,22 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
         }
         break;
 #endif /* LWIP_SO_LINGER */
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+        case SO_ZEROCOPY:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_TCP);
+          *(int *)optval = sock->zerocopy;
+          break;
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
+#if LWIP_TCP && LWIP_TCP_PACING
+        case SO_MAX_PACING_RATE:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, u32_t, NETCONN_TCP);
+          if (sock->conn->pcb.tcp->state == LISTEN) {
+            done_socket(sock);
+            return EINVAL;
+          }
+          *(u32_t *)optval = tcp_get_pacing_rate(sock->conn->pcb.tcp);
+          break;
+#endif /* LWIP_TCP && LWIP_TCP_PACING */
 #if LWIP_UDP
         case SO_NO_CHECK:
           LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_UDP);
@@ -3100,6 +4152,12 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
 #endif /* LWIP_UDPLITE */
           *(int *)optval = udp_is_flag_set(sock->conn->pcb.udp, UDP_FLAGS_NOCHKSUM) ? 1 : 0;
           break;
+#if LWIP_UDP_REUSEPORT
+        case SO_REUSEPORT:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_UDP);
+          *(int *)optval = udp_is_flag_set(sock->conn->pcb.udp, UDP_FLAGS_REUSEPORT) ? 1 : 0;
+          break;
+#endif /* LWIP_UDP_REUSEPORT */
 #endif /* LWIP_UDP*/
         default:
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, SOL_SOCKET, UNIMPL: optname=0x%x, ..)\n",
@@ -3167,9 +4225,15 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
 #if LWIP_TCP
     /* Level: IPPROTO_TCP */
     case IPPROTO_TCP:
-      /* Special case: all IPPROTO_TCP option take an int */
+      /* Special case: all IPPROTO_TCP option take an int (TCP_CONGESTION
+         takes a string, names are never shorter than an int) */
       LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_TCP);
+#if LWIP_TCP_FASTOPEN
+      /* fast open is the only option a listening pcb knows about */
+      if ((sock->conn->pcb.tcp->state == LISTEN) && (optname != TCP_FASTOPEN)) {
+#else /* LWIP_TCP_FASTOPEN */
       if (sock->conn->pcb.tcp->state == LISTEN) {
+#endif /* LWIP_TCP_FASTOPEN */
         done_socket(sock);
         return EINVAL;
       }
@@ -3202,6 +4266,30 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
                                       s, *(int *)optval));
           break;
 #endif /* LWIP_TCP_KEEPALIVE */
+        case TCP_CONGESTION: {
+          const char *name = tcp_get_congestion(sock->conn->pcb.tcp);
+          socklen_t len = (socklen_t)LWIP_MIN(strlen(name) + 1, *optlen);
+          MEMCPY(optval, name, len);
+          *optlen = len;
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) = %s\n",
+                                      s, name));
+          break;
+        }
+#if LWIP_TCP_ACK_POLICY
+        case TCP_QUICKACK:
+          *(int *)optval = tcp_quickack_enabled(sock->conn->pcb.tcp);
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_QUICKACK) = %d\n",
+                                      s, *(int *)optval));
+          break;
+#endif /* LWIP_TCP_ACK_POLICY */
+#if LWIP_TCP_FASTOPEN
+        case TCP_FASTOPEN:
+        case TCP_FASTOPEN_CONNECT:
+          *(int *)optval = tcp_fastopen_enabled(sock->conn->pcb.tcp);
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_FASTOPEN) = %d\n",
+                                      s, *(int *)optval));
+          break;
+#endif /* LWIP_TCP_FASTOPEN */
         default:
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                                       s, optname));
@@ -3236,6 +4324,25 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
       break;
 #endif /* LWIP_IPV6 */
 
+#if LWIP_UDP && LWIP_UDP_GSO
+    /* Level: IPPROTO_UDP */
+    case IPPROTO_UDP:
+      switch (optname) {
+        case UDP_SEGMENT:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_UDP);
+          *(int *)optval = udp_get_gso_size(sock->conn->pcb.udp);
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_UDP, UDP_SEGMENT) = %d\n",
+                                      s, (*(int *)optval)) );
+          break;
+        default:
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_UDP, UNIMPL: optname=0x%x, ..)\n",
+                                      s, optname));
+          err = ENOPROTOOPT;
+          break;
+      }  /* switch (optname) */
+      break;
+#endif /* LWIP_UDP && LWIP_UDP_GSO */
+
 #if LWIP_UDP && LWIP_UDPLITE
     /* Level: IPPROTO_UDPLITE */
     case IPPROTO_UDPLITE:
@@ -3434,6 +4541,12 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
           } else {
             ip_reset_option(sock->conn->pcb.ip, optname);
           }
+#if LWIP_TCP_TIMER_WHEEL
+          if ((optname == SOF_KEEPALIVE) &&
+              (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP)) {
+            tcp_timer_update(sock->conn->pcb.tcp);
+          }
+#endif /* LWIP_TCP_TIMER_WHEEL */
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, SOL_SOCKET, optname=0x%x, ..) -> %s\n",
                                       s, optname, (*(const int *)optval ? "on" : "off")));
           break;
@@ -3493,6 +4606,23 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
         }
         break;
 #endif /* LWIP_SO_LINGER */
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+        case SO_ZEROCOPY:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_TCP);
+          sock->zerocopy = (u8_t)(*(const int *)optval ? 1 : 0);
+          break;
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
+#if LWIP_TCP && LWIP_TCP_PACING
+        case SO_MAX_PACING_RATE:
+          /* 0: pacing off, 0xffffffff: pace at the rate derived from cwnd and RTT */
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, u32_t, NETCONN_TCP);
+          if (sock->conn->pcb.tcp->state == LISTEN) {
+            done_socket(sock);
+            return EINVAL;
+          }
+          tcp_set_pacing_rate(sock->conn->pcb.tcp, *(const u32_t *)optval);
+          break;
+#endif /* LWIP_TCP && LWIP_TCP_PACING */
 #if LWIP_UDP
         case SO_NO_CHECK:
           LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_UDP);
@@ -3509,6 +4639,17 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
             udp_clear_flags(sock->conn->pcb.udp, UDP_FLAGS_NOCHKSUM);
           }
           break;
+#if LWIP_UDP_REUSEPORT
+        case SO_REUSEPORT:
+          /* must be set before bind() to take effect */
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_UDP);
+          if (*(const int *)optval) {
+            udp_set_flags(sock->conn->pcb.udp, UDP_FLAGS_REUSEPORT);
+          } else {
+            udp_clear_flags(sock->conn->pcb.udp, UDP_FLAGS_REUSEPORT);
+          }
+          break;
+#endif /* LWIP_UDP_REUSEPORT */
 #endif /* LWIP_UDP */
         case SO_BINDTODEVICE: {
           const struct ifreq *iface;
@@ -3641,9 +4782,15 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
 #if LWIP_TCP
     /* Level: IPPROTO_TCP */
     case IPPROTO_TCP:
-      /* Special case: all IPPROTO_TCP option take an int */
+      /* Special case: all IPPROTO_TCP option take an int (TCP_CONGESTION
+         takes a string, names are never shorter than an int) */
       LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_TCP);
+#if LWIP_TCP_FASTOPEN
+      /* fast open is the only option a listening pcb knows about */
+      if ((sock->conn->pcb.tcp->state == LISTEN) && (optname != TCP_FASTOPEN)) {
+#else /* LWIP_TCP_FASTOPEN */
       if (sock->conn->pcb.tcp->state == LISTEN) {
+#endif /* LWIP_TCP_FASTOPEN */
         done_socket(sock);
         return EINVAL;
       }
@@ -3680,12 +4827,53 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
                                       s, sock->conn->pcb.tcp->keep_cnt));
           break;
 #endif /* LWIP_TCP_KEEPALIVE */
+        case TCP_CONGESTION: {
+          char name[16];
+          socklen_t len = LWIP_MIN(optlen, (socklen_t)(sizeof(name) - 1));
+          MEMCPY(name, optval, len);
+          name[len] = 0;
+          if (tcp_set_congestion(sock->conn->pcb.tcp, name) != ERR_OK) {
+            err = ENOENT;
+          }
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) -> %s\n",
+                                      s, name));
+          break;
+        }
+#if LWIP_TCP_ACK_POLICY
+        case TCP_QUICKACK:
+          tcp_quickack(sock->conn->pcb.tcp, (u8_t)(*(const int *)optval != 0));
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_QUICKACK) -> %d\n",
+                                      s, *(const int *)optval));
+          break;
+#endif /* LWIP_TCP_ACK_POLICY */
+#if LWIP_TCP_FASTOPEN
+        case TCP_FASTOPEN:
+          /* the value is the queue length of fast open requests on Linux,
+             lwIP does not limit them beyond the accept backlog */
+          tcp_fastopen(sock->conn->pcb.tcp, (u8_t)(*(const int *)optval > 0));
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_FASTOPEN) -> %d\n",
+                                      s, *(const int *)optval));
+          break;
+        case TCP_FASTOPEN_CONNECT:
+          if (sock->conn->pcb.tcp->state != CLOSED) {
+            err = EISCONN;
+            break;
+          }
+          tcp_fastopen(sock->conn->pcb.tcp, (u8_t)(*(const int *)optval != 0));
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_FASTOPEN_CONNECT) -> %d\n",
+                                      s, *(const int *)optval));
+          break;
+#endif /* LWIP_TCP_FASTOPEN */
         default:
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                                       s, optname));
           err = ENOPROTOOPT;
           break;
       }  /* switch (optname) */
+#if LWIP_TCP_TIMER_WHEEL
+      /* the keepalive timer may have changed */
+      tcp_timer_update(sock->conn->pcb.tcp);
+#endif /* LWIP_TCP_TIMER_WHEEL */
       break;
 #endif /* LWIP_TCP*/
 
@@ -3755,6 +4943,29 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
       break;
 #endif /* LWIP_IPV6 */
 
+#if LWIP_UDP && LWIP_UDP_GSO
+    /* Level: IPPROTO_UDP */
+    case IPPROTO_UDP:
+      switch (optname) {
+        case UDP_SEGMENT:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_UDP);
+          if ((*(const int *)optval < 0) || (*(const int *)optval > 0xffff - UDP_HLEN)) {
+            done_socket(sock);
+            return EINVAL;
+          }
+          udp_set_gso_size(sock->conn->pcb.udp, (u16_t)(*(const int *)optval));
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_UDP, UDP_SEGMENT) -> %d\n",
+                                      s, (*(const int *)optval)) );
+          break;
+        default:
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_UDP, UNIMPL: optname=0x%x, ..)\n",
+                                      s, optname));
+          err = ENOPROTOOPT;
+          break;
+      }  /* switch (optname) */
+      break;
+#endif /* LWIP_UDP && LWIP_UDP_GSO */
+
 #if LWIP_UDP && LWIP_UDPLITE
     /* Level: IPPROTO_UDPLITE */
     case IPPROTO_UDPLITE:
@@ -48,6 +48,7 @@
 #include "lwip/ip.h"
 #include "lwip/pbuf.h"
 #include "lwip/etharp.h"
+#include "lwip/tcp.h"
 #include "netif/ethernet.h"
 
 #define TCPIP_MSG_VAR_REF(name)     API_VAR_REF(name)
@@ -75,6 +76,14 @@ tcpip_mbox_fetch(sys_mbox_t* mbox, void** msg)
 {
   LWIP_ASSERT_CORE_LOCKED();
 
+#if LWIP_TCP_GRO
+  if (sys_arch_mbox_tryfetch(mbox, msg) != SYS_MBOX_EMPTY) {
+    return;
+  }
+  /* no more messages waiting: end of the receive batch */
+  tcp_gro_flush(NULL);
+#endif /* LWIP_TCP_GRO */
+
   UNLOCK_TCPIP_CORE();
   sys_mbox_fetch(mbox, msg);
   LOCK_TCPIP_CORE();
@@ -97,6 +106,16 @@ tcpip_mbox_fetch(sys_mbox_t *mbox, void **msg)
 again:
   LWIP_ASSERT_CORE_LOCKED();
 
+#if LWIP_TCP_GRO
+  if (sys_timeouts_sleeptime() != 0) {
+    if (sys_arch_mbox_tryfetch(mbox, msg) != SYS_MBOX_EMPTY) {
+      return;
+    }
+    /* no more messages waiting: end of the receive batch */
+    tcp_gro_flush(NULL);
+  }
+#endif /* LWIP_TCP_GRO */
+
   sleeptime = sys_timeouts_sleeptime();
   if (sleeptime == SYS_TIMEOUTS_SLEEPTIME_INFINITE) {
     UNLOCK_TCPIP_CORE();
@@ -190,6 +209,20 @@ tcpip_thread_handle_msg(struct tcpip_msg *msg)
       }
       memp_free(MEMP_TCPIP_MSG_INPKT, msg);
       break;
+#if LWIP_TCPIP_INPUT_BATCH
+    case TCPIP_MSG_INPKT_BATCH: {
+      struct tcpip_msg_inpkt_batch *batch = (struct tcpip_msg_inpkt_batch *)msg;
+      u16_t i;
+      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET BATCH %p (%"U16_F" packets)\n", (void *)msg, batch->num));
+      for (i = 0; i < batch->num; i++) {
+        if (msg->msg.inp.input_fn(batch->p[i], msg->msg.inp.netif) != ERR_OK) {
+          pbuf_free(batch->p[i]);
+        }
+      }
+      memp_free(MEMP_TCPIP_MSG_INPKT_BATCH, batch);
+      break;
+    }
+#endif /* LWIP_TCPIP_INPUT_BATCH */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
@@ -230,8 +263,19 @@ tcpip_thread_poll_one(void)
 {
   int ret = 0;
   struct tcpip_msg *msg;
+  u32_t res;
 
-  if (sys_arch_mbox_tryfetch(&tcpip_mbox, (void **)&msg) != SYS_MBOX_EMPTY) {
+  res = sys_arch_mbox_tryfetch(&tcpip_mbox, (void **)&msg);
+#if LWIP_TCP_GRO
+  if (res == SYS_MBOX_EMPTY) {
+    /* like tcpip_thread: the mailbox ran empty, which may queue new work */
+    LOCK_TCPIP_CORE();
+    tcp_gro_flush(NULL);
+    UNLOCK_TCPIP_CORE();
+    res = sys_arch_mbox_tryfetch(&tcpip_mbox, (void **)&msg);
+  }
+#endif /* LWIP_TCP_GRO */
+  if (res != SYS_MBOX_EMPTY) {
     LOCK_TCPIP_CORE();
     if (msg != NULL) {
       tcpip_thread_handle_msg(msg);
@@ -304,6 +348,93 @@ tcpip_input(struct pbuf *p, struct netif *inp)
     return tcpip_inpkt(p, inp, ip_input);
 }
 
+#if LWIP_TCPIP_INPUT_BATCH
+/**
+ * Pass received packets to tcpip_thread for input processing. The packets
+ * are posted with one message per TCPIP_INPUT_BATCH_SIZE packets and
+ * processed back to back.
+ *
+ * @param pkts the received packets. If not all of them could be passed on
+ *             (ERR_MEM), the entries of those that have been are set to NULL:
+ *             the caller still owns (and has to free) the remaining ones.
+ * @param num number of packets in pkts
+ * @param inp the network interface on which the packets were received
+ * @param input_fn input function to call
+ */
+err_t
+tcpip_inpkt_batch(struct pbuf **pkts, u16_t num, struct netif *inp, netif_input_fn input_fn)
+{
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+  u16_t i;
+  LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_inpkt_batch: %"U16_F" PACKETS/%p\n", num, (void *)inp));
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < num; i++) {
+    if (input_fn(pkts[i], inp) != ERR_OK) {
+      pbuf_free(pkts[i]);
+    }
+    pkts[i] = NULL;
+  }
+  UNLOCK_TCPIP_CORE();
+  return ERR_OK;
+#else /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+  struct tcpip_msg_inpkt_batch *batch;
+  u16_t i, j, n;
+
+  LWIP_ASSERT("Invalid mbox", sys_mbox_valid_val(tcpip_mbox));
+  LWIP_ERROR("tcpip_inpkt_batch: invalid pkts", (pkts != NULL) || (num == 0), return ERR_ARG;);
+
+  for (i = 0; i < num; i += n) {
+    n = (u16_t)LWIP_MIN(num - i, TCPIP_INPUT_BATCH_SIZE);
+    batch = (struct tcpip_msg_inpkt_batch *)memp_malloc(MEMP_TCPIP_MSG_INPKT_BATCH);
+    if (batch == NULL) {
+      return ERR_MEM;
+    }
+    batch->msg.type = TCPIP_MSG_INPKT_BATCH;
+    batch->msg.msg.inp.p = NULL;
+    batch->msg.msg.inp.netif = inp;
+    batch->msg.msg.inp.input_fn = input_fn;
+    batch->num = n;
+    for (j = 0; j < n; j++) {
+      batch->p[j] = pkts[i + j];
+    }
+    if (sys_mbox_trypost(&tcpip_mbox, &batch->msg) != ERR_OK) {
+      memp_free(MEMP_TCPIP_MSG_INPKT_BATCH, batch);
+      return ERR_MEM;
+    }
+    for (j = 0; j < n; j++) {
+      pkts[i + j] = NULL;
+    }
+  }
+  return ERR_OK;
+#endif /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+}
+
+/**
+ * @ingroup lwip_os
+ * Pass several received packets to tcpip_thread for input processing with
+ * ethernet_input or ip_input, like tcpip_input() does for one packet but
+ * with one message per TCPIP_INPUT_BATCH_SIZE packets.
+ * Drivers can call this instead of netif->input() when netif->input is
+ * tcpip_input.
+ *
+ * @param pkts the received packets. If not all of them could be passed on
+ *             (ERR_MEM), the entries of those that have been are set to NULL:
+ *             the caller still owns (and has to free) the remaining ones.
+ * @param num number of packets in pkts
+ * @param inp the network interface on which the packets were received
+ */
+err_t
+tcpip_input_batch(struct pbuf **pkts, u16_t num, struct netif *inp)
+{
+#if LWIP_ETHERNET
+  if (inp->flags & (NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET)) {
+    return tcpip_inpkt_batch(pkts, num, inp, ethernet_input);
+  } else
+#endif /* LWIP_ETHERNET */
+    return tcpip_inpkt_batch(pkts, num, inp, ip_input);
+}
+#endif /* LWIP_TCPIP_INPUT_BATCH */
+
 /**
  * @ingroup lwip_os
  * Call a specific function in the thread context of
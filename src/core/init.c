@@ -163,12 +163,57 @@ PACK_STRUCT_END
 #if (LWIP_TCP && TCP_LISTEN_BACKLOG && ((TCP_DEFAULT_LISTEN_BACKLOG < 0) || (TCP_DEFAULT_LISTEN_BACKLOG > 0xff)))
 #error "If you want to use TCP backlog, TCP_DEFAULT_LISTEN_BACKLOG must fit into an u8_t"
 #endif
+#if (LWIP_TCP && TCP_OOSEQ_RBTREE && !TCP_QUEUE_OOSEQ)
+#error "To use TCP_OOSEQ_RBTREE, TCP_QUEUE_OOSEQ needs to be enabled"
+#endif
 #if (LWIP_TCP && LWIP_TCP_SACK_OUT && !TCP_QUEUE_OOSEQ)
 #error "To use LWIP_TCP_SACK_OUT, TCP_QUEUE_OOSEQ needs to be enabled"
 #endif
 #if (LWIP_TCP && LWIP_TCP_SACK_OUT && (LWIP_TCP_MAX_SACK_NUM < 1))
 #error "LWIP_TCP_MAX_SACK_NUM must be greater than 0"
 #endif
+#if (LWIP_TCP && LWIP_TCP_SACK_IN && !LWIP_TCP_SACK_OUT)
+#error "To use LWIP_TCP_SACK_IN, LWIP_TCP_SACK_OUT needs to be enabled"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_GSO)
+#error "If you want to use LWIP_TCP_GSO, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_GRO)
+#error "If you want to use LWIP_TCP_GRO, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_GRO && ((TCP_GRO_FLOWS < 1) || (TCP_GRO_MAX_SEGS < 2)))
+#error "TCP_GRO_FLOWS must be at least 1 and TCP_GRO_MAX_SEGS at least 2"
+#endif
+#if ((!LWIP_TCP || !LWIP_TIMERS) && LWIP_TCP_PACING)
+#error "If you want to use LWIP_TCP_PACING, you have to define LWIP_TCP=1 and LWIP_TIMERS=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_PACING && (TCP_PACING_BURST < 1))
+#error "TCP_PACING_BURST must be at least 1"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_TIMER_WHEEL)
+#error "If you want to use LWIP_TCP_TIMER_WHEEL, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_TIMER_WHEEL && ((TCP_TIMER_WHEEL_SIZE < 2) || ((TCP_TIMER_WHEEL_SIZE & (TCP_TIMER_WHEEL_SIZE - 1)) != 0)))
+#error "TCP_TIMER_WHEEL_SIZE must be a power of 2"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_FASTOPEN)
+#error "If you want to use LWIP_TCP_FASTOPEN, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_FASTOPEN && (TCP_FASTOPEN_CACHE_SIZE < 1))
+#error "TCP_FASTOPEN_CACHE_SIZE must be at least 1"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_SYN_COOKIES)
+#error "If you want to use LWIP_TCP_SYN_COOKIES, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_SYN_COOKIES && (TCP_SYN_QUEUE_SIZE > 255))
+#error "TCP_SYN_QUEUE_SIZE must be at most 255"
+#endif
+#if (!LWIP_TCP && LWIP_TCP_ACK_POLICY)
+#error "If you want to use LWIP_TCP_ACK_POLICY, you have to define LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if (LWIP_TCP_ACK_POLICY && ((TCP_ACK_EVERY < 1) || (TCP_ACK_EVERY > 255) || (TCP_QUICKACK_SEGS > 255)))
+#error "TCP_ACK_EVERY must be 1..255 and TCP_QUICKACK_SEGS at most 255"
+#endif
 #if (LWIP_NETIF_API && (NO_SYS==1))
 #error "If you want to use NETIF API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
@@ -235,6 +280,15 @@ PACK_STRUCT_END
 #if LWIP_TCP && LWIP_NETIF_TX_SINGLE_PBUF && !TCP_OVERSIZE
 #error "LWIP_NETIF_TX_SINGLE_PBUF needs TCP_OVERSIZE enabled to create single-pbuf TCP packets"
 #endif
+#if LWIP_TCP && LWIP_TCP_PCB_HASH && ((TCP_PCB_HASH_SIZE & (TCP_PCB_HASH_SIZE - 1)) || (TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1)))
+#error "TCP_PCB_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be powers of 2"
+#endif
+#if LWIP_UDP && LWIP_UDP_PCB_HASH && (UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1))
+#error "UDP_PCB_HASH_SIZE must be a power of 2"
+#endif
+#if LWIP_TIMERS && !LWIP_TIMERS_CUSTOM && LWIP_TIMERS_WHEEL && (SYS_TIMEOUT_HASH_SIZE & (SYS_TIMEOUT_HASH_SIZE - 1))
+#error "SYS_TIMEOUT_HASH_SIZE must be a power of 2"
+#endif
 #if LWIP_NETCONN && LWIP_TCP
 #if NETCONN_COPY != TCP_WRITE_FLAG_COPY
 #error "NETCONN_COPY != TCP_WRITE_FLAG_COPY"
@@ -246,6 +300,21 @@ PACK_STRUCT_END
 #if LWIP_NETCONN_FULLDUPLEX && !LWIP_NETCONN_SEM_PER_THREAD
 #error "For LWIP_NETCONN_FULLDUPLEX to work, LWIP_NETCONN_SEM_PER_THREAD is required"
 #endif
+#if LWIP_NETCONN_RING && !(LWIP_NETCONN && LWIP_TCP)
+#error "If you want to use LWIP_NETCONN_RING, you have to define LWIP_NETCONN=1 and LWIP_TCP=1 in your lwipopts.h"
+#endif
+#if LWIP_SO_ZEROCOPY && ((LWIP_SO_ZEROCOPY_PENDING < 1) || (LWIP_SO_ZEROCOPY_PENDING > 255))
+#error "LWIP_SO_ZEROCOPY_PENDING must be in the range of 1..255"
+#endif
+#if LWIP_SOCKET && LWIP_SOCKET_EPOLL && !(LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL)
+#error "If you want to use LWIP_SOCKET_EPOLL, you have to define LWIP_SOCKET_SELECT=1 or LWIP_SOCKET_POLL=1 in your lwipopts.h"
+#endif
+#if LWIP_SOCKET && LWIP_SOCKET_EPOLL && (LWIP_SOCKET_EPOLL_NUM < 1)
+#error "LWIP_SOCKET_EPOLL_NUM must be at least 1"
+#endif
+#if LWIP_SOCKET && LWIP_SOCKET_MMSG && ((LWIP_SOCKET_MMSG_BATCH < 1) || (LWIP_SOCKET_MMSG_BATCH > 0xFFFF))
+#error "LWIP_SOCKET_MMSG_BATCH must be in the range of 1..65535"
+#endif
 
 
 /* Compile-time checks for deprecated options.
@@ -276,6 +345,18 @@ PACK_STRUCT_END
 #define LWIP_DISABLE_MEMP_SANITY_CHECKS 0
 #endif
 
+#if MEMP_THREAD_CACHE
+#if MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK
+#error "MEMP_THREAD_CACHE cannot be used with MEMP_MEM_MALLOC or MEMP_OVERFLOW_CHECK"
+#endif
+#ifndef LWIP_THREAD_LOCAL
+#error "MEMP_THREAD_CACHE needs LWIP_THREAD_LOCAL, define it in your cc.h"
+#endif
+#if MEMP_THREAD_CACHE_SIZE < 2
+#error "MEMP_THREAD_CACHE_SIZE must be at least 2"
+#endif
+#endif /* MEMP_THREAD_CACHE */
+
 /* MEMP sanity checks */
 #if MEMP_MEM_MALLOC
 #if !LWIP_DISABLE_MEMP_SANITY_CHECKS
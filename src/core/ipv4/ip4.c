@@ -740,7 +740,11 @@ ip4_input(struct pbuf *p, struct netif *inp)
 #if LWIP_TCP
       case IP_PROTO_TCP:
         MIB2_STATS_INC(mib2.ipindelivers);
+#if LWIP_TCP_GRO
+        tcp_gro_input(p, inp);
+#else /* LWIP_TCP_GRO */
         tcp_input(p, inp);
+#endif /* LWIP_TCP_GRO */
         break;
 #endif /* LWIP_TCP */
 #if LWIP_ICMP
@@ -966,6 +970,17 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
     chk_sum += iphdr->_id;
 #endif /* CHECKSUM_GEN_IP_INLINE */
     ++ip_id;
+#if LWIP_TCP_GSO
+    if (pbuf_is_gso(p) && (proto == IP_PROTO_TCP) &&
+        (p->len >= ip_hlen + TCP_HLEN)) {
+      /* tcp_gso_segment() numbers the wire segments of a super-segment
+         ip_id, ip_id + 1, ...: reserve the IDs after the first one */
+      u16_t tcp_hlen = TCPH_HDRLEN_BYTES((struct tcp_hdr *)((u8_t *)p->payload + ip_hlen));
+      if (p->tot_len > ip_hlen + tcp_hlen) {
+        ip_id = (u16_t)(ip_id + (p->tot_len - ip_hlen - tcp_hlen - 1) / p->gso_size);
+      }
+    }
+#endif /* LWIP_TCP_GSO */
 
     if (src == NULL) {
       ip4_addr_copy(iphdr->src, *IP4_ADDR_ANY4);
@@ -1031,8 +1046,9 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 #endif /* ENABLE_LOOPBACK */
 #if IP_FRAG
-  /* don't fragment if interface has mtu set to 0 [loopif] */
-  if (netif->mtu && (p->tot_len > netif->mtu)) {
+  /* don't fragment if interface has mtu set to 0 [loopif] or if the
+     netif cuts TCP super-segments itself */
+  if (netif->mtu && (p->tot_len > netif->mtu) && !pbuf_is_gso(p)) {
     return ip4_frag(p, netif, dest);
   }
 #endif /* IP_FRAG */
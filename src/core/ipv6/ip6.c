@@ -1075,7 +1075,11 @@ options_done:
 #endif /* LWIP_UDP */
 #if LWIP_TCP
     case IP6_NEXTH_TCP:
+#if LWIP_TCP_GRO
+      tcp_gro_input(p, inp);
+#else /* LWIP_TCP_GRO */
       tcp_input(p, inp);
+#endif /* LWIP_TCP_GRO */
       break;
 #endif /* LWIP_TCP */
 #if LWIP_ICMP6
@@ -1260,8 +1264,9 @@ ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 #endif /* ENABLE_LOOPBACK */
 #if LWIP_IPV6_FRAG
-  /* don't fragment if interface has mtu set to 0 [loopif] */
-  if (netif_mtu6(netif) && (p->tot_len > nd6_get_destination_mtu(dest, netif))) {
+  /* don't fragment if interface has mtu set to 0 [loopif] or if the
+     netif cuts TCP super-segments itself */
+  if (netif_mtu6(netif) && (p->tot_len > nd6_get_destination_mtu(dest, netif)) && !pbuf_is_gso(p)) {
     return ip6_frag(p, netif, dest);
   }
 #endif /* LWIP_IPV6_FRAG */
@@ -325,6 +325,110 @@ memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int li
 #endif
 }
 
+#if MEMP_THREAD_CACHE
+/** Free elements of one pool cached by one thread */
+struct memp_magazine {
+  struct memp *list;
+  u16_t count;
+};
+
+/** The magazines of the calling thread, one per pool */
+static LWIP_THREAD_LOCAL struct memp_magazine memp_magazines[MEMP_MAX];
+
+/** Maximum number of elements in the magazine of a pool, 0 if not cached */
+static u16_t
+memp_magazine_size(const struct memp_desc *desc)
+{
+  return (u16_t)LWIP_MIN(MEMP_THREAD_CACHE_SIZE, desc->num / 8);
+}
+
+/** Move up to num elements from a pool to a magazine */
+static void
+memp_magazine_refill(const struct memp_desc *desc, struct memp_magazine *mag, u16_t num)
+{
+  struct memp *memp;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  for (; (num > 0) && (*desc->tab != NULL); num--) {
+    memp = *desc->tab;
+    *desc->tab = memp->next;
+    memp->next = mag->list;
+    mag->list = memp;
+    mag->count++;
+  }
+#if MEMP_STATS
+  if (mag->list == NULL) {
+    desc->stats->err++;
+  }
+#endif
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/** Move up to num elements from a magazine back to its pool */
+static void
+memp_magazine_drain(const struct memp_desc *desc, struct memp_magazine *mag, u16_t num)
+{
+  struct memp *memp;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  for (; (num > 0) && (mag->list != NULL); num--) {
+    memp = mag->list;
+    mag->list = memp->next;
+    mag->count--;
+    memp->next = *desc->tab;
+    *desc->tab = memp;
+  }
+#if MEMP_SANITY_CHECK
+  LWIP_ASSERT("memp sanity", memp_sanity(desc));
+#endif /* MEMP_SANITY_CHECK */
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+#if MEMP_STATS
+/**
+ * Count an element handed out from a magazine (used > 0) or freed into one
+ * (used < 0): elements parked in magazines don't count as used.
+ */
+static void
+memp_magazine_stats(const struct memp_desc *desc, s8_t used)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  if (used > 0) {
+    desc->stats->used++;
+    if (desc->stats->used > desc->stats->max) {
+      desc->stats->max = desc->stats->used;
+    }
+  } else {
+    desc->stats->used--;
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+}
+#else /* MEMP_STATS */
+#define memp_magazine_stats(desc, used)
+#endif /* MEMP_STATS */
+
+/**
+ * Return all elements cached by the calling thread to their pools.
+ * Call this before a thread that has allocated or freed pool elements
+ * exits, otherwise the elements in its cache are lost.
+ */
+void
+memp_thread_cache_flush(void)
+{
+  u16_t i;
+
+  for (i = 0; i < MEMP_MAX; i++) {
+    if (memp_magazines[i].count > 0) {
+      memp_magazine_drain(memp_pools[i], &memp_magazines[i], memp_magazines[i].count);
+    }
+  }
+}
+#endif /* MEMP_THREAD_CACHE */
+
 /**
  * Get an element from a specific pool.
  *
@@ -340,12 +444,36 @@ memp_malloc_fn(memp_t type, const char *file, const int line)
 #endif
 {
   void *memp;
+#if MEMP_THREAD_CACHE
+  struct memp_magazine *mag;
+  u16_t size;
+#endif /* MEMP_THREAD_CACHE */
   LWIP_ERROR("memp_malloc: type < MEMP_MAX", (type < MEMP_MAX), return NULL;);
 
 #if MEMP_OVERFLOW_CHECK >= 2
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
+#if MEMP_THREAD_CACHE
+  size = memp_magazine_size(memp_pools[type]);
+  if (size > 0) {
+    mag = &memp_magazines[type];
+    if (mag->list == NULL) {
+      memp_magazine_refill(memp_pools[type], mag, (u16_t)((size + 1) / 2));
+      if (mag->list == NULL) {
+        LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", memp_pools[type]->desc));
+        return NULL;
+      }
+    }
+    memp = mag->list;
+    mag->list = mag->list->next;
+    mag->count--;
+    memp_magazine_stats(memp_pools[type], 1);
+    /* cast through u8_t* to get rid of alignment warnings */
+    return ((u8_t *)memp + MEMP_SIZE);
+  }
+#endif /* MEMP_THREAD_CACHE */
+
 #if !MEMP_OVERFLOW_CHECK
   memp = do_memp_malloc_pool(memp_pools[type]);
 #else
@@ -422,6 +550,11 @@ memp_free(memp_t type, void *mem)
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
   struct memp *old_first;
 #endif
+#if MEMP_THREAD_CACHE && !defined(LWIP_HOOK_MEMP_AVAILABLE)
+  struct memp_magazine *mag;
+  struct memp *memp;
+  u16_t size;
+#endif /* MEMP_THREAD_CACHE && !LWIP_HOOK_MEMP_AVAILABLE */
 
   LWIP_ERROR("memp_free: type < MEMP_MAX", (type < MEMP_MAX), return;);
 
@@ -433,6 +566,28 @@ memp_free(memp_t type, void *mem)
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
+#if MEMP_THREAD_CACHE && !defined(LWIP_HOOK_MEMP_AVAILABLE)
+  /* (with LWIP_HOOK_MEMP_AVAILABLE, elements are freed to the pool directly
+     so that the hook sees the pool becoming available) */
+  size = memp_magazine_size(memp_pools[type]);
+  if (size > 0) {
+    LWIP_ASSERT("memp_free: mem properly aligned",
+                ((mem_ptr_t)mem % MEM_ALIGNMENT) == 0);
+    /* cast through void* to get rid of alignment warnings */
+    memp = (struct memp *)(void *)((u8_t *)mem - MEMP_SIZE);
+    mag = &memp_magazines[type];
+    memp->next = mag->list;
+    mag->list = memp;
+    mag->count++;
+    memp_magazine_stats(memp_pools[type], -1);
+    if (mag->count > size) {
+      /* keep half a magazine for the next allocations */
+      memp_magazine_drain(memp_pools[type], mag, (u16_t)(mag->count - size / 2));
+    }
+    return;
+  }
+#endif /* MEMP_THREAD_CACHE && !LWIP_HOOK_MEMP_AVAILABLE */
+
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
   old_first = *memp_pools[type]->tab;
 #endif
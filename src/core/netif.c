@@ -775,6 +775,10 @@ netif_remove(struct netif *netif)
 
   netif_invoke_ext_callback(netif, LWIP_NSC_NETIF_REMOVED, NULL);
 
+#if LWIP_TCP_GRO
+  tcp_gro_flush(netif);
+#endif /* LWIP_TCP_GRO */
+
 #if LWIP_IPV4
   if (!ip4_addr_isany_val(*netif_ip4_addr(netif))) {
     netif_do_ip_addr_changed(netif_ip_addr4(netif), NULL);
@@ -186,6 +186,9 @@ pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, u16_t tot_len, u16_t len,
   p->flags = flags;
   p->ref = 1;
   p->if_idx = NETIF_NO_INDEX;
+#if LWIP_TCP_GSO || LWIP_TCP_GRO
+  p->gso_size = 0;
+#endif /* LWIP_TCP_GSO || LWIP_TCP_GRO */
 
   LWIP_PBUF_CUSTOM_DATA_INIT(p);
 }
@@ -1354,6 +1357,9 @@ pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p)
   err = pbuf_copy(q, p);
   LWIP_UNUSED_ARG(err); /* in case of LWIP_NOASSERT */
   LWIP_ASSERT("pbuf_copy failed", err == ERR_OK);
+#if LWIP_TCP_GSO || LWIP_TCP_GRO
+  q->gso_size = p->gso_size;
+#endif /* LWIP_TCP_GSO || LWIP_TCP_GRO */
   return q;
 }
 
@@ -0,0 +1,169 @@
+/**
+ * @file
+ * Local port usage bitmap
+ *
+ * Used by TCP and UDP (LWIP_PORT_BITMAP) to find an unused port of their
+ * ephemeral port range without walking all pcbs. With LWIP_RAND, the search
+ * starts at a random port for every allocation (RFC 6056, algorithm 1).
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_PORT_BITMAP /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/portmap.h"
+#include "lwip/def.h"
+
+#define PORTMAP_IN_RANGE(map, port) (((port) >= (map)->start) && ((port) <= (map)->end))
+#define PORTMAP_IDX(map, port)      ((u32_t)((port) - (map)->start))
+#define PORTMAP_BIT(idx)            ((u32_t)1 << ((idx) & 31))
+
+/**
+ * Note that a pcb got bound to a port.
+ * Ports outside the range of the map are ignored.
+ *
+ * @param map the port map of the protocol
+ * @param port the local port of the pcb
+ */
+void
+portmap_acquire(struct portmap *map, u16_t port)
+{
+  u32_t idx;
+
+  if (!PORTMAP_IN_RANGE(map, port)) {
+    return;
+  }
+  idx = PORTMAP_IDX(map, port);
+  if (map->used[idx / 32] & PORTMAP_BIT(idx)) {
+    map->shared[idx / 32] |= PORTMAP_BIT(idx);
+  } else {
+    map->used[idx / 32] |= PORTMAP_BIT(idx);
+  }
+}
+
+/**
+ * Note that a pcb releases its local port.
+ *
+ * @param map the port map of the protocol
+ * @param port the local port of the pcb
+ * @return 1 if the port may still be used by other pcbs: the caller has to
+ *         count them and pass the result to portmap_set_users()
+ */
+u8_t
+portmap_release(struct portmap *map, u16_t port)
+{
+  u32_t idx;
+
+  if (!PORTMAP_IN_RANGE(map, port)) {
+    return 0;
+  }
+  idx = PORTMAP_IDX(map, port);
+  if (map->shared[idx / 32] & PORTMAP_BIT(idx)) {
+    return 1;
+  }
+  map->used[idx / 32] &= ~PORTMAP_BIT(idx);
+  return 0;
+}
+
+/**
+ * Set the usage of a port after portmap_release() returned 1.
+ *
+ * @param map the port map of the protocol
+ * @param port the local port
+ * @param users the number of pcbs that are still bound to the port
+ */
+void
+portmap_set_users(struct portmap *map, u16_t port, u32_t users)
+{
+  u32_t idx;
+
+  LWIP_ASSERT("port out of range", PORTMAP_IN_RANGE(map, port));
+  idx = PORTMAP_IDX(map, port);
+  if (users == 0) {
+    map->used[idx / 32] &= ~PORTMAP_BIT(idx);
+  } else {
+    map->used[idx / 32] |= PORTMAP_BIT(idx);
+  }
+  if (users <= 1) {
+    map->shared[idx / 32] &= ~PORTMAP_BIT(idx);
+  }
+}
+
+/**
+ * Find a port of the range that no pcb is bound to.
+ * The port is not acquired, the caller does that when binding the pcb.
+ *
+ * @param map the port map of the protocol
+ * @return an unused port or 0 if all ports of the range are used
+ */
+u16_t
+portmap_find(struct portmap *map)
+{
+  u32_t num = (u32_t)(map->end - map->start) + 1;
+  u32_t words = (num + 31) / 32;
+  u32_t idx, word, i;
+
+#ifdef LWIP_RAND
+  /* RFC 6056 algorithm 1: search from a random position in the range */
+  idx = (u32_t)LWIP_RAND() % num;
+#else /* LWIP_RAND */
+  /* continue after the last port handed out */
+  idx = (PORTMAP_IDX(map, map->last) + 1) % num;
+#endif /* LWIP_RAND */
+
+  /* one word after the other, the first one again at last for the ports
+     before the start position */
+  word = idx / 32;
+  for (i = 0; i <= words; i++) {
+    u32_t free_bits = ~map->used[word];
+    if (i == 0) {
+      free_bits &= ~(PORTMAP_BIT(idx) - 1);
+    }
+    if ((word == words - 1) && ((num & 31) != 0)) {
+      free_bits &= ((u32_t)1 << (num & 31)) - 1;
+    }
+    if (free_bits != 0) {
+      idx = word * 32;
+      while ((free_bits & 1) == 0) {
+        free_bits >>= 1;
+        idx++;
+      }
+      map->last = (u16_t)(map->start + idx);
+      return map->last;
+    }
+    word = (word + 1 == words) ? 0 : word + 1;
+  }
+  return 0;
+}
+
+#endif /* LWIP_PORT_BITMAP */
@@ -111,6 +111,7 @@
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/nd6.h"
+#include "lwip/priv/portmap.h"
 
 #include <string.h>
 
@@ -134,13 +135,6 @@
 #define TCP_KEEP_INTVL(pcb) TCP_KEEPINTVL_DEFAULT
 #endif /* LWIP_TCP_KEEPALIVE */
 
-/* As initial send MSS, we use TCP_MSS but limit it to 536. */
-#if TCP_MSS > 536
-#define INITIAL_MSS 536
-#else
-#define INITIAL_MSS TCP_MSS
-#endif
-
 static const char *const tcp_state_str[] = {
   "CLOSED",
   "LISTEN",
@@ -155,8 +149,13 @@ static const char *const tcp_state_str[] = {
   "TIME_WAIT"
 };
 
+#if LWIP_PORT_BITMAP
+/* used local TCP ports (TCP_LOCAL_PORT_RANGE_END is never handed out) */
+PORTMAP_DECLARE(tcp_portmap, TCP_LOCAL_PORT_RANGE_START, TCP_LOCAL_PORT_RANGE_END - 1);
+#else /* LWIP_PORT_BITMAP */
 /* last local TCP port */
 static u16_t tcp_port = TCP_LOCAL_PORT_RANGE_START;
+#endif /* LWIP_PORT_BITMAP */
 
 /* Incremented every coarse grained timer shot (typically every 500 ms). */
 u32_t tcp_ticks;
@@ -184,12 +183,35 @@ struct tcp_pcb **const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcbs
 
 u8_t tcp_active_pcbs_changed;
 
+#if LWIP_TCP_PCB_HASH
+/** Hash buckets of active and TIME-WAIT PCBs, keyed by 4-tuple */
+static struct tcp_pcb *tcp_pcb_hash[TCP_PCB_HASH_SIZE];
+/** Hash buckets of listening PCBs, keyed by local port */
+static struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+
+#define TCP_LISTEN_HASH_IDX(port) ((port) & (TCP_LISTEN_HASH_SIZE - 1))
+#endif /* LWIP_TCP_PCB_HASH */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
 static u8_t tcp_timer;
 static u8_t tcp_timer_ctr;
 static u16_t tcp_new_port(void);
 
 static err_t tcp_close_shutdown_fin(struct tcp_pcb *pcb);
+#if LWIP_TCP_TIMER_WHEEL
+/** Active and TIME-WAIT pcbs by the tcp_ticks value they are due in (modulo size) */
+static struct tcp_pcb *tcp_timer_wheel[TCP_TIMER_WHEEL_SIZE];
+/** Slot currently processed by tcp_slowtmr */
+static struct tcp_pcb *tcp_timer_run;
+/** Pcbs with a delayed ACK, a pending FIN or refused data */
+static struct tcp_pcb *tcp_timer_fast_pcbs;
+/** Fast list currently processed by tcp_fasttmr */
+static struct tcp_pcb *tcp_timer_fast_run;
+
+static void tcp_timer_unlink(struct tcp_pcb *pcb);
+static void tcp_timer_fast_unlink(struct tcp_pcb *pcb);
+static u8_t tcp_timer_poll_sync(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_TIMER_WHEEL */
 #if LWIP_TCP_PCB_NUM_EXT_ARGS
 static void tcp_ext_arg_invoke_callbacks_destroyed(struct tcp_pcb_ext_args *ext_args);
 #endif
@@ -200,7 +222,7 @@ static void tcp_ext_arg_invoke_callbacks_destroyed(struct tcp_pcb_ext_args *ext_
 void
 tcp_init(void)
 {
-#ifdef LWIP_RAND
+#if defined(LWIP_RAND) && !LWIP_PORT_BITMAP
   tcp_port = TCP_ENSURE_LOCAL_PORT_RANGE(LWIP_RAND());
 #endif /* LWIP_RAND */
 }
@@ -210,6 +232,18 @@ void
 tcp_free(struct tcp_pcb *pcb)
 {
   LWIP_ASSERT("tcp_free: LISTEN", pcb->state != LISTEN);
+#if LWIP_TCP_PACING
+  tcp_pace_stop(pcb);
+#endif /* LWIP_TCP_PACING */
+#if LWIP_TCP_TIMER_WHEEL
+  tcp_timer_unlink(pcb);
+  tcp_timer_fast_unlink(pcb);
+#endif /* LWIP_TCP_TIMER_WHEEL */
+#if LWIP_PORT_BITMAP
+  if (pcb->local_port != 0) {
+    tcp_port_release(pcb);
+  }
+#endif /* LWIP_PORT_BITMAP */
 #if LWIP_TCP_PCB_NUM_EXT_ARGS
   tcp_ext_arg_invoke_callbacks_destroyed(pcb->ext_args);
 #endif
@@ -276,6 +310,9 @@ tcp_listen_closed(struct tcp_pcb *pcb)
     tcp_remove_listener(*tcp_pcb_lists[i], (struct tcp_pcb_listen *)pcb);
   }
 #endif
+#if LWIP_TCP_SYN_COOKIES
+  tcp_syn_queue_purge((struct tcp_pcb_listen *)pcb);
+#endif /* LWIP_TCP_SYN_COOKIES */
   LWIP_UNUSED_ARG(pcb);
 }
 
@@ -449,6 +486,7 @@ tcp_close_shutdown_fin(struct tcp_pcb *pcb)
   } else if (err == ERR_MEM) {
     /* Mark this pcb for closing. Closing is retried from tcp_tmr. */
     tcp_set_flags(pcb, TF_CLOSEPEND);
+    TCP_TIMER_FAST(pcb);
     /* We have to return ERR_OK from here to indicate to the callers that this
        pcb should not be used any more as it will be freed soon via tcp_tmr.
        This is OK here since sending FIN does not guarantee a time frime for
@@ -493,6 +531,8 @@ tcp_close(struct tcp_pcb *pcb)
   if (pcb->state != LISTEN) {
     /* Set a flag not to receive any more data... */
     tcp_set_flags(pcb, TF_RXCLOSED);
+    /* (this may start the FIN-WAIT-2 timeout) */
+    tcp_timer_update(pcb);
   }
   /* ... and close */
   return tcp_close_shutdown(pcb, 1);
@@ -524,6 +564,7 @@ tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx)
   if (shut_rx) {
     /* shut down the receive side: set a flag not to receive any more data... */
     tcp_set_flags(pcb, TF_RXCLOSED);
+    tcp_timer_update(pcb);
     if (shut_tx) {
       /* shutting down the tx AND rx side is the same as closing for the raw API */
       return tcp_close_shutdown(pcb, 1);
@@ -745,6 +786,7 @@ tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     ip_addr_set(&pcb->local_ip, ipaddr);
   }
   pcb->local_port = port;
+  TCP_PORT_ACQUIRE(port);
   TCP_REG(&tcp_bound_pcbs, pcb);
   LWIP_DEBUGF(TCP_DEBUG, ("tcp_bind: bind to port %"U16_F"\n", port));
   return ERR_OK;
@@ -889,6 +931,12 @@ tcp_listen_with_backlog_and_err(struct tcp_pcb *pcb, u8_t backlog, err_t *err)
   lpcb->local_port = pcb->local_port;
   lpcb->state = LISTEN;
   lpcb->prio = pcb->prio;
+#if LWIP_TCP_FASTOPEN
+  lpcb->fastopen = pcb->fastopen;
+#endif /* LWIP_TCP_FASTOPEN */
+#if LWIP_TCP_SYN_COOKIES
+  lpcb->syncookies = 0;
+#endif /* LWIP_TCP_SYN_COOKIES */
   lpcb->so_options = pcb->so_options;
   lpcb->netif_idx = pcb->netif_idx;
   lpcb->ttl = pcb->ttl;
@@ -907,6 +955,10 @@ tcp_listen_with_backlog_and_err(struct tcp_pcb *pcb, u8_t backlog, err_t *err)
   /* copy over ext_args to listening pcb  */
   memcpy(&lpcb->ext_args, &pcb->ext_args, sizeof(pcb->ext_args));
 #endif
+#if LWIP_PORT_BITMAP
+  /* the listening pcb takes over the port */
+  pcb->local_port = 0;
+#endif /* LWIP_PORT_BITMAP */
   tcp_free(pcb);
 #if LWIP_CALLBACK_API
   lpcb->accept = tcp_accept_null;
@@ -970,9 +1022,22 @@ tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
  */
 void
 tcp_recved(struct tcp_pcb *pcb, u16_t len)
+{
+  tcp_recved_ext(pcb, len);
+}
+
+/**
+ * @ingroup tcp_raw
+ * Like @ref tcp_recved, but 'len' is not limited to 16 bits, so data
+ * received in a scaled window can be acknowledged with one call.
+ *
+ * @param pcb the tcp_pcb for which data is read
+ * @param len the amount of bytes that have been read by the application
+ */
+void
+tcp_recved_ext(struct tcp_pcb *pcb, size_t len)
 {
   u32_t wnd_inflation;
-  tcpwnd_size_t rcv_wnd;
 
   LWIP_ASSERT_CORE_LOCKED();
 
@@ -982,13 +1047,13 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
   LWIP_ASSERT("don't call tcp_recved for listen-pcbs",
               pcb->state != LISTEN);
 
-  rcv_wnd = (tcpwnd_size_t)(pcb->rcv_wnd + len);
-  if ((rcv_wnd > TCP_WND_MAX(pcb)) || (rcv_wnd < pcb->rcv_wnd)) {
-    /* window got too big or tcpwnd_size_t overflow */
-    LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: window got too big or tcpwnd_size_t overflow\n"));
+  if ((pcb->rcv_wnd >= TCP_WND_MAX(pcb)) ||
+      (len > (size_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd))) {
+    /* window got too big */
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: window got too big\n"));
     pcb->rcv_wnd = TCP_WND_MAX(pcb);
   } else  {
-    pcb->rcv_wnd = rcv_wnd;
+    pcb->rcv_wnd = (tcpwnd_size_t)(pcb->rcv_wnd + len);
   }
 
   wnd_inflation = tcp_update_rcv_ann_wnd(pcb);
@@ -1002,10 +1067,59 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     tcp_output(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: received %"U16_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: received %"SZT_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
                           len, pcb->rcv_wnd, (u16_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd)));
 }
 
+#if LWIP_TCP_ACK_POLICY
+/**
+ * @ingroup tcp_raw
+ * Set how many full-sized segments are acknowledged with one ACK
+ * (LWIP_TCP_ACK_POLICY, default TCP_ACK_EVERY). Less data is acknowledged
+ * by the delayed ACK of the fast timer.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param segs number of segments per ACK (1: acknowledge every full-sized
+ *        segment at once)
+ */
+void
+tcp_ack_every(struct tcp_pcb *pcb, u8_t segs)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_ack_every: invalid pcb", pcb != NULL, return);
+  LWIP_ERROR("tcp_ack_every: invalid state", pcb->state != LISTEN, return);
+
+  pcb->ack_every = (u8_t)LWIP_MAX(segs, 1);
+}
+
+/**
+ * @ingroup tcp_raw
+ * Enter or leave quick-ack mode (LWIP_TCP_ACK_POLICY): the next
+ * TCP_QUICKACK_SEGS segments are acknowledged at once. The stack enters
+ * quick-ack mode by itself at the start of a connection and when data
+ * arrives out of order.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param enable 1 to enter quick-ack mode, 0 to delay ACKs again
+ */
+void
+tcp_quickack(struct tcp_pcb *pcb, u8_t enable)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_quickack: invalid pcb", pcb != NULL, return);
+  LWIP_ERROR("tcp_quickack: invalid state", pcb->state != LISTEN, return);
+
+  pcb->ack_quick = enable ? TCP_QUICKACK_SEGS : 0;
+  if (enable && (pcb->flags & TF_ACK_DELAY)) {
+    /* don't hold back the ACK for what was received so far */
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+  }
+}
+#endif /* LWIP_TCP_ACK_POLICY */
+
 /**
  * Allocate a new local TCP port.
  *
@@ -1014,6 +1128,9 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
 static u16_t
 tcp_new_port(void)
 {
+#if LWIP_PORT_BITMAP
+  return portmap_find(&tcp_portmap);
+#else /* LWIP_PORT_BITMAP */
   u8_t i;
   u16_t n = 0;
   struct tcp_pcb *pcb;
@@ -1036,8 +1153,47 @@ again:
     }
   }
   return tcp_port;
+#endif /* LWIP_PORT_BITMAP */
 }
 
+#if LWIP_PORT_BITMAP
+/**
+ * Mark a local port used in the port bitmap.
+ *
+ * @param port the local port a pcb got bound to
+ */
+void
+tcp_port_acquire(u16_t port)
+{
+  portmap_acquire(&tcp_portmap, port);
+}
+
+/**
+ * Update the port bitmap for a pcb that releases its local port.
+ * If the port was used more than once, the remaining pcbs are counted.
+ *
+ * @param pcb the pcb that releases its local port
+ */
+void
+tcp_port_release(struct tcp_pcb *pcb)
+{
+  if (portmap_release(&tcp_portmap, pcb->local_port)) {
+    struct tcp_pcb *cpcb;
+    u32_t users = 0;
+    u8_t i;
+
+    for (i = 0; i < NUM_TCP_PCB_LISTS; i++) {
+      for (cpcb = *tcp_pcb_lists[i]; cpcb != NULL; cpcb = cpcb->next) {
+        if ((cpcb != pcb) && (cpcb->local_port == pcb->local_port)) {
+          users++;
+        }
+      }
+    }
+    portmap_set_users(&tcp_portmap, pcb->local_port, users);
+  }
+}
+#endif /* LWIP_PORT_BITMAP */
+
 /**
  * @ingroup tcp_raw
  * Connects to another host. The function given as the "connected"
@@ -1122,6 +1278,7 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
     if (pcb->local_port == 0) {
       return ERR_BUF;
     }
+    TCP_PORT_ACQUIRE(pcb->local_port);
   } else {
 #if SO_REUSE
     if (ip_get_option(pcb, SOF_REUSEADDR)) {
@@ -1169,6 +1326,14 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   LWIP_UNUSED_ARG(connected);
 #endif /* LWIP_CALLBACK_API */
 
+#if LWIP_TCP_FASTOPEN
+  /* Ask for a cookie or send the one we have (see tcp_fastopen()) */
+  pcb->fastopen_optlen = 0;
+  if (pcb->fastopen & TCP_FASTOPEN_ENABLED) {
+    pcb->fastopen_optlen = TCP_FASTOPEN_OPT_LEN(tcp_fastopen_cache_get(ipaddr, NULL));
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+
   /* Send a SYN together with the MSS option. */
   ret = tcp_enqueue_flags(pcb, TCP_SYN);
   if (ret == ERR_OK) {
@@ -1180,11 +1345,430 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
     TCP_REG_ACTIVE(pcb);
     MIB2_STATS_INC(mib2.tcpactiveopens);
 
-    tcp_output(pcb);
+#if LWIP_TCP_FASTOPEN
+    if (pcb->fastopen_optlen > TCP_FASTOPEN_OPT_LEN(0)) {
+      /* we have a cookie: the SYN waits for data to carry */
+      pcb->fastopen |= TCP_FASTOPEN_SYN_DATA;
+      TCP_TIMER_FAST(pcb);
+    } else
+#endif /* LWIP_TCP_FASTOPEN */
+    {
+      tcp_output(pcb);
+    }
   }
   return ret;
 }
 
+/**
+ * Runs the slow timers of an active pcb for one tick: retransmission and
+ * persist timers, keepalive, out-of-sequence data and the timeouts of the
+ * SYN-RCVD, FIN-WAIT-2 and LAST-ACK states.
+ *
+ * @param pcb the active pcb to check
+ * @param pcb_reset set to 1 if a RST should be sent when removing the pcb
+ * @return != 0 if the pcb should be removed
+ */
+static u8_t
+tcp_slowtmr_check(struct tcp_pcb *pcb, u8_t *pcb_reset)
+{
+  u8_t pcb_remove = 0;
+  err_t err;
+
+  if (pcb->state == SYN_SENT && pcb->nrtx >= TCP_SYNMAXRTX) {
+    ++pcb_remove;
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: max SYN retries reached\n"));
+  } else if (pcb->nrtx >= TCP_MAXRTX) {
+    ++pcb_remove;
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: max DATA retries reached\n"));
+  } else {
+    if (pcb->persist_backoff > 0) {
+      LWIP_ASSERT("tcp_slowtimr: persist ticking with in-flight data", pcb->unacked == NULL);
+      LWIP_ASSERT("tcp_slowtimr: persist ticking with empty send buffer", pcb->unsent != NULL);
+      if (pcb->persist_probe >= TCP_MAXRTX) {
+        ++pcb_remove; /* max probes reached */
+      } else {
+        u8_t backoff_cnt = tcp_persist_backoff[pcb->persist_backoff - 1];
+        if (pcb->persist_cnt < backoff_cnt) {
+          pcb->persist_cnt++;
+        }
+        if (pcb->persist_cnt >= backoff_cnt) {
+          int next_slot = 1; /* increment timer to next slot */
+          /* If snd_wnd is zero, send 1 byte probes */
+          if (pcb->snd_wnd == 0) {
+            if (tcp_zero_window_probe(pcb) != ERR_OK) {
+              next_slot = 0; /* try probe again with current slot */
+            }
+            /* snd_wnd not fully closed, split unsent head and fill window */
+          } else {
+            if (tcp_split_unsent_seg(pcb, (u16_t)pcb->snd_wnd) == ERR_OK) {
+              if (tcp_output(pcb) == ERR_OK) {
+                /* sending will cancel persist timer, else retry with current slot */
+                next_slot = 0;
+              }
+            }
+          }
+          if (next_slot) {
+            pcb->persist_cnt = 0;
+            if (pcb->persist_backoff < sizeof(tcp_persist_backoff)) {
+              pcb->persist_backoff++;
+            }
+          }
+        }
+      }
+    } else {
+      /* Increase the retransmission timer if it is running */
+      if ((pcb->rtime >= 0) && (pcb->rtime < 0x7FFF)) {
+        ++pcb->rtime;
+      }
+
+      if (pcb->rtime >= pcb->rto) {
+        /* Time for a retransmission. */
+        LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_slowtmr: rtime %"S16_F
+                                    " pcb->rto %"S16_F"\n",
+                                    pcb->rtime, pcb->rto));
+        /* If prepare phase fails but we have unsent data but no unacked data,
+           still execute the backoff calculations below, as this means we somehow
+           failed to send segment. */
+        if ((tcp_rexmit_rto_prepare(pcb) == ERR_OK) || ((pcb->unacked == NULL) && (pcb->unsent != NULL))) {
+          /* Double retransmission time-out unless we are trying to
+           * connect to somebody (i.e., we are in SYN_SENT). */
+          if (pcb->state != SYN_SENT) {
+            u8_t backoff_idx = LWIP_MIN(pcb->nrtx, sizeof(tcp_backoff) - 1);
+            int calc_rto = ((pcb->sa >> 3) + pcb->sv) << tcp_backoff[backoff_idx];
+            pcb->rto = (s16_t)LWIP_MIN(calc_rto, 0x7FFF);
+          }
+
+          /* Reset the retransmission timer. */
+          pcb->rtime = 0;
+
+          /* Reduce congestion window and ssthresh. */
+          pcb->cc->on_rto(pcb);
+          pcb->cwnd = pcb->mss;
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
+                                       " ssthresh %"TCPWNDSIZE_F"\n",
+                                       pcb->cwnd, pcb->ssthresh));
+          pcb->bytes_acked = 0;
+
+          /* The following needs to be called AFTER cwnd is set to one
+             mss - STJ */
+          tcp_rexmit_rto_commit(pcb);
+        }
+      }
+    }
+  }
+  /* Check if this PCB has stayed too long in FIN-WAIT-2 */
+  if (pcb->state == FIN_WAIT_2) {
+    /* If this PCB is in FIN_WAIT_2 because of SHUT_WR don't let it time out. */
+    if (pcb->flags & TF_RXCLOSED) {
+      /* PCB was fully closed (either through close() or SHUT_RDWR):
+         normal FIN-WAIT timeout handling. */
+      if ((u32_t)(tcp_ticks - pcb->tmr) >
+          TCP_FIN_WAIT_TIMEOUT / TCP_SLOW_INTERVAL) {
+        ++pcb_remove;
+        LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in FIN-WAIT-2\n"));
+      }
+    }
+  }
+
+  /* Check if KEEPALIVE should be sent */
+  if (ip_get_option(pcb, SOF_KEEPALIVE) &&
+      ((pcb->state == ESTABLISHED) ||
+       (pcb->state == CLOSE_WAIT))) {
+    if ((u32_t)(tcp_ticks - pcb->tmr) >
+        (pcb->keep_idle + TCP_KEEP_DUR(pcb)) / TCP_SLOW_INTERVAL) {
+      LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: KEEPALIVE timeout. Aborting connection to "));
+      ip_addr_debug_print_val(TCP_DEBUG, pcb->remote_ip);
+      LWIP_DEBUGF(TCP_DEBUG, ("\n"));
+
+      ++pcb_remove;
+      *pcb_reset = 1;
+    } else if ((u32_t)(tcp_ticks - pcb->tmr) >
+               (pcb->keep_idle + pcb->keep_cnt_sent * TCP_KEEP_INTVL(pcb))
+               / TCP_SLOW_INTERVAL) {
+      err = tcp_keepalive(pcb);
+      if (err == ERR_OK) {
+        pcb->keep_cnt_sent++;
+      }
+    }
+  }
+
+  /* If this PCB has queued out of sequence data, but has been
+     inactive for too long, will drop the data (it will eventually
+     be retransmitted). */
+#if TCP_QUEUE_OOSEQ
+  if (pcb->ooseq != NULL &&
+      (tcp_ticks - pcb->tmr >= (u32_t)pcb->rto * TCP_OOSEQ_TIMEOUT)) {
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: dropping OOSEQ queued data\n"));
+    tcp_free_ooseq(pcb);
+  }
+#endif /* TCP_QUEUE_OOSEQ */
+
+  /* Check if this PCB has stayed too long in SYN-RCVD */
+  if (pcb->state == SYN_RCVD) {
+    if ((u32_t)(tcp_ticks - pcb->tmr) >
+        TCP_SYN_RCVD_TIMEOUT / TCP_SLOW_INTERVAL) {
+      ++pcb_remove;
+      LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in SYN-RCVD\n"));
+    }
+  }
+
+  /* Check if this PCB has stayed too long in LAST-ACK */
+  if (pcb->state == LAST_ACK) {
+    if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
+      ++pcb_remove;
+      LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in LAST-ACK\n"));
+    }
+  }
+
+  return pcb_remove;
+}
+
+#if LWIP_TCP_TIMER_WHEEL
+/** Remove a pcb from its timer wheel slot (or from tcp_timer_run) */
+static void
+tcp_timer_unlink(struct tcp_pcb *pcb)
+{
+  if (pcb->tmr_pprev != NULL) {
+    *pcb->tmr_pprev = pcb->tmr_next;
+    if (pcb->tmr_next != NULL) {
+      pcb->tmr_next->tmr_pprev = pcb->tmr_pprev;
+    }
+    pcb->tmr_next = NULL;
+    pcb->tmr_pprev = NULL;
+  }
+}
+
+/** Remove a pcb from the fast timer list (or from tcp_timer_fast_run) */
+static void
+tcp_timer_fast_unlink(struct tcp_pcb *pcb)
+{
+  if (pcb->fast_pprev != NULL) {
+    *pcb->fast_pprev = pcb->fast_next;
+    if (pcb->fast_next != NULL) {
+      pcb->fast_next->fast_pprev = pcb->fast_pprev;
+    }
+    pcb->fast_next = NULL;
+    pcb->fast_pprev = NULL;
+  }
+}
+
+/** Put a pcb on the fast timer list if tcp_fasttmr has something to do for it */
+void
+tcp_timer_fast(struct tcp_pcb *pcb)
+{
+  if ((pcb->fast_pprev == NULL) &&
+      ((pcb->flags & (TF_ACK_DELAY | TF_CLOSEPEND)) || (pcb->refused_data != NULL))) {
+    pcb->fast_next = tcp_timer_fast_pcbs;
+    if (tcp_timer_fast_pcbs != NULL) {
+      tcp_timer_fast_pcbs->fast_pprev = &pcb->fast_next;
+    }
+    tcp_timer_fast_pcbs = pcb;
+    pcb->fast_pprev = &tcp_timer_fast_pcbs;
+  }
+}
+
+/**
+ * Bring polltmr up to date with the tcp_ticks passed since tmr_poll, as if
+ * tcp_slowtmr had looked at the pcb in every tick.
+ *
+ * @return 1 if the poll interval expired in the current tick
+ */
+static u8_t
+tcp_timer_poll_sync(struct tcp_pcb *pcb)
+{
+  u32_t elapsed = tcp_ticks - pcb->tmr_poll;
+  u32_t first;
+
+  pcb->tmr_poll = tcp_ticks;
+  if (elapsed == 0) {
+    return 0;
+  }
+  if (pcb->pollinterval == 0) {
+    pcb->polltmr = 0;
+    return 1;
+  }
+  first = (pcb->polltmr < pcb->pollinterval) ? (u32_t)(pcb->pollinterval - pcb->polltmr) : 1;
+  if (elapsed < first) {
+    pcb->polltmr = (u8_t)(pcb->polltmr + elapsed);
+    return 0;
+  }
+  pcb->polltmr = (u8_t)((elapsed - first) % pcb->pollinterval);
+  return (pcb->polltmr == 0);
+}
+
+/** Number of ticks from now until the poll interval of a pcb expires */
+static u32_t
+tcp_timer_poll_next(struct tcp_pcb *pcb)
+{
+  u32_t elapsed = tcp_ticks - pcb->tmr_poll;
+  u32_t first;
+
+  if (pcb->pollinterval == 0) {
+    return 1;
+  }
+  first = (pcb->polltmr < pcb->pollinterval) ? (u32_t)(pcb->pollinterval - pcb->polltmr) : 1;
+  if (elapsed < first) {
+    return first - elapsed;
+  }
+  return pcb->pollinterval - ((elapsed - first) % pcb->pollinterval);
+}
+
+/** Number of ticks from now until (tcp_ticks - pcb->tmr) > limit */
+static u32_t
+tcp_timer_after(struct tcp_pcb *pcb, u32_t limit)
+{
+  u32_t idle = tcp_ticks - pcb->tmr;
+  return (idle <= limit) ? (limit - idle + 1) : 1;
+}
+
+/**
+ * Calculate when tcp_slowtmr has to look at a pcb next: in the next tick
+ * while the retransmission or persist timer is running, else at the first
+ * timeout or poll that can have an effect. Far away deadlines are checked
+ * once per wheel revolution.
+ *
+ * @return number of ticks from now, 1..TCP_TIMER_WHEEL_SIZE
+ */
+static u32_t
+tcp_timer_next(struct tcp_pcb *pcb)
+{
+  u32_t next = TCP_TIMER_WHEEL_SIZE;
+
+  if (pcb->state == TIME_WAIT) {
+    return LWIP_MIN(next, tcp_timer_after(pcb, 2 * TCP_MSL / TCP_SLOW_INTERVAL));
+  }
+  if ((pcb->rtime >= 0) || (pcb->persist_backoff > 0) || (pcb->nrtx >= TCP_MAXRTX) ||
+      ((pcb->state == SYN_SENT) && (pcb->nrtx >= TCP_SYNMAXRTX))) {
+    return 1;
+  }
+  /* a poll without callback has an effect only if tcp_output has something to do */
+  if (
+#if LWIP_CALLBACK_API
+      (pcb->poll != NULL) ||
+#else /* LWIP_CALLBACK_API */
+      (pcb->state != SYN_RCVD) ||
+#endif /* LWIP_CALLBACK_API */
+      (pcb->unsent != NULL) || (pcb->flags & (TF_ACK_NOW | TF_NAGLEMEMERR))) {
+    next = LWIP_MIN(next, tcp_timer_poll_next(pcb));
+  }
+  if ((pcb->state == FIN_WAIT_2) && (pcb->flags & TF_RXCLOSED)) {
+    next = LWIP_MIN(next, tcp_timer_after(pcb, TCP_FIN_WAIT_TIMEOUT / TCP_SLOW_INTERVAL));
+  }
+  if (ip_get_option(pcb, SOF_KEEPALIVE) &&
+      ((pcb->state == ESTABLISHED) || (pcb->state == CLOSE_WAIT))) {
+    next = LWIP_MIN(next, tcp_timer_after(pcb,
+                    (pcb->keep_idle + pcb->keep_cnt_sent * TCP_KEEP_INTVL(pcb)) / TCP_SLOW_INTERVAL));
+  }
+#if TCP_QUEUE_OOSEQ
+  if (pcb->ooseq != NULL) {
+    u32_t limit = (u32_t)pcb->rto * TCP_OOSEQ_TIMEOUT;
+    next = LWIP_MIN(next, (limit == 0) ? 1 : tcp_timer_after(pcb, limit - 1));
+  }
+#endif /* TCP_QUEUE_OOSEQ */
+  if (pcb->state == SYN_RCVD) {
+    next = LWIP_MIN(next, tcp_timer_after(pcb, TCP_SYN_RCVD_TIMEOUT / TCP_SLOW_INTERVAL));
+  } else if (pcb->state == LAST_ACK) {
+    next = LWIP_MIN(next, tcp_timer_after(pcb, 2 * TCP_MSL / TCP_SLOW_INTERVAL));
+  }
+  return next;
+}
+
+/**
+ * @ingroup tcp_raw
+ * Recalculate when the slow timer has to look at a pcb. This is done by the
+ * stack itself whenever it changes timer related state; application code
+ * that changes keepalive settings (SOF_KEEPALIVE, keep_idle, keep_intvl,
+ * keep_cnt) of a pcb directly has to call this afterwards.
+ * Only available with LWIP_TCP_TIMER_WHEEL (else this is an empty macro).
+ *
+ * @param pcb the tcp_pcb whose timers changed
+ */
+void
+tcp_timer_update(struct tcp_pcb *pcb)
+{
+  u32_t due;
+
+  if ((pcb->state == CLOSED) || (pcb->state == LISTEN)) {
+    return;
+  }
+  due = tcp_ticks + tcp_timer_next(pcb);
+  if (pcb->tmr_pprev != NULL) {
+    if ((s32_t)(due - pcb->tmr_due) >= 0) {
+      /* already scheduled early enough, the next visit recalculates */
+      return;
+    }
+    tcp_timer_unlink(pcb);
+  } else {
+    /* new on the wheel (polltmr starts counting now) or being visited in
+       this tick (polltmr is up to date already) */
+    pcb->tmr_poll = tcp_ticks;
+  }
+  pcb->tmr_due = due;
+  pcb->tmr_next = tcp_timer_wheel[due & (TCP_TIMER_WHEEL_SIZE - 1)];
+  if (pcb->tmr_next != NULL) {
+    pcb->tmr_next->tmr_pprev = &pcb->tmr_next;
+  }
+  tcp_timer_wheel[due & (TCP_TIMER_WHEEL_SIZE - 1)] = pcb;
+  pcb->tmr_pprev = &tcp_timer_wheel[due & (TCP_TIMER_WHEEL_SIZE - 1)];
+}
+
+/** tcp_slowtmr for one active pcb taken from the timer wheel */
+static void
+tcp_slowtmr_pcb(struct tcp_pcb *pcb)
+{
+  u8_t pcb_reset = 0;
+  u8_t poll;
+  err_t err;
+
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: processing active pcb\n"));
+  poll = tcp_timer_poll_sync(pcb);
+  if (tcp_slowtmr_check(pcb, &pcb_reset)) {
+#if LWIP_CALLBACK_API
+    tcp_err_fn err_fn = pcb->errf;
+#endif /* LWIP_CALLBACK_API */
+    void *err_arg;
+    enum tcp_state last_state;
+    tcp_pcb_purge(pcb);
+    TCP_RMV_ACTIVE(pcb);
+    if (pcb_reset) {
+      tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
+              pcb->local_port, pcb->remote_port);
+    }
+    err_arg = pcb->callback_arg;
+    last_state = pcb->state;
+    tcp_free(pcb);
+    TCP_EVENT_ERR(last_state, err_fn, err_arg, ERR_ABRT);
+    return;
+  }
+
+  /* schedule the next visit now, the poll callback may free the pcb */
+  tcp_timer_update(pcb);
+  if (poll) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: polling application\n"));
+    tcp_active_pcbs_changed = 0;
+    TCP_EVENT_POLL(pcb, err);
+    /* if err == ERR_ABRT, 'pcb' is already deallocated */
+    if ((err == ERR_OK) && !tcp_active_pcbs_changed) {
+      tcp_output(pcb);
+    }
+  }
+}
+
+/** tcp_slowtmr for one TIME-WAIT pcb taken from the timer wheel */
+static void
+tcp_slowtmr_tw_pcb(struct tcp_pcb *pcb)
+{
+  /* Check if this PCB has stayed long enough in TIME-WAIT */
+  if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
+    tcp_pcb_purge(pcb);
+    TCP_RMV(&tcp_tw_pcbs, pcb);
+    tcp_free(pcb);
+  } else {
+    tcp_timer_update(pcb);
+  }
+}
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
 /**
  * Called every 500 ms and implements the retransmission timer and the timer that
  * removes PCBs that have been in TIME-WAIT for enough time. It also increments
@@ -1195,8 +1779,31 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
 void
 tcp_slowtmr(void)
 {
+#if LWIP_TCP_TIMER_WHEEL
+  struct tcp_pcb *pcb;
+  struct tcp_pcb **slot;
+
+  ++tcp_ticks;
+  ++tcp_timer_ctr;
+
+  /* Only the pcbs due in this tick are in the slot: take them all (pcbs that
+     are scheduled again while processing go to later slots) */
+  slot = &tcp_timer_wheel[tcp_ticks & (TCP_TIMER_WHEEL_SIZE - 1)];
+  tcp_timer_run = *slot;
+  *slot = NULL;
+  if (tcp_timer_run != NULL) {
+    tcp_timer_run->tmr_pprev = &tcp_timer_run;
+  }
+  while ((pcb = tcp_timer_run) != NULL) {
+    tcp_timer_unlink(pcb);
+    if (pcb->state == TIME_WAIT) {
+      tcp_slowtmr_tw_pcb(pcb);
+    } else if ((pcb->state != CLOSED) && (pcb->state != LISTEN)) {
+      tcp_slowtmr_pcb(pcb);
+    }
+  }
+#else /* LWIP_TCP_TIMER_WHEEL */
   struct tcp_pcb *pcb, *prev;
-  tcpwnd_size_t eff_wnd;
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
   err_t err;
@@ -1226,158 +1833,8 @@ tcp_slowtmr_start:
     }
     pcb->last_timer = tcp_timer_ctr;
 
-    pcb_remove = 0;
     pcb_reset = 0;
-
-    if (pcb->state == SYN_SENT && pcb->nrtx >= TCP_SYNMAXRTX) {
-      ++pcb_remove;
-      LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: max SYN retries reached\n"));
-    } else if (pcb->nrtx >= TCP_MAXRTX) {
-      ++pcb_remove;
-      LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: max DATA retries reached\n"));
-    } else {
-      if (pcb->persist_backoff > 0) {
-        LWIP_ASSERT("tcp_slowtimr: persist ticking with in-flight data", pcb->unacked == NULL);
-        LWIP_ASSERT("tcp_slowtimr: persist ticking with empty send buffer", pcb->unsent != NULL);
-        if (pcb->persist_probe >= TCP_MAXRTX) {
-          ++pcb_remove; /* max probes reached */
-        } else {
-          u8_t backoff_cnt = tcp_persist_backoff[pcb->persist_backoff - 1];
-          if (pcb->persist_cnt < backoff_cnt) {
-            pcb->persist_cnt++;
-          }
-          if (pcb->persist_cnt >= backoff_cnt) {
-            int next_slot = 1; /* increment timer to next slot */
-            /* If snd_wnd is zero, send 1 byte probes */
-            if (pcb->snd_wnd == 0) {
-              if (tcp_zero_window_probe(pcb) != ERR_OK) {
-                next_slot = 0; /* try probe again with current slot */
-              }
-              /* snd_wnd not fully closed, split unsent head and fill window */
-            } else {
-              if (tcp_split_unsent_seg(pcb, (u16_t)pcb->snd_wnd) == ERR_OK) {
-                if (tcp_output(pcb) == ERR_OK) {
-                  /* sending will cancel persist timer, else retry with current slot */
-                  next_slot = 0;
-                }
-              }
-            }
-            if (next_slot) {
-              pcb->persist_cnt = 0;
-              if (pcb->persist_backoff < sizeof(tcp_persist_backoff)) {
-                pcb->persist_backoff++;
-              }
-            }
-          }
-        }
-      } else {
-        /* Increase the retransmission timer if it is running */
-        if ((pcb->rtime >= 0) && (pcb->rtime < 0x7FFF)) {
-          ++pcb->rtime;
-        }
-
-        if (pcb->rtime >= pcb->rto) {
-          /* Time for a retransmission. */
-          LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_slowtmr: rtime %"S16_F
-                                      " pcb->rto %"S16_F"\n",
-                                      pcb->rtime, pcb->rto));
-          /* If prepare phase fails but we have unsent data but no unacked data,
-             still execute the backoff calculations below, as this means we somehow
-             failed to send segment. */
-          if ((tcp_rexmit_rto_prepare(pcb) == ERR_OK) || ((pcb->unacked == NULL) && (pcb->unsent != NULL))) {
-            /* Double retransmission time-out unless we are trying to
-             * connect to somebody (i.e., we are in SYN_SENT). */
-            if (pcb->state != SYN_SENT) {
-              u8_t backoff_idx = LWIP_MIN(pcb->nrtx, sizeof(tcp_backoff) - 1);
-              int calc_rto = ((pcb->sa >> 3) + pcb->sv) << tcp_backoff[backoff_idx];
-              pcb->rto = (s16_t)LWIP_MIN(calc_rto, 0x7FFF);
-            }
-
-            /* Reset the retransmission timer. */
-            pcb->rtime = 0;
-
-            /* Reduce congestion window and ssthresh. */
-            eff_wnd = LWIP_MIN(pcb->cwnd, pcb->snd_wnd);
-            pcb->ssthresh = eff_wnd >> 1;
-            if (pcb->ssthresh < (tcpwnd_size_t)(pcb->mss << 1)) {
-              pcb->ssthresh = (tcpwnd_size_t)(pcb->mss << 1);
-            }
-            pcb->cwnd = pcb->mss;
-            LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
-                                         " ssthresh %"TCPWNDSIZE_F"\n",
-                                         pcb->cwnd, pcb->ssthresh));
-            pcb->bytes_acked = 0;
-
-            /* The following needs to be called AFTER cwnd is set to one
-               mss - STJ */
-            tcp_rexmit_rto_commit(pcb);
-          }
-        }
-      }
-    }
-    /* Check if this PCB has stayed too long in FIN-WAIT-2 */
-    if (pcb->state == FIN_WAIT_2) {
-      /* If this PCB is in FIN_WAIT_2 because of SHUT_WR don't let it time out. */
-      if (pcb->flags & TF_RXCLOSED) {
-        /* PCB was fully closed (either through close() or SHUT_RDWR):
-           normal FIN-WAIT timeout handling. */
-        if ((u32_t)(tcp_ticks - pcb->tmr) >
-            TCP_FIN_WAIT_TIMEOUT / TCP_SLOW_INTERVAL) {
-          ++pcb_remove;
-          LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in FIN-WAIT-2\n"));
-        }
-      }
-    }
-
-    /* Check if KEEPALIVE should be sent */
-    if (ip_get_option(pcb, SOF_KEEPALIVE) &&
-        ((pcb->state == ESTABLISHED) ||
-         (pcb->state == CLOSE_WAIT))) {
-      if ((u32_t)(tcp_ticks - pcb->tmr) >
-          (pcb->keep_idle + TCP_KEEP_DUR(pcb)) / TCP_SLOW_INTERVAL) {
-        LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: KEEPALIVE timeout. Aborting connection to "));
-        ip_addr_debug_print_val(TCP_DEBUG, pcb->remote_ip);
-        LWIP_DEBUGF(TCP_DEBUG, ("\n"));
-
-        ++pcb_remove;
-        ++pcb_reset;
-      } else if ((u32_t)(tcp_ticks - pcb->tmr) >
-                 (pcb->keep_idle + pcb->keep_cnt_sent * TCP_KEEP_INTVL(pcb))
-                 / TCP_SLOW_INTERVAL) {
-        err = tcp_keepalive(pcb);
-        if (err == ERR_OK) {
-          pcb->keep_cnt_sent++;
-        }
-      }
-    }
-
-    /* If this PCB has queued out of sequence data, but has been
-       inactive for too long, will drop the data (it will eventually
-       be retransmitted). */
-#if TCP_QUEUE_OOSEQ
-    if (pcb->ooseq != NULL &&
-        (tcp_ticks - pcb->tmr >= (u32_t)pcb->rto * TCP_OOSEQ_TIMEOUT)) {
-      LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: dropping OOSEQ queued data\n"));
-      tcp_free_ooseq(pcb);
-    }
-#endif /* TCP_QUEUE_OOSEQ */
-
-    /* Check if this PCB has stayed too long in SYN-RCVD */
-    if (pcb->state == SYN_RCVD) {
-      if ((u32_t)(tcp_ticks - pcb->tmr) >
-          TCP_SYN_RCVD_TIMEOUT / TCP_SLOW_INTERVAL) {
-        ++pcb_remove;
-        LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in SYN-RCVD\n"));
-      }
-    }
-
-    /* Check if this PCB has stayed too long in LAST-ACK */
-    if (pcb->state == LAST_ACK) {
-      if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
-        ++pcb_remove;
-        LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in LAST-ACK\n"));
-      }
-    }
+    pcb_remove = tcp_slowtmr_check(pcb, &pcb_reset);
 
     /* If the PCB should be removed, do it. */
     if (pcb_remove) {
@@ -1397,6 +1854,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_active_pcbs, pcb);
 
       if (pcb_reset) {
         tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1463,6 +1921,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       tcp_free(pcb2);
@@ -1471,6 +1930,32 @@ tcp_slowtmr_start:
       pcb = pcb->next;
     }
   }
+#endif /* LWIP_TCP_TIMER_WHEEL */
+}
+
+/** Send the delayed ACK or the pending FIN of an active pcb */
+static void
+tcp_fasttmr_pcb(struct tcp_pcb *pcb)
+{
+  /* send delayed ACKs */
+  if (pcb->flags & TF_ACK_DELAY) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: delayed ACK\n"));
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+    tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+  }
+#if LWIP_TCP_FASTOPEN
+  /* send a SYN that waited for data in vain */
+  if (pcb->fastopen & TCP_FASTOPEN_SYN_DATA) {
+    tcp_output(pcb);
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+  /* send pending FIN */
+  if (pcb->flags & TF_CLOSEPEND) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: pending FIN\n"));
+    tcp_clear_flags(pcb, TF_CLOSEPEND);
+    tcp_close_shutdown_fin(pcb);
+  }
 }
 
 /**
@@ -1486,6 +1971,30 @@ tcp_fasttmr(void)
 
   ++tcp_timer_ctr;
 
+#if LWIP_TCP_GRO
+  /* in case the driver does not flush at the end of its batches */
+  tcp_gro_flush(NULL);
+#endif /* LWIP_TCP_GRO */
+
+#if LWIP_TCP_TIMER_WHEEL
+  /* Only pcbs with something to do are on the fast list (the ones that still
+     have something to do afterwards add themselves again) */
+  tcp_timer_fast_run = tcp_timer_fast_pcbs;
+  tcp_timer_fast_pcbs = NULL;
+  if (tcp_timer_fast_run != NULL) {
+    tcp_timer_fast_run->fast_pprev = &tcp_timer_fast_run;
+  }
+  while ((pcb = tcp_timer_fast_run) != NULL) {
+    tcp_timer_fast_unlink(pcb);
+    if ((pcb->state != CLOSED) && (pcb->state != LISTEN) && (pcb->state != TIME_WAIT)) {
+      tcp_fasttmr_pcb(pcb);
+      /* If there is data which was previously "refused" by upper layer */
+      if (pcb->refused_data != NULL) {
+        tcp_process_refused_data(pcb);
+      }
+    }
+  }
+#else /* LWIP_TCP_TIMER_WHEEL */
 tcp_fasttmr_start:
   pcb = tcp_active_pcbs;
 
@@ -1493,19 +2002,7 @@ tcp_fasttmr_start:
     if (pcb->last_timer != tcp_timer_ctr) {
       struct tcp_pcb *next;
       pcb->last_timer = tcp_timer_ctr;
-      /* send delayed ACKs */
-      if (pcb->flags & TF_ACK_DELAY) {
-        LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: delayed ACK\n"));
-        tcp_ack_now(pcb);
-        tcp_output(pcb);
-        tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
-      }
-      /* send pending FIN */
-      if (pcb->flags & TF_CLOSEPEND) {
-        LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: pending FIN\n"));
-        tcp_clear_flags(pcb, TF_CLOSEPEND);
-        tcp_close_shutdown_fin(pcb);
-      }
+      tcp_fasttmr_pcb(pcb);
 
       next = pcb->next;
 
@@ -1523,6 +2020,7 @@ tcp_fasttmr_start:
       pcb = pcb->next;
     }
   }
+#endif /* LWIP_TCP_TIMER_WHEEL */
 }
 
 /** Call tcp_output for all active pcbs that have TF_NAGLEMEMERR set */
@@ -1560,6 +2058,7 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
 #if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
     pbuf_split_64k(refused_data, &rest);
     pcb->refused_data = rest;
+    TCP_TIMER_FAST(pcb);
 #else /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
     pcb->refused_data = NULL;
 #endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
@@ -1597,6 +2096,7 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
       }
 #endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       pcb->refused_data = refused_data;
+      TCP_TIMER_FAST(pcb);
       return ERR_INPROGRESS;
     }
   }
@@ -1917,6 +2417,7 @@ tcp_alloc(u8_t prio)
     connection is established. To avoid these complications, we set ssthresh to the
     largest effective cwnd (amount of in-flight data) that the sender can have. */
     pcb->ssthresh = TCP_SND_BUF;
+    tcp_set_congestion_ops(pcb, &TCP_CC_DEFAULT);
 
 #if LWIP_CALLBACK_API
     pcb->recv = tcp_recv_null;
@@ -1929,6 +2430,11 @@ tcp_alloc(u8_t prio)
     pcb->keep_intvl = TCP_KEEPINTVL_DEFAULT;
     pcb->keep_cnt   = TCP_KEEPCNT_DEFAULT;
 #endif /* LWIP_TCP_KEEPALIVE */
+
+#if LWIP_TCP_ACK_POLICY
+    pcb->ack_every = TCP_ACK_EVERY;
+    pcb->ack_quick = TCP_QUICKACK_SEGS;
+#endif /* LWIP_TCP_ACK_POLICY */
     pcb_tci_init(pcb);
   }
   return pcb;
@@ -2043,6 +2549,27 @@ tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent)
   if (pcb != NULL) {
     LWIP_ASSERT("invalid socket state for sent callback", pcb->state != LISTEN);
     pcb->sent = sent;
+    pcb->sent_ext = NULL;
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Like @ref tcp_sent, but the callback gets all bytes acknowledged by one
+ * ACK in one call instead of in pieces of at most 0xffff bytes.
+ * Replaces a callback set via @ref tcp_sent (and vice versa).
+ *
+ * @param pcb tcp_pcb to set the sent callback
+ * @param sent callback function to call for this pcb when data is successfully sent
+ */
+void
+tcp_sent_ext(struct tcp_pcb *pcb, tcp_sent_ext_fn sent)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  if (pcb != NULL) {
+    LWIP_ASSERT("invalid socket state for sent callback", pcb->state != LISTEN);
+    pcb->sent = NULL;
+    pcb->sent_ext = sent;
   }
 }
 
@@ -2124,7 +2651,14 @@ tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
 #else /* LWIP_CALLBACK_API */
   LWIP_UNUSED_ARG(poll);
 #endif /* LWIP_CALLBACK_API */
+#if LWIP_TCP_TIMER_WHEEL
+  if (pcb->tmr_pprev != NULL) {
+    /* the ticks passed so far still count with the old interval */
+    tcp_timer_poll_sync(pcb);
+  }
+#endif /* LWIP_TCP_TIMER_WHEEL */
   pcb->pollinterval = interval;
+  tcp_timer_update(pcb);
 }
 
 /**
@@ -2211,11 +2745,221 @@ tcp_pcb_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
 
   pcb->state = CLOSED;
   /* reset the local port to prevent the pcb from being 'bound' */
+  if (pcb->local_port != 0) {
+    TCP_PORT_RELEASE(pcb);
+  }
   pcb->local_port = 0;
 
   LWIP_ASSERT("tcp_pcb_remove: tcp_pcbs_sane()", tcp_pcbs_sane());
 }
 
+#if LWIP_TCP_PCB_HASH
+/** Fold an IP address into 32 bits for hashing */
+static u32_t
+tcp_pcb_hash_ip(const ip_addr_t *ipaddr)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(ipaddr)) {
+    const ip6_addr_t *ip6addr = ip_2_ip6(ipaddr);
+    return ip6addr->addr[0] ^ ip6addr->addr[1] ^ ip6addr->addr[2] ^ ip6addr->addr[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  return ip4_addr_get_u32(ip_2_ip4(ipaddr));
+#else /* LWIP_IPV4 */
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+/** Calculate the bucket index of a connection in tcp_pcb_hash.
+ * The local IP address is not hashed since it is mostly the same
+ * for all connections. */
+static u16_t
+tcp_pcb_hash_idx(const ip_addr_t *remote_ip, u16_t local_port, u16_t remote_port)
+{
+  u32_t h = tcp_pcb_hash_ip(remote_ip) ^ (((u32_t)remote_port << 16) | local_port);
+  /* multiplicative (Fibonacci) hashing, the upper bits are the best mixed */
+  h *= 0x9E3779B1UL;
+  return (u16_t)((h >> 16) & (TCP_PCB_HASH_SIZE - 1));
+}
+
+/**
+ * Add a PCB to the hash index belonging to a PCB list.
+ * Called from TCP_REG after the PCB has been added to the list.
+ *
+ * @param pcbs the PCB list the PCB has been added to
+ * @param pcb the tcp_pcb to add
+ */
+void
+tcp_pcb_hash_insert(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **bucket = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(lpcb->local_port)];
+    lpcb->hash_next = *bucket;
+    *bucket = lpcb;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    struct tcp_pcb **bucket = &tcp_pcb_hash[tcp_pcb_hash_idx(&pcb->remote_ip, pcb->local_port, pcb->remote_port)];
+    pcb->hash_next = *bucket;
+    *bucket = pcb;
+  }
+}
+
+/**
+ * Remove a PCB from the hash index belonging to a PCB list.
+ * Called from TCP_RMV after the PCB has been removed from the list.
+ *
+ * @param pcbs the PCB list the PCB has been removed from
+ * @param pcb the tcp_pcb to remove
+ */
+void
+tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **prev = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(lpcb->local_port)];
+    for (; *prev != NULL; prev = &(*prev)->hash_next) {
+      if (*prev == lpcb) {
+        *prev = lpcb->hash_next;
+        break;
+      }
+    }
+    lpcb->hash_next = NULL;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    struct tcp_pcb **prev = &tcp_pcb_hash[tcp_pcb_hash_idx(&pcb->remote_ip, pcb->local_port, pcb->remote_port)];
+    for (; *prev != NULL; prev = &(*prev)->hash_next) {
+      if (*prev == pcb) {
+        *prev = pcb->hash_next;
+        break;
+      }
+    }
+    pcb->hash_next = NULL;
+  }
+}
+
+/**
+ * Find the active or TIME-WAIT PCB of a connection. Active PCBs are
+ * preferred over TIME-WAIT PCBs, like in the list search of tcp_input().
+ * A matching active PCB is moved to the front of its bucket so that
+ * subsequent lookups will be faster.
+ *
+ * @param local_ip local IP address of the connection
+ * @param local_port local port of the connection
+ * @param remote_ip remote IP address of the connection
+ * @param remote_port remote port of the connection
+ * @param netif_idx index of the netif the segment was received on
+ * @return the matching tcp_pcb or NULL if there is none
+ */
+struct tcp_pcb *
+tcp_pcb_hash_lookup(const ip_addr_t *local_ip, u16_t local_port,
+                    const ip_addr_t *remote_ip, u16_t remote_port,
+                    u8_t netif_idx)
+{
+  struct tcp_pcb **bucket = &tcp_pcb_hash[tcp_pcb_hash_idx(remote_ip, local_port, remote_port)];
+  struct tcp_pcb *pcb, *prev = NULL;
+  struct tcp_pcb *tw_pcb = NULL;
+
+  for (pcb = *bucket; pcb != NULL; prev = pcb, pcb = pcb->hash_next) {
+    /* check if PCB is bound to specific netif */
+    if ((pcb->netif_idx != NETIF_NO_INDEX) && (pcb->netif_idx != netif_idx)) {
+      continue;
+    }
+    if (pcb->remote_port == remote_port &&
+        pcb->local_port == local_port &&
+        ip_addr_eq(&pcb->remote_ip, remote_ip) &&
+        ip_addr_eq(&pcb->local_ip, local_ip)) {
+      if (pcb->state == TIME_WAIT) {
+        /* keep looking for an active connection */
+        if (tw_pcb == NULL) {
+          tw_pcb = pcb;
+        }
+        continue;
+      }
+      if (prev != NULL) {
+        prev->hash_next = pcb->hash_next;
+        pcb->hash_next = *bucket;
+        *bucket = pcb;
+      } else {
+        TCP_STATS_INC(tcp.cachehit);
+      }
+      return pcb;
+    }
+  }
+  return tw_pcb;
+}
+
+/**
+ * Find the listening PCB for a connection request. Like the list search of
+ * tcp_input(), a PCB bound to the specific local IP address is preferred
+ * over a PCB bound to IP_ANY if SO_REUSE is enabled.
+ * A matching PCB is moved to the front of its bucket.
+ *
+ * @param local_ip destination IP address of the connection request
+ * @param local_port destination port of the connection request
+ * @param netif_idx index of the netif the segment was received on
+ * @return the matching tcp_pcb_listen or NULL if there is none
+ */
+struct tcp_pcb_listen *
+tcp_listen_hash_lookup(const ip_addr_t *local_ip, u16_t local_port, u8_t netif_idx)
+{
+  struct tcp_pcb_listen **bucket = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(local_port)];
+  struct tcp_pcb_listen *lpcb, *prev = NULL;
+#if SO_REUSE
+  struct tcp_pcb_listen *lpcb_prev = NULL;
+  struct tcp_pcb_listen *lpcb_any = NULL;
+#endif /* SO_REUSE */
+
+  for (lpcb = *bucket; lpcb != NULL; prev = lpcb, lpcb = lpcb->hash_next) {
+    /* check if PCB is bound to specific netif */
+    if ((lpcb->netif_idx != NETIF_NO_INDEX) && (lpcb->netif_idx != netif_idx)) {
+      continue;
+    }
+    if (lpcb->local_port == local_port) {
+      if (IP_IS_ANY_TYPE_VAL(lpcb->local_ip)) {
+        /* found an ANY TYPE (IPv4/IPv6) match */
+#if SO_REUSE
+        lpcb_any = lpcb;
+        lpcb_prev = prev;
+#else /* SO_REUSE */
+        break;
+#endif /* SO_REUSE */
+      } else if (IP_ADDR_PCB_VERSION_MATCH_EXACT(lpcb, local_ip)) {
+        if (ip_addr_eq(&lpcb->local_ip, local_ip)) {
+          /* found an exact match */
+          break;
+        } else if (ip_addr_isany(&lpcb->local_ip)) {
+          /* found an ANY-match */
+#if SO_REUSE
+          lpcb_any = lpcb;
+          lpcb_prev = prev;
+#else /* SO_REUSE */
+          break;
+#endif /* SO_REUSE */
+        }
+      }
+    }
+  }
+#if SO_REUSE
+  /* first try specific local IP */
+  if (lpcb == NULL) {
+    /* only pass to ANY if no specific local IP has been found */
+    lpcb = lpcb_any;
+    prev = lpcb_prev;
+  }
+#endif /* SO_REUSE */
+  if (lpcb != NULL) {
+    if (prev != NULL) {
+      prev->hash_next = lpcb->hash_next;
+      lpcb->hash_next = *bucket;
+      *bucket = lpcb;
+    } else {
+      TCP_STATS_INC(tcp.cachehit);
+    }
+  }
+  return lpcb;
+}
+#endif /* LWIP_TCP_PCB_HASH */
+
 /**
  * Calculates a new initial sequence number for new connections.
  *
@@ -2238,6 +2982,67 @@ tcp_next_iss(struct tcp_pcb *pcb)
 #endif /* LWIP_HOOK_TCP_ISN */
 }
 
+#if LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES
+#define TCP_SIP_ROTL(x, b) (u32_t)(((x) << (b)) | ((x) >> (32 - (b))))
+
+#define TCP_SIPROUND do { \
+  v0 += v1; v1 = TCP_SIP_ROTL(v1, 5); v1 ^= v0; v0 = TCP_SIP_ROTL(v0, 16); \
+  v2 += v3; v3 = TCP_SIP_ROTL(v3, 8); v3 ^= v2; \
+  v0 += v3; v3 = TCP_SIP_ROTL(v3, 7); v3 ^= v0; \
+  v2 += v1; v1 = TCP_SIP_ROTL(v1, 13); v1 ^= v2; v2 = TCP_SIP_ROTL(v2, 16); \
+} while (0)
+
+/**
+ * HalfSipHash-2-4 with 64 bit output of 'len' bytes at 'data', used to derive
+ * fast open and SYN cookies.
+ *
+ * @param key the 64 bit secret key
+ * @param data the data to hash
+ * @param len length of the data
+ * @param out receives the 8 byte hash
+ */
+void
+tcp_halfsiphash(const u32_t *key, const u8_t *data, u8_t len, u8_t *out)
+{
+  u32_t v0, v1, v2, v3, m, b;
+  u8_t i, left;
+
+  v0 = key[0];
+  v1 = key[1] ^ 0xee;
+  v2 = key[0] ^ 0x6c796765UL;
+  v3 = key[1] ^ 0x74656462UL;
+
+  for (left = len; left >= 4; left = (u8_t)(left - 4), data += 4) {
+    m = (u32_t)data[0] | ((u32_t)data[1] << 8) | ((u32_t)data[2] << 16) | ((u32_t)data[3] << 24);
+    v3 ^= m;
+    TCP_SIPROUND;
+    TCP_SIPROUND;
+    v0 ^= m;
+  }
+  b = (u32_t)len << 24;
+  for (i = 0; i < left; i++) {
+    b |= (u32_t)data[i] << (8 * i);
+  }
+  v3 ^= b;
+  TCP_SIPROUND;
+  TCP_SIPROUND;
+  v0 ^= b;
+
+  v2 ^= 0xee;
+  for (i = 0; i < 4; i++) {
+    TCP_SIPROUND;
+  }
+  b = v1 ^ v3;
+  MEMCPY(out, &b, 4);
+  v1 ^= 0xdd;
+  for (i = 0; i < 4; i++) {
+    TCP_SIPROUND;
+  }
+  b = v1 ^ v3;
+  MEMCPY(out + 4, &b, 4);
+}
+#endif /* LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES */
+
 #if TCP_CALCULATE_EFF_SEND_MSS
 /**
  * Calculates the effective send mss that can be used for a specific IP address
@@ -2398,6 +3203,11 @@ tcp_free_ooseq(struct tcp_pcb *pcb)
   if (pcb->ooseq) {
     tcp_segs_free(pcb->ooseq);
     pcb->ooseq = NULL;
+#if TCP_OOSEQ_RBTREE
+    pcb->ooseq_root = pcb->ooseq_tail = NULL;
+    pcb->ooseq_bytes = 0;
+    pcb->ooseq_pbufs = 0;
+#endif /* TCP_OOSEQ_RBTREE */
 #if LWIP_TCP_SACK_OUT
     memset(pcb->rcv_sacks, 0, sizeof(pcb->rcv_sacks));
 #endif /* LWIP_TCP_SACK_OUT */
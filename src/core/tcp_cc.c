@@ -0,0 +1,303 @@
+/**
+ * @file
+ * Transmission Control Protocol, congestion control modules
+ *
+ * The core calls the hooks of the module selected for a pcb
+ * (see @ref tcp_set_congestion_ops) to adjust cwnd and ssthresh:
+ * - tcp_cc_reno: RFC 5681 slow start and congestion avoidance (default)
+ * - tcp_cc_cubic: RFC 8312 CUBIC (LWIP_TCP_CUBIC)
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/def.h"
+#if LWIP_TCP_CUBIC
+#include "lwip/sys.h"
+#endif
+
+#include <string.h>
+
+/** All modules that can be selected by name */
+static const struct tcp_cc_ops *const tcp_cc_modules[] = {
+  &tcp_cc_reno,
+#if LWIP_TCP_CUBIC
+  &tcp_cc_cubic,
+#endif /* LWIP_TCP_CUBIC */
+};
+
+/**
+ * @ingroup tcp_raw
+ * Select the congestion control module of a pcb.
+ * The module's state is reset, cwnd and ssthresh are kept.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param ops the module to use (e.g. &tcp_cc_reno)
+ */
+void
+tcp_set_congestion_ops(struct tcp_pcb *pcb, const struct tcp_cc_ops *ops)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_set_congestion_ops: invalid pcb", pcb != NULL, return);
+  LWIP_ERROR("tcp_set_congestion_ops: invalid ops", (ops != NULL) && (ops->on_ack != NULL) &&
+             (ops->on_loss != NULL) && (ops->on_rto != NULL), return);
+
+  pcb->cc = ops;
+  pcb->bytes_acked = 0;
+  if (ops->init != NULL) {
+    ops->init(pcb);
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Select the congestion control module of a pcb by name ("reno", "cubic").
+ *
+ * @param pcb the tcp_pcb to change
+ * @param name name of the module
+ * @return ERR_OK or ERR_ARG if no module of that name is compiled in
+ */
+err_t
+tcp_set_congestion(struct tcp_pcb *pcb, const char *name)
+{
+  size_t i;
+
+  LWIP_ERROR("tcp_set_congestion: invalid name", name != NULL, return ERR_ARG);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(tcp_cc_modules); i++) {
+    if (!strcmp(tcp_cc_modules[i]->name, name)) {
+      tcp_set_congestion_ops(pcb, tcp_cc_modules[i]);
+      return ERR_OK;
+    }
+  }
+  return ERR_ARG;
+}
+
+/* RFC 3465, section 2.2 Slow Start */
+static void
+tcp_cc_slow_start(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  tcpwnd_size_t increase;
+  /* limit to 1 SMSS segment during period following RTO */
+  u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
+
+  increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
+  TCP_WND_INC(pcb->cwnd, increase);
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+}
+
+static void
+tcp_cc_reno_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcp_cc_slow_start(pcb, acked);
+  } else {
+    /* RFC 3465, section 2.1 Congestion Avoidance */
+    TCP_WND_INC(pcb->bytes_acked, acked);
+    if (pcb->bytes_acked >= pcb->cwnd) {
+      pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
+      TCP_WND_INC(pcb->cwnd, pcb->mss);
+    }
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+  }
+}
+
+static void
+tcp_cc_reno_on_loss(struct tcp_pcb *pcb)
+{
+  /* Set ssthresh to half of the minimum of the current
+   * cwnd and the advertised window */
+  pcb->ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
+
+  /* The minimum value for ssthresh should be 2 MSS */
+  if (pcb->ssthresh < (2U * pcb->mss)) {
+    LWIP_DEBUGF(TCP_FR_DEBUG,
+                ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
+                 " should be min 2 mss %"U16_F"...\n",
+                 pcb->ssthresh, (u16_t)(2 * pcb->mss)));
+    pcb->ssthresh = 2 * pcb->mss;
+  }
+}
+
+/** RFC 5681 (TCP Reno), the default */
+const struct tcp_cc_ops tcp_cc_reno = {
+  "reno",
+  NULL,
+  tcp_cc_reno_on_ack,
+  tcp_cc_reno_on_loss,
+  tcp_cc_reno_on_loss,
+  NULL
+};
+
+#if LWIP_TCP_CUBIC
+/* Multiplicative decrease factor beta_cubic = 0.7, scaled by 1024 */
+#define TCP_CUBIC_BETA           717
+/* Additive increase of the TCP-friendly estimate per RTT:
+   3 * (1 - beta) / (1 + beta) = 0.53 segments, scaled by 1024 */
+#define TCP_CUBIC_ALPHA          541
+/* Limit for |t - K| (ms) to keep the cube in 64 bit */
+#define TCP_CUBIC_MAX_DELTA_T    100000UL
+
+/** Integer cube root, rounded down, for a < 2^63 */
+static u32_t
+tcp_cubic_cbrt(u64_t a)
+{
+  u32_t x = 0, y;
+  int s;
+
+  for (s = 20; s >= 0; s--) {
+    y = x | ((u32_t)1 << s);
+    if ((u64_t)y * y * y <= a) {
+      x = y;
+    }
+  }
+  return x;
+}
+
+static void
+tcp_cc_cubic_init(struct tcp_pcb *pcb)
+{
+  memset(&pcb->cubic, 0, sizeof(pcb->cubic));
+}
+
+static void
+tcp_cc_cubic_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  struct tcp_cubic *c = &pcb->cubic;
+  u32_t now, t, delta_t, target, cnt, cnt_est;
+  u64_t delta;
+
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcp_cc_slow_start(pcb, acked);
+    return;
+  }
+
+  now = sys_now();
+  if (c->epoch_start == 0) {
+    /* start of a congestion avoidance epoch */
+    c->epoch_start = (now != 0) ? now : 1;
+    c->w_est = pcb->cwnd;
+    if (pcb->cwnd < c->w_max) {
+      /* K = cbrt((w_max - cwnd) / C) with C = 0.4 segments/s^3, in ms */
+      c->k = tcp_cubic_cbrt((u64_t)(c->w_max - pcb->cwnd) * 2500000000UL / pcb->mss);
+      c->origin = c->w_max;
+    } else {
+      c->k = 0;
+      c->origin = pcb->cwnd;
+    }
+  }
+
+  /* target window one RTT ahead: W(t) = C * (t - K)^3 + origin */
+  t = (u32_t)(now - c->epoch_start) + (u32_t)((pcb->sa >> 3) * TCP_SLOW_INTERVAL);
+  delta_t = (t > c->k) ? (t - c->k) : (c->k - t);
+  if (delta_t > TCP_CUBIC_MAX_DELTA_T) {
+    delta_t = TCP_CUBIC_MAX_DELTA_T;
+  }
+  delta = ((u64_t)delta_t * delta_t * delta_t / 1000) * 4 * pcb->mss / 10000000UL;
+  if (t > c->k) {
+    target = (delta > (u64_t)(0xffffffffUL - c->origin)) ? 0xffffffffUL : (u32_t)(c->origin + delta);
+  } else {
+    target = (delta >= c->origin) ? pcb->mss : (u32_t)(c->origin - delta);
+  }
+  /* don't grow faster than 1.5 * cwnd per RTT */
+  target = LWIP_MIN(target, (u32_t)pcb->cwnd + pcb->cwnd / 2);
+
+  /* bytes to be acked for each MSS of cwnd growth */
+  if (target > pcb->cwnd) {
+    cnt = (u32_t)((u64_t)pcb->cwnd * pcb->mss / (target - pcb->cwnd));
+  } else {
+    cnt = 100 * pcb->cwnd;
+  }
+
+  /* TCP-friendly region: grow at least as fast as standard TCP would */
+  c->w_est += (u32_t)((u64_t)acked * pcb->mss * TCP_CUBIC_ALPHA / 1024 / pcb->cwnd);
+  if (c->w_est > pcb->cwnd) {
+    cnt_est = (u32_t)((u64_t)pcb->cwnd * pcb->mss / (c->w_est - pcb->cwnd));
+    cnt = LWIP_MIN(cnt, cnt_est);
+  }
+  cnt = LWIP_MAX(cnt, 1);
+
+  TCP_WND_INC(pcb->bytes_acked, acked);
+  if (pcb->bytes_acked >= cnt) {
+    u32_t segs = pcb->bytes_acked / cnt;
+    pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - segs * cnt);
+    TCP_WND_INC(pcb->cwnd, (tcpwnd_size_t)LWIP_MIN(segs * pcb->mss, 0xffffU));
+  }
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: cubic cwnd %"TCPWNDSIZE_F" target %"U32_F"\n",
+                               pcb->cwnd, target));
+}
+
+static void
+tcp_cc_cubic_on_loss(struct tcp_pcb *pcb)
+{
+  struct tcp_cubic *c = &pcb->cubic;
+
+  c->epoch_start = 0;
+  /* fast convergence: release bandwidth if the plateau keeps shrinking */
+  if (pcb->cwnd < c->w_last_max) {
+    c->w_max = (u32_t)((u64_t)pcb->cwnd * (1024 + TCP_CUBIC_BETA) / 2048);
+  } else {
+    c->w_max = pcb->cwnd;
+  }
+  c->w_last_max = pcb->cwnd;
+
+  pcb->ssthresh = (tcpwnd_size_t)((u64_t)pcb->cwnd * TCP_CUBIC_BETA / 1024);
+  if (pcb->ssthresh < (2U * pcb->mss)) {
+    pcb->ssthresh = 2 * pcb->mss;
+  }
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_cc_cubic_on_loss: w_max %"U32_F" ssthresh %"TCPWNDSIZE_F"\n",
+                               c->w_max, pcb->ssthresh));
+}
+
+static void
+tcp_cc_cubic_on_idle(struct tcp_pcb *pcb)
+{
+  /* don't count the idle time as growth time */
+  pcb->cubic.epoch_start = 0;
+}
+
+/** RFC 8312 (CUBIC) */
+const struct tcp_cc_ops tcp_cc_cubic = {
+  "cubic",
+  tcp_cc_cubic_init,
+  tcp_cc_cubic_on_ack,
+  tcp_cc_cubic_on_loss,
+  tcp_cc_cubic_on_loss,
+  tcp_cc_cubic_on_idle
+};
+#endif /* LWIP_TCP_CUBIC */
+
+#endif /* LWIP_TCP */
@@ -0,0 +1,235 @@
+/**
+ * @file
+ * Transmission Control Protocol, Fast Open (RFC 7413) cookies
+ *
+ * Server side: cookies are a keyed hash (HalfSipHash-2-4) of the client
+ * address, so they can be validated without keeping state per client.
+ * Client side: a small cache of the cookies servers handed out, consulted by
+ * tcp_connect() to decide whether data can be sent with the SYN.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP && LWIP_TCP_FASTOPEN /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+#ifndef LWIP_RAND
+#error "If you want to use LWIP_TCP_FASTOPEN, you have to define LWIP_RAND=(random function) in your lwipopts.h"
+#endif
+
+/** A cookie handed out by a server */
+struct tcp_fastopen_cache_entry {
+  ip_addr_t addr;
+  /** 0: unused */
+  u8_t len;
+  u8_t cookie[TCP_FASTOPEN_COOKIE_MAX];
+};
+
+static struct tcp_fastopen_cache_entry tcp_fastopen_cache[TCP_FASTOPEN_CACHE_SIZE];
+/** entry replaced next if a server is not in the cache yet */
+static u8_t tcp_fastopen_cache_next;
+
+/** Secret key of the server cookies */
+static u32_t tcp_fastopen_key[2];
+static u8_t tcp_fastopen_key_set;
+
+/**
+ * @ingroup tcp_raw
+ * Set the secret key server cookies are derived from (by default, it is
+ * initialized from LWIP_RAND() when the first cookie is needed). Cookies
+ * handed out with the old key are not accepted any more.
+ *
+ * @param key0 first half of the 64 bit key
+ * @param key1 second half of the 64 bit key
+ */
+void
+tcp_fastopen_set_key(u32_t key0, u32_t key1)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  tcp_fastopen_key[0] = key0;
+  tcp_fastopen_key[1] = key1;
+  tcp_fastopen_key_set = 1;
+}
+
+/**
+ * @ingroup tcp_raw
+ * Enable or disable TCP Fast Open (RFC 7413) for a pcb.
+ *
+ * On a listening pcb (or a pcb that is passed to tcp_listen() later), clients
+ * asking for a cookie get one with the SYN|ACK. Data in a SYN with a valid
+ * cookie is acknowledged at once: the accept callback is called and the data
+ * passed to the recv callback before the handshake is complete.
+ *
+ * On a pcb passed to tcp_connect() later, the SYN asks for a cookie. If a
+ * cookie of the server is known already, tcp_connect() does not send the SYN
+ * but holds it back to carry the data of the first tcp_write(): it is sent by
+ * the next tcp_output() (or by the fast timer if nothing is written).
+ *
+ * @param pcb the tcp_pcb to change
+ * @param enable 1 to enable fast open, 0 to disable it
+ */
+void
+tcp_fastopen(struct tcp_pcb *pcb, u8_t enable)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_fastopen: invalid pcb", pcb != NULL, return);
+
+  if (enable) {
+    pcb->fastopen |= TCP_FASTOPEN_ENABLED;
+  } else {
+    pcb->fastopen = (u8_t)(pcb->fastopen & ~TCP_FASTOPEN_ENABLED);
+  }
+}
+
+/**
+ * Compute the cookie for a client.
+ *
+ * @param addr the address of the client
+ * @param cookie receives TCP_FASTOPEN_COOKIE_LEN bytes
+ */
+void
+tcp_fastopen_cookie(const ip_addr_t *addr, u8_t *cookie)
+{
+  if (!tcp_fastopen_key_set) {
+    tcp_fastopen_key[0] = (u32_t)LWIP_RAND();
+    tcp_fastopen_key[1] = (u32_t)LWIP_RAND();
+    tcp_fastopen_key_set = 1;
+  }
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    tcp_halfsiphash(tcp_fastopen_key, (const u8_t *)ip_2_ip6(addr)->addr, 16, cookie);
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    tcp_halfsiphash(tcp_fastopen_key, (const u8_t *)&ip_2_ip4(addr)->addr, 4, cookie);
+#endif /* LWIP_IPV4 */
+  }
+}
+
+/**
+ * Check the cookie a client sent with its SYN.
+ *
+ * @param addr the address of the client
+ * @param cookie the cookie received
+ * @param len length of the cookie
+ * @return 1 if the cookie is valid, 0 if not
+ */
+u8_t
+tcp_fastopen_cookie_valid(const ip_addr_t *addr, const u8_t *cookie, u8_t len)
+{
+  u8_t expected[TCP_FASTOPEN_COOKIE_LEN];
+  u8_t i, diff = 0;
+
+  if (len != TCP_FASTOPEN_COOKIE_LEN) {
+    return 0;
+  }
+  tcp_fastopen_cookie(addr, expected);
+  for (i = 0; i < TCP_FASTOPEN_COOKIE_LEN; i++) {
+    diff |= (u8_t)(cookie[i] ^ expected[i]);
+  }
+  return (u8_t)(diff == 0);
+}
+
+static struct tcp_fastopen_cache_entry *
+tcp_fastopen_cache_find(const ip_addr_t *addr)
+{
+  u8_t i;
+
+  for (i = 0; i < TCP_FASTOPEN_CACHE_SIZE; i++) {
+    if ((tcp_fastopen_cache[i].len != 0) && ip_addr_eq(&tcp_fastopen_cache[i].addr, addr)) {
+      return &tcp_fastopen_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Look up the cookie of a server.
+ *
+ * @param addr the address of the server
+ * @param cookie receives the cookie (up to TCP_FASTOPEN_COOKIE_MAX bytes),
+ *        may be NULL
+ * @return the length of the cookie, 0 if none is known
+ */
+u8_t
+tcp_fastopen_cache_get(const ip_addr_t *addr, u8_t *cookie)
+{
+  struct tcp_fastopen_cache_entry *entry = tcp_fastopen_cache_find(addr);
+
+  if (entry == NULL) {
+    return 0;
+  }
+  if (cookie != NULL) {
+    MEMCPY(cookie, entry->cookie, entry->len);
+  }
+  return entry->len;
+}
+
+/**
+ * Remember the cookie a server handed out, replacing the oldest entry if the
+ * cache is full. Cookies that would not fit into a SYN are ignored.
+ *
+ * @param addr the address of the server
+ * @param cookie the cookie
+ * @param len length of the cookie, 0 to forget the cookie of the server
+ */
+void
+tcp_fastopen_cache_set(const ip_addr_t *addr, const u8_t *cookie, u8_t len)
+{
+  struct tcp_fastopen_cache_entry *entry = tcp_fastopen_cache_find(addr);
+
+  if ((len > TCP_FASTOPEN_COOKIE_MAX) || (TCP_FASTOPEN_OPT_LEN(len) > TCP_FASTOPEN_OPT_SPACE)) {
+    len = 0;
+  }
+  if (entry == NULL) {
+    if (len == 0) {
+      return;
+    }
+    entry = &tcp_fastopen_cache[tcp_fastopen_cache_next];
+    tcp_fastopen_cache_next = (u8_t)((tcp_fastopen_cache_next + 1) % TCP_FASTOPEN_CACHE_SIZE);
+    ip_addr_copy(entry->addr, *addr);
+  }
+  entry->len = len;
+  if (len != 0) {
+    MEMCPY(entry->cookie, cookie, len);
+  }
+}
+
+#endif /* LWIP_TCP && LWIP_TCP_FASTOPEN */
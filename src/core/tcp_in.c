@@ -58,6 +58,9 @@
 #if LWIP_ND6_TCP_REACHABILITY_HINTS
 #include "lwip/nd6.h"
 #endif /* LWIP_ND6_TCP_REACHABILITY_HINTS */
+#if LWIP_TCP_PACING
+#include "lwip/sys.h"
+#endif /* LWIP_TCP_PACING */
 
 #include <string.h>
 
@@ -84,6 +87,30 @@ static u8_t flags;
 
 static u8_t recv_flags;
 static struct pbuf *recv_data;
+#if LWIP_TCP_GRO
+/* number of segments tcp_gro_input() merged into the current one */
+static u16_t recv_segs;
+#endif /* LWIP_TCP_GRO */
+
+#if LWIP_TCP_SACK_IN
+/* SACK blocks of the current segment, set by tcp_parseopt() */
+static struct tcp_sack_range tcp_in_sacks[LWIP_TCP_SACK_IN_MAX_BLOCKS];
+static u8_t tcp_in_num_sacks;
+#endif /* LWIP_TCP_SACK_IN */
+
+#if LWIP_TCP_FASTOPEN
+/* Fast open option of the current segment, set by tcp_parseopt(): length of
+   the cookie (0 for a cookie request) or TCP_FASTOPEN_NO_OPT */
+#define TCP_FASTOPEN_NO_OPT 0xFF
+static u8_t tcp_in_fastopen_len;
+static u8_t tcp_in_fastopen_cookie[TCP_FASTOPEN_COOKIE_MAX];
+#endif /* LWIP_TCP_FASTOPEN */
+
+#if LWIP_TCP_SYN_COOKIES
+/* Scratch pcb the SYN|ACK of a connection request is sent from when no pcb
+   is allocated for it */
+static struct tcp_pcb tcp_syncookie_pcb;
+#endif /* LWIP_TCP_SYN_COOKIES */
 
 struct tcp_pcb *tcp_input_pcb;
 
@@ -93,7 +120,20 @@ static void tcp_receive(struct tcp_pcb *pcb);
 static void tcp_parseopt(struct tcp_pcb *pcb);
 
 static void tcp_listen_input(struct tcp_pcb_listen *pcb);
+static void tcp_listen_init_pcb(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb, u32_t irs);
+static u8_t tcp_listen_syn_options(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb);
+#if LWIP_TCP_SYN_COOKIES
+static u8_t tcp_listen_syncookie(struct tcp_pcb_listen *pcb);
+static err_t tcp_listen_syncookie_ack(struct tcp_pcb_listen *pcb, struct tcp_pcb **npcb);
+#endif /* LWIP_TCP_SYN_COOKIES */
+#if LWIP_TCP_FASTOPEN
+static err_t tcp_listen_fastopen(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb);
+static err_t tcp_fastopen_synack(struct tcp_pcb *pcb, struct tcp_seg *rseg);
+#endif /* LWIP_TCP_FASTOPEN */
 static void tcp_timewait_input(struct tcp_pcb *pcb);
+#if LWIP_TCP_ACK_POLICY
+static void tcp_ack_policy(struct tcp_pcb *pcb, u32_t len);
+#endif /* LWIP_TCP_ACK_POLICY */
 
 static int tcp_input_delayed_close(struct tcp_pcb *pcb);
 
@@ -104,6 +144,9 @@ static void tcp_remove_sacks_lt(struct tcp_pcb *pcb, u32_t seq);
 static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 #endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
 #endif /* LWIP_TCP_SACK_OUT */
+#if LWIP_TCP_SACK_IN
+static void tcp_sack_update_scoreboard(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK_IN */
 
 /**
  * The initial input processing of TCP. It verifies the TCP header, demultiplexes
@@ -117,19 +160,31 @@ static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
-  struct tcp_pcb *pcb, *prev;
+  struct tcp_pcb *pcb, *tw_pcb = NULL;
   struct tcp_pcb_listen *lpcb;
+#if !LWIP_TCP_PCB_HASH
+  struct tcp_pcb *prev;
 #if SO_REUSE
   struct tcp_pcb *lpcb_prev = NULL;
   struct tcp_pcb_listen *lpcb_any = NULL;
 #endif /* SO_REUSE */
+#endif /* !LWIP_TCP_PCB_HASH */
   u8_t hdrlen_bytes;
   err_t err;
+#if LWIP_TCP_GRO
+  u16_t gro_size;
+#endif /* LWIP_TCP_GRO */
 
   LWIP_UNUSED_ARG(inp);
   LWIP_ASSERT_CORE_LOCKED();
   LWIP_ASSERT("tcp_input: invalid pbuf", p != NULL);
 
+#if LWIP_TCP_GRO
+  /* set for segments held back by tcp_gro_input(), which verified the checksums */
+  gro_size = p->gso_size;
+  p->gso_size = 0;
+#endif /* LWIP_TCP_GRO */
+
   PERF_START;
 
   TCP_STATS_INC(tcp.recv);
@@ -157,6 +212,9 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
+#if LWIP_TCP_GRO
+  if (gro_size == 0)
+#endif /* LWIP_TCP_GRO */
   IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
     /* Verify TCP checksum. */
     u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
@@ -179,6 +237,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
     goto dropped;
   }
 
+#if LWIP_TCP_GRO
+  recv_segs = (gro_size == 0) ? 1 : (u16_t)((p->tot_len - hdrlen_bytes + gro_size - 1) / gro_size);
+#endif /* LWIP_TCP_GRO */
+
   /* Move the payload pointer in the pbuf so that it points to the
      TCP data instead of the TCP header. */
   tcphdr_optlen = (u16_t)(hdrlen_bytes - TCP_HLEN);
@@ -245,6 +307,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
   /* Demultiplex an incoming segment. First, we check if it is destined
      for an active connection. */
+#if LWIP_TCP_PCB_HASH
+  /* The hash lookup returns a TIME-WAIT PCB only if there is no active one */
+  pcb = tcp_pcb_hash_lookup(ip_current_dest_addr(), tcphdr->dest,
+                            ip_current_src_addr(), tcphdr->src,
+                            netif_get_index(ip_data.current_input_netif));
+  if ((pcb != NULL) && (pcb->state == TIME_WAIT)) {
+    tw_pcb = pcb;
+    pcb = NULL;
+  }
+#else /* LWIP_TCP_PCB_HASH */
   prev = NULL;
 
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
@@ -279,41 +351,51 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
     prev = pcb;
   }
+#endif /* LWIP_TCP_PCB_HASH */
 
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
-    for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
-      LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
+#if !LWIP_TCP_PCB_HASH
+    for (tw_pcb = tcp_tw_pcbs; tw_pcb != NULL; tw_pcb = tw_pcb->next) {
+      LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", tw_pcb->state == TIME_WAIT);
 
       /* check if PCB is bound to specific netif */
-      if ((pcb->netif_idx != NETIF_NO_INDEX) &&
-          (pcb->netif_idx != netif_get_index(ip_data.current_input_netif))) {
+      if ((tw_pcb->netif_idx != NETIF_NO_INDEX) &&
+          (tw_pcb->netif_idx != netif_get_index(ip_data.current_input_netif))) {
         continue;
       }
 
-      if (pcb->remote_port == tcphdr->src &&
-          pcb->local_port == tcphdr->dest &&
-          ip_addr_eq(&pcb->remote_ip, ip_current_src_addr()) &&
-          ip_addr_eq(&pcb->local_ip, ip_current_dest_addr())) {
-        /* We don't really care enough to move this PCB to the front
-           of the list since we are not very likely to receive that
-           many segments for connections in TIME-WAIT. */
-        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+      if (tw_pcb->remote_port == tcphdr->src &&
+          tw_pcb->local_port == tcphdr->dest &&
+          ip_addr_eq(&tw_pcb->remote_ip, ip_current_src_addr()) &&
+          ip_addr_eq(&tw_pcb->local_ip, ip_current_dest_addr())) {
+        break;
+      }
+    }
+#endif /* !LWIP_TCP_PCB_HASH */
+    if (tw_pcb != NULL) {
+      /* We don't really care enough to move this PCB to the front
+         of the list since we are not very likely to receive that
+         many segments for connections in TIME-WAIT. */
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
-        if (LWIP_HOOK_TCP_INPACKET_PCB(pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
-                                       tcphdr_opt2, p) == ERR_OK)
+      if (LWIP_HOOK_TCP_INPACKET_PCB(tw_pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
+                                     tcphdr_opt2, p) == ERR_OK)
 #endif
-        {
-          tcp_timewait_input(pcb);
-        }
-        pbuf_free(p);
-        return;
+      {
+        tcp_timewait_input(tw_pcb);
       }
+      pbuf_free(p);
+      return;
     }
 
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
+#if LWIP_TCP_PCB_HASH
+    lpcb = tcp_listen_hash_lookup(ip_current_dest_addr(), tcphdr->dest,
+                                  netif_get_index(ip_data.current_input_netif));
+#else /* LWIP_TCP_PCB_HASH */
     prev = NULL;
     for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
       /* check if PCB is bound to specific netif */
@@ -370,14 +452,39 @@ tcp_input(struct pbuf *p, struct netif *inp)
       } else {
         TCP_STATS_INC(tcp.cachehit);
       }
-
+    }
+#endif /* LWIP_TCP_PCB_HASH */
+#if LWIP_TCP_SYN_COOKIES
+    if ((lpcb != NULL) && lpcb->syncookies && ((flags & (TCP_SYN | TCP_RST | TCP_ACK)) == TCP_ACK)) {
+      /* maybe the final ACK of a handshake answered with a SYN cookie */
+      if (tcp_listen_syncookie_ack(lpcb, &pcb) != ERR_OK) {
+        pbuf_free(p);
+        return;
+      }
+      if (pcb != NULL) {
+        /* go on with the new pcb in SYN_RCVD */
+        lpcb = NULL;
+      }
+    }
+#endif /* LWIP_TCP_SYN_COOKIES */
+    if (lpcb != NULL) {
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
       if (LWIP_HOOK_TCP_INPACKET_PCB((struct tcp_pcb *)lpcb, tcphdr, tcphdr_optlen,
                                      tcphdr_opt1len, tcphdr_opt2, p) == ERR_OK)
 #endif
       {
+#if LWIP_TCP_FASTOPEN
+        /* data in a SYN may be passed on by tcp_listen_fastopen() */
+        inseg.next = NULL;
+        inseg.len = p->tot_len;
+        inseg.p = p;
+        inseg.tcphdr = tcphdr;
+#endif /* LWIP_TCP_FASTOPEN */
         tcp_listen_input(lpcb);
+#if LWIP_TCP_FASTOPEN
+        inseg.p = NULL;
+#endif /* LWIP_TCP_FASTOPEN */
       }
       pbuf_free(p);
       return;
@@ -452,6 +559,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
         /* If the application has registered a "sent" function to be
            called when new send buffer space is available, we call it
            now. */
+#if LWIP_CALLBACK_API
+        if ((recv_acked > 0) && (pcb->sent_ext != NULL)) {
+          /* the extended callback takes all acked bytes at once */
+          err = pcb->sent_ext(pcb->callback_arg, pcb, recv_acked);
+          if (err == ERR_ABRT) {
+            goto aborted;
+          }
+          recv_acked = 0;
+        }
+#endif /* LWIP_CALLBACK_API */
         if (recv_acked > 0) {
           u16_t acked16;
 #if LWIP_WND_SCALE
@@ -516,6 +633,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
             }
 #endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
             pcb->refused_data = recv_data;
+            TCP_TIMER_FAST(pcb);
             LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: keep incoming packet, because pcb is \"full\"\n"));
 #if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
             break;
@@ -632,9 +750,24 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
   struct tcp_pcb *npcb;
   u32_t iss;
   err_t rc;
+  u8_t fastopen_accept;
 
   if (flags & TCP_RST) {
     /* An incoming RST should be ignored. Return. */
+#if LWIP_TCP_SYN_COOKIES
+    /* (but it ends a connection request in the SYN queue) */
+    if (pcb->syncookies) {
+      struct tcp_syn_entry syn, *entry;
+      ip_addr_copy(syn.local_ip, *ip_current_dest_addr());
+      ip_addr_copy(syn.remote_ip, *ip_current_src_addr());
+      syn.local_port = pcb->local_port;
+      syn.remote_port = tcphdr->src;
+      entry = tcp_syn_queue_find(&syn);
+      if ((entry != NULL) && (entry->listener == pcb) && (seqno == entry->irs + 1)) {
+        tcp_syn_queue_remove(entry);
+      }
+    }
+#endif /* LWIP_TCP_SYN_COOKIES */
     return;
   }
 
@@ -656,6 +789,11 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
       return;
     }
 #endif /* TCP_LISTEN_BACKLOG */
+#if LWIP_TCP_SYN_COOKIES
+    if (pcb->syncookies && tcp_listen_syncookie(pcb)) {
+      return;
+    }
+#endif /* LWIP_TCP_SYN_COOKIES */
     npcb = tcp_alloc(pcb->prio);
     /* If a new PCB could not be created (probably due to lack of memory),
        we don't do anything, but rely on the sender will retransmit the
@@ -673,41 +811,19 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     tcp_set_flags(npcb, TF_BACKLOGPEND);
 #endif /* TCP_LISTEN_BACKLOG */
     /* Set up the new PCB. */
-    ip_addr_copy(npcb->local_ip, *ip_current_dest_addr());
-    ip_addr_copy(npcb->remote_ip, *ip_current_src_addr());
-    npcb->local_port = pcb->local_port;
-    npcb->remote_port = tcphdr->src;
-    npcb->state = SYN_RCVD;
-    npcb->rcv_nxt = seqno + 1;
-    npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+    tcp_listen_init_pcb(pcb, npcb, seqno);
+    TCP_PORT_ACQUIRE(npcb->local_port);
     iss = tcp_next_iss(npcb);
     npcb->snd_wl2 = iss;
     npcb->snd_nxt = iss;
     npcb->lastack = iss;
     npcb->snd_lbb = iss;
-    npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
-    npcb->callback_arg = pcb->callback_arg;
-#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
-    npcb->listener = pcb;
-#endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
-#if LWIP_VLAN_PCP
-    npcb->netif_hints.tci = pcb->netif_hints.tci;
-#endif /* LWIP_VLAN_PCP */
-    /* inherit socket options */
-    npcb->so_options = pcb->so_options & SOF_INHERITED;
-    npcb->netif_idx = pcb->netif_idx;
     /* Register the new PCB so that we can begin receiving segments
        for it. */
     TCP_REG_ACTIVE(npcb);
 
     /* Parse any options in the SYN. */
-    tcp_parseopt(npcb);
-    npcb->snd_wnd = tcphdr->wnd;
-    npcb->snd_wnd_max = npcb->snd_wnd;
-
-#if TCP_CALCULATE_EFF_SEND_MSS
-    npcb->mss = tcp_eff_send_mss(npcb->mss, &npcb->local_ip, &npcb->remote_ip);
-#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+    fastopen_accept = tcp_listen_syn_options(pcb, npcb);
 
     MIB2_STATS_INC(mib2.tcppassiveopens);
 
@@ -724,11 +840,377 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
       tcp_abandon(npcb, 0);
       return;
     }
+#if LWIP_TCP_FASTOPEN
+    if (fastopen_accept && (tcp_listen_fastopen(pcb, npcb) == ERR_ABRT)) {
+      return;
+    }
+#else /* LWIP_TCP_FASTOPEN */
+    LWIP_UNUSED_ARG(fastopen_accept);
+#endif /* LWIP_TCP_FASTOPEN */
     tcp_output(npcb);
   }
   return;
 }
 
+/**
+ * Set up a pcb for a connection request to a listening pcb (the state
+ * passed on by the listener and the receive side of the connection).
+ *
+ * @param pcb the tcp_pcb_listen the connection request arrived for
+ * @param npcb the new tcp_pcb
+ * @param irs sequence number of the SYN
+ */
+static void
+tcp_listen_init_pcb(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb, u32_t irs)
+{
+  ip_addr_copy(npcb->local_ip, *ip_current_dest_addr());
+  ip_addr_copy(npcb->remote_ip, *ip_current_src_addr());
+  npcb->local_port = pcb->local_port;
+  npcb->remote_port = tcphdr->src;
+  npcb->state = SYN_RCVD;
+  npcb->rcv_nxt = irs + 1;
+  npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+  npcb->snd_wl1 = irs - 1;/* initialise to seqno-1 to force window update */
+  npcb->callback_arg = pcb->callback_arg;
+#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
+  npcb->listener = pcb;
+#endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
+#if LWIP_VLAN_PCP
+  npcb->netif_hints.tci = pcb->netif_hints.tci;
+#endif /* LWIP_VLAN_PCP */
+  /* inherit socket options */
+  npcb->so_options = pcb->so_options & SOF_INHERITED;
+  npcb->netif_idx = pcb->netif_idx;
+}
+
+/**
+ * Take the options and the window of a SYN segment into a pcb set up by
+ * tcp_listen_init_pcb().
+ *
+ * @param pcb the tcp_pcb_listen the SYN arrived for
+ * @param npcb the new tcp_pcb
+ * @return 1 if data in the SYN can be taken right away (fast open), 0 if not
+ */
+static u8_t
+tcp_listen_syn_options(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb)
+{
+  u8_t fastopen_accept = 0;
+
+  tcp_parseopt(npcb);
+  npcb->snd_wnd = tcphdr->wnd;
+  npcb->snd_wnd_max = npcb->snd_wnd;
+
+#if TCP_CALCULATE_EFF_SEND_MSS
+  npcb->mss = tcp_eff_send_mss(npcb->mss, &npcb->local_ip, &npcb->remote_ip);
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+
+#if LWIP_TCP_FASTOPEN
+  if ((pcb->fastopen & TCP_FASTOPEN_ENABLED) && (tcp_in_fastopen_len != TCP_FASTOPEN_NO_OPT)) {
+    if (tcp_fastopen_cookie_valid(&npcb->remote_ip, tcp_in_fastopen_cookie, tcp_in_fastopen_len)) {
+      /* take the data right away (if it fits into the window) */
+      fastopen_accept = (u8_t)((inseg.len > 0) && (inseg.len <= npcb->rcv_wnd));
+    } else {
+      /* cookie request or invalid cookie: send a cookie with the SYN|ACK */
+      npcb->fastopen_optlen = TCP_FASTOPEN_OPT_LEN(TCP_FASTOPEN_COOKIE_LEN);
+    }
+  }
+#else /* LWIP_TCP_FASTOPEN */
+  LWIP_UNUSED_ARG(pcb);
+#endif /* LWIP_TCP_FASTOPEN */
+  return fastopen_accept;
+}
+
+#if LWIP_TCP_SYN_COOKIES
+/**
+ * Called by tcp_listen_input() for a SYN to a listening pcb with SYN cookies
+ * enabled: the SYN is answered with a SYN|ACK carrying a cookie, without
+ * allocating a pcb. The options of the SYN are kept in the SYN queue if
+ * there is room, else the connection is set up without window scaling, SACK
+ * and timestamps.
+ *
+ * @param pcb the tcp_pcb_listen for which the SYN arrived
+ * @return 1 if the SYN was answered, 0 if it needs a pcb (fast open data)
+ */
+static u8_t
+tcp_listen_syncookie(struct tcp_pcb_listen *pcb)
+{
+  struct tcp_pcb *npcb = &tcp_syncookie_pcb;
+  struct tcp_syn_entry syn;
+
+  memset(npcb, 0, sizeof(struct tcp_pcb));
+  npcb->rcv_wnd = npcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
+  npcb->ttl = TCP_TTL;
+  npcb->mss = INITIAL_MSS;
+  tcp_listen_init_pcb(pcb, npcb, seqno);
+  if (tcp_listen_syn_options(pcb, npcb)) {
+    return 0;
+  }
+
+  memset(&syn, 0, sizeof(syn));
+  syn.listener = pcb;
+  ip_addr_copy(syn.local_ip, npcb->local_ip);
+  ip_addr_copy(syn.remote_ip, npcb->remote_ip);
+  syn.local_port = npcb->local_port;
+  syn.remote_port = npcb->remote_port;
+  syn.irs = seqno;
+  syn.ticks = tcp_ticks;
+#if LWIP_TCP_TIMESTAMPS
+  syn.ts_recent = npcb->ts_recent;
+#endif /* LWIP_TCP_TIMESTAMPS */
+  syn.flags = (tcpflags_t)(npcb->flags & TCP_SYN_ENTRY_FLAGS);
+  syn.mss = npcb->mss;
+#if LWIP_WND_SCALE
+  syn.snd_scale = npcb->snd_scale;
+#endif /* LWIP_WND_SCALE */
+  syn.iss = tcp_syncookie_make(&syn, 1);
+  if (tcp_syn_queue_add(&syn) == NULL) {
+    /* the queue is full: only what the cookie carries is left */
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_syncookie: SYN queue full\n"));
+    syn.iss = tcp_syncookie_make(&syn, 0);
+    tcp_clear_flags(npcb, TCP_SYN_ENTRY_FLAGS);
+#if LWIP_WND_SCALE
+    npcb->rcv_scale = 0;
+    npcb->rcv_wnd = npcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
+#endif /* LWIP_WND_SCALE */
+  }
+  tcp_send_synack(npcb, syn.iss);
+  return 1;
+}
+
+/**
+ * Reset a connection whose final ACK cannot be accepted (the peer is in
+ * ESTABLISHED already) and forget its SYN queue entry.
+ *
+ * @param entry the SYN queue entry of the connection or NULL
+ */
+static void
+tcp_listen_syncookie_refuse(struct tcp_syn_entry *entry)
+{
+  if (entry != NULL) {
+    tcp_syn_queue_remove(entry);
+  }
+  LWIP_DEBUGF(TCP_RST_DEBUG, ("tcp_listen_syncookie_refuse: sending reset\n"));
+  tcp_rst_netif(ip_data.current_input_netif, ackno, seqno + tcplen, ip_current_dest_addr(),
+                ip_current_src_addr(), tcphdr->dest, tcphdr->src);
+}
+
+/**
+ * Called by tcp_input() for an ACK to a listening pcb with SYN cookies
+ * enabled. If the ACK acknowledges a valid cookie, a pcb in SYN_RCVD is set
+ * up for the connection (with the options from the SYN queue or from the
+ * cookie) and the ACK is processed for it like for any other pcb.
+ *
+ * @param pcb the tcp_pcb_listen for which the ACK arrived
+ * @param npcb receives the new tcp_pcb, NULL if the cookie is not valid
+ *        (tcp_listen_input() sends a RST then)
+ * @return ERR_OK, or ERR_MEM if the ACK has to be dropped (backlog full or
+ *         out of memory). The peer considers the connection established
+ *         and does not retransmit the ACK, so it is refused with a RST.
+ */
+static err_t
+tcp_listen_syncookie_ack(struct tcp_pcb_listen *pcb, struct tcp_pcb **npcb)
+{
+  struct tcp_syn_entry syn, *entry = NULL;
+  struct tcp_pcb *cpcb;
+  u8_t res;
+
+  *npcb = NULL;
+  ip_addr_copy(syn.local_ip, *ip_current_dest_addr());
+  ip_addr_copy(syn.remote_ip, *ip_current_src_addr());
+  syn.local_port = pcb->local_port;
+  syn.remote_port = tcphdr->src;
+  syn.irs = seqno - 1;
+  res = tcp_syncookie_check(&syn, ackno - 1);
+  if (res == TCP_SYNCOOKIE_QUEUED) {
+    entry = tcp_syn_queue_find(&syn);
+    if ((entry == NULL) || (entry->listener != pcb) || (entry->irs != syn.irs) || (entry->iss != syn.iss)) {
+      res = TCP_SYNCOOKIE_INVALID;
+    }
+  }
+  if (res == TCP_SYNCOOKIE_INVALID) {
+    return ERR_OK;
+  }
+
+#if TCP_LISTEN_BACKLOG
+  if (pcb->accepts_pending >= pcb->backlog) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_syncookie_ack: listen backlog exceeded for port %"U16_F"\n", tcphdr->dest));
+    tcp_listen_syncookie_refuse(entry);
+    return ERR_MEM;
+  }
+#endif /* TCP_LISTEN_BACKLOG */
+  cpcb = tcp_alloc(pcb->prio);
+  if (cpcb == NULL) {
+    err_t err;
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_syncookie_ack: could not allocate PCB\n"));
+    TCP_STATS_INC(tcp.memerr);
+    TCP_EVENT_ACCEPT(pcb, NULL, pcb->callback_arg, ERR_MEM, err);
+    LWIP_UNUSED_ARG(err); /* err not useful here */
+    tcp_listen_syncookie_refuse(entry);
+    return ERR_MEM;
+  }
+#if TCP_LISTEN_BACKLOG
+  pcb->accepts_pending++;
+  tcp_set_flags(cpcb, TF_BACKLOGPEND);
+#endif /* TCP_LISTEN_BACKLOG */
+  tcp_listen_init_pcb(pcb, cpcb, syn.irs);
+  TCP_PORT_ACQUIRE(cpcb->local_port);
+  if (entry != NULL) {
+    /* the options of the SYN */
+    cpcb->mss = entry->mss;
+    tcp_set_flags(cpcb, entry->flags);
+#if LWIP_WND_SCALE
+    if (entry->flags & TF_WND_SCALE) {
+      cpcb->snd_scale = entry->snd_scale;
+      cpcb->rcv_scale = TCP_RCV_SCALE;
+      cpcb->rcv_wnd = cpcb->rcv_ann_wnd = TCP_WND;
+    }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_TIMESTAMPS
+    cpcb->ts_recent = entry->ts_recent;
+#endif /* LWIP_TCP_TIMESTAMPS */
+    tcp_syn_queue_remove(entry);
+  } else {
+    cpcb->mss = syn.mss;
+  }
+  /* the SYN|ACK is acknowledged by this segment */
+  cpcb->snd_wl2 = syn.iss;
+  cpcb->lastack = syn.iss;
+  cpcb->snd_nxt = syn.iss + 1;
+  cpcb->snd_lbb = syn.iss + 1;
+  cpcb->snd_wnd = SND_WND_SCALE(cpcb, tcphdr->wnd);
+  cpcb->snd_wnd_max = cpcb->snd_wnd;
+  TCP_REG_ACTIVE(cpcb);
+
+  MIB2_STATS_INC(mib2.tcppassiveopens);
+
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+  if (tcp_ext_arg_invoke_callbacks_passive_open(pcb, cpcb) != ERR_OK) {
+    tcp_abandon(cpcb, 0);
+    return ERR_ABRT;
+  }
+#endif
+
+  *npcb = cpcb;
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_TCP_FASTOPEN
+/**
+ * Called by tcp_listen_input() for a SYN with data and a valid fast open
+ * cookie (RFC 7413): the data is acknowledged with the SYN|ACK, the new
+ * connection is accepted and the data passed to the application before the
+ * handshake is complete.
+ *
+ * @param pcb the tcp_pcb_listen for which the SYN arrived
+ * @param npcb the new tcp_pcb in SYN_RCVD
+ * @return ERR_ABRT if npcb was aborted, ERR_OK otherwise
+ */
+static err_t
+tcp_listen_fastopen(struct tcp_pcb_listen *pcb, struct tcp_pcb *npcb)
+{
+  struct pbuf *p = inseg.p;
+  err_t err;
+
+  LWIP_UNUSED_ARG(pcb); /* not used with LWIP_EVENT_API */
+
+  /* the data follows the SYN: take it like tcp_receive() does */
+  npcb->rcv_nxt += inseg.len;
+  npcb->rcv_wnd -= inseg.len;
+  tcp_update_rcv_ann_wnd(npcb);
+  npcb->cwnd = LWIP_TCP_CALC_INITIAL_CWND(npcb->mss);
+  npcb->fastopen |= TCP_FASTOPEN_ACCEPTED;
+
+  tcp_backlog_accepted(npcb);
+  /* Call the accept function. */
+  TCP_EVENT_ACCEPT(pcb, npcb, npcb->callback_arg, ERR_OK, err);
+  if (err != ERR_OK) {
+    /* If the accept function returns with an error, we abort
+     * the connection. */
+    /* Already aborted? */
+    if (err != ERR_ABRT) {
+      tcp_abort(npcb);
+    }
+    return ERR_ABRT;
+  }
+
+  /* the pbuf is freed by tcp_input() */
+  pbuf_ref(p);
+  if (flags & TCP_PSH) {
+    p->flags |= PBUF_FLAG_PUSH;
+  }
+  TCP_EVENT_RECV(npcb, p, ERR_OK, err);
+  if (err == ERR_ABRT) {
+    return ERR_ABRT;
+  }
+  if (err != ERR_OK) {
+    npcb->refused_data = p;
+    TCP_TIMER_FAST(npcb);
+  }
+  return ERR_OK;
+}
+
+/**
+ * Called by tcp_process() when the SYN|ACK of an active open arrives:
+ * remembers the cookie of the server and accounts for data sent with the
+ * SYN. Data the server did not take is queued to be sent again.
+ *
+ * @param pcb the tcp_pcb that is established now
+ * @param rseg the SYN segment (taken off the queues, freed by the caller)
+ * @return ERR_OK, or ERR_MEM if the data could not be queued again
+ */
+static err_t
+tcp_fastopen_synack(struct tcp_pcb *pcb, struct tcp_seg *rseg)
+{
+  u16_t acked = (u16_t)(ackno - lwip_ntohl(rseg->tcphdr->seqno) - 1);
+
+  if (pcb->fastopen_optlen != 0) {
+    if ((tcp_in_fastopen_len != TCP_FASTOPEN_NO_OPT) && (tcp_in_fastopen_len >= TCP_FASTOPEN_COOKIE_MIN)) {
+      tcp_fastopen_cache_set(&pcb->remote_ip, tcp_in_fastopen_cookie, tcp_in_fastopen_len);
+    } else if ((rseg->len > 0) && (acked == 0)) {
+      /* the server did not take our cookie and sent no new one */
+      tcp_fastopen_cache_set(&pcb->remote_ip, NULL, 0);
+    }
+  }
+  if (rseg->len > 0) {
+    if ((acked < rseg->len) && (tcp_fastopen_rexmit(pcb, rseg, acked) != ERR_OK)) {
+      return ERR_MEM;
+    }
+    pcb->snd_buf = (tcpwnd_size_t)(pcb->snd_buf + acked);
+    recv_acked = acked;
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_FASTOPEN */
+
+#if LWIP_TCP_ACK_POLICY
+/**
+ * Called by tcp_receive() for in-sequence data instead of tcp_ack(): the
+ * data is acknowledged at once in quick-ack mode, when it fills a gap and
+ * when pcb->ack_every full-sized segments are unacknowledged. Else, the
+ * fast timer sends a delayed ACK.
+ *
+ * @param pcb the tcp_pcb that received data
+ * @param len sequence space taken by the segment (and the ooseq segments
+ *        it completed)
+ */
+static void
+tcp_ack_policy(struct tcp_pcb *pcb, u32_t len)
+{
+  pcb->ack_pending = (tcpwnd_size_t)(pcb->ack_pending + len);
+  if (pcb->ack_quick > 0) {
+    pcb->ack_quick--;
+    tcp_ack_now(pcb);
+  } else if ((len > tcplen) || (pcb->ack_pending >= (tcpwnd_size_t)pcb->ack_every * pcb->mss)) {
+    /* a gap was filled or enough data arrived (maybe in one GRO batch) */
+    tcp_ack_now(pcb);
+  } else {
+    tcp_set_flags(pcb, TF_ACK_DELAY);
+    TCP_TIMER_FAST(pcb);
+  }
+}
+#endif /* LWIP_TCP_ACK_POLICY */
+
 /**
  * Called by tcp_input() when a segment arrives for a connection in
  * TIME_WAIT.
@@ -867,7 +1349,12 @@ tcp_process(struct tcp_pcb *pcb)
                                     pcb->unacked ? lwip_ntohl(pcb->unacked->tcphdr->seqno) : 0));
       /* received SYN ACK with expected sequence number? */
       if ((flags & TCP_ACK) && (flags & TCP_SYN)
-          && (ackno == pcb->lastack + 1)) {
+          && ((ackno == pcb->lastack + 1)
+#if LWIP_TCP_FASTOPEN
+              /* data sent with the SYN may be acknowledged, too */
+              || TCP_SEQ_BETWEEN(ackno, pcb->lastack + 1, pcb->snd_nxt)
+#endif /* LWIP_TCP_FASTOPEN */
+             )) {
         pcb->rcv_nxt = seqno + 1;
         pcb->rcv_ann_right_edge = pcb->rcv_nxt;
         pcb->lastack = ackno;
@@ -897,6 +1384,13 @@ tcp_process(struct tcp_pcb *pcb)
         } else {
           pcb->unacked = rseg->next;
         }
+#if LWIP_TCP_FASTOPEN
+        if (tcp_fastopen_synack(pcb, rseg) != ERR_OK) {
+          tcp_seg_free(rseg);
+          tcp_abort(pcb);
+          return ERR_ABRT;
+        }
+#endif /* LWIP_TCP_FASTOPEN */
         tcp_seg_free(rseg);
 
         /* If there's nothing left to acknowledge, stop the retransmit
@@ -932,7 +1426,11 @@ tcp_process(struct tcp_pcb *pcb)
       break;
     case SYN_RCVD:
       if (flags & TCP_SYN) {
-        if (seqno == pcb->rcv_nxt - 1) {
+        if ((seqno == pcb->rcv_nxt - 1)
+#if LWIP_TCP_FASTOPEN
+            || ((pcb->fastopen & TCP_FASTOPEN_ACCEPTED) && (seqno + tcplen == pcb->rcv_nxt))
+#endif /* LWIP_TCP_FASTOPEN */
+           ) {
           /* Looks like another copy of the SYN - retransmit our SYN-ACK */
           tcp_rexmit(pcb);
         }
@@ -941,6 +1439,11 @@ tcp_process(struct tcp_pcb *pcb)
         if (TCP_SEQ_BETWEEN(ackno, pcb->lastack + 1, pcb->snd_nxt)) {
           pcb->state = ESTABLISHED;
           LWIP_DEBUGF(TCP_DEBUG, ("TCP connection established %"U16_F" -> %"U16_F".\n", inseg.tcphdr->src, inseg.tcphdr->dest));
+#if LWIP_TCP_FASTOPEN
+          if (pcb->fastopen & TCP_FASTOPEN_ACCEPTED) {
+            /* already accepted by tcp_listen_fastopen() */
+          } else
+#endif /* LWIP_TCP_FASTOPEN */
 #if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
           if (pcb->listener == NULL) {
             /* listen pcb might be closed by now */
@@ -1055,20 +1558,315 @@ tcp_process(struct tcp_pcb *pcb)
 }
 
 #if TCP_QUEUE_OOSEQ
+#if TCP_OOSEQ_RBTREE
+/* Red-black tree over pcb->ooseq: the tree holds the same segments as the
+   list, in the same order, so inserting only needs the list predecessor and
+   no key comparisons. rb_child[0] is the left, rb_child[1] the right child. */
+
+#define TCP_OOS_IS_RED(seg) (((seg) != NULL) && (seg)->rb_red)
+
+/** Replace 'old' by 'seg' as the child of old's parent */
+static void
+tcp_oos_rb_replace(struct tcp_pcb *pcb, struct tcp_seg *old, struct tcp_seg *seg)
+{
+  struct tcp_seg *parent = old->rb_parent;
+
+  if (parent == NULL) {
+    pcb->ooseq_root = seg;
+  } else {
+    parent->rb_child[(parent->rb_child[0] == old) ? 0 : 1] = seg;
+  }
+  if (seg != NULL) {
+    seg->rb_parent = parent;
+  }
+}
+
+/** Rotate the subtree at 'seg' towards direction 'dir' (0: left, 1: right) */
+static void
+tcp_oos_rb_rotate(struct tcp_pcb *pcb, struct tcp_seg *seg, int dir)
+{
+  struct tcp_seg *up = seg->rb_child[1 - dir];
+
+  seg->rb_child[1 - dir] = up->rb_child[dir];
+  if (up->rb_child[dir] != NULL) {
+    up->rb_child[dir]->rb_parent = seg;
+  }
+  tcp_oos_rb_replace(pcb, seg, up);
+  up->rb_child[dir] = seg;
+  seg->rb_parent = up;
+}
+
+static struct tcp_seg *
+tcp_oos_rb_edge(struct tcp_seg *seg, int dir)
+{
+  while (seg->rb_child[dir] != NULL) {
+    seg = seg->rb_child[dir];
+  }
+  return seg;
+}
+
+/** The segment in front of 'seg' on ooseq */
+static struct tcp_seg *
+tcp_oos_rb_prev(struct tcp_seg *seg)
+{
+  if (seg->rb_child[0] != NULL) {
+    return tcp_oos_rb_edge(seg->rb_child[0], 1);
+  }
+  while ((seg->rb_parent != NULL) && (seg == seg->rb_parent->rb_child[0])) {
+    seg = seg->rb_parent;
+  }
+  return seg->rb_parent;
+}
+
+/**
+ * The last segment on ooseq starting before seqno 'seq', NULL if none.
+ * Most segments arrive beyond the end of the queue: check that first.
+ */
+static struct tcp_seg *
+tcp_oos_rb_lower(struct tcp_pcb *pcb, u32_t seq)
+{
+  struct tcp_seg *seg, *lower = NULL;
+
+  if ((pcb->ooseq_tail != NULL) && TCP_SEQ_LT(pcb->ooseq_tail->tcphdr->seqno, seq)) {
+    return pcb->ooseq_tail;
+  }
+  for (seg = pcb->ooseq_root; seg != NULL; ) {
+    if (TCP_SEQ_LT(seg->tcphdr->seqno, seq)) {
+      lower = seg;
+      seg = seg->rb_child[1];
+    } else {
+      seg = seg->rb_child[0];
+    }
+  }
+  return lower;
+}
+
+/** Add 'seg' to the tree behind 'prev' (NULL: as first segment) */
+static void
+tcp_oos_rb_insert(struct tcp_pcb *pcb, struct tcp_seg *seg, struct tcp_seg *prev)
+{
+  struct tcp_seg *parent, *gparent, *uncle;
+  int dir;
+
+  seg->rb_child[0] = seg->rb_child[1] = NULL;
+  seg->rb_red = 1;
+  if (pcb->ooseq_root == NULL) {
+    seg->rb_parent = NULL;
+    pcb->ooseq_root = seg;
+  } else if (prev == NULL) {
+    parent = tcp_oos_rb_edge(pcb->ooseq_root, 0);
+    parent->rb_child[0] = seg;
+    seg->rb_parent = parent;
+  } else if (prev->rb_child[1] == NULL) {
+    prev->rb_child[1] = seg;
+    seg->rb_parent = prev;
+  } else {
+    parent = tcp_oos_rb_edge(prev->rb_child[1], 0);
+    parent->rb_child[0] = seg;
+    seg->rb_parent = parent;
+  }
+  if ((pcb->ooseq_tail == NULL) || (prev == pcb->ooseq_tail)) {
+    pcb->ooseq_tail = seg;
+  }
+  pcb->ooseq_bytes += seg->p->tot_len;
+  pcb->ooseq_pbufs = (u16_t)(pcb->ooseq_pbufs + pbuf_clen(seg->p));
+
+  while (((parent = seg->rb_parent) != NULL) && parent->rb_red) {
+    gparent = parent->rb_parent;
+    dir = (parent == gparent->rb_child[0]) ? 0 : 1;
+    uncle = gparent->rb_child[1 - dir];
+    if (TCP_OOS_IS_RED(uncle)) {
+      uncle->rb_red = 0;
+      parent->rb_red = 0;
+      gparent->rb_red = 1;
+      seg = gparent;
+      continue;
+    }
+    if (seg == parent->rb_child[1 - dir]) {
+      tcp_oos_rb_rotate(pcb, parent, dir);
+      parent = seg;
+    }
+    parent->rb_red = 0;
+    gparent->rb_red = 1;
+    tcp_oos_rb_rotate(pcb, gparent, 1 - dir);
+    break;
+  }
+  pcb->ooseq_root->rb_red = 0;
+}
+
+/** Remove 'seg' from the tree (not from the list) */
+static void
+tcp_oos_rb_remove(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct tcp_seg *child, *parent, *next, *sibling;
+  u8_t red = seg->rb_red;
+  int dir;
+
+  if (seg == pcb->ooseq_tail) {
+    pcb->ooseq_tail = tcp_oos_rb_prev(seg);
+  }
+  pcb->ooseq_bytes -= seg->p->tot_len;
+  pcb->ooseq_pbufs = (u16_t)(pcb->ooseq_pbufs - pbuf_clen(seg->p));
+
+  if ((seg->rb_child[0] == NULL) || (seg->rb_child[1] == NULL)) {
+    child = seg->rb_child[(seg->rb_child[0] == NULL) ? 1 : 0];
+    parent = seg->rb_parent;
+    tcp_oos_rb_replace(pcb, seg, child);
+  } else {
+    /* replace seg by the next segment, which has no left child */
+    next = tcp_oos_rb_edge(seg->rb_child[1], 0);
+    red = next->rb_red;
+    child = next->rb_child[1];
+    if (next->rb_parent == seg) {
+      parent = next;
+    } else {
+      parent = next->rb_parent;
+      tcp_oos_rb_replace(pcb, next, child);
+      next->rb_child[1] = seg->rb_child[1];
+      next->rb_child[1]->rb_parent = next;
+    }
+    tcp_oos_rb_replace(pcb, seg, next);
+    next->rb_child[0] = seg->rb_child[0];
+    next->rb_child[0]->rb_parent = next;
+    next->rb_red = seg->rb_red;
+  }
+  if (red) {
+    return;
+  }
+
+  /* a black segment is gone: restore the black height */
+  while ((child != pcb->ooseq_root) && !TCP_OOS_IS_RED(child)) {
+    dir = (child == parent->rb_child[0]) ? 0 : 1;
+    sibling = parent->rb_child[1 - dir];
+    if (sibling->rb_red) {
+      sibling->rb_red = 0;
+      parent->rb_red = 1;
+      tcp_oos_rb_rotate(pcb, parent, dir);
+      sibling = parent->rb_child[1 - dir];
+    }
+    if (!TCP_OOS_IS_RED(sibling->rb_child[0]) && !TCP_OOS_IS_RED(sibling->rb_child[1])) {
+      sibling->rb_red = 1;
+      child = parent;
+      parent = child->rb_parent;
+    } else {
+      if (!TCP_OOS_IS_RED(sibling->rb_child[1 - dir])) {
+        sibling->rb_child[dir]->rb_red = 0;
+        sibling->rb_red = 1;
+        tcp_oos_rb_rotate(pcb, sibling, 1 - dir);
+        sibling = parent->rb_child[1 - dir];
+      }
+      sibling->rb_red = parent->rb_red;
+      parent->rb_red = 0;
+      sibling->rb_child[1 - dir]->rb_red = 0;
+      tcp_oos_rb_rotate(pcb, parent, dir);
+      child = pcb->ooseq_root;
+    }
+  }
+  if (child != NULL) {
+    child->rb_red = 0;
+  }
+}
+
+#if LWIP_TCP_SACK_OUT
+/** Index of the SACK block containing seqno 'seq', -1 if none */
+static int
+tcp_oos_sack_find(struct tcp_pcb *pcb, u32_t seq)
+{
+  int i;
+
+  for (i = 0; (i < LWIP_TCP_MAX_SACK_NUM) && LWIP_TCP_SACK_VALID(pcb, i); i++) {
+    if (TCP_SEQ_LEQ(pcb->rcv_sacks[i].left, seq) && TCP_SEQ_LT(seq, pcb->rcv_sacks[i].right)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Left edge of the run of contiguous segments on ooseq that ends with 'seg'.
+ * The SACK blocks sent last describe such runs, so mostly no walk is needed.
+ */
+static u32_t
+tcp_oos_run_start(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct tcp_seg *prev;
+  int i;
+
+  for (;;) {
+    i = tcp_oos_sack_find(pcb, seg->tcphdr->seqno);
+    if (i >= 0) {
+      return pcb->rcv_sacks[i].left;
+    }
+    prev = tcp_oos_rb_prev(seg);
+    if ((prev == NULL) || (prev->tcphdr->seqno + prev->len != seg->tcphdr->seqno)) {
+      return seg->tcphdr->seqno;
+    }
+    seg = prev;
+  }
+}
+#endif /* LWIP_TCP_SACK_OUT */
+
+#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
+/** Check if ooseq exceeds one of the limits */
+static int
+tcp_oos_over_limit(struct tcp_pcb *pcb)
+{
+#ifdef TCP_OOSEQ_BYTES_LIMIT
+  if (pcb->ooseq_bytes > (u32_t)TCP_OOSEQ_BYTES_LIMIT(pcb)) {
+    return 1;
+  }
+#endif /* TCP_OOSEQ_BYTES_LIMIT */
+#ifdef TCP_OOSEQ_PBUFS_LIMIT
+  if (pcb->ooseq_pbufs > (u16_t)TCP_OOSEQ_PBUFS_LIMIT(pcb)) {
+    return 1;
+  }
+#endif /* TCP_OOSEQ_PBUFS_LIMIT */
+  return 0;
+}
+#endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
+#else /* TCP_OOSEQ_RBTREE */
+#define tcp_oos_rb_insert(pcb, seg, prev)
+#define tcp_oos_rb_remove(pcb, seg)
+#endif /* TCP_OOSEQ_RBTREE */
+
+/** Shorten a segment on ooseq to 'len' bytes */
+static void
+tcp_oos_trim(struct tcp_pcb *pcb, struct tcp_seg *seg, u16_t len)
+{
+#if TCP_OOSEQ_RBTREE
+  pcb->ooseq_bytes -= seg->p->tot_len;
+  pcb->ooseq_pbufs = (u16_t)(pcb->ooseq_pbufs - pbuf_clen(seg->p));
+#else /* TCP_OOSEQ_RBTREE */
+  LWIP_UNUSED_ARG(pcb);
+#endif /* TCP_OOSEQ_RBTREE */
+  seg->len = len;
+  pbuf_realloc(seg->p, len);
+#if TCP_OOSEQ_RBTREE
+  pcb->ooseq_bytes += seg->p->tot_len;
+  pcb->ooseq_pbufs = (u16_t)(pcb->ooseq_pbufs + pbuf_clen(seg->p));
+#endif /* TCP_OOSEQ_RBTREE */
+}
+
 /**
  * Insert segment into the list (segments covered with new one will be deleted)
  *
  * Called from tcp_receive()
  */
 static void
-tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
+tcp_oos_insert_segment(struct tcp_pcb *pcb, struct tcp_seg *cseg, struct tcp_seg *next)
 {
   struct tcp_seg *old_seg;
 
   LWIP_ASSERT("tcp_oos_insert_segment: invalid cseg", cseg != NULL);
+  LWIP_UNUSED_ARG(pcb);
 
   if (TCPH_FLAGS(cseg->tcphdr) & TCP_FIN) {
     /* received segment overlaps all following segments */
+#if TCP_OOSEQ_RBTREE
+    for (old_seg = next; old_seg != NULL; old_seg = old_seg->next) {
+      tcp_oos_rb_remove(pcb, old_seg);
+    }
+#endif /* TCP_OOSEQ_RBTREE */
     tcp_segs_free(next);
     next = NULL;
   } else {
@@ -1083,6 +1881,7 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
       }
       old_seg = next;
       next = next->next;
+      tcp_oos_rb_remove(pcb, old_seg);
       tcp_seg_free(old_seg);
     }
     if (next &&
@@ -1162,6 +1961,12 @@ tcp_receive(struct tcp_pcb *pcb)
   if (flags & TCP_ACK) {
     right_wnd_edge = pcb->snd_wnd + pcb->snd_wl2;
 
+#if LWIP_TCP_SACK_IN
+    if (TCP_SACK_IN_ENABLED(pcb) && (tcp_in_num_sacks > 0)) {
+      tcp_sack_update_scoreboard(pcb);
+    }
+#endif /* LWIP_TCP_SACK_IN */
+
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
         (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
@@ -1219,6 +2024,18 @@ tcp_receive(struct tcp_pcb *pcb)
               if ((u8_t)(pcb->dupacks + 1) > pcb->dupacks) {
                 ++pcb->dupacks;
               }
+#if LWIP_TCP_SACK_IN
+              if (TCP_SACK_IN_ENABLED(pcb)) {
+                /* RFC 6675: no cwnd inflation, the pipe estimate limits output.
+                   Enough SACKed data above snd_una counts as DupThresh dupacks. */
+                if ((pcb->dupacks < 3) && (pcb->unacked != NULL)) {
+                  tcp_sack_pipe(pcb);
+                  if (pcb->unacked->flags & TF_SEG_SACK_LOST) {
+                    pcb->dupacks = 3;
+                  }
+                }
+              } else
+#endif /* LWIP_TCP_SACK_IN */
               if (pcb->dupacks > 3) {
                 /* Inflate the congestion window */
                 TCP_WND_INC(pcb->cwnd, pcb->mss);
@@ -1239,9 +2056,27 @@ tcp_receive(struct tcp_pcb *pcb)
          in fast retransmit. Also reset the congestion window to the
          slow start threshold. */
       if (pcb->flags & TF_INFR) {
-        tcp_clear_flags(pcb, TF_INFR);
-        pcb->cwnd = pcb->ssthresh;
-        pcb->bytes_acked = 0;
+#if LWIP_TCP_SACK_IN
+        /* On a partial ACK, stay in loss recovery until all data outstanding
+           when it started is acknowledged (RFC 6675) */
+        if (!TCP_SACK_IN_ENABLED(pcb) || TCP_SEQ_GEQ(ackno, pcb->recovery_point))
+#endif /* LWIP_TCP_SACK_IN */
+        {
+#if LWIP_TCP_SACK_IN
+          struct tcp_seg *seg;
+          /* the lost and retransmitted marks belong to this recovery: a new
+             one starts from the SACK information only */
+          for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+            seg->flags &= (u8_t)~(TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT);
+          }
+          for (seg = pcb->unsent; seg != NULL; seg = seg->next) {
+            seg->flags &= (u8_t)~(TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT);
+          }
+#endif /* LWIP_TCP_SACK_IN */
+          tcp_clear_flags(pcb, TF_INFR);
+          pcb->cwnd = pcb->ssthresh;
+          pcb->bytes_acked = 0;
+        }
       }
 
       /* Reset the number of retransmissions. */
@@ -1258,25 +2093,9 @@ tcp_receive(struct tcp_pcb *pcb)
       pcb->lastack = ackno;
 
       /* Update the congestion control variables (cwnd and
-         ssthresh). */
-      if (pcb->state >= ESTABLISHED) {
-        if (pcb->cwnd < pcb->ssthresh) {
-          tcpwnd_size_t increase;
-          /* limit to 1 SMSS segment during period following RTO */
-          u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
-          /* RFC 3465, section 2.2 Slow Start */
-          increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
-          TCP_WND_INC(pcb->cwnd, increase);
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        } else {
-          /* RFC 3465, section 2.1 Congestion Avoidance */
-          TCP_WND_INC(pcb->bytes_acked, acked);
-          if (pcb->bytes_acked >= pcb->cwnd) {
-            pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
-            TCP_WND_INC(pcb->cwnd, pcb->mss);
-          }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        }
+         ssthresh), but not during loss recovery. */
+      if ((pcb->state >= ESTABLISHED) && !(pcb->flags & TF_INFR)) {
+        pcb->cc->on_ack(pcb, acked);
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
                                     ackno,
@@ -1305,6 +2124,9 @@ tcp_receive(struct tcp_pcb *pcb)
       }
 
       pcb->polltmr = 0;
+#if LWIP_TCP_TIMER_WHEEL
+      pcb->tmr_poll = tcp_ticks;
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
 #if TCP_OVERSIZE
       if (pcb->unsent == NULL) {
@@ -1368,6 +2190,18 @@ tcp_receive(struct tcp_pcb *pcb)
       LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: RTO %"U16_F" (%"U16_F" milliseconds)\n",
                                   pcb->rto, (u16_t)(pcb->rto * TCP_SLOW_INTERVAL)));
 
+#if LWIP_TCP_PACING
+      {
+        /* +1: the sample is truncated to ms, this also keeps srtt != 0 */
+        u32_t rtt = sys_now() - pcb->pace.rtt_start + 1;
+        if (pcb->pace.srtt == 0) {
+          pcb->pace.srtt = rtt << 3;
+        } else {
+          pcb->pace.srtt = pcb->pace.srtt - (pcb->pace.srtt >> 3) + rtt;
+        }
+      }
+#endif /* LWIP_TCP_PACING */
+
       pcb->rttest = 0;
     }
   }
@@ -1463,6 +2297,10 @@ tcp_receive(struct tcp_pcb *pcb)
     if (TCP_SEQ_BETWEEN(seqno, pcb->rcv_nxt,
                         pcb->rcv_nxt + pcb->rcv_wnd - 1)) {
       if (pcb->rcv_nxt == seqno) {
+#if LWIP_TCP_ACK_POLICY
+        /* start of the data taken (with the ooseq segments it completes) */
+        u32_t rcv_start = seqno;
+#endif /* LWIP_TCP_ACK_POLICY */
         /* The incoming segment is the next in sequence. We check if
            we have to trim the end of the segment and update rcv_nxt
            and pass the data to the application. */
@@ -1505,6 +2343,11 @@ tcp_receive(struct tcp_pcb *pcb)
               pcb->ooseq = pcb->ooseq->next;
               tcp_seg_free(old_ooseq);
             }
+#if TCP_OOSEQ_RBTREE
+            pcb->ooseq_root = pcb->ooseq_tail = NULL;
+            pcb->ooseq_bytes = 0;
+            pcb->ooseq_pbufs = 0;
+#endif /* TCP_OOSEQ_RBTREE */
           } else {
             struct tcp_seg *next = pcb->ooseq;
             /* Remove all segments on ooseq that are covered by inseg already.
@@ -1521,6 +2364,7 @@ tcp_receive(struct tcp_pcb *pcb)
               }
               tmp = next;
               next = next->next;
+              tcp_oos_rb_remove(pcb, tmp);
               tcp_seg_free(tmp);
             }
             /* Now trim right side of inseg if it overlaps with the first
@@ -1580,6 +2424,7 @@ tcp_receive(struct tcp_pcb *pcb)
 
           struct tcp_seg *cseg = pcb->ooseq;
           seqno = pcb->ooseq->tcphdr->seqno;
+          tcp_oos_rb_remove(pcb, cseg);
 
           pcb->rcv_nxt += TCP_TCPLEN(cseg);
           LWIP_ASSERT("tcp_receive: ooseq tcplen > rcv_wnd",
@@ -1628,7 +2473,19 @@ tcp_receive(struct tcp_pcb *pcb)
 
 
         /* Acknowledge the segment(s). */
-        tcp_ack(pcb);
+#if LWIP_TCP_ACK_POLICY
+        tcp_ack_policy(pcb, pcb->rcv_nxt - rcv_start);
+#else /* LWIP_TCP_ACK_POLICY */
+#if LWIP_TCP_GRO
+        if (recv_segs > 1) {
+          /* merged segments count like separate ones: ACK every second */
+          tcp_ack_now(pcb);
+        } else
+#endif /* LWIP_TCP_GRO */
+        {
+          tcp_ack(pcb);
+        }
+#endif /* LWIP_TCP_ACK_POLICY */
 
 #if LWIP_TCP_SACK_OUT
         if (LWIP_TCP_SACK_VALID(pcb, 0)) {
@@ -1650,10 +2507,19 @@ tcp_receive(struct tcp_pcb *pcb)
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
 
+#if LWIP_TCP_ACK_POLICY
+        /* data got lost: acknowledge at once until the sender recovered */
+        pcb->ack_quick = TCP_QUICKACK_SEGS;
+#endif /* LWIP_TCP_ACK_POLICY */
 #if TCP_QUEUE_OOSEQ
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
           pcb->ooseq = tcp_seg_copy(&inseg);
+#if TCP_OOSEQ_RBTREE
+          if (pcb->ooseq != NULL) {
+            tcp_oos_rb_insert(pcb, pcb->ooseq, NULL);
+          }
+#endif /* TCP_OOSEQ_RBTREE */
 #if LWIP_TCP_SACK_OUT
           if (pcb->flags & TF_SACK) {
             /* All the SACKs should be invalid, so we can simply store the most recent one: */
@@ -1680,7 +2546,16 @@ tcp_receive(struct tcp_pcb *pcb)
           u32_t sackbeg = TCP_SEQ_LT(seqno, pcb->ooseq->tcphdr->seqno) ? seqno : pcb->ooseq->tcphdr->seqno;
 #endif /* LWIP_TCP_SACK_OUT */
           struct tcp_seg *next, *prev = NULL;
-          for (next = pcb->ooseq; next != NULL; next = next->next) {
+#if TCP_OOSEQ_RBTREE
+          /* skip the segments in front of the new one */
+          next = tcp_oos_rb_lower(pcb, seqno);
+          if (next == NULL) {
+            next = pcb->ooseq;
+          }
+#else /* TCP_OOSEQ_RBTREE */
+          next = pcb->ooseq;
+#endif /* TCP_OOSEQ_RBTREE */
+          for (; next != NULL; next = next->next) {
             if (seqno == next->tcphdr->seqno) {
               /* The sequence number of the incoming segment is the
                  same as the sequence number of the segment on
@@ -1707,7 +2582,8 @@ tcp_receive(struct tcp_pcb *pcb)
                   } else {
                     pcb->ooseq = cseg;
                   }
-                  tcp_oos_insert_segment(cseg, next);
+                  tcp_oos_insert_segment(pcb, cseg, next);
+                  tcp_oos_rb_insert(pcb, cseg, prev);
                 }
                 break;
               } else {
@@ -1726,7 +2602,8 @@ tcp_receive(struct tcp_pcb *pcb)
                   struct tcp_seg *cseg = tcp_seg_copy(&inseg);
                   if (cseg != NULL) {
                     pcb->ooseq = cseg;
-                    tcp_oos_insert_segment(cseg, next);
+                    tcp_oos_insert_segment(pcb, cseg, next);
+                    tcp_oos_rb_insert(pcb, cseg, NULL);
                   }
                   break;
                 }
@@ -1743,11 +2620,11 @@ tcp_receive(struct tcp_pcb *pcb)
                   if (cseg != NULL) {
                     if (TCP_SEQ_GT(prev->tcphdr->seqno + prev->len, seqno)) {
                       /* We need to trim the prev segment. */
-                      prev->len = (u16_t)(seqno - prev->tcphdr->seqno);
-                      pbuf_realloc(prev->p, prev->len);
+                      tcp_oos_trim(pcb, prev, (u16_t)(seqno - prev->tcphdr->seqno));
                     }
                     prev->next = cseg;
-                    tcp_oos_insert_segment(cseg, next);
+                    tcp_oos_insert_segment(pcb, cseg, next);
+                    tcp_oos_rb_insert(pcb, cseg, prev);
                   }
                   break;
                 }
@@ -1779,8 +2656,7 @@ tcp_receive(struct tcp_pcb *pcb)
                 if (next->next != NULL) {
                   if (TCP_SEQ_GT(next->tcphdr->seqno + next->len, seqno)) {
                     /* We need to trim the last segment. */
-                    next->len = (u16_t)(seqno - next->tcphdr->seqno);
-                    pbuf_realloc(next->p, next->len);
+                    tcp_oos_trim(pcb, next, (u16_t)(seqno - next->tcphdr->seqno));
                   }
                   /* check if the remote side overruns our receive window */
                   if (TCP_SEQ_GT((u32_t)tcplen + seqno, pcb->rcv_nxt + (u32_t)pcb->rcv_wnd)) {
@@ -1800,6 +2676,7 @@ tcp_receive(struct tcp_pcb *pcb)
                     LWIP_ASSERT("tcp_receive: segment not trimmed correctly to rcv_wnd",
                                 (seqno + tcplen) == (pcb->rcv_nxt + pcb->rcv_wnd));
                   }
+                  tcp_oos_rb_insert(pcb, next->next, next);
                 }
                 break;
               }
@@ -1819,12 +2696,26 @@ tcp_receive(struct tcp_pcb *pcb)
               if (prev->tcphdr->seqno + prev->len != next->tcphdr->seqno) {
                 sackbeg = next->tcphdr->seqno;
               }
+#if TCP_OOSEQ_RBTREE
+              else {
+                /* the walk above started at prev */
+                sackbeg = tcp_oos_run_start(pcb, prev);
+              }
+#endif /* TCP_OOSEQ_RBTREE */
             } else {
               next = NULL;
             }
             if (next != NULL) {
               u32_t sackend = next->tcphdr->seqno;
               for ( ; (next != NULL) && (sackend == next->tcphdr->seqno); next = next->next) {
+#if TCP_OOSEQ_RBTREE
+                int i = tcp_oos_sack_find(pcb, sackend);
+                if (i >= 0) {
+                  /* the rest of the run was reported already */
+                  sackend = pcb->rcv_sacks[i].right;
+                  break;
+                }
+#endif /* TCP_OOSEQ_RBTREE */
                 sackend += next->len;
               }
               tcp_add_sack(pcb, sackbeg, sackend);
@@ -1832,7 +2723,25 @@ tcp_receive(struct tcp_pcb *pcb)
           }
 #endif /* LWIP_TCP_SACK_OUT */
         }
-#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
+#if (defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)) && TCP_OOSEQ_RBTREE
+        /* Throw away segments from the end of ooseq while one of the limits
+           is exceeded (the tree keeps the totals). */
+        while ((pcb->ooseq_tail != NULL) && tcp_oos_over_limit(pcb)) {
+          struct tcp_seg *last = pcb->ooseq_tail;
+          tcp_oos_rb_remove(pcb, last);
+          if (pcb->ooseq_tail == NULL) {
+            pcb->ooseq = NULL;
+          } else {
+            pcb->ooseq_tail->next = NULL;
+          }
+#if LWIP_TCP_SACK_OUT
+          if (pcb->flags & TF_SACK) {
+            tcp_remove_sacks_gt(pcb, last->tcphdr->seqno);
+          }
+#endif /* LWIP_TCP_SACK_OUT */
+          tcp_seg_free(last);
+        }
+#elif defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
         {
           /* Check that the data on ooseq doesn't exceed one of the limits
              and throw away everything above that limit. */
@@ -1913,6 +2822,19 @@ tcp_get_next_optbyte(void)
   }
 }
 
+#if LWIP_TCP_SACK_IN
+static u32_t
+tcp_get_next_optword(void)
+{
+  u32_t word;
+  word = (u32_t)tcp_get_next_optbyte() << 24;
+  word |= (u32_t)tcp_get_next_optbyte() << 16;
+  word |= (u32_t)tcp_get_next_optbyte() << 8;
+  word |= tcp_get_next_optbyte();
+  return word;
+}
+#endif /* LWIP_TCP_SACK_IN */
+
 /**
  * Parses the options contained in the incoming segment.
  *
@@ -1929,6 +2851,16 @@ tcp_parseopt(struct tcp_pcb *pcb)
 #if LWIP_TCP_TIMESTAMPS
   u32_t tsval;
 #endif
+#if LWIP_TCP_SACK_IN || LWIP_TCP_FASTOPEN
+  u8_t i;
+#endif
+
+#if LWIP_TCP_SACK_IN
+  tcp_in_num_sacks = 0;
+#endif
+#if LWIP_TCP_FASTOPEN
+  tcp_in_fastopen_len = TCP_FASTOPEN_NO_OPT;
+#endif
 
   LWIP_ASSERT("tcp_parseopt: invalid pcb", pcb != NULL);
 
@@ -2024,6 +2956,48 @@ tcp_parseopt(struct tcp_pcb *pcb)
           }
           break;
 #endif /* LWIP_TCP_SACK_OUT */
+#if LWIP_TCP_SACK_IN
+        case LWIP_TCP_OPT_SACK:
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+          data = tcp_get_next_optbyte();
+          if ((data < 10) || (((data - 2) & 7) != 0) || (tcp_optidx - 2 + data) > tcphdr_optlen) {
+            /* Bad length */
+            LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+            return;
+          }
+          /* TCP SACK option with valid length: store the blocks for tcp_receive() */
+          for (i = 0; i < (data - 2) / 8; i++) {
+            u32_t left = tcp_get_next_optword();
+            u32_t right = tcp_get_next_optword();
+            if (tcp_in_num_sacks < LWIP_TCP_SACK_IN_MAX_BLOCKS) {
+              tcp_in_sacks[tcp_in_num_sacks].left = left;
+              tcp_in_sacks[tcp_in_num_sacks].right = right;
+              tcp_in_num_sacks++;
+            }
+          }
+          break;
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_FASTOPEN
+        case LWIP_TCP_OPT_FASTOPEN:
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: FASTOPEN\n"));
+          data = tcp_get_next_optbyte();
+          if ((data < 2) || (tcp_optidx - 2 + data) > tcphdr_optlen) {
+            /* Bad length */
+            LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+            return;
+          }
+          data = (u8_t)(data - 2);
+          if ((data == 0) || ((data >= TCP_FASTOPEN_COOKIE_MIN) && (data <= TCP_FASTOPEN_COOKIE_MAX))) {
+            /* cookie request or cookie of valid length: store it for the SYN handling */
+            for (i = 0; i < data; i++) {
+              tcp_in_fastopen_cookie[i] = tcp_get_next_optbyte();
+            }
+            tcp_in_fastopen_len = data;
+          } else {
+            tcp_optidx += data;
+          }
+          break;
+#endif /* LWIP_TCP_FASTOPEN */
         default:
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: other\n"));
           data = tcp_get_next_optbyte();
@@ -2191,4 +3165,220 @@ tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq)
 
 #endif /* LWIP_TCP_SACK_OUT */
 
+#if LWIP_TCP_SACK_IN
+/**
+ * Marks the segments on the unacked queue that are covered by the SACK blocks
+ * of the received segment (the scoreboard of RFC 6675).
+ * Only whole segments are marked, partially SACKed segments stay unmarked.
+ *
+ * @param pcb the tcp_pcb for which the segment arrived
+ */
+static void
+tcp_sack_update_scoreboard(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  u32_t left, right, seg_seqno;
+  u8_t i;
+
+  for (i = 0; i < tcp_in_num_sacks; i++) {
+    left = tcp_in_sacks[i].left;
+    right = tcp_in_sacks[i].right;
+    /* Ignore D-SACKs (RFC 2883) and blocks not covering data in flight */
+    if (!TCP_SEQ_LT(left, right) || TCP_SEQ_LT(left, ackno) ||
+        TCP_SEQ_LEQ(left, pcb->lastack) || TCP_SEQ_GT(right, pcb->snd_nxt)) {
+      LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_update_scoreboard: ignoring block %"U32_F":%"U32_F"\n", left, right));
+      continue;
+    }
+    for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+      seg_seqno = lwip_ntohl(seg->tcphdr->seqno);
+      if (TCP_SEQ_GEQ(seg_seqno, right)) {
+        break;
+      }
+      if (TCP_SEQ_GEQ(seg_seqno, left) && TCP_SEQ_LEQ(seg_seqno + TCP_TCPLEN(seg), right)) {
+        seg->flags |= TF_SEG_SACKED;
+      }
+    }
+  }
+}
+#endif /* LWIP_TCP_SACK_IN */
+
+#if LWIP_TCP_GRO
+/** A connection tcp_gro_input() holds back segments for */
+struct tcp_gro_flow {
+  /** the merged segment (payload at the TCP header), NULL if unused */
+  struct pbuf *p;
+  /** ip_data of the first segment, restored for tcp_input() */
+  struct ip_globals ip;
+  /** sequence number the next segment must start with */
+  u32_t next_seqno;
+  /** number of segments merged */
+  u16_t segs;
+};
+static struct tcp_gro_flow tcp_gro_flows[TCP_GRO_FLOWS];
+static u8_t tcp_gro_next_evict;
+
+/** Pass the merged segment of a flow on to tcp_input() */
+static void
+tcp_gro_deliver(struct tcp_gro_flow *flow)
+{
+  struct ip_globals current;
+  struct pbuf *p = flow->p;
+
+  flow->p = NULL;
+  SMEMCPY(&current, &ip_data, sizeof(current));
+  SMEMCPY(&ip_data, &flow->ip, sizeof(ip_data));
+  tcp_input(p, ip_current_input_netif());
+  SMEMCPY(&ip_data, &current, sizeof(ip_data));
+}
+
+/**
+ * Check if a segment may be held back and merged: an ACK with data (and
+ * maybe PSH) but no other flags, header in the first pbuf, valid checksum.
+ * Everything else goes to tcp_input() right away, which drops it or treats
+ * it as usual.
+ *
+ * @return the TCP header length or 0 if p may not be merged
+ */
+static u16_t
+tcp_gro_mergeable(struct pbuf *p, struct netif *inp)
+{
+  struct tcp_hdr *hdr = (struct tcp_hdr *)p->payload;
+  u16_t hdrlen;
+
+  LWIP_UNUSED_ARG(inp);
+  if (p->len < TCP_HLEN) {
+    return 0;
+  }
+  hdrlen = TCPH_HDRLEN_BYTES(hdr);
+  if ((hdrlen < TCP_HLEN) || (p->len < hdrlen) || (p->tot_len == hdrlen) ||
+      ((TCPH_FLAGS(hdr) & ~TCP_PSH) != TCP_ACK) ||
+      ip_addr_isbroadcast(ip_current_dest_addr(), ip_current_netif()) ||
+      ip_addr_ismulticast(ip_current_dest_addr())) {
+    return 0;
+  }
+#if CHECKSUM_CHECK_TCP
+  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
+    if (ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
+                         ip_current_src_addr(), ip_current_dest_addr()) != 0) {
+      return 0;
+    }
+  }
+#endif /* CHECKSUM_CHECK_TCP */
+  return hdrlen;
+}
+
+/**
+ * Called by IP instead of tcp_input() if LWIP_TCP_GRO is enabled.
+ * In-order data segments of a connection are appended (pbuf_cat) to the
+ * one held back for it, keeping the header of the first segment with the
+ * window and PSH flag of the last one. The merged segment is passed on
+ * when a segment does not fit (out of order, other flags, options or ACK
+ * number, shorter than the first one), after PSH, after TCP_GRO_MAX_SEGS
+ * segments or 64 KByte, and by tcp_gro_flush() at the end of the batch.
+ * pbuf->gso_size tells tcp_input() the segment size, so it can count the
+ * merged segments for the delayed ACK.
+ *
+ * @param p received IP packet, payload pointing to the TCP header
+ * @param inp network interface on which the packet was received
+ */
+void
+tcp_gro_input(struct pbuf *p, struct netif *inp)
+{
+  struct tcp_gro_flow *flow, *free_flow = NULL;
+  struct tcp_hdr *hdr, *fhdr;
+  u16_t hdrlen, len;
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("tcp_gro_input: invalid pbuf", p != NULL);
+
+  hdrlen = tcp_gro_mergeable(p, inp);
+  if ((hdrlen == 0) && (p->len < TCP_HLEN)) {
+    tcp_input(p, inp);
+    return;
+  }
+  hdr = (struct tcp_hdr *)p->payload;
+  len = (u16_t)(p->tot_len - hdrlen);
+
+  for (i = 0; i < TCP_GRO_FLOWS; i++) {
+    flow = &tcp_gro_flows[i];
+    if (flow->p == NULL) {
+      if (free_flow == NULL) {
+        free_flow = flow;
+      }
+      continue;
+    }
+    fhdr = (struct tcp_hdr *)flow->p->payload;
+    if ((hdr->src != fhdr->src) || (hdr->dest != fhdr->dest) ||
+        !ip_addr_cmp(ip_current_src_addr(), &flow->ip.current_iphdr_src) ||
+        !ip_addr_cmp(ip_current_dest_addr(), &flow->ip.current_iphdr_dest)) {
+      continue;
+    }
+    if ((hdrlen != 0) && (inp == flow->ip.current_input_netif) &&
+        (lwip_ntohl(hdr->seqno) == flow->next_seqno) && (hdr->ackno == fhdr->ackno) &&
+        (hdrlen == TCPH_HDRLEN_BYTES(fhdr)) &&
+        (memcmp(hdr + 1, fhdr + 1, hdrlen - TCP_HLEN) == 0) &&
+        (len <= flow->p->gso_size) && ((u32_t)flow->p->tot_len + len <= 0xffffU)) {
+      fhdr->wnd = hdr->wnd;
+      TCPH_SET_FLAG(fhdr, TCPH_FLAGS(hdr) & TCP_PSH);
+      pbuf_remove_header(p, hdrlen);
+      pbuf_cat(flow->p, p);
+      flow->next_seqno += len;
+      flow->segs++;
+      /* tcp_input() counts the merged segment once */
+      TCP_STATS_INC(tcp.recv);
+      MIB2_STATS_INC(mib2.tcpinsegs);
+      if ((TCPH_FLAGS(fhdr) & TCP_PSH) || (len < flow->p->gso_size) ||
+          (flow->segs >= TCP_GRO_MAX_SEGS)) {
+        tcp_gro_deliver(flow);
+      }
+      return;
+    }
+    /* keep the order of the connection's segments */
+    tcp_gro_deliver(flow);
+    free_flow = flow;
+    break;
+  }
+
+  if ((hdrlen == 0) || (TCPH_FLAGS(hdr) & TCP_PSH)) {
+    tcp_input(p, inp);
+    return;
+  }
+  if (free_flow == NULL) {
+    free_flow = &tcp_gro_flows[tcp_gro_next_evict];
+    tcp_gro_next_evict = (u8_t)((tcp_gro_next_evict + 1) % TCP_GRO_FLOWS);
+    tcp_gro_deliver(free_flow);
+  }
+  SMEMCPY(&free_flow->ip, &ip_data, sizeof(ip_data));
+  free_flow->p = p;
+  free_flow->next_seqno = lwip_ntohl(hdr->seqno) + len;
+  free_flow->segs = 1;
+  p->gso_size = len;
+}
+
+/**
+ * @ingroup tcp_raw
+ * End of a receive batch for LWIP_TCP_GRO: pass all segments held back for
+ * netif (NULL: for all netifs) on to TCP. The tcpip thread calls this when
+ * its mailbox runs empty, the TCP timer every TCP_TMR_INTERVAL; NO_SYS
+ * drivers (and those using LWIP_TCPIP_CORE_LOCKING_INPUT) should call it
+ * after passing a batch of received packets to netif->input.
+ *
+ * @param netif the netif that received the batch, NULL for all
+ */
+void
+tcp_gro_flush(struct netif *netif)
+{
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  for (i = 0; i < TCP_GRO_FLOWS; i++) {
+    if ((tcp_gro_flows[i].p != NULL) &&
+        ((netif == NULL) || (tcp_gro_flows[i].ip.current_input_netif == netif))) {
+      tcp_gro_deliver(&tcp_gro_flows[i]);
+    }
+  }
+}
+#endif /* LWIP_TCP_GRO */
+
 #endif /* LWIP_TCP */
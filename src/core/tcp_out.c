@@ -74,9 +74,12 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
-#if LWIP_TCP_TIMESTAMPS
+#if LWIP_TCP_TIMESTAMPS || LWIP_TCP_PACING
 #include "lwip/sys.h"
 #endif
+#if LWIP_TCP_PACING
+#include "lwip/timeouts.h"
+#endif
 
 #include <string.h>
 
@@ -84,11 +87,19 @@
 #include LWIP_HOOK_FILENAME
 #endif
 
+#if LWIP_TCP_FASTOPEN
+/* The fast open option is sent in SYN segments (the ones with the MSS option) */
+#define LWIP_TCP_OPT_LENGTH_PCB(flags, pcb) \
+  (LWIP_TCP_OPT_LENGTH(flags) + (((flags) & TF_SEG_OPTS_MSS) ? (pcb)->fastopen_optlen : 0))
+#else /* LWIP_TCP_FASTOPEN */
+#define LWIP_TCP_OPT_LENGTH_PCB(flags, pcb) LWIP_TCP_OPT_LENGTH(flags)
+#endif /* LWIP_TCP_FASTOPEN */
+
 /* Allow to add custom TCP header options by defining this hook */
 #ifdef LWIP_HOOK_TCP_OUT_TCPOPT_LENGTH
-#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) LWIP_HOOK_TCP_OUT_TCPOPT_LENGTH(pcb, LWIP_TCP_OPT_LENGTH(flags))
+#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) LWIP_HOOK_TCP_OUT_TCPOPT_LENGTH(pcb, LWIP_TCP_OPT_LENGTH_PCB(flags, pcb))
 #else
-#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) LWIP_TCP_OPT_LENGTH(flags)
+#define LWIP_TCP_OPT_LENGTH_SEGMENT(flags, pcb) LWIP_TCP_OPT_LENGTH_PCB(flags, pcb)
 #endif
 
 /* Define some copy-macros for checksum-on-copy so that the code looks
@@ -126,9 +137,21 @@
 
 /* Forward declarations.*/
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif);
+#if LWIP_TCP_GSO
+static err_t tcp_output_gso(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif, u32_t wnd, u16_t *nsegs);
+#endif /* LWIP_TCP_GSO */
 static err_t tcp_output_control_segment_netif(const struct tcp_pcb *pcb, struct pbuf *p,
                                               const ip_addr_t *src, const ip_addr_t *dst,
                                               struct netif *netif);
+#if LWIP_TCP_SACK_IN
+static u32_t tcp_sack_rexmit_lost(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_PACING
+static void tcp_pace_timeout(void *arg);
+#endif /* LWIP_TCP_PACING */
+#if LWIP_TCP_TIMER_WHEEL
+static err_t tcp_output_pcb(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
 /* tcp_route: common code that returns a fixed bound netif or calls ip_route */
 static struct netif *
@@ -305,7 +328,7 @@ tcp_seg_add_chksum(u16_t chksum, u16_t len, u16_t *seg_chksum,
  * @return ERR_OK if tcp_write is allowed to proceed, another err_t otherwise
  */
 static err_t
-tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
+tcp_write_checks(struct tcp_pcb *pcb, size_t len)
 {
   LWIP_ASSERT("tcp_write_checks: invalid pcb", pcb != NULL);
 
@@ -322,7 +345,7 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
 
   /* fail on too much data */
   if (len > pcb->snd_buf) {
-    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"TCPWNDSIZE_F")\n",
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("tcp_write: too much data (len=%"SZT_F" > snd_buf=%"TCPWNDSIZE_F")\n",
                 len, pcb->snd_buf));
     tcp_set_flags(pcb, TF_NAGLEMEMERR);
     return ERR_MEM;
@@ -391,16 +414,43 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
  */
 err_t
 tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+{
+  return tcp_write_ext(pcb, arg, len, apiflags, NULL);
+}
+
+/**
+ * @ingroup tcp_raw
+ * Like @ref tcp_write, but 'len' is not limited to 16 bits: with window
+ * scaling, a large buffer can be enqueued with one call (see also
+ * @ref tcp_sndbuf_ext).
+ *
+ * If 'written' is NULL, the data is enqueued completely or not at all, just
+ * like tcp_write() does. Otherwise, as much data as fits into the send buffer,
+ * the queue length limit and the available memory is enqueued and the number
+ * of bytes enqueued is returned in 'written'. ERR_MEM is returned if nothing could be enqueued.
+ * The PSH flag is only set if all data was enqueued.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param arg Pointer to the data to be enqueued for sending.
+ * @param len Data length in bytes
+ * @param apiflags combination of TCP_WRITE_FLAG_COPY and TCP_WRITE_FLAG_MORE (see tcp_write)
+ * @param written if != NULL, enqueue a part of the data if not all of it fits
+ *                and return the number of bytes enqueued here
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write_ext(struct tcp_pcb *pcb, const void *arg, size_t len, u8_t apiflags, size_t *written)
 {
   struct pbuf *concat_p = NULL;
   struct tcp_seg *last_unsent = NULL, *seg = NULL, *prev_seg = NULL, *queue = NULL;
-  u16_t pos = 0; /* position in 'arg' data */
+  size_t pos = 0; /* position in 'arg' data */
   u16_t queuelen;
   u8_t optlen;
   u8_t optflags = 0;
 #if TCP_OVERSIZE
   u16_t oversize = 0;
   u16_t oversize_used = 0;
+  u16_t oversize_queued;
 #if TCP_OVERSIZE_DBGCHECK
   u16_t oversize_add = 0;
 #endif /* TCP_OVERSIZE_DBGCHECK*/
@@ -427,11 +477,18 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
   apiflags |= TCP_WRITE_FLAG_COPY;
 #endif /* LWIP_NETIF_TX_SINGLE_PBUF */
 
-  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_write(pcb=%p, data=%p, len=%"U16_F", apiflags=%"U16_F")\n",
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_write(pcb=%p, data=%p, len=%"SZT_F", apiflags=%"U16_F")\n",
                                  (void *)pcb, arg, len, (u16_t)apiflags));
   LWIP_ERROR("tcp_write: arg == NULL (programmer violates API)",
              arg != NULL, return ERR_ARG;);
 
+  if (written != NULL) {
+    *written = 0;
+    if ((len > pcb->snd_buf) && (pcb->snd_buf > 0)) {
+      len = pcb->snd_buf;
+      apiflags |= TCP_WRITE_FLAG_MORE;
+    }
+  }
   err = tcp_write_checks(pcb, len);
   if (err != ERR_OK) {
     return err;
@@ -506,7 +563,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
     if (oversize > 0) {
       LWIP_ASSERT("inconsistent oversize vs. space", oversize <= space);
       seg = last_unsent;
-      oversize_used = LWIP_MIN(space, LWIP_MIN(oversize, len));
+      oversize_used = (u16_t)LWIP_MIN(LWIP_MIN(space, oversize), len);
       pos += oversize_used;
       oversize -= oversize_used;
       space -= oversize_used;
@@ -532,7 +589,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
      * oversize info is lost.
      */
     if ((pos < len) && (space > 0) && (last_unsent->len > 0)) {
-      u16_t seglen = LWIP_MIN(space, len - pos);
+      u16_t seglen = (u16_t)LWIP_MIN(space, len - pos);
       seg = last_unsent;
 
       /* Create a pbuf with a copy or reference to seglen bytes. We
@@ -597,11 +654,14 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
    * The new segments are chained together in the local 'queue'
    * variable, ready to be appended to pcb->unsent.
    */
+#if TCP_OVERSIZE
+  oversize_queued = oversize;
+#endif /* TCP_OVERSIZE */
   while (pos < len) {
     struct pbuf *p;
-    u16_t left = len - pos;
+    u16_t clen;
     u16_t max_len = mss_local - optlen;
-    u16_t seglen = LWIP_MIN(left, max_len);
+    u16_t seglen = (u16_t)LWIP_MIN(len - pos, max_len);
 #if TCP_CHECKSUM_ON_COPY
     u16_t chksum = 0;
     u8_t chksum_swapped = 0;
@@ -612,7 +672,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
        * into pbuf */
       if ((p = tcp_pbuf_prealloc(PBUF_TRANSPORT, seglen + optlen, mss_local, &oversize, pcb, apiflags, queue == NULL)) == NULL) {
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write : could not allocate memory for pbuf copy size %"U16_F"\n", seglen));
-        goto memerr;
+        break;
       }
       LWIP_ASSERT("tcp_write: check that first pbuf can hold the complete seglen",
                   (p->len >= seglen));
@@ -629,7 +689,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
 #endif /* TCP_OVERSIZE */
       if ((p2 = pbuf_alloc(PBUF_TRANSPORT, seglen, PBUF_ROM)) == NULL) {
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
-        goto memerr;
+        break;
       }
 #if TCP_CHECKSUM_ON_COPY
       /* calculate the checksum of nocopy-data */
@@ -648,27 +708,28 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
          * well. */
         pbuf_free(p2);
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write: could not allocate memory for header pbuf\n"));
-        goto memerr;
+        break;
       }
       /* Concatenate the headers and data pbufs together. */
       pbuf_cat(p/*header*/, p2/*data*/);
     }
 
-    queuelen += pbuf_clen(p);
+    clen = pbuf_clen(p);
 
     /* Now that there are more segments queued, we check again if the
      * length of the queue exceeds the configured maximum or
      * overflows. */
-    if (queuelen > LWIP_MIN(TCP_SND_QUEUELEN, TCP_SNDQUEUELEN_OVERFLOW)) {
+    if (queuelen + clen > LWIP_MIN(TCP_SND_QUEUELEN, TCP_SNDQUEUELEN_OVERFLOW)) {
       LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write: queue too long %"U16_F" (%d)\n",
-                  queuelen, (int)TCP_SND_QUEUELEN));
+                  (u16_t)(queuelen + clen), (int)TCP_SND_QUEUELEN));
       pbuf_free(p);
-      goto memerr;
+      break;
     }
 
-    if ((seg = tcp_create_segment(pcb, p, 0, pcb->snd_lbb + pos, optflags)) == NULL) {
-      goto memerr;
+    if ((seg = tcp_create_segment(pcb, p, 0, pcb->snd_lbb + (u32_t)pos, optflags)) == NULL) {
+      break;
     }
+    queuelen = (u16_t)(queuelen + clen);
 #if TCP_OVERSIZE_DBGCHECK
     seg->oversize_left = oversize;
 #endif /* TCP_OVERSIZE_DBGCHECK */
@@ -694,6 +755,21 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
                 lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg)));
 
     pos += seglen;
+#if TCP_OVERSIZE
+    oversize_queued = oversize;
+#endif /* TCP_OVERSIZE */
+  }
+
+  if (pos < len) {
+    /* Phase 3 ran out of memory: a partial write enqueues what is done */
+    if ((written == NULL) || (pos == 0)) {
+      goto memerr;
+    }
+    len = pos;
+    apiflags |= TCP_WRITE_FLAG_MORE;
+#if TCP_OVERSIZE
+    oversize = oversize_queued;
+#endif /* TCP_OVERSIZE */
   }
 
   /*
@@ -779,9 +855,12 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
   /*
    * Finally update the pcb state.
    */
-  pcb->snd_lbb += len;
-  pcb->snd_buf -= len;
+  pcb->snd_lbb += (u32_t)len;
+  pcb->snd_buf = (tcpwnd_size_t)(pcb->snd_buf - len);
   pcb->snd_queuelen = queuelen;
+  if (written != NULL) {
+    *written = len;
+  }
 
   LWIP_DEBUGF(TCP_QLEN_DEBUG, ("tcp_write: %"S16_F" (after enqueued)\n",
                                pcb->snd_queuelen));
@@ -795,9 +874,12 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
     TCPH_SET_FLAG(seg->tcphdr, TCP_PSH);
   }
 
+  /* tcp_slowtmr has to poll this pcb until the data is sent */
+  tcp_timer_update(pcb);
   return ERR_OK;
 memerr:
   tcp_set_flags(pcb, TF_NAGLEMEMERR);
+  tcp_timer_update(pcb);
   TCP_STATS_INC(tcp.memerr);
 
   if (concat_p != NULL) {
@@ -1229,6 +1311,348 @@ tcp_build_wnd_scale_option(u32_t *opts)
 }
 #endif
 
+#if LWIP_TCP_FASTOPEN
+/** Build a fast open option (pcb->fastopen_optlen bytes long) at the
+ * specified options pointer: our cookie for the client in a SYN|ACK, the
+ * cookie of the server (or a cookie request) in a SYN.
+ *
+ * @param pcb tcp_pcb
+ * @param opts option pointer where to store the fast open option
+ * @return pointer behind the option
+ */
+static u32_t *
+tcp_build_fastopen_option(const struct tcp_pcb *pcb, u32_t *opts)
+{
+  u8_t cookie[TCP_FASTOPEN_COOKIE_MAX];
+  u8_t *opt = (u8_t *)opts;
+  u8_t len;
+
+  if (pcb->state == SYN_SENT) {
+    len = tcp_fastopen_cache_get(&pcb->remote_ip, cookie);
+    if (TCP_FASTOPEN_OPT_LEN(len) > pcb->fastopen_optlen) {
+      /* the cache changed since tcp_connect(): ask for a new cookie */
+      len = 0;
+    }
+  } else {
+    tcp_fastopen_cookie(&pcb->remote_ip, cookie);
+    len = TCP_FASTOPEN_COOKIE_LEN;
+  }
+  /* Pad with NOP options in front to make everything nicely aligned */
+  memset(opt, LWIP_TCP_OPT_NOP, (size_t)(pcb->fastopen_optlen - 2 - len));
+  opt += pcb->fastopen_optlen - 2 - len;
+  opt[0] = LWIP_TCP_OPT_FASTOPEN;
+  opt[1] = (u8_t)(2 + len);
+  MEMCPY(opt + 2, cookie, len);
+  return opts + pcb->fastopen_optlen / 4;
+}
+
+#endif /* LWIP_TCP_FASTOPEN */
+
+/** Build the options of a segment sent by tcp_output() (or of a SYN|ACK sent
+ * without a pcb on the lists) at the specified options pointer.
+ *
+ * @param pcb tcp_pcb
+ * @param opts option pointer where to store the options
+ * @param optflags TF_SEG_OPTS_* flags of the options to build
+ * @param netif the netif used to send the segment
+ * @return pointer behind the options
+ */
+static u32_t *
+tcp_build_options(const struct tcp_pcb *pcb, u32_t *opts, u8_t optflags, struct netif *netif)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(netif); /* only used with TCP_CALCULATE_EFF_SEND_MSS */
+
+  /* NB MSS option is only set on SYN packets */
+  if (optflags & TF_SEG_OPTS_MSS) {
+    u16_t mss;
+#if TCP_CALCULATE_EFF_SEND_MSS
+    mss = tcp_eff_send_mss_netif(TCP_MSS, netif, &pcb->remote_ip);
+#else /* TCP_CALCULATE_EFF_SEND_MSS */
+    mss = TCP_MSS;
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+    *opts = TCP_BUILD_MSS_OPTION(mss);
+    opts += 1;
+  }
+#if LWIP_TCP_TIMESTAMPS
+  if (optflags & TF_SEG_OPTS_TS) {
+    tcp_build_timestamp_option(pcb, opts);
+    opts += 3;
+  }
+#endif
+#if LWIP_WND_SCALE
+  if (optflags & TF_SEG_OPTS_WND_SCALE) {
+    tcp_build_wnd_scale_option(opts);
+    opts += 1;
+  }
+#endif
+#if LWIP_TCP_SACK_OUT
+  if (optflags & TF_SEG_OPTS_SACK_PERM) {
+    /* Pad with two NOP options to make everything nicely aligned
+     * NOTE: When we send both timestamp and SACK_PERM options,
+     * we could use the first two NOPs before the timestamp to store SACK_PERM option,
+     * but that would complicate the code.
+     */
+    *(opts++) = PP_HTONL(0x01010402);
+  }
+#endif
+#if LWIP_TCP_FASTOPEN
+  if ((optflags & TF_SEG_OPTS_MSS) && (pcb->fastopen_optlen != 0)) {
+    opts = tcp_build_fastopen_option(pcb, opts);
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+  return opts;
+}
+
+#if LWIP_TCP_FASTOPEN
+/**
+ * Replace the SYN held back by tcp_connect() and the first data segment
+ * queued after it by one segment carrying both (RFC 7413). Until the SYN is
+ * acknowledged, nothing else is sent. If there is no data (or no memory),
+ * the SYN is sent alone.
+ *
+ * @param pcb the tcp_pcb in SYN_SENT
+ */
+static void
+tcp_output_fastopen(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *syn = pcb->unsent;
+  struct tcp_seg *data, *seg;
+  struct pbuf *p;
+  u16_t optlen, off;
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum = 0;
+  u8_t chksum_swapped = 0;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+  pcb->fastopen = (u8_t)(pcb->fastopen & ~TCP_FASTOPEN_SYN_DATA);
+  if ((syn == NULL) || (pcb->unacked != NULL) || (syn->len != 0) ||
+      !(TCPH_FLAGS(syn->tcphdr) & TCP_SYN)) {
+    return;
+  }
+  data = syn->next;
+  if ((data == NULL) || (data->len == 0) ||
+      (TCPH_FLAGS(data->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST))) {
+    return;
+  }
+  optlen = (u16_t)(TCPH_HDRLEN_BYTES(syn->tcphdr) - TCP_HLEN);
+  p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(optlen + data->len), PBUF_RAM);
+  if (p == NULL) {
+    return;
+  }
+  off = (u16_t)((u8_t *)data->tcphdr - (u8_t *)data->p->payload + TCPH_HDRLEN_BYTES(data->tcphdr));
+  if (pbuf_copy_partial(data->p, (u8_t *)p->payload + optlen, data->len, off) != data->len) {
+    pbuf_free(p);
+    return;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  tcp_seg_add_chksum(~inet_chksum((const u8_t *)p->payload + optlen, data->len), data->len,
+                     &chksum, &chksum_swapped);
+#endif /* TCP_CHECKSUM_ON_COPY */
+  seg = tcp_create_segment(pcb, p, (u8_t)(TCP_SYN | (TCPH_FLAGS(data->tcphdr) & TCP_PSH)),
+                           lwip_ntohl(syn->tcphdr->seqno), syn->flags);
+  if (seg == NULL) {
+    return;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  seg->chksum = chksum;
+  seg->chksum_swapped = chksum_swapped;
+  seg->flags |= TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+  seg->next = data->next;
+  pcb->unsent = seg;
+  pcb->snd_queuelen = (u16_t)(pcb->snd_queuelen + pbuf_clen(seg->p) - pbuf_clen(syn->p) - pbuf_clen(data->p));
+#if TCP_OVERSIZE
+  if (seg->next == NULL) {
+    /* the new unsent tail has no space */
+    pcb->unsent_oversize = 0;
+  }
+#endif /* TCP_OVERSIZE */
+  tcp_seg_free(syn);
+  tcp_seg_free(data);
+  /* only the SYN may be sent before the handshake is complete */
+  pcb->cwnd = seg->len;
+}
+
+/**
+ * Called by tcp_process() when a SYN|ACK acknowledges the SYN of a fast open
+ * connection but not all data sent with it: the rest is put in front of
+ * pcb->unsent to be sent again without SYN.
+ *
+ * @param pcb the tcp_pcb that is established now
+ * @param seg the SYN segment (taken off the queues, freed by the caller)
+ * @param acked number of data bytes in seg that were acknowledged
+ * @return ERR_OK or ERR_MEM if the data could not be queued
+ */
+err_t
+tcp_fastopen_rexmit(struct tcp_pcb *pcb, const struct tcp_seg *seg, u16_t acked)
+{
+  struct tcp_seg *rest;
+  struct pbuf *p;
+  u16_t len, off;
+  u8_t optflags = 0;
+  u8_t optlen;
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum = 0;
+  u8_t chksum_swapped = 0;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+  LWIP_ASSERT("tcp_fastopen_rexmit: nothing to send", acked < seg->len);
+
+#if LWIP_TCP_TIMESTAMPS
+  if (pcb->flags & TF_TIMESTAMP) {
+    optflags = TF_SEG_OPTS_TS;
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+  optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(optflags, pcb);
+  len = (u16_t)(seg->len - acked);
+  p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(optlen + len), PBUF_RAM);
+  if (p == NULL) {
+    return ERR_MEM;
+  }
+  off = (u16_t)((u8_t *)seg->tcphdr - (u8_t *)seg->p->payload + TCPH_HDRLEN_BYTES(seg->tcphdr) + acked);
+  if (pbuf_copy_partial(seg->p, (u8_t *)p->payload + optlen, len, off) != len) {
+    pbuf_free(p);
+    return ERR_MEM;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  tcp_seg_add_chksum(~inet_chksum((const u8_t *)p->payload + optlen, len), len,
+                     &chksum, &chksum_swapped);
+#endif /* TCP_CHECKSUM_ON_COPY */
+  rest = tcp_create_segment(pcb, p, TCP_PSH, lwip_ntohl(seg->tcphdr->seqno) + 1 + acked, optflags);
+  if (rest == NULL) {
+    return ERR_MEM;
+  }
+#if TCP_CHECKSUM_ON_COPY
+  rest->chksum = chksum;
+  rest->chksum_swapped = chksum_swapped;
+  rest->flags |= TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+  rest->next = pcb->unsent;
+  pcb->unsent = rest;
+  pcb->snd_queuelen = (u16_t)(pcb->snd_queuelen + pbuf_clen(rest->p));
+  pcb->snd_nxt = lwip_ntohl(rest->tcphdr->seqno);
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_FASTOPEN */
+
+#if LWIP_TCP_PACING
+/** Upper bound of the pacing rate in bytes per millisecond: keeps the credit
+ * arithmetic in 32 bits (faster than this is the same as not pacing) */
+#define TCP_PACING_RATE_MAX 0x1000000UL
+
+/**
+ * @ingroup tcp_raw
+ * Enable or disable pacing for a pcb. With pacing, tcp_output() sends at most
+ * TCP_PACING_BURST segments back to back and spreads the rest of the window
+ * over time at a rate of 2*cwnd/RTT in slow start and 1.2*cwnd/RTT after it.
+ * Until an RTT has been measured, only the limit applies.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param max_rate 0 to disable pacing, TCP_PACING_RATE_AUTO to pace at the
+ *        rate derived from cwnd and RTT or a limit in bytes per second
+ */
+void
+tcp_set_pacing_rate(struct tcp_pcb *pcb, u32_t max_rate)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_set_pacing_rate: invalid pcb", pcb != NULL, return);
+  LWIP_ERROR("tcp_set_pacing_rate: invalid state", pcb->state != LISTEN, return);
+
+  if ((pcb->pace.max_rate == 0) && (max_rate != 0)) {
+    /* start with a full burst */
+    pcb->pace.stamp = sys_now();
+    pcb->pace.credit = (s32_t)(TCP_PACING_BURST * (u32_t)pcb->mss);
+  }
+  pcb->pace.max_rate = max_rate;
+  if ((max_rate == 0) && (pcb->flags & TF_PACE_TIMER)) {
+    tcp_pace_stop(pcb);
+    tcp_output(pcb);
+  }
+}
+
+/** Cancel a pending tcp_pace_timeout (called before a pcb is freed) */
+void
+tcp_pace_stop(struct tcp_pcb *pcb)
+{
+  if (pcb->flags & TF_PACE_TIMER) {
+    sys_untimeout(tcp_pace_timeout, pcb);
+    tcp_clear_flags(pcb, TF_PACE_TIMER);
+  }
+}
+
+/** sys_timeout handler: the pacing delay of a pcb has passed */
+static void
+tcp_pace_timeout(void *arg)
+{
+  struct tcp_pcb *pcb = (struct tcp_pcb *)arg;
+
+  tcp_clear_flags(pcb, TF_PACE_TIMER);
+  tcp_output(pcb);
+}
+
+/** Current pacing rate of a pcb in bytes per millisecond, 0 if not paced */
+static u32_t
+tcp_pace_rate(const struct tcp_pcb *pcb)
+{
+  u32_t rate = 0;
+
+  if (pcb->pace.max_rate == 0) {
+    return 0;
+  }
+  if (pcb->pace.srtt != 0) {
+    u32_t wnd = pcb->cwnd;
+    u32_t srtt = LWIP_MAX((pcb->pace.srtt + 4) >> 3, 1);
+    /* like Linux: leave room for cwnd to grow within the next RTT */
+    wnd = (pcb->cwnd < pcb->ssthresh) ? (wnd << 1) : (wnd + wnd / 5);
+    rate = LWIP_MAX(wnd / srtt, 1);
+  }
+  if (pcb->pace.max_rate != TCP_PACING_RATE_AUTO) {
+    u32_t max = LWIP_MAX(pcb->pace.max_rate / 1000, 1);
+    if ((rate == 0) || (rate > max)) {
+      rate = max;
+    }
+  }
+  return LWIP_MIN(rate, TCP_PACING_RATE_MAX);
+}
+
+/**
+ * Refill the pacing credit of a pcb for the time passed since the last call.
+ * If no credit is left, schedule tcp_pace_timeout for when there is again.
+ *
+ * @param pcb the tcp_pcb to send on
+ * @param rate pacing rate in bytes per millisecond (from tcp_pace_rate())
+ * @return 1 if the next segment may be sent now, 0 if it is held back
+ */
+static int
+tcp_pace_check(struct tcp_pcb *pcb, u32_t rate)
+{
+  u32_t now = sys_now();
+  u32_t elapsed = now - pcb->pace.stamp;
+  s32_t burst = (s32_t)LWIP_MAX(rate, TCP_PACING_BURST * (u32_t)pcb->mss);
+
+  pcb->pace.stamp = now;
+  if (pcb->pace.credit < burst) {
+    if (elapsed > (u32_t)(burst - pcb->pace.credit) / rate) {
+      pcb->pace.credit = burst;
+    } else {
+      pcb->pace.credit += (s32_t)(rate * elapsed);
+    }
+  }
+  if (pcb->pace.credit > 0) {
+    return 1;
+  }
+  if (!(pcb->flags & TF_PACE_TIMER)) {
+    /* wait until the debt is paid (rounded up) */
+    sys_timeout((u32_t)(-pcb->pace.credit) / rate + 1, tcp_pace_timeout, pcb);
+    tcp_set_flags(pcb, TF_PACE_TIMER);
+    MIB2_STATS_INC(mib2.tcppacingdelays);
+  }
+  return 0;
+}
+#endif /* LWIP_TCP_PACING */
+
 /**
  * @ingroup tcp_raw
  * Find out what we can send and send it
@@ -1237,13 +1661,37 @@ tcp_build_wnd_scale_option(u32_t *opts)
  * @return ERR_OK if data has been sent or nothing to send
  *         another err_t on error
  */
+#if LWIP_TCP_TIMER_WHEEL
+err_t
+tcp_output(struct tcp_pcb *pcb)
+{
+  err_t err = tcp_output_pcb(pcb);
+  /* the retransmission or persist timer may be running now */
+  tcp_timer_update(pcb);
+  return err;
+}
+
+static err_t
+tcp_output_pcb(struct tcp_pcb *pcb)
+#else /* LWIP_TCP_TIMER_WHEEL */
 err_t
 tcp_output(struct tcp_pcb *pcb)
+#endif /* LWIP_TCP_TIMER_WHEEL */
 {
   struct tcp_seg *seg, *useg;
   u32_t wnd, snd_nxt;
   err_t err;
   struct netif *netif;
+#if LWIP_TCP_SACK_IN
+  u8_t sack_recovery;
+  u32_t sack_budget = 0;
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_GSO
+  u16_t gso_segs = 0;
+#endif /* LWIP_TCP_GSO */
+#if LWIP_TCP_PACING
+  u32_t pace_rate;
+#endif /* LWIP_TCP_PACING */
 #if TCP_CWND_DEBUG
   s16_t i = 0;
 #endif /* TCP_CWND_DEBUG */
@@ -1263,8 +1711,23 @@ tcp_output(struct tcp_pcb *pcb)
     return ERR_OK;
   }
 
+#if LWIP_TCP_FASTOPEN
+  if (pcb->fastopen & TCP_FASTOPEN_SYN_DATA) {
+    tcp_output_fastopen(pcb);
+  }
+#endif /* LWIP_TCP_FASTOPEN */
+
   wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd);
 
+#if LWIP_TCP_SACK_IN
+  /* In loss recovery, cwnd - pipe limits what is sent (see below) */
+  sack_recovery = (u8_t)(TCP_SACK_IN_ENABLED(pcb) && (pcb->flags & TF_INFR));
+  if (sack_recovery) {
+    sack_budget = tcp_sack_rexmit_lost(pcb);
+    wnd = pcb->snd_wnd;
+  }
+#endif /* LWIP_TCP_SACK_IN */
+
   seg = pcb->unsent;
 
   if (seg == NULL) {
@@ -1327,6 +1790,17 @@ tcp_output(struct tcp_pcb *pcb)
   /* Stop persist timer, above conditions are not active */
   pcb->persist_backoff = 0;
 
+  /* Tell congestion control when sending restarts after an idle period
+     longer than one RTO */
+  if ((pcb->unacked == NULL) && (pcb->cc->on_idle != NULL) &&
+      ((u32_t)(tcp_ticks - pcb->tmr) > (u32_t)pcb->rto)) {
+    pcb->cc->on_idle(pcb);
+  }
+
+#if LWIP_TCP_PACING
+  pace_rate = tcp_pace_rate(pcb);
+#endif /* LWIP_TCP_PACING */
+
   /* useg should point to last segment on unacked queue */
   useg = pcb->unacked;
   if (useg != NULL) {
@@ -1348,6 +1822,30 @@ tcp_output(struct tcp_pcb *pcb)
         ((pcb->flags & (TF_NAGLEMEMERR | TF_FIN)) == 0)) {
       break;
     }
+#if LWIP_TCP_SACK_IN
+    if (sack_recovery) {
+      /* RFC 6675: send while cwnd - pipe allows it, but the fast retransmit
+         of the segment at snd_una is never held back */
+      if ((seg->len > sack_budget) && (lwip_ntohl(seg->tcphdr->seqno) != pcb->lastack)) {
+        break;
+      }
+      sack_budget = (seg->len > sack_budget) ? 0 : (sack_budget - seg->len);
+    }
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_PACING
+    /* (the rest of a super-segment was paced when it was sent) */
+    if ((pace_rate != 0) &&
+#if LWIP_TCP_GSO
+        (gso_segs == 0) &&
+#endif /* LWIP_TCP_GSO */
+        !tcp_pace_check(pcb, pace_rate)) {
+      if (pcb->flags & TF_ACK_NOW) {
+        /* the data has to wait, but an ACK is due */
+        tcp_send_empty_ack(pcb);
+      }
+      break;
+    }
+#endif /* LWIP_TCP_PACING */
 #if TCP_CWND_DEBUG
     LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
                                  pcb->snd_wnd, pcb->cwnd, wnd,
@@ -1361,18 +1859,45 @@ tcp_output(struct tcp_pcb *pcb)
       TCPH_SET_FLAG(seg->tcphdr, TCP_ACK);
     }
 
+#if LWIP_TCP_GSO
+    if (gso_segs > 0) {
+      /* already sent as part of the last super-segment */
+      gso_segs--;
+      err = ERR_OK;
+    } else {
+      u32_t gso_wnd = wnd;
+#if LWIP_TCP_PACING
+      if (pace_rate != 0) {
+        /* don't send more than the pacing credit as one super-segment */
+        gso_wnd = LWIP_MIN(wnd, lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + (u32_t)pcb->pace.credit);
+      }
+#endif /* LWIP_TCP_PACING */
+      /* sends seg alone or together with the gso_segs segments after it */
+      err = tcp_output_gso(seg, pcb, netif, gso_wnd, &gso_segs);
+    }
+#else /* LWIP_TCP_GSO */
     err = tcp_output_segment(seg, pcb, netif);
+#endif /* LWIP_TCP_GSO */
     if (err != ERR_OK) {
       /* segment could not be sent, for whatever reason */
       tcp_set_flags(pcb, TF_NAGLEMEMERR);
       return err;
     }
+#if LWIP_TCP_PACING
+    if (pace_rate != 0) {
+      pcb->pace.credit -= (s32_t)seg->len;
+      MIB2_STATS_INC(mib2.tcppacedsegs);
+    }
+#endif /* LWIP_TCP_PACING */
 #if TCP_OVERSIZE_DBGCHECK
     seg->oversize_left = 0;
 #endif /* TCP_OVERSIZE_DBGCHECK */
     pcb->unsent = seg->next;
     if (pcb->state != SYN_SENT) {
       tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+#if LWIP_TCP_ACK_POLICY
+      pcb->ack_pending = 0;
+#endif /* LWIP_TCP_ACK_POLICY */
     }
     snd_nxt = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
     if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
@@ -1411,6 +1936,12 @@ tcp_output(struct tcp_pcb *pcb)
     }
     seg = pcb->unsent;
   }
+#if LWIP_TCP_SACK_IN
+  if (sack_recovery && (pcb->flags & TF_ACK_NOW)) {
+    /* data was held back by the pipe estimate, but an ACK is due */
+    tcp_send_empty_ack(pcb);
+  }
+#endif /* LWIP_TCP_SACK_IN */
 #if TCP_OVERSIZE
   if (pcb->unsent == NULL) {
     /* last unsent has been removed, reset unsent_oversize */
@@ -1448,33 +1979,68 @@ tcp_output_segment_busy(const struct tcp_seg *seg)
   return 0;
 }
 
+#if LWIP_SO_ZEROCOPY
 /**
- * Called by tcp_output() to actually send a TCP segment over IP.
+ * Copy the data referenced by the unsent and unacked segments of a pcb
+ * (written without TCP_WRITE_FLAG_COPY, i.e. PBUF_ROM) into pbufs of their
+ * own, so that the application may reuse that memory before the data is
+ * acknowledged. Used when a netconn with zero-copy writes is closed.
  *
- * @param seg the tcp_seg to send
+ * @param pcb the tcp_pcb whose queued data to copy
+ * @return ERR_OK if no segment references application data any more,
+ *         ERR_MEM if out of memory or a segment is still referenced by
+ *         the netif driver (try again later)
+ */
+err_t
+tcp_copy_rom_data(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  struct pbuf **pq, *q, *r;
+  u8_t i;
+
+  for (i = 0; i < 2; i++) {
+    for (seg = (i == 0) ? pcb->unsent : pcb->unacked; seg != NULL; seg = seg->next) {
+      /* the first pbuf holds the TCP header, it is never PBUF_ROM */
+      for (pq = &seg->p->next; (q = *pq) != NULL; pq = &(*pq)->next) {
+        if (q->type_internal != (u8_t)PBUF_ROM) {
+          continue;
+        }
+        if (tcp_output_segment_busy(seg)) {
+          /* the driver has the chain, don't change it */
+          return ERR_MEM;
+        }
+        r = pbuf_alloc(PBUF_RAW, q->len, PBUF_RAM);
+        if (r == NULL) {
+          return ERR_MEM;
+        }
+        MEMCPY(r->payload, q->payload, q->len);
+        r->tot_len = q->tot_len;
+        r->next = q->next;
+        q->next = NULL;
+        pbuf_free(q);
+        *pq = r;
+      }
+    }
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_SO_ZEROCOPY */
+
+/**
+ * Fill in the parts of a segment's TCP header that are only known when it
+ * is sent (ackno, window, options) and start the RTO and RTT timers.
+ *
+ * @param seg the tcp_seg to prepare
  * @param pcb the tcp_pcb for the TCP connection used to send the segment
  * @param netif the netif used to send the segment
  */
-static err_t
-tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
+static void
+tcp_output_segment_hdr(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
 {
-  err_t err;
   u16_t len;
   u32_t *opts;
-#if TCP_CHECKSUM_ON_COPY
-  int seg_chksum_was_swapped = 0;
-#endif
 
-  LWIP_ASSERT("tcp_output_segment: invalid seg", seg != NULL);
-  LWIP_ASSERT("tcp_output_segment: invalid pcb", pcb != NULL);
-  LWIP_ASSERT("tcp_output_segment: invalid netif", netif != NULL);
-
-  if (tcp_output_segment_busy(seg)) {
-    /* This should not happen: rexmit functions should have checked this.
-       However, since this function modifies p->len, we must not continue in this case. */
-    LWIP_DEBUGF(TCP_RTO_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_output_segment: segment busy\n"));
-    return ERR_OK;
-  }
+  LWIP_UNUSED_ARG(netif); /* only used with TCP_CALCULATE_EFF_SEND_MSS */
 
   /* The TCP header has already been constructed, but the ackno and
    wnd fields remain. */
@@ -1494,44 +2060,12 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
-  /* Add any requested options.  NB MSS option is only set on SYN
-     packets, so ignore it here */
+  /* Add any requested options. */
   /* cast through void* to get rid of alignment warnings */
-  opts = (u32_t *)(void *)(seg->tcphdr + 1);
-  if (seg->flags & TF_SEG_OPTS_MSS) {
-    u16_t mss;
-#if TCP_CALCULATE_EFF_SEND_MSS
-    mss = tcp_eff_send_mss_netif(TCP_MSS, netif, &pcb->remote_ip);
-#else /* TCP_CALCULATE_EFF_SEND_MSS */
-    mss = TCP_MSS;
-#endif /* TCP_CALCULATE_EFF_SEND_MSS */
-    *opts = TCP_BUILD_MSS_OPTION(mss);
-    opts += 1;
-  }
 #if LWIP_TCP_TIMESTAMPS
   pcb->ts_lastacksent = pcb->rcv_nxt;
-
-  if (seg->flags & TF_SEG_OPTS_TS) {
-    tcp_build_timestamp_option(pcb, opts);
-    opts += 3;
-  }
-#endif
-#if LWIP_WND_SCALE
-  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
-    tcp_build_wnd_scale_option(opts);
-    opts += 1;
-  }
-#endif
-#if LWIP_TCP_SACK_OUT
-  if (seg->flags & TF_SEG_OPTS_SACK_PERM) {
-    /* Pad with two NOP options to make everything nicely aligned
-     * NOTE: When we send both timestamp and SACK_PERM options,
-     * we could use the first two NOPs before the timestamp to store SACK_PERM option,
-     * but that would complicate the code.
-     */
-    *(opts++) = PP_HTONL(0x01010402);
-  }
 #endif
+  opts = tcp_build_options(pcb, (u32_t *)(void *)(seg->tcphdr + 1), seg->flags, netif);
 
   /* Set retransmission timer running if it is not currently enabled
      This must be set before checking the route. */
@@ -1542,6 +2076,10 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   if (pcb->rttest == 0) {
     pcb->rttest = tcp_ticks;
     pcb->rtseq = lwip_ntohl(seg->tcphdr->seqno);
+#if LWIP_TCP_PACING
+    /* the same segment is timed with ms resolution for the pacing rate */
+    pcb->pace.rtt_start = sys_now();
+#endif /* LWIP_TCP_PACING */
 
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_output_segment: rtseq %"U32_F"\n", pcb->rtseq));
   }
@@ -1566,6 +2104,35 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   opts = LWIP_HOOK_TCP_OUT_ADD_TCPOPTS(seg->p, seg->tcphdr, pcb, opts);
 #endif
   LWIP_ASSERT("options not filled", (u8_t *)opts == ((u8_t *)(seg->tcphdr + 1)) + LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
+}
+
+/**
+ * Called by tcp_output() to actually send a TCP segment over IP.
+ *
+ * @param seg the tcp_seg to send
+ * @param pcb the tcp_pcb for the TCP connection used to send the segment
+ * @param netif the netif used to send the segment
+ */
+static err_t
+tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
+{
+  err_t err;
+#if TCP_CHECKSUM_ON_COPY
+  int seg_chksum_was_swapped = 0;
+#endif
+
+  LWIP_ASSERT("tcp_output_segment: invalid seg", seg != NULL);
+  LWIP_ASSERT("tcp_output_segment: invalid pcb", pcb != NULL);
+  LWIP_ASSERT("tcp_output_segment: invalid netif", netif != NULL);
+
+  if (tcp_output_segment_busy(seg)) {
+    /* This should not happen: rexmit functions should have checked this.
+       However, since this function modifies p->len, we must not continue in this case. */
+    LWIP_DEBUGF(TCP_RTO_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_output_segment: segment busy\n"));
+    return ERR_OK;
+  }
+
+  tcp_output_segment_hdr(seg, pcb, netif);
 
 #if CHECKSUM_GEN_TCP
   IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
@@ -1624,6 +2191,366 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   return err;
 }
 
+#if LWIP_TCP_GSO
+#if LWIP_IPV4 && LWIP_IPV6
+#define TCP_GSO_IP_HLEN(pcb) (IP_IS_V6(&(pcb)->remote_ip) ? IP6_HLEN : IP_HLEN)
+#elif LWIP_IPV6
+#define TCP_GSO_IP_HLEN(pcb) IP6_HLEN
+#else
+#define TCP_GSO_IP_HLEN(pcb) IP_HLEN
+#endif
+
+#if ENABLE_LOOPBACK
+/**
+ * Check whether ip_output_if() would hand segments of this pcb to
+ * netif_loop_output() instead of the netif driver (mirrors the checks in
+ * ip4_output_if_opt_src() and ip6_output_if_src()). The loopback path copies
+ * the packet and knows nothing about super-segments, so they must not be
+ * built for it.
+ */
+static int
+tcp_output_gso_to_self(struct tcp_pcb *pcb, struct netif *netif)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(&pcb->remote_ip)) {
+    s8_t i;
+#if !LWIP_HAVE_LOOPIF
+    if (ip6_addr_isloopback(ip_2_ip6(&pcb->remote_ip))) {
+      return 1;
+    }
+#endif /* !LWIP_HAVE_LOOPIF */
+    for (i = 0; i < LWIP_IPV6_NUM_ADDRESSES; i++) {
+      if (ip6_addr_isvalid(netif_ip6_addr_state(netif, i)) &&
+          ip6_addr_eq(ip_2_ip6(&pcb->remote_ip), netif_ip6_addr(netif, i))) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  if (ip4_addr_eq(ip_2_ip4(&pcb->remote_ip), netif_ip4_addr(netif))
+#if !LWIP_HAVE_LOOPIF
+      || ip4_addr_isloopback(ip_2_ip4(&pcb->remote_ip))
+#endif /* !LWIP_HAVE_LOOPIF */
+     ) {
+    return 1;
+  }
+#endif /* LWIP_IPV4 */
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(netif);
+  return 0;
+}
+#endif /* ENABLE_LOOPBACK */
+
+/**
+ * Count the segments following pcb->unsent that can go out together with it
+ * in one super-segment: they must be contiguous, have the same length and
+ * header length as the first one, carry no SYN/FIN/RST, fit into the send
+ * window and not be held back by the nagle algorithm.
+ *
+ * @param pcb the tcp_pcb to send from
+ * @param netif the netif used to send
+ * @param wnd the send window (like in tcp_output())
+ * @return number of segments after pcb->unsent to include
+ */
+static u16_t
+tcp_output_gso_count(struct tcp_pcb *pcb, struct netif *netif, u32_t wnd)
+{
+  struct tcp_seg *seg = pcb->unsent;
+  struct tcp_seg *s;
+  u32_t next_seqno, tot_len, max_len;
+  u16_t hdrlen, nsegs = 0;
+
+  if (!(netif->flags & NETIF_FLAG_GSO) || (pcb->flags & TF_INFR) || (seg->len == 0) ||
+      (TCPH_FLAGS(seg->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST))) {
+    return 0;
+  }
+#if ENABLE_LOOPBACK
+  if (tcp_output_gso_to_self(pcb, netif)) {
+    return 0;
+  }
+#endif /* ENABLE_LOOPBACK */
+  hdrlen = TCPH_HDRLEN_BYTES(seg->tcphdr);
+  /* the link header must still fit into the 16 bit pbuf length */
+  max_len = LWIP_MIN(netif->gso_max_size, 0xffffU - PBUF_LINK_ENCAPSULATION_HLEN - PBUF_LINK_HLEN);
+  max_len = (max_len > (u32_t)(TCP_GSO_IP_HLEN(pcb) + hdrlen)) ? max_len - TCP_GSO_IP_HLEN(pcb) - hdrlen : 0;
+  tot_len = seg->len;
+  next_seqno = lwip_ntohl(seg->tcphdr->seqno) + seg->len;
+
+  for (s = seg->next; s != NULL; s = s->next) {
+    if ((s->len != seg->len) || (lwip_ntohl(s->tcphdr->seqno) != next_seqno) ||
+        (TCPH_HDRLEN_BYTES(s->tcphdr) != hdrlen) ||
+        (TCPH_FLAGS(s->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST)) ||
+        (tot_len + s->len > max_len) ||
+        (next_seqno - pcb->lastack + s->len > wnd) ||
+        tcp_output_segment_busy(s)) {
+      break;
+    }
+    if ((s->next == NULL) && (s->len < pcb->mss) && !(pcb->flags & TF_NODELAY)) {
+      /* leave the last one to the nagle check of tcp_output() */
+      break;
+    }
+    tot_len += s->len;
+    next_seqno += s->len;
+    nsegs++;
+  }
+  return nsegs;
+}
+
+/**
+ * Send pcb->unsent together with the segments after it as one TCP
+ * super-segment if the netif supports it (see NETIF_FLAG_GSO), or alone by
+ * tcp_output_segment() if not. The super-segment has the header of the
+ * first segment, references the data of all segments and leaves the TCP
+ * checksum to the netif.
+ *
+ * @param seg the first tcp_seg to send (pcb->unsent)
+ * @param pcb the tcp_pcb for the TCP connection used to send the segment
+ * @param netif the netif used to send the segment
+ * @param wnd the send window (like in tcp_output())
+ * @param nsegs returns the number of segments after seg that were sent, too
+ */
+static err_t
+tcp_output_gso(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif, u32_t wnd, u16_t *nsegs)
+{
+  struct pbuf *p, *q, *r, *last;
+  struct tcp_seg *s;
+  struct tcp_hdr *tcphdr;
+  u16_t hdrlen, off, left, len, tot_len, i, n;
+  err_t err;
+
+  *nsegs = 0;
+  n = tcp_output_gso_count(pcb, netif, wnd);
+  if ((n == 0) || tcp_output_segment_busy(seg)) {
+    return tcp_output_segment(seg, pcb, netif);
+  }
+  hdrlen = TCPH_HDRLEN_BYTES(seg->tcphdr);
+  p = pbuf_alloc(PBUF_TRANSPORT, hdrlen, PBUF_RAM);
+  if (p == NULL) {
+    return tcp_output_segment(seg, pcb, netif);
+  }
+  /* reference the data behind the TCP header of each segment */
+  last = p;
+  tot_len = hdrlen;
+  for (i = 0, s = seg; i <= n; i++, s = s->next) {
+    q = s->p;
+    off = (u16_t)((u8_t *)s->tcphdr - (u8_t *)q->payload + hdrlen);
+    while ((q != NULL) && (off >= q->len)) {
+      off = (u16_t)(off - q->len);
+      q = q->next;
+    }
+    for (left = s->len; left > 0; left = (u16_t)(left - len), off = 0, q = q->next) {
+      LWIP_ASSERT("tcp_output_gso: segment data too short", q != NULL);
+      len = LWIP_MIN(left, (u16_t)(q->len - off));
+      r = pbuf_alloc_reference((u8_t *)q->payload + off, len, PBUF_REF);
+      if (r == NULL) {
+        pbuf_free(p);
+        return tcp_output_segment(seg, pcb, netif);
+      }
+      last->next = r;
+      last = r;
+      tot_len = (u16_t)(tot_len + len);
+    }
+  }
+  for (q = p; q != NULL; q = q->next) {
+    q->tot_len = tot_len;
+    tot_len = (u16_t)(tot_len - q->len);
+  }
+
+  /* one header for all: that of the first segment with the PSH flag of the last */
+  tcp_output_segment_hdr(seg, pcb, netif);
+  tcphdr = (struct tcp_hdr *)p->payload;
+  MEMCPY(tcphdr, seg->tcphdr, hdrlen);
+  TCPH_UNSET_FLAG(tcphdr, TCP_PSH);
+  for (s = seg, i = 0; i < n; i++, s = s->next) {
+    TCP_STATS_INC(tcp.xmit);
+    MIB2_STATS_INC(mib2.tcpoutsegs);
+  }
+  TCPH_SET_FLAG(tcphdr, TCPH_FLAGS(s->tcphdr) & TCP_PSH);
+  TCP_STATS_INC(tcp.xmit);
+  p->gso_size = seg->len;
+
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_output_gso: %"U32_F":%"U32_F" in %"U16_F" segments\n",
+                                 lwip_ntohl(seg->tcphdr->seqno), lwip_ntohl(s->tcphdr->seqno) + s->len,
+                                 (u16_t)(n + 1)));
+  NETIF_SET_HINTS(netif, &(pcb->netif_hints));
+  err = ip_output_if(p, &pcb->local_ip, &pcb->remote_ip, pcb->ttl,
+                     pcb->tos, IP_PROTO_TCP, netif);
+  NETIF_RESET_HINTS(netif);
+  pbuf_free(p);
+
+  *nsegs = n;
+  return err;
+}
+
+/**
+ * @ingroup tcp_raw
+ * Software GSO: cut a TCP super-segment (a pbuf with gso_size != 0, see
+ * NETIF_FLAG_GSO) into wire segments of p->gso_size payload bytes and pass
+ * them to 'output' one by one. Netif drivers that set NETIF_FLAG_GSO without
+ * having segmentation hardware call this from their linkoutput function.
+ * IP and TCP checksums are generated as configured for the netif.
+ *
+ * @param netif the netif sending p
+ * @param p the super-segment, starting with link_hlen bytes of link header
+ *          followed by the IP and TCP headers in the first pbuf
+ * @param link_hlen length of the link header in front of the IP header
+ * @param output called for every wire segment (e.g. the driver's real linkoutput)
+ * @return ERR_OK or the first error returned by output
+ */
+err_t
+tcp_gso_segment(struct netif *netif, struct pbuf *p, u16_t link_hlen, netif_linkoutput_fn output)
+{
+  struct tcp_hdr *tcphdr;
+  struct pbuf *q, *r, *data;
+  void *iphdr;
+  u16_t iphlen, hlen, off, len, data_off, left, n;
+  u32_t seqno;
+  u8_t flags;
+  err_t err;
+#if LWIP_IPV4
+  u16_t ip_id = 0;
+#endif /* LWIP_IPV4 */
+
+  LWIP_ERROR("tcp_gso_segment: invalid pbuf",
+             (p != NULL) && (p->gso_size > 0) && (p->len > link_hlen), return ERR_ARG);
+  LWIP_ERROR("tcp_gso_segment: invalid output", output != NULL, return ERR_ARG);
+
+  iphdr = (u8_t *)p->payload + link_hlen;
+#if LWIP_IPV6
+  if (IP_HDR_GET_VERSION(iphdr) == 6) {
+    iphlen = IP6_HLEN;
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    iphlen = IPH_HL_BYTES((struct ip_hdr *)iphdr);
+    ip_id = lwip_ntohs(IPH_ID((struct ip_hdr *)iphdr));
+#else /* LWIP_IPV4 */
+    return ERR_VAL;
+#endif /* LWIP_IPV4 */
+  }
+  LWIP_ERROR("tcp_gso_segment: headers not in first pbuf",
+             p->len >= link_hlen + iphlen + TCP_HLEN, return ERR_VAL);
+  tcphdr = (struct tcp_hdr *)((u8_t *)iphdr + iphlen);
+  hlen = (u16_t)(link_hlen + iphlen + TCPH_HDRLEN_BYTES(tcphdr));
+  LWIP_ERROR("tcp_gso_segment: headers not in first pbuf", p->len >= hlen, return ERR_VAL);
+  seqno = lwip_ntohl(tcphdr->seqno);
+  flags = (u8_t)TCPH_FLAGS(tcphdr);
+  data = p;
+  data_off = hlen;
+  q = NULL;
+
+  for (off = hlen; off < p->tot_len; off = (u16_t)(off + len)) {
+    len = LWIP_MIN(p->gso_size, (u16_t)(p->tot_len - off));
+    while (data_off >= data->len) {
+      data_off = (u16_t)(data_off - data->len);
+      data = data->next;
+    }
+    if ((q != NULL) && (q->ref == 1) && (q->next->ref == 1) && (q->next->next == NULL) &&
+        (data->len - data_off >= len)) {
+      /* the driver did not keep the last wire segment: reuse its headers and
+         point the data reference at the next chunk (the common case) */
+      r = q->next;
+      r->payload = (u8_t *)data->payload + data_off;
+      r->len = r->tot_len = len;
+      q->tot_len = (u16_t)(hlen + len);
+      data_off = (u16_t)(data_off + len);
+    } else {
+      if (q != NULL) {
+        pbuf_free(q);
+      }
+      /* a copy of the headers, followed by references to the data */
+      q = pbuf_alloc(PBUF_RAW, hlen, PBUF_RAM);
+      if (q == NULL) {
+        return ERR_MEM;
+      }
+      MEMCPY(q->payload, p->payload, hlen);
+      for (left = len; left > 0; left = (u16_t)(left - n)) {
+        while (data_off >= data->len) {
+          data_off = (u16_t)(data_off - data->len);
+          data = data->next;
+        }
+        n = LWIP_MIN(left, (u16_t)(data->len - data_off));
+        r = pbuf_alloc_reference((u8_t *)data->payload + data_off, n, PBUF_REF);
+        if (r == NULL) {
+          pbuf_free(q);
+          return ERR_MEM;
+        }
+        pbuf_cat(q, r);
+        data_off = (u16_t)(data_off + n);
+      }
+    }
+
+    iphdr = (u8_t *)q->payload + link_hlen;
+    tcphdr = (struct tcp_hdr *)((u8_t *)iphdr + iphlen);
+    tcphdr->seqno = lwip_htonl(seqno);
+    if (off + len < p->tot_len) {
+      /* PSH and FIN only on the last segment */
+      TCPH_UNSET_FLAG(tcphdr, TCP_PSH | TCP_FIN);
+    } else {
+      TCPH_SET_FLAG(tcphdr, flags & (TCP_PSH | TCP_FIN));
+    }
+#if LWIP_IPV6
+    if (IP_HDR_GET_VERSION(iphdr) == 6) {
+      IP6H_PLEN_SET((struct ip6_hdr *)iphdr, (u16_t)(hlen - link_hlen - iphlen + len));
+    } else
+#endif /* LWIP_IPV6 */
+    {
+#if LWIP_IPV4
+      struct ip_hdr *ip4hdr = (struct ip_hdr *)iphdr;
+      IPH_LEN_SET(ip4hdr, lwip_htons((u16_t)(hlen - link_hlen + len)));
+      IPH_ID_SET(ip4hdr, lwip_htons(ip_id));
+      ip_id++;
+      IPH_CHKSUM_SET(ip4hdr, 0);
+#if CHECKSUM_GEN_IP
+      IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
+        IPH_CHKSUM_SET(ip4hdr, inet_chksum(ip4hdr, iphlen));
+      }
+#endif /* CHECKSUM_GEN_IP */
+#endif /* LWIP_IPV4 */
+    }
+#if CHECKSUM_GEN_TCP
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
+      tcphdr->chksum = 0;
+      pbuf_remove_header(q, (size_t)link_hlen + iphlen);
+#if LWIP_IPV6
+      if (IP_HDR_GET_VERSION(iphdr) == 6) {
+        struct ip6_hdr *ip6hdr = (struct ip6_hdr *)iphdr;
+        ip6_addr_t src, dest;
+        ip6_addr_copy_from_packed(src, ip6hdr->src);
+        ip6_addr_copy_from_packed(dest, ip6hdr->dest);
+        tcphdr->chksum = ip6_chksum_pseudo(q, IP_PROTO_TCP, q->tot_len, &src, &dest);
+      } else
+#endif /* LWIP_IPV6 */
+      {
+#if LWIP_IPV4
+        struct ip_hdr *ip4hdr = (struct ip_hdr *)iphdr;
+        ip4_addr_t src, dest;
+        ip4_addr_copy(src, ip4hdr->src);
+        ip4_addr_copy(dest, ip4hdr->dest);
+        tcphdr->chksum = inet_chksum_pseudo(q, IP_PROTO_TCP, q->tot_len, &src, &dest);
+#endif /* LWIP_IPV4 */
+      }
+      pbuf_add_header(q, (size_t)link_hlen + iphlen);
+    }
+#endif /* CHECKSUM_GEN_TCP */
+
+    err = output(netif, q);
+    if (err != ERR_OK) {
+      pbuf_free(q);
+      return err;
+    }
+    seqno += len;
+  }
+  if (q != NULL) {
+    pbuf_free(q);
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_GSO */
+
 /**
  * Requeue all unacked segments for retransmission
  *
@@ -1635,6 +2562,9 @@ err_t
 tcp_rexmit_rto_prepare(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg;
+#if LWIP_TCP_SACK_IN
+  struct tcp_seg *useg;
+#endif /* LWIP_TCP_SACK_IN */
 
   LWIP_ASSERT("tcp_rexmit_rto_prepare: invalid pcb", pcb != NULL);
 
@@ -1669,6 +2599,17 @@ tcp_rexmit_rto_prepare(struct tcp_pcb *pcb)
   /* unacked queue is now empty */
   pcb->unacked = NULL;
 
+#if LWIP_TCP_SACK_IN
+  /* RTO ends loss recovery and discards the scoreboard (the receiver may
+     have reneged on SACKed data, RFC 2018) */
+  for (useg = pcb->unsent; useg != NULL; useg = useg->next) {
+    useg->flags &= (u8_t)~(TF_SEG_SACKED | TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT);
+  }
+  if (TCP_SACK_IN_ENABLED(pcb)) {
+    tcp_clear_flags(pcb, TF_INFR);
+  }
+#endif /* LWIP_TCP_SACK_IN */
+
   /* Mark RTO in-progress */
   tcp_set_flags(pcb, TF_RTO);
   /* Record the next byte following retransmit */
@@ -1717,6 +2658,33 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
   }
 }
 
+/**
+ * Insert a segment that was taken off the unacked queue into the unsent queue
+ * for retransmission, keeping the unsent queue sorted.
+ *
+ * @param pcb the tcp_pcb the segment belongs to
+ * @param seg the segment to retransmit
+ */
+void
+tcp_rexmit_seg(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct tcp_seg **cur_seg;
+
+  cur_seg = &(pcb->unsent);
+  while (*cur_seg &&
+         TCP_SEQ_LT(lwip_ntohl((*cur_seg)->tcphdr->seqno), lwip_ntohl(seg->tcphdr->seqno))) {
+    cur_seg = &((*cur_seg)->next );
+  }
+  seg->next = *cur_seg;
+  *cur_seg = seg;
+#if TCP_OVERSIZE
+  if (seg->next == NULL) {
+    /* the retransmitted segment is last in unsent, so reset unsent_oversize */
+    pcb->unsent_oversize = 0;
+  }
+#endif /* TCP_OVERSIZE */
+}
+
 /**
  * Requeue the first unacked segment for retransmission
  *
@@ -1728,7 +2696,6 @@ err_t
 tcp_rexmit(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg;
-  struct tcp_seg **cur_seg;
 
   LWIP_ASSERT("tcp_rexmit: invalid pcb", pcb != NULL);
 
@@ -1746,22 +2713,8 @@ tcp_rexmit(struct tcp_pcb *pcb)
   }
 
   /* Move the first unacked segment to the unsent queue */
-  /* Keep the unsent queue sorted. */
   pcb->unacked = seg->next;
-
-  cur_seg = &(pcb->unsent);
-  while (*cur_seg &&
-         TCP_SEQ_LT(lwip_ntohl((*cur_seg)->tcphdr->seqno), lwip_ntohl(seg->tcphdr->seqno))) {
-    cur_seg = &((*cur_seg)->next );
-  }
-  seg->next = *cur_seg;
-  *cur_seg = seg;
-#if TCP_OVERSIZE
-  if (seg->next == NULL) {
-    /* the retransmitted segment is last in unsent, so reset unsent_oversize */
-    pcb->unsent_oversize = 0;
-  }
-#endif /* TCP_OVERSIZE */
+  tcp_rexmit_seg(pcb, seg);
 
   if (pcb->nrtx < 0xFF) {
     ++pcb->nrtx;
@@ -1789,6 +2742,9 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
   LWIP_ASSERT("tcp_rexmit_fast: invalid pcb", pcb != NULL);
 
   if (pcb->unacked != NULL && !(pcb->flags & TF_INFR)) {
+#if LWIP_TCP_SACK_IN
+    struct tcp_seg *seg = pcb->unacked;
+#endif /* LWIP_TCP_SACK_IN */
     /* This is fast retransmit. Retransmit the first unacked segment. */
     LWIP_DEBUGF(TCP_FR_DEBUG,
                 ("tcp_receive: dupacks %"U16_F" (%"U32_F
@@ -1796,20 +2752,20 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  (u16_t)pcb->dupacks, pcb->lastack,
                  lwip_ntohl(pcb->unacked->tcphdr->seqno)));
     if (tcp_rexmit(pcb) == ERR_OK) {
-      /* Set ssthresh to half of the minimum of the current
-       * cwnd and the advertised window */
-      pcb->ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
-
-      /* The minimum value for ssthresh should be 2 MSS */
-      if (pcb->ssthresh < (2U * pcb->mss)) {
-        LWIP_DEBUGF(TCP_FR_DEBUG,
-                    ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
-                     " should be min 2 mss %"U16_F"...\n",
-                     pcb->ssthresh, (u16_t)(2 * pcb->mss)));
-        pcb->ssthresh = 2 * pcb->mss;
+      /* Let congestion control set ssthresh */
+      pcb->cc->on_loss(pcb);
+
+#if LWIP_TCP_SACK_IN
+      if (TCP_SACK_IN_ENABLED(pcb)) {
+        /* RFC 6675 loss recovery: output is limited by cwnd - pipe */
+        seg->flags |= TF_SEG_SACK_REXMIT;
+        pcb->cwnd = pcb->ssthresh;
+        pcb->recovery_point = pcb->snd_nxt;
+      } else
+#endif /* LWIP_TCP_SACK_IN */
+      {
+        pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
       }
-
-      pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
       tcp_set_flags(pcb, TF_INFR);
 
       /* Reset the retransmission timer to prevent immediate rto retransmissions */
@@ -1818,6 +2774,97 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
   }
 }
 
+#if LWIP_TCP_SACK_IN
+/** RFC 6675 DupThresh: SACKed segments above a hole that make it count as lost */
+#define TCP_SACK_DUPTHRESH 3
+
+/**
+ * Walk the scoreboard on the unacked queue: mark the segments that are
+ * considered lost (RFC 6675 IsLost) and estimate the number of bytes still in
+ * the network (RFC 6675 SetPipe).
+ *
+ * @param pcb the tcp_pcb to estimate the pipe for
+ * @return the number of outstanding bytes
+ */
+u32_t
+tcp_sack_pipe(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  u32_t pipe = 0, sacked_bytes = 0;
+  u16_t sacked_segs = 0;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked_segs++;
+      sacked_bytes += seg->len;
+    }
+  }
+  /* sacked_segs and sacked_bytes now count what is SACKed above seg */
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked_segs--;
+      sacked_bytes -= seg->len;
+      continue;
+    }
+    if ((sacked_segs >= TCP_SACK_DUPTHRESH) ||
+        (sacked_bytes > (u32_t)(TCP_SACK_DUPTHRESH - 1) * pcb->mss)) {
+      seg->flags |= TF_SEG_SACK_LOST;
+    }
+    if (!(seg->flags & TF_SEG_SACK_LOST)) {
+      pipe += TCP_TCPLEN(seg);
+    }
+    if (seg->flags & TF_SEG_SACK_REXMIT) {
+      pipe += TCP_TCPLEN(seg);
+    }
+  }
+  return pipe;
+}
+
+/**
+ * Selective retransmission in loss recovery (RFC 6675 NextSeg rule 1):
+ * requeue the segments on the unacked queue that are lost and not yet
+ * retransmitted, as far as cwnd - pipe allows.
+ *
+ * Called by tcp_output() while in loss recovery.
+ *
+ * @param pcb the tcp_pcb in loss recovery
+ * @return the number of bytes that may be sent now (retransmissions included)
+ */
+static u32_t
+tcp_sack_rexmit_lost(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg, **cur_seg;
+  u32_t pipe, budget, requeued = 0;
+
+  pipe = tcp_sack_pipe(pcb);
+  budget = (pipe < pcb->cwnd) ? (pcb->cwnd - pipe) : 0;
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_rexmit_lost: cwnd %"TCPWNDSIZE_F" pipe %"U32_F"\n",
+                             pcb->cwnd, pipe));
+
+  cur_seg = &pcb->unacked;
+  while (*cur_seg != NULL) {
+    seg = *cur_seg;
+    if ((seg->flags & (TF_SEG_SACKED | TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT)) != TF_SEG_SACK_LOST) {
+      cur_seg = &seg->next;
+      continue;
+    }
+    if ((requeued + seg->len > budget) || tcp_output_segment_busy(seg)) {
+      break;
+    }
+    LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_rexmit_lost: retransmit %"U32_F"\n",
+                               lwip_ntohl(seg->tcphdr->seqno)));
+    *cur_seg = seg->next;
+    seg->flags |= TF_SEG_SACK_REXMIT;
+    tcp_rexmit_seg(pcb, seg);
+    requeued += seg->len;
+    /* Don't take any rtt measurements after retransmitting. */
+    pcb->rttest = 0;
+    MIB2_STATS_INC(mib2.tcpretranssegs);
+  }
+  return budget;
+}
+#endif /* LWIP_TCP_SACK_IN */
+
 static struct pbuf *
 tcp_output_alloc_header_common(u32_t ackno, u16_t optlen, u16_t datalen,
                         u32_t seqno_be /* already in network byte order */,
@@ -2113,6 +3160,7 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   if (p == NULL) {
     /* let tcp_fasttmr retry sending this ACK */
     tcp_set_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+    TCP_TIMER_FAST(pcb);
     LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_output: (ACK) could not allocate pbuf\n"));
     return ERR_BUF;
   }
@@ -2128,14 +3176,77 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   if (err != ERR_OK) {
     /* let tcp_fasttmr retry sending this ACK */
     tcp_set_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+    TCP_TIMER_FAST(pcb);
   } else {
     /* remove ACK flags from the PCB, as we sent an empty ACK now */
     tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+#if LWIP_TCP_ACK_POLICY
+    pcb->ack_pending = 0;
+#endif /* LWIP_TCP_ACK_POLICY */
   }
 
   return err;
 }
 
+#if LWIP_TCP_SYN_COOKIES
+/**
+ * Send a SYN|ACK for a connection request answered without a pcb
+ * (LWIP_TCP_SYN_COOKIES). It is not queued and never retransmitted: if it
+ * gets lost, the retransmitted SYN is answered again.
+ *
+ * Called by tcp_listen_input().
+ *
+ * @param pcb a temporary pcb initialized from the SYN (not on any list)
+ * @param iss the sequence number to use (the cookie)
+ */
+err_t
+tcp_send_synack(struct tcp_pcb *pcb, u32_t iss)
+{
+  struct pbuf *p;
+  struct netif *netif;
+  u32_t *opts;
+  u8_t optlen, optflags = TF_SEG_OPTS_MSS;
+
+  LWIP_ASSERT("tcp_send_synack: invalid pcb", pcb != NULL);
+
+#if LWIP_WND_SCALE
+  if (pcb->flags & TF_WND_SCALE) {
+    optflags |= TF_SEG_OPTS_WND_SCALE;
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+  if (pcb->flags & TF_SACK) {
+    optflags |= TF_SEG_OPTS_SACK_PERM;
+  }
+#endif /* LWIP_TCP_SACK_OUT */
+#if LWIP_TCP_TIMESTAMPS
+  if (pcb->flags & TF_TIMESTAMP) {
+    optflags |= TF_SEG_OPTS_TS;
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+  optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(optflags, pcb);
+
+  netif = tcp_route(pcb, &pcb->local_ip, &pcb->remote_ip);
+  if (netif == NULL) {
+    return ERR_RTE;
+  }
+  /* the window of a SYN segment is never scaled */
+  p = tcp_output_alloc_header_common(pcb->rcv_nxt, optlen, 0, lwip_htonl(iss),
+    pcb->local_port, pcb->remote_port, TCP_SYN | TCP_ACK, TCPWND_MIN16(pcb->rcv_ann_wnd));
+  if (p == NULL) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_send_synack: could not allocate pbuf\n"));
+    return ERR_MEM;
+  }
+  opts = tcp_build_options(pcb, (u32_t *)(void *)((struct tcp_hdr *)p->payload + 1), optflags, netif);
+  LWIP_ASSERT("options not filled", (u8_t *)opts == (u8_t *)p->payload + TCP_HLEN + optlen);
+  LWIP_UNUSED_ARG(opts); /* for LWIP_NOASSERT */
+
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_send_synack: seqno %"U32_F" ackno %"U32_F"\n", iss, pcb->rcv_nxt));
+  MIB2_STATS_INC(mib2.tcpoutsegs);
+  return tcp_output_control_segment_netif(pcb, p, &pcb->local_ip, &pcb->remote_ip, netif);
+}
+#endif /* LWIP_TCP_SYN_COOKIES */
+
 /**
  * Send keepalive packets to keep a connection active although
  * no data is sent over it.
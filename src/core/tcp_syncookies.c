@@ -0,0 +1,313 @@
+/**
+ * @file
+ * Transmission Control Protocol, SYN cookies and the SYN queue
+ *
+ * A listener with SYN cookies enabled answers connection requests without
+ * allocating a pcb. The options of a request are kept in a small SYN queue
+ * shared by all listeners, the sequence number of the SYN|ACK is a keyed
+ * hash of the connection (the cookie) so the final ACK can be checked even
+ * if the queue was full. The pcb is allocated when the final ACK arrives.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP && LWIP_TCP_SYN_COOKIES /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+#ifndef LWIP_RAND
+#error "If you want to use LWIP_TCP_SYN_COOKIES, you have to define LWIP_RAND=(random function) in your lwipopts.h"
+#endif
+
+/* Layout of a cookie, from the least significant bit: index into
+   tcp_syncookie_mss (3 bits), TCP_SYNCOOKIE_QUEUED_FLAG, time counter
+   (5 bits) and 23 bits of the hash */
+#define TCP_SYNCOOKIE_MSS_MASK     0x7UL
+#define TCP_SYNCOOKIE_QUEUED_FLAG  0x8UL
+#define TCP_SYNCOOKIE_CTR_SHIFT    4
+#define TCP_SYNCOOKIE_CTR_MASK     0x1FUL
+#define TCP_SYNCOOKIE_LOW_MASK     0x1FFUL
+
+/** The time counter advances every 64 seconds. A cookie is accepted in the
+    period it was made in and in the next one. */
+#define TCP_SYNCOOKIE_PERIOD       (64000UL / TCP_SLOW_INTERVAL)
+
+/** Send MSS values a cookie can carry (the largest one not above the MSS
+    of the peer is used) */
+static const u16_t tcp_syncookie_mss[] = {128, 536, 1024, 1220, 1360, 1400, 1440, 1460};
+
+static struct tcp_syn_entry tcp_syn_queue[TCP_SYN_QUEUE_SIZE];
+
+/** Secret key of the cookies */
+static u32_t tcp_syncookie_key[2];
+static u8_t tcp_syncookie_key_set;
+
+/**
+ * @ingroup tcp_raw
+ * Enable or disable SYN cookies for a listening pcb.
+ *
+ * With SYN cookies, a SYN does not allocate a pcb: it is answered with a
+ * SYN|ACK whose sequence number is a cookie, its options are kept in a SYN
+ * queue of TCP_SYN_QUEUE_SIZE entries shared by all listeners. When the
+ * final ACK carries a valid cookie, the pcb is allocated and accepted as
+ * usual. While the queue is full, window scaling, SACK and timestamps are
+ * not offered to new connections (the cookie cannot remember them).
+ *
+ * A SYN|ACK is not retransmitted (the client retransmits its SYN instead).
+ *
+ * @param pcb the listening tcp_pcb to change
+ * @param enable 1 to enable SYN cookies, 0 to disable them
+ */
+void
+tcp_syncookies(struct tcp_pcb *pcb, u8_t enable)
+{
+  struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_syncookies: invalid pcb", (pcb != NULL) && (pcb->state == LISTEN), return);
+
+  lpcb->syncookies = (u8_t)(enable != 0);
+  if (!enable) {
+    tcp_syn_queue_purge(lpcb);
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Set the secret key SYN cookies are derived from (by default, it is
+ * initialized from LWIP_RAND() when the first cookie is needed). Cookies
+ * handed out with the old key are not accepted any more.
+ *
+ * @param key0 first half of the 64 bit key
+ * @param key1 second half of the 64 bit key
+ */
+void
+tcp_syncookies_set_key(u32_t key0, u32_t key1)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  tcp_syncookie_key[0] = key0;
+  tcp_syncookie_key[1] = key1;
+  tcp_syncookie_key_set = 1;
+}
+
+static u8_t
+tcp_syncookie_addr(u8_t *buf, const ip_addr_t *addr)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    MEMCPY(buf, ip_2_ip6(addr)->addr, 16);
+    return 16;
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  MEMCPY(buf, &ip_2_ip4(addr)->addr, 4);
+  return 4;
+#else /* LWIP_IPV4 */
+  LWIP_UNUSED_ARG(buf);
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+/**
+ * The hash bits of a cookie.
+ *
+ * @param syn the connection (addresses, ports and irs are used)
+ * @param ctr the time counter
+ * @param low the lower bits of the cookie
+ */
+static u32_t
+tcp_syncookie_hash(const struct tcp_syn_entry *syn, u32_t ctr, u32_t low)
+{
+  u8_t buf[2 * 16 + 4 * 4];
+  u8_t out[8];
+  u8_t len;
+  u32_t val;
+
+  if (!tcp_syncookie_key_set) {
+    tcp_syncookie_key[0] = (u32_t)LWIP_RAND();
+    tcp_syncookie_key[1] = (u32_t)LWIP_RAND();
+    tcp_syncookie_key_set = 1;
+  }
+  len = tcp_syncookie_addr(buf, &syn->local_ip);
+  len = (u8_t)(len + tcp_syncookie_addr(buf + len, &syn->remote_ip));
+  val = ((u32_t)syn->local_port << 16) | syn->remote_port;
+  MEMCPY(buf + len, &val, 4);
+  MEMCPY(buf + len + 4, &syn->irs, 4);
+  MEMCPY(buf + len + 8, &ctr, 4);
+  MEMCPY(buf + len + 12, &low, 4);
+  tcp_halfsiphash(tcp_syncookie_key, buf, (u8_t)(len + 16), out);
+  MEMCPY(&val, out, 4);
+  return val & ~TCP_SYNCOOKIE_LOW_MASK;
+}
+
+/**
+ * Make the cookie for a connection request.
+ *
+ * @param syn the connection request (addresses, ports, irs and mss are used)
+ * @param queued 1 if the options are kept in the SYN queue
+ * @return the cookie, to be used as the sequence number of the SYN|ACK
+ */
+u32_t
+tcp_syncookie_make(struct tcp_syn_entry *syn, u8_t queued)
+{
+  u32_t ctr = tcp_ticks / TCP_SYNCOOKIE_PERIOD;
+  u32_t low;
+  u8_t i;
+
+  for (i = LWIP_ARRAYSIZE(tcp_syncookie_mss) - 1; (i > 0) && (tcp_syncookie_mss[i] > syn->mss); i--);
+  low = i | ((ctr & TCP_SYNCOOKIE_CTR_MASK) << TCP_SYNCOOKIE_CTR_SHIFT);
+  if (queued) {
+    low |= TCP_SYNCOOKIE_QUEUED_FLAG;
+  }
+  return tcp_syncookie_hash(syn, ctr, low) | low;
+}
+
+/**
+ * Check the cookie acknowledged by the final ACK of a handshake.
+ *
+ * @param syn the connection (addresses, ports and irs are used), iss and
+ *        mss are set if the cookie is valid
+ * @param iss the sequence number acknowledged (the cookie)
+ * @return TCP_SYNCOOKIE_INVALID, TCP_SYNCOOKIE_VALID or TCP_SYNCOOKIE_QUEUED
+ *         if the options are in the SYN queue
+ */
+u8_t
+tcp_syncookie_check(struct tcp_syn_entry *syn, u32_t iss)
+{
+  u32_t ctr = tcp_ticks / TCP_SYNCOOKIE_PERIOD;
+  u32_t low = iss & TCP_SYNCOOKIE_LOW_MASK;
+
+  if ((((iss >> TCP_SYNCOOKIE_CTR_SHIFT) ^ ctr) & TCP_SYNCOOKIE_CTR_MASK) != 0) {
+    /* made in the period before? */
+    ctr--;
+    if ((((iss >> TCP_SYNCOOKIE_CTR_SHIFT) ^ ctr) & TCP_SYNCOOKIE_CTR_MASK) != 0) {
+      return TCP_SYNCOOKIE_INVALID;
+    }
+  }
+  if (tcp_syncookie_hash(syn, ctr, low) != (iss & ~TCP_SYNCOOKIE_LOW_MASK)) {
+    return TCP_SYNCOOKIE_INVALID;
+  }
+  syn->iss = iss;
+  syn->mss = LWIP_MIN(tcp_syncookie_mss[iss & TCP_SYNCOOKIE_MSS_MASK], TCP_MSS);
+  return (iss & TCP_SYNCOOKIE_QUEUED_FLAG) ? TCP_SYNCOOKIE_QUEUED : TCP_SYNCOOKIE_VALID;
+}
+
+/** An entry is free if it is unused or timed out like a pcb in SYN_RCVD */
+static u8_t
+tcp_syn_queue_used(const struct tcp_syn_entry *entry)
+{
+  return (u8_t)((entry->listener != NULL) &&
+                ((u32_t)(tcp_ticks - entry->ticks) < TCP_SYN_RCVD_TIMEOUT / TCP_SLOW_INTERVAL));
+}
+
+/**
+ * Find the SYN queue entry of a connection.
+ *
+ * @param syn the connection (addresses and ports are used)
+ * @return the entry or NULL if the connection is not in the queue
+ */
+struct tcp_syn_entry *
+tcp_syn_queue_find(const struct tcp_syn_entry *syn)
+{
+  u8_t i;
+
+  for (i = 0; i < TCP_SYN_QUEUE_SIZE; i++) {
+    struct tcp_syn_entry *entry = &tcp_syn_queue[i];
+    if (tcp_syn_queue_used(entry) &&
+        (entry->local_port == syn->local_port) && (entry->remote_port == syn->remote_port) &&
+        ip_addr_eq(&entry->local_ip, &syn->local_ip) && ip_addr_eq(&entry->remote_ip, &syn->remote_ip)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Put a connection request into the SYN queue (replacing the entry of the
+ * same connection if the SYN was retransmitted).
+ *
+ * @param syn the connection request
+ * @return the entry or NULL if the queue is full
+ */
+struct tcp_syn_entry *
+tcp_syn_queue_add(const struct tcp_syn_entry *syn)
+{
+  struct tcp_syn_entry *entry = tcp_syn_queue_find(syn);
+  u8_t i;
+
+  for (i = 0; (entry == NULL) && (i < TCP_SYN_QUEUE_SIZE); i++) {
+    if (!tcp_syn_queue_used(&tcp_syn_queue[i])) {
+      entry = &tcp_syn_queue[i];
+    }
+  }
+  if (entry != NULL) {
+    SMEMCPY(entry, syn, sizeof(struct tcp_syn_entry));
+  }
+  return entry;
+}
+
+/**
+ * Remove an entry from the SYN queue.
+ *
+ * @param entry the entry returned by tcp_syn_queue_find()
+ */
+void
+tcp_syn_queue_remove(struct tcp_syn_entry *entry)
+{
+  entry->listener = NULL;
+}
+
+/**
+ * Remove the entries of a listener from the SYN queue (it is closed or does
+ * not use SYN cookies any more).
+ *
+ * @param lpcb the listener
+ */
+void
+tcp_syn_queue_purge(const struct tcp_pcb_listen *lpcb)
+{
+  u8_t i;
+
+  for (i = 0; i < TCP_SYN_QUEUE_SIZE; i++) {
+    if (tcp_syn_queue[i].listener == lpcb) {
+      tcp_syn_queue[i].listener = NULL;
+    }
+  }
+}
+
+#endif /* LWIP_TCP && LWIP_TCP_SYN_COOKIES */
@@ -118,11 +118,275 @@ const int lwip_num_cyclic_timers = LWIP_ARRAYSIZE(lwip_cyclic_timers);
 
 #if LWIP_TIMERS && !LWIP_TIMERS_CUSTOM
 
+static u32_t current_timeout_due_time;
+
+#if LWIP_TIMERS_WHEEL
+/* The timing wheel has TIMEO_WHEEL_LEVELS levels of TIMEO_WHEEL_SLOTS slots.
+ * A timeout is kept on the level of the highest group of TIMEO_WHEEL_BITS bits
+ * in which its expiry time differs from wheel_time (the time the wheel has
+ * been advanced to), in the slot selected by that group of its expiry time.
+ * So a slot on level 0 holds timeouts expiring at exactly one time, and the
+ * timeouts of a slot on a higher level are moved down ("cascaded") when
+ * wheel_time reaches the start of the time range covered by that slot.
+ * A bitmap per level marks the slots in use, so finding the next slot to
+ * process does not depend on the number of slots or timeouts. Each slot is a
+ * doubly linked list in the order the timeouts were added to it. */
+#define TIMEO_WHEEL_BITS    5
+#define TIMEO_WHEEL_SLOTS   (1 << TIMEO_WHEEL_BITS)
+#define TIMEO_WHEEL_MASK    (TIMEO_WHEEL_SLOTS - 1)
+/* enough levels to cover all 32 bits of u32_t */
+#define TIMEO_WHEEL_LEVELS  ((32 + TIMEO_WHEEL_BITS - 1) / TIMEO_WHEEL_BITS)
+/* list of timeouts expiring after wheel_time has wrapped around */
+#define TIMEO_LIST_WRAPPED  (TIMEO_WHEEL_LEVELS * TIMEO_WHEEL_SLOTS)
+/* list of timeouts added with an expiry time before wheel_time, sorted by time */
+#define TIMEO_LIST_OVERDUE  (TIMEO_LIST_WRAPPED + 1)
+#define TIMEO_NUM_LISTS     (TIMEO_LIST_OVERDUE + 1)
+
+/** Wheel slots plus the wrapped and the overdue list */
+static struct sys_timeo *timeo_lists[TIMEO_NUM_LISTS];
+/** One bit per used wheel slot */
+static u32_t timeo_wheel_used[TIMEO_WHEEL_LEVELS];
+/** Time the wheel has been advanced to */
+static u32_t wheel_time;
+/** Number of timeouts on the wheel */
+static u32_t timeo_count;
+/** Hash of all timeouts by handler and argument for sys_untimeout() */
+static struct sys_timeo *timeo_hash[SYS_TIMEOUT_HASH_SIZE];
+
+static u32_t
+timeo_hash_idx(sys_timeout_handler handler, void *arg)
+{
+  u32_t key = (u32_t)(mem_ptr_t)handler ^ (u32_t)(mem_ptr_t)arg;
+  key *= 0x9E3779B1UL;
+  return (key >> 16) & (SYS_TIMEOUT_HASH_SIZE - 1);
+}
+
+/** Index of the lowest bit set in a non-zero u32_t */
+static u8_t
+timeo_lowest_bit(u32_t x)
+{
+  static const u8_t debruijn_idx[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+  };
+  return debruijn_idx[(u32_t)((x & (~x + 1)) * 0x077CB531UL) >> 27];
+}
+
+static void
+timeo_list_insert(u8_t list, struct sys_timeo *timeout, struct sys_timeo *before)
+{
+  struct sys_timeo *head = timeo_lists[list];
+
+  timeout->list = list;
+  if (head == NULL) {
+    timeout->next = NULL;
+    timeout->prev = timeout;
+    timeo_lists[list] = timeout;
+  } else if (before == NULL) {
+    /* append */
+    timeout->next = NULL;
+    timeout->prev = head->prev;
+    head->prev->next = timeout;
+    head->prev = timeout;
+  } else {
+    timeout->next = before;
+    timeout->prev = before->prev;
+    if (before == head) {
+      timeo_lists[list] = timeout;
+    } else {
+      before->prev->next = timeout;
+    }
+    before->prev = timeout;
+  }
+  if (list < TIMEO_LIST_WRAPPED) {
+    timeo_wheel_used[list / TIMEO_WHEEL_SLOTS] |= (u32_t)1 << (list % TIMEO_WHEEL_SLOTS);
+  }
+}
+
+static void
+timeo_list_remove(struct sys_timeo *timeout)
+{
+  u8_t list = timeout->list;
+  struct sys_timeo *head = timeo_lists[list];
+
+  if (timeout == head) {
+    timeo_lists[list] = timeout->next;
+  } else {
+    timeout->prev->next = timeout->next;
+  }
+  if (timeout->next != NULL) {
+    timeout->next->prev = timeout->prev;
+  } else if (timeout != head) {
+    head->prev = timeout->prev;
+  }
+  if ((timeo_lists[list] == NULL) && (list < TIMEO_LIST_WRAPPED)) {
+    timeo_wheel_used[list / TIMEO_WHEEL_SLOTS] &= ~((u32_t)1 << (list % TIMEO_WHEEL_SLOTS));
+  }
+}
+
+/** Put a timeout on the wheel slot (or list) matching its expiry time */
+static void
+timeo_wheel_add(struct sys_timeo *timeout)
+{
+  u32_t diff;
+  u8_t level;
+
+  if (TIME_LESS_THAN(timeout->time, wheel_time)) {
+    struct sys_timeo *t;
+    for (t = timeo_lists[TIMEO_LIST_OVERDUE]; t != NULL; t = t->next) {
+      if (TIME_LESS_THAN(timeout->time, t->time)) {
+        break;
+      }
+    }
+    timeo_list_insert(TIMEO_LIST_OVERDUE, timeout, t);
+    return;
+  }
+  if (timeout->time < wheel_time) {
+    timeo_list_insert(TIMEO_LIST_WRAPPED, timeout, NULL);
+    return;
+  }
+  diff = timeout->time ^ wheel_time;
+  for (level = 0; diff > TIMEO_WHEEL_MASK; level++) {
+    diff >>= TIMEO_WHEEL_BITS;
+  }
+  timeo_list_insert((u8_t)(level * TIMEO_WHEEL_SLOTS + ((timeout->time >> (level * TIMEO_WHEEL_BITS)) & TIMEO_WHEEL_MASK)),
+                    timeout, NULL);
+}
+
+/** Find the next wheel slot that has to be processed (overdue list not included).
+ * @param time returns the time at which this slot has to be processed
+ * @return index of the slot, TIMEO_LIST_WRAPPED if wheel_time has to wrap
+ *         around first or TIMEO_NUM_LISTS if there are no timeouts
+ */
+static u16_t
+timeo_wheel_next(u32_t *time)
+{
+  u32_t used;
+  u8_t level, slot, shift;
+
+  used = timeo_wheel_used[0] & ((u32_t)0xffffffffUL << (wheel_time & TIMEO_WHEEL_MASK));
+  if (used != 0) {
+    slot = timeo_lowest_bit(used);
+    *time = (wheel_time & ~(u32_t)TIMEO_WHEEL_MASK) | slot;
+    return slot;
+  }
+  for (level = 1; level < TIMEO_WHEEL_LEVELS; level++) {
+    used = timeo_wheel_used[level];
+    if (used != 0) {
+      slot = timeo_lowest_bit(used);
+      shift = (u8_t)(level * TIMEO_WHEEL_BITS);
+      *time = (u32_t)slot << shift;
+      if (shift + TIMEO_WHEEL_BITS < 32) {
+        *time |= wheel_time & ~(((u32_t)1 << (shift + TIMEO_WHEEL_BITS)) - 1);
+      }
+      return (u16_t)(level * TIMEO_WHEEL_SLOTS + slot);
+    }
+  }
+  if (timeo_lists[TIMEO_LIST_WRAPPED] != NULL) {
+    *time = 0;
+    return TIMEO_LIST_WRAPPED;
+  }
+  return TIMEO_NUM_LISTS;
+}
+
+/** Find the expiry time of the next timeout
+ * @return 1 if there is a timeout, 0 otherwise
+ */
+static int
+timeo_next_time(u32_t *time)
+{
+  struct sys_timeo *t;
+  u16_t list;
+
+  if (timeo_lists[TIMEO_LIST_OVERDUE] != NULL) {
+    *time = timeo_lists[TIMEO_LIST_OVERDUE]->time;
+    return 1;
+  }
+  list = timeo_wheel_next(time);
+  if (list == TIMEO_NUM_LISTS) {
+    return 0;
+  }
+  if (list >= TIMEO_WHEEL_SLOTS) {
+    /* timeouts on higher levels are not sorted */
+    *time = timeo_lists[list]->time;
+    for (t = timeo_lists[list]->next; t != NULL; t = t->next) {
+      if (TIME_LESS_THAN(t->time, *time)) {
+        *time = t->time;
+      }
+    }
+  }
+  return 1;
+}
+
+/** Remove a timeout from the wheel (it is not freed) */
+static void
+timeo_remove(struct sys_timeo *timeout)
+{
+  timeo_list_remove(timeout);
+  *timeout->hash_pprev = timeout->hash_next;
+  if (timeout->hash_next != NULL) {
+    timeout->hash_next->hash_pprev = timeout->hash_pprev;
+  }
+  timeo_count--;
+}
+
+/** Add a timeout to the wheel */
+static void
+timeo_insert(struct sys_timeo *timeout)
+{
+  struct sys_timeo **bucket = &timeo_hash[timeo_hash_idx(timeout->h, timeout->arg)];
+
+  if (timeo_count == 0) {
+    /* (re)start the wheel at the current time */
+    wheel_time = sys_now();
+  }
+  timeo_count++;
+  timeout->hash_next = *bucket;
+  if (*bucket != NULL) {
+    (*bucket)->hash_pprev = &timeout->hash_next;
+  }
+  timeout->hash_pprev = bucket;
+  *bucket = timeout;
+  timeo_wheel_add(timeout);
+}
+
+#if LWIP_TESTMODE
+/** Take all timeouts off the wheel, returns them linked by 'next' */
+struct sys_timeo *
+sys_timeouts_take_all(void)
+{
+  struct sys_timeo *all = NULL, *t;
+  u16_t list;
+
+  for (list = 0; list < TIMEO_NUM_LISTS; list++) {
+    while ((t = timeo_lists[list]) != NULL) {
+      timeo_remove(t);
+      t->next = all;
+      all = t;
+    }
+  }
+  return all;
+}
+
+/** Put timeouts taken off by sys_timeouts_take_all() back on the wheel */
+void
+sys_timeouts_put_all(struct sys_timeo *timeouts)
+{
+  struct sys_timeo *t;
+
+  while (timeouts != NULL) {
+    t = timeouts;
+    timeouts = t->next;
+    timeo_insert(t);
+  }
+}
+#endif /* LWIP_TESTMODE */
+
+#else /* LWIP_TIMERS_WHEEL */
+
 /** The one and only timeout list */
 static struct sys_timeo *next_timeout;
 
-static u32_t current_timeout_due_time;
-
 #if LWIP_TESTMODE
 struct sys_timeo**
 sys_timeouts_get_next_timeout(void)
@@ -130,6 +394,7 @@ sys_timeouts_get_next_timeout(void)
   return &next_timeout;
 }
 #endif
+#endif /* LWIP_TIMERS_WHEEL */
 
 #if LWIP_TCP
 /** global variable that shows if the tcp timer is currently scheduled or not */
@@ -183,7 +448,10 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg, const ch
 sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
 #endif
 {
-  struct sys_timeo *timeout, *t;
+  struct sys_timeo *timeout;
+#if !LWIP_TIMERS_WHEEL
+  struct sys_timeo *t;
+#endif /* !LWIP_TIMERS_WHEEL */
 
   timeout = (struct sys_timeo *)memp_malloc(MEMP_SYS_TIMEOUT);
   if (timeout == NULL) {
@@ -202,6 +470,9 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
                              (void *)timeout, abs_time, handler_name, (void *)arg));
 #endif /* LWIP_DEBUG_TIMERNAMES */
 
+#if LWIP_TIMERS_WHEEL
+  timeo_insert(timeout);
+#else /* LWIP_TIMERS_WHEEL */
   if (next_timeout == NULL) {
     next_timeout = timeout;
     return;
@@ -218,6 +489,7 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
       }
     }
   }
+#endif /* LWIP_TIMERS_WHEEL */
 }
 
 /**
@@ -316,6 +588,23 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
 void
 sys_untimeout(sys_timeout_handler handler, void *arg)
 {
+#if LWIP_TIMERS_WHEEL
+  struct sys_timeo *match = NULL, *t;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  /* find the first one to expire if the same timeout is added more than once */
+  for (t = timeo_hash[timeo_hash_idx(handler, arg)]; t != NULL; t = t->hash_next) {
+    if ((t->h == handler) && (t->arg == arg) &&
+        ((match == NULL) || TIME_LESS_THAN(t->time, match->time))) {
+      match = t;
+    }
+  }
+  if (match != NULL) {
+    timeo_remove(match);
+    memp_free(MEMP_SYS_TIMEOUT, match);
+  }
+#else /* LWIP_TIMERS_WHEEL */
   struct sys_timeo *prev_t, *t;
 
   LWIP_ASSERT_CORE_LOCKED();
@@ -337,7 +626,7 @@ sys_untimeout(sys_timeout_handler handler, void *arg)
       return;
     }
   }
-  return;
+#endif /* LWIP_TIMERS_WHEEL */
 }
 
 /**
@@ -362,9 +651,48 @@ sys_check_timeouts(void)
     struct sys_timeo *tmptimeout;
     sys_timeout_handler handler;
     void *arg;
+#if LWIP_TIMERS_WHEEL
+    u32_t time;
+    u16_t list;
+#endif /* LWIP_TIMERS_WHEEL */
 
     PBUF_CHECK_FREE_OOSEQ();
 
+#if LWIP_TIMERS_WHEEL
+    tmptimeout = timeo_lists[TIMEO_LIST_OVERDUE];
+    if (tmptimeout == NULL) {
+      list = timeo_wheel_next(&time);
+      if ((list == TIMEO_NUM_LISTS) || TIME_LESS_THAN(now, time)) {
+        /* nothing expired: the wheel can be advanced to now */
+        if (!TIME_LESS_THAN(now, wheel_time)) {
+          wheel_time = now;
+        }
+        return;
+      }
+      wheel_time = time;
+      if (list >= TIMEO_WHEEL_SLOTS) {
+        /* move the timeouts of this slot to lower levels */
+        struct sys_timeo *t = timeo_lists[list];
+        timeo_lists[list] = NULL;
+        if (list < TIMEO_LIST_WRAPPED) {
+          timeo_wheel_used[list / TIMEO_WHEEL_SLOTS] &= ~((u32_t)1 << (list % TIMEO_WHEEL_SLOTS));
+        }
+        while (t != NULL) {
+          tmptimeout = t;
+          t = t->next;
+          timeo_wheel_add(tmptimeout);
+        }
+        continue;
+      }
+      tmptimeout = timeo_lists[list];
+    } else if (TIME_LESS_THAN(now, tmptimeout->time)) {
+      /* time went backwards: the earliest timeout is not due yet */
+      return;
+    }
+
+    /* Timeout has expired */
+    timeo_remove(tmptimeout);
+#else /* LWIP_TIMERS_WHEEL */
     tmptimeout = next_timeout;
     if (tmptimeout == NULL) {
       return;
@@ -376,6 +704,7 @@ sys_check_timeouts(void)
 
     /* Timeout has expired */
     next_timeout = tmptimeout->next;
+#endif /* LWIP_TIMERS_WHEEL */
     handler = tmptimeout->h;
     arg = tmptimeout->arg;
     current_timeout_due_time = tmptimeout->time;
@@ -406,6 +735,39 @@ sys_restart_timeouts(void)
   u32_t now;
   u32_t base;
   struct sys_timeo *t;
+#if LWIP_TIMERS_WHEEL
+  struct sys_timeo *all = NULL, *last = NULL;
+  u16_t list;
+
+  if (!timeo_next_time(&base)) {
+    return;
+  }
+
+  now = sys_now();
+
+  /* take all timeouts off the wheel and put them back with the new times */
+  for (list = 0; list < TIMEO_NUM_LISTS; list++) {
+    if (timeo_lists[list] != NULL) {
+      if (last == NULL) {
+        all = timeo_lists[list];
+      } else {
+        last->next = timeo_lists[list];
+      }
+      last = timeo_lists[list]->prev;
+      timeo_lists[list] = NULL;
+    }
+  }
+  for (list = 0; list < TIMEO_WHEEL_LEVELS; list++) {
+    timeo_wheel_used[list] = 0;
+  }
+  wheel_time = now;
+  while (all != NULL) {
+    t = all;
+    all = t->next;
+    t->time = (t->time - base) + now;
+    timeo_wheel_add(t);
+  }
+#else /* LWIP_TIMERS_WHEEL */
 
   if (next_timeout == NULL) {
     return;
@@ -417,6 +779,7 @@ sys_restart_timeouts(void)
   for (t = next_timeout; t != NULL; t = t->next) {
     t->time = (t->time - base) + now;
   }
+#endif /* LWIP_TIMERS_WHEEL */
 }
 
 /** Return the time left before the next timeout is due. If no timeouts are
@@ -426,17 +789,25 @@ u32_t
 sys_timeouts_sleeptime(void)
 {
   u32_t now;
+  u32_t next_time;
 
   LWIP_ASSERT_CORE_LOCKED();
 
+#if LWIP_TIMERS_WHEEL
+  if (!timeo_next_time(&next_time)) {
+    return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
+  }
+#else /* LWIP_TIMERS_WHEEL */
   if (next_timeout == NULL) {
     return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
   }
+  next_time = next_timeout->time;
+#endif /* LWIP_TIMERS_WHEEL */
   now = sys_now();
-  if (TIME_LESS_THAN(next_timeout->time, now)) {
+  if (TIME_LESS_THAN(next_time, now)) {
     return 0;
   } else {
-    u32_t ret = (u32_t)(next_timeout->time - now);
+    u32_t ret = (u32_t)(next_time - now);
     LWIP_ASSERT("invalid sleeptime", ret <= LWIP_MAX_TIMEOUT);
     return ret;
   }
@@ -62,6 +62,7 @@
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
 #include "lwip/dhcp.h"
+#include "lwip/priv/portmap.h"
 
 #include <string.h>
 
@@ -73,20 +74,38 @@
 #define UDP_ENSURE_LOCAL_PORT_RANGE(port) ((u16_t)(((port) & (u16_t)~UDP_LOCAL_PORT_RANGE_START) + UDP_LOCAL_PORT_RANGE_START))
 #endif
 
+#if LWIP_PORT_BITMAP
+/* used local UDP ports */
+PORTMAP_DECLARE(udp_portmap, UDP_LOCAL_PORT_RANGE_START, UDP_LOCAL_PORT_RANGE_END);
+#else /* LWIP_PORT_BITMAP */
 /* last local UDP port */
 static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
+#endif /* LWIP_PORT_BITMAP */
 
 /* The list of UDP PCBs */
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if LWIP_UDP_PCB_HASH
+/* Hash buckets of UDP PCBs, keyed by local port */
+static struct udp_pcb *udp_pcb_hash[UDP_PCB_HASH_SIZE];
+
+/* The chain of PCBs that may be bound to a port is its hash bucket */
+#define UDP_PORT_PCBS(port) (&udp_pcb_hash[(port) & (UDP_PCB_HASH_SIZE - 1)])
+#define UDP_PCB_NEXT(pcb)   ((pcb)->hash_next)
+#else /* LWIP_UDP_PCB_HASH */
+/* Without hash index, every PCB may be bound to the port */
+#define UDP_PORT_PCBS(port) (&udp_pcbs)
+#define UDP_PCB_NEXT(pcb)   ((pcb)->next)
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * Initialize this module.
  */
 void
 udp_init(void)
 {
-#ifdef LWIP_RAND
+#if defined(LWIP_RAND) && !LWIP_PORT_BITMAP
   udp_port = UDP_ENSURE_LOCAL_PORT_RANGE(LWIP_RAND());
 #endif /* LWIP_RAND */
 }
@@ -99,6 +118,9 @@ udp_init(void)
 static u16_t
 udp_new_port(void)
 {
+#if LWIP_PORT_BITMAP
+  return portmap_find(&udp_portmap);
+#else /* LWIP_PORT_BITMAP */
   u16_t n = 0;
   struct udp_pcb *pcb;
 
@@ -106,8 +128,8 @@ again:
   if (udp_port++ == UDP_LOCAL_PORT_RANGE_END) {
     udp_port = UDP_LOCAL_PORT_RANGE_START;
   }
-  /* Check all PCBs. */
-  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+  /* Check all PCBs that may be bound to this port. */
+  for (pcb = *UDP_PORT_PCBS(udp_port); pcb != NULL; pcb = UDP_PCB_NEXT(pcb)) {
     if (pcb->local_port == udp_port) {
       if (++n > (UDP_LOCAL_PORT_RANGE_END - UDP_LOCAL_PORT_RANGE_START)) {
         return 0;
@@ -116,8 +138,33 @@ again:
     }
   }
   return udp_port;
+#endif /* LWIP_PORT_BITMAP */
 }
 
+#if LWIP_PORT_BITMAP
+/**
+ * Update the port bitmap for a pcb that releases its local port.
+ * If the port was used more than once, the remaining pcbs are counted.
+ *
+ * @param pcb the pcb that releases its local port
+ */
+static void
+udp_port_release(struct udp_pcb *pcb)
+{
+  if (portmap_release(&udp_portmap, pcb->local_port)) {
+    struct udp_pcb *ipcb;
+    u32_t users = 0;
+
+    for (ipcb = *UDP_PORT_PCBS(pcb->local_port); ipcb != NULL; ipcb = UDP_PCB_NEXT(ipcb)) {
+      if ((ipcb != pcb) && (ipcb->local_port == pcb->local_port)) {
+        users++;
+      }
+    }
+    portmap_set_users(&udp_portmap, pcb->local_port, users);
+  }
+}
+#endif /* LWIP_PORT_BITMAP */
+
 /** Common code to see if the current input packet matches the pcb
  * (current input packet is accessed via ip(4/6)_current_* macros)
  *
@@ -178,6 +225,79 @@ udp_input_local_match(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast)
   return 0;
 }
 
+#if LWIP_UDP_PCB_HASH
+/** Remove a PCB from the hash bucket of its local port (if it is in there) */
+static void
+udp_pcb_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **prev;
+
+  for (prev = UDP_PORT_PCBS(pcb->local_port); *prev != NULL; prev = &(*prev)->hash_next) {
+    if (*prev == pcb) {
+      *prev = pcb->hash_next;
+      break;
+    }
+  }
+  pcb->hash_next = NULL;
+}
+#endif /* LWIP_UDP_PCB_HASH */
+
+#if LWIP_UDP_REUSEPORT
+/** Select the PCB of a reuse-port group that gets the current input packet.
+ * The group consists of all unconnected PCBs with UDP_FLAGS_REUSEPORT that are
+ * bound to the same local address and port as 'pcb' and match the packet.
+ * Rendezvous hashing over the flow (source address and port) is used so that
+ * a flow sticks to one PCB regardless of the order of the PCBs in the list,
+ * and only the flows of a PCB are redistributed if it leaves the group.
+ *
+ * @param pcb first matching unconnected pcb (which has UDP_FLAGS_REUSEPORT set)
+ * @param inp network interface on which the datagram was received
+ * @param broadcast 1 if his is an IPv4 broadcast (global or subnet-only), 0 otherwise
+ * @param src source port of the datagram
+ * @return the selected pcb
+ */
+static struct udp_pcb *
+udp_reuseport_select(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast, u16_t src)
+{
+  struct udp_pcb *cur, *best = pcb;
+  u32_t flow, score, best_score = 0;
+  const ip_addr_t *src_ip = ip_current_src_addr();
+
+#if LWIP_IPV6
+  if (IP_IS_V6(src_ip)) {
+    const ip6_addr_t *src_ip6 = ip_2_ip6(src_ip);
+    flow = src_ip6->addr[0] ^ src_ip6->addr[1] ^ src_ip6->addr[2] ^ src_ip6->addr[3];
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    flow = ip4_addr_get_u32(ip_2_ip4(src_ip));
+#else /* LWIP_IPV4 */
+    flow = 0;
+#endif /* LWIP_IPV4 */
+  }
+  flow ^= src;
+
+  for (cur = *UDP_PORT_PCBS(pcb->local_port); cur != NULL; cur = UDP_PCB_NEXT(cur)) {
+    if ((cur->local_port == pcb->local_port) &&
+        ((cur->flags & (UDP_FLAGS_REUSEPORT | UDP_FLAGS_CONNECTED)) == UDP_FLAGS_REUSEPORT) &&
+        ip_addr_eq(&cur->local_ip, &pcb->local_ip) &&
+        (udp_input_local_match(cur, inp, broadcast) != 0)) {
+      /* mix flow and pcb identity, the pcb with the highest score wins */
+      score = (flow ^ (u32_t)(mem_ptr_t)cur) * 0x9E3779B1UL;
+      score ^= score >> 15;
+      score *= 0x85EBCA77UL;
+      score ^= score >> 13;
+      if ((best_score == 0) || (score > best_score)) {
+        best = cur;
+        best_score = score;
+      }
+    }
+  }
+  return best;
+}
+#endif /* LWIP_UDP_REUSEPORT */
+
 /**
  * Process an incoming UDP datagram.
  *
@@ -196,6 +316,7 @@ udp_input(struct pbuf *p, struct netif *inp)
   struct udp_hdr *udphdr;
   struct udp_pcb *pcb, *prev;
   struct udp_pcb *uncon_pcb;
+  struct udp_pcb **pcbs;
   u16_t src, dest;
   u8_t broadcast;
   u8_t for_us = 0;
@@ -246,11 +367,12 @@ udp_input(struct pbuf *p, struct netif *inp)
   pcb = NULL;
   prev = NULL;
   uncon_pcb = NULL;
+  pcbs = UDP_PORT_PCBS(dest);
   /* Iterate through the UDP pcb list for a matching pcb.
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
    * matches the local port and ip address gets the datagram. */
-  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+  for (pcb = *pcbs; pcb != NULL; pcb = UDP_PCB_NEXT(pcb)) {
     /* print the PCB local and remote address */
     LWIP_DEBUGF(UDP_DEBUG, ("pcb ("));
     ip_addr_debug_print_val(UDP_DEBUG, pcb->local_ip);
@@ -291,11 +413,11 @@ udp_input(struct pbuf *p, struct netif *inp)
            ip_addr_eq(&pcb->remote_ip, ip_current_src_addr()))) {
         /* the first fully matching PCB */
         if (prev != NULL) {
-          /* move the pcb to the front of udp_pcbs so that is
-             found faster next time */
-          prev->next = pcb->next;
-          pcb->next = udp_pcbs;
-          udp_pcbs = pcb;
+          /* move the pcb to the front of udp_pcbs (or its hash bucket)
+             so that is found faster next time */
+          UDP_PCB_NEXT(prev) = UDP_PCB_NEXT(pcb);
+          UDP_PCB_NEXT(pcb) = *pcbs;
+          *pcbs = pcb;
         } else {
           UDP_STATS_INC(udp.cachehit);
         }
@@ -308,6 +430,12 @@ udp_input(struct pbuf *p, struct netif *inp)
   /* no fully matching pcb found? then look for an unconnected pcb */
   if (pcb == NULL) {
     pcb = uncon_pcb;
+#if LWIP_UDP_REUSEPORT
+    if ((pcb != NULL) && (pcb->flags & UDP_FLAGS_REUSEPORT)) {
+      /* spread flows across all pcbs sharing this address and port */
+      pcb = udp_reuseport_select(pcb, inp, broadcast, src);
+    }
+#endif /* LWIP_UDP_REUSEPORT */
   }
 
   /* Check checksum if this is a match or if it was directed at us. */
@@ -380,7 +508,7 @@ udp_input(struct pbuf *p, struct netif *inp)
         /* pass broadcast- or multicast packets to all multicast pcbs
            if SOF_REUSEADDR is set on the first match */
         struct udp_pcb *mpcb;
-        for (mpcb = udp_pcbs; mpcb != NULL; mpcb = mpcb->next) {
+        for (mpcb = *pcbs; mpcb != NULL; mpcb = UDP_PCB_NEXT(mpcb)) {
           if (mpcb != pcb) {
             /* compare PCB local addr+port to UDP destination addr+port */
             if ((mpcb->local_port == dest) &&
@@ -693,6 +821,74 @@ udp_sendto_if_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_i
 #endif /* LWIP_CHECKSUM_ON_COPY && CHECKSUM_GEN_UDP */
 }
 
+#if LWIP_UDP_GSO
+/** Send the data of p as datagrams of pcb->gso_size bytes (the last one may
+ * be shorter) over one netif. Every datagram references its part of p with
+ * PBUF_REF pbufs. Sending stops at the first error.
+ */
+static err_t
+udp_sendto_if_src_segmented(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip,
+                            u16_t dst_port, struct netif *netif, const ip_addr_t *src_ip)
+{
+  struct pbuf *r, *seg, *q;
+  u16_t offset, seglen, left, len, roff;
+  u16_t hlen = UDP_HLEN;
+  err_t err = ERR_OK;
+
+  /* all datagrams must fit into the MTU, we don't send a train of fragments */
+#if LWIP_IPV6
+  if (IP_IS_V6(dst_ip)) {
+    hlen += IP6_HLEN;
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    hlen += IP_HLEN;
+#endif /* LWIP_IPV4 */
+  }
+  if ((netif->mtu != 0) && ((u32_t)pcb->gso_size + hlen > netif->mtu)) {
+    LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("udp_send: gso_size %"U16_F" exceeds the MTU\n", pcb->gso_size));
+    return ERR_VAL;
+  }
+
+  r = p;
+  roff = 0;
+  for (offset = 0; (err == ERR_OK) && (offset < p->tot_len); offset = (u16_t)(offset + seglen)) {
+    seglen = (u16_t)LWIP_MIN(pcb->gso_size, p->tot_len - offset);
+    seg = NULL;
+    for (left = seglen; left > 0; left = (u16_t)(left - len)) {
+      while (roff == r->len) {
+        r = r->next;
+        roff = 0;
+        LWIP_ASSERT("udp_sendto_if_src_segmented: pbuf chain too short", r != NULL);
+      }
+      len = (u16_t)LWIP_MIN(left, r->len - roff);
+      q = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+      if (q == NULL) {
+        err = ERR_MEM;
+        break;
+      }
+      q->payload = (u8_t *)r->payload + roff;
+      q->len = q->tot_len = len;
+      if (seg == NULL) {
+        seg = q;
+      } else {
+        pbuf_cat(seg, q);
+      }
+      roff = (u16_t)(roff + len);
+    }
+    if (err == ERR_OK) {
+      /* not larger than gso_size: sent as one datagram */
+      err = udp_sendto_if_src(pcb, seg, dst_ip, dst_port, netif, src_ip);
+    }
+    if (seg != NULL) {
+      pbuf_free(seg);
+    }
+  }
+  return err;
+}
+#endif /* LWIP_UDP_GSO */
+
 /** @ingroup udp_raw
  * Same as @ref udp_sendto_if, but with source address */
 err_t
@@ -752,6 +948,14 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
     }
   }
 
+#if LWIP_UDP_GSO
+  if ((pcb->gso_size != 0) && (p->tot_len > pcb->gso_size)) {
+    /* a checksum computed while copying covers the whole pbuf, so it is
+       of no use for the datagrams */
+    return udp_sendto_if_src_segmented(pcb, p, dst_ip, dst_port, netif, src_ip);
+  }
+#endif /* LWIP_UDP_GSO */
+
   /* packet too large to add a UDP header without causing an overflow? */
   if ((u16_t)(p->tot_len + UDP_HLEN) < p->tot_len) {
     return ERR_MEM;
@@ -955,8 +1159,9 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE, (", port = %"U16_F")\n", port));
 
   rebind = 0;
-  /* Check for double bind and rebind of the same pcb */
-  for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+  /* Check for double bind and rebind of the same pcb
+     (a pcb on the list is always bound to a port) */
+  for (ipcb = *UDP_PORT_PCBS(pcb->local_port); ipcb != NULL; ipcb = UDP_PCB_NEXT(ipcb)) {
     /* is this UDP PCB already on active list? */
     if (pcb == ipcb) {
       rebind = 1;
@@ -985,15 +1190,18 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
       return ERR_USE;
     }
   } else {
-    for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+    for (ipcb = *UDP_PORT_PCBS(port); ipcb != NULL; ipcb = UDP_PCB_NEXT(ipcb)) {
       if (pcb != ipcb) {
         /* By default, we don't allow to bind to a port that any other udp
            PCB is already bound to, unless *all* PCBs with that port have the
-           REUSEADDR flag set. */
+           REUSEADDR (or REUSEPORT) flag set. */
 #if SO_REUSE
         if (!ip_get_option(pcb, SOF_REUSEADDR) ||
             !ip_get_option(ipcb, SOF_REUSEADDR))
 #endif /* SO_REUSE */
+#if LWIP_UDP_REUSEPORT
+        if (!(pcb->flags & ipcb->flags & UDP_FLAGS_REUSEPORT))
+#endif /* LWIP_UDP_REUSEPORT */
         {
           /* port matches that of PCB in list and REUSEADDR not set -> reject */
           if ((ipcb->local_port == port) &&
@@ -1016,6 +1224,18 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
+#if LWIP_UDP_PCB_HASH
+  if (rebind) {
+    /* the pcb may move to another bucket */
+    udp_pcb_hash_remove(pcb);
+  }
+#endif /* LWIP_UDP_PCB_HASH */
+#if LWIP_PORT_BITMAP
+  if (rebind) {
+    udp_port_release(pcb);
+  }
+  portmap_acquire(&udp_portmap, port);
+#endif /* LWIP_PORT_BITMAP */
   pcb->local_port = port;
   mib2_udp_bind(pcb);
   /* pcb not active yet? */
@@ -1024,6 +1244,10 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
   }
+#if LWIP_UDP_PCB_HASH
+  pcb->hash_next = *UDP_PORT_PCBS(port);
+  *UDP_PORT_PCBS(port) = pcb;
+#endif /* LWIP_UDP_PCB_HASH */
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print_val(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, pcb->local_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->local_port));
@@ -1107,7 +1331,7 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->remote_port));
 
   /* Insert UDP PCB into the list of active UDP PCBs. */
-  for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+  for (ipcb = *UDP_PORT_PCBS(pcb->local_port); ipcb != NULL; ipcb = UDP_PCB_NEXT(ipcb)) {
     if (pcb == ipcb) {
       /* already on the list, just return */
       return ERR_OK;
@@ -1116,6 +1340,10 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   /* PCB not yet on the list, add PCB now */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
+#if LWIP_UDP_PCB_HASH
+  pcb->hash_next = *UDP_PORT_PCBS(pcb->local_port);
+  *UDP_PORT_PCBS(pcb->local_port) = pcb;
+#endif /* LWIP_UDP_PCB_HASH */
   return ERR_OK;
 }
 
@@ -1189,6 +1417,14 @@ udp_remove(struct udp_pcb *pcb)
   LWIP_ERROR("udp_remove: invalid pcb", pcb != NULL, return);
 
   mib2_udp_unbind(pcb);
+#if LWIP_PORT_BITMAP
+  if (pcb->local_port != 0) {
+    udp_port_release(pcb);
+  }
+#endif /* LWIP_PORT_BITMAP */
+#if LWIP_UDP_PCB_HASH
+  udp_pcb_hash_remove(pcb);
+#endif /* LWIP_UDP_PCB_HASH */
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
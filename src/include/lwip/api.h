@@ -65,6 +65,7 @@ extern "C" {
 #define NETCONN_DONTBLOCK   0x04
 #define NETCONN_NOAUTORCVD  0x08 /* prevent netconn_recv_data_tcp() from updating the tcp window - must be done manually via netconn_tcp_recvd() */
 #define NETCONN_NOFIN       0x10 /* upper layer already received data, leave FIN in queue until called again */
+#define NETCONN_ZEROCOPY    0x20 /* don't copy, reference the data until it is acknowledged (see netconn_zerocopy_completed()) */
 
 /* Flags for struct netconn.flags (u8_t) */
 /** This netconn had an error, don't block on recvmbox/acceptmbox any more */
@@ -214,6 +215,83 @@ struct api_msg;
 /** A callback prototype to inform about events for a netconn */
 typedef void (* netconn_callback)(struct netconn *, enum netconn_evt, u16_t len);
 
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+/** Zero-copy writes (NETCONN_ZEROCOPY) of a TCP netconn. Writes are numbered
+ * from 0 on, a write is completed when all of its data is acknowledged. */
+struct netconn_zerocopy {
+  /** number of the next zero-copy write */
+  u32_t next;
+  /** writes before this number are completed */
+  u32_t done;
+  /** writes before this number have been returned by netconn_zerocopy_completed() */
+  u32_t reported;
+  /** writes not completed yet, oldest first: when 'seqno' is acknowledged,
+      the writes before 'next' are completed */
+  struct {
+    u32_t seqno;
+    u32_t next;
+  } pending[LWIP_SO_ZEROCOPY_PENDING];
+  u8_t pending_first;
+  u8_t pending_num;
+};
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
+
+#if LWIP_TCP && LWIP_NETCONN_RING
+struct netconn_ring;
+struct netconn_ring_op;
+
+/** @ingroup netconn_tcp
+ * Operations that can be queued to a @ref netconn_ring_get_sqe "netconn_ring" */
+enum netconn_ring_opcode {
+  /** accept a connection on a listening netconn: completed with the new netconn */
+  NETCONN_RING_ACCEPT,
+  /** connect to 'addr' and 'port' */
+  NETCONN_RING_CONNECT,
+  /** receive up to 'len' bytes into 'buf': completed with 0 bytes when the
+      remote side has closed the connection */
+  NETCONN_RING_RECV,
+  /** send 'len' bytes from 'buf': completed when all of them are enqueued */
+  NETCONN_RING_SEND,
+  /** close and delete the netconn: operations still waiting for it are
+      completed with ERR_CLSD first */
+  NETCONN_RING_CLOSE
+};
+
+/** @ingroup netconn_tcp
+ * An entry of the submission ring */
+struct netconn_ring_sqe {
+  /** the operation (enum netconn_ring_opcode) */
+  u8_t opcode;
+  /** the netconn, created with @ref netconn_ring_callback as callback */
+  struct netconn *conn;
+  /** RECV/SEND: the application buffer, it must stay valid until the
+      operation is completed */
+  void *buf;
+  /** RECV/SEND: size of the buffer */
+  size_t len;
+  /** CONNECT: remote address and port */
+  ip_addr_t addr;
+  u16_t port;
+  /** passed to the completion unchanged */
+  void *user_data;
+};
+
+/** @ingroup netconn_tcp
+ * An entry of the completion ring */
+struct netconn_ring_cqe {
+  /** user_data of the submission */
+  void *user_data;
+  /** ACCEPT: the new netconn, else the netconn of the submission */
+  struct netconn *conn;
+  /** RECV/SEND: number of bytes received/sent */
+  size_t len;
+  /** result of the operation */
+  err_t err;
+  /** the operation (enum netconn_ring_opcode) */
+  u8_t opcode;
+};
+#endif /* LWIP_TCP && LWIP_NETCONN_RING */
+
 /** A netconn descriptor */
 struct netconn {
   /** type of the netconn (TCP, UDP or RAW) */
@@ -280,6 +358,17 @@ struct netconn {
       this temporarily stores the message.
       Also used during connect and close. */
   struct api_msg *current_msg;
+#if LWIP_SO_ZEROCOPY
+  /** TCP: zero-copy writes waiting to be acknowledged */
+  struct netconn_zerocopy zerocopy;
+#endif /* LWIP_SO_ZEROCOPY */
+#if LWIP_NETCONN_RING
+  /** TCP: netconn_ring operations waiting for this netconn, oldest first */
+  struct netconn_ring_op *ring_ops;
+  /** TCP: data taken from recvmbox by a netconn_ring RECV that did not fit
+      into its buffer */
+  struct pbuf *ring_lastdata;
+#endif /* LWIP_NETCONN_RING */
 #endif /* LWIP_TCP */
   /** A callback function that is informed about events for this netconn */
   netconn_callback callback;
@@ -334,12 +423,15 @@ err_t   netconn_accept(struct netconn *conn, struct netconn **new_conn);
 err_t   netconn_recv(struct netconn *conn, struct netbuf **new_buf);
 err_t   netconn_recv_udp_raw_netbuf(struct netconn *conn, struct netbuf **new_buf);
 err_t   netconn_recv_udp_raw_netbuf_flags(struct netconn *conn, struct netbuf **new_buf, u8_t apiflags);
+err_t   netconn_recv_udp_raw_multi(struct netconn *conn, struct netbuf **bufs, u16_t num,
+                                   u16_t *received, u8_t apiflags);
 err_t   netconn_recv_tcp_pbuf(struct netconn *conn, struct pbuf **new_buf);
 err_t   netconn_recv_tcp_pbuf_flags(struct netconn *conn, struct pbuf **new_buf, u8_t apiflags);
 err_t   netconn_tcp_recvd(struct netconn *conn, size_t len);
 err_t   netconn_sendto(struct netconn *conn, struct netbuf *buf,
                              const ip_addr_t *addr, u16_t port);
 err_t   netconn_send(struct netconn *conn, struct netbuf *buf);
+err_t   netconn_send_multi(struct netconn *conn, struct netbuf **bufs, u16_t num, u16_t *sent);
 err_t   netconn_write_partly(struct netconn *conn, const void *dataptr, size_t size,
                              u8_t apiflags, size_t *bytes_written);
 err_t   netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
@@ -347,9 +439,22 @@ err_t   netconn_write_vectors_partly(struct netconn *conn, struct netvector *vec
 /** @ingroup netconn_tcp */
 #define netconn_write(conn, dataptr, size, apiflags) \
           netconn_write_partly(conn, dataptr, size, apiflags, NULL)
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+err_t   netconn_zerocopy_completed(struct netconn *conn, u32_t *lo, u32_t *hi);
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
 err_t   netconn_close(struct netconn *conn);
 err_t   netconn_shutdown(struct netconn *conn, u8_t shut_rx, u8_t shut_tx);
 
+#if LWIP_TCP && LWIP_NETCONN_RING
+struct netconn_ring *netconn_ring_new(u16_t entries);
+err_t   netconn_ring_delete(struct netconn_ring *ring);
+struct netconn_ring_sqe *netconn_ring_get_sqe(struct netconn_ring *ring);
+err_t   netconn_ring_submit(struct netconn_ring *ring);
+u16_t   netconn_ring_reap(struct netconn_ring *ring, struct netconn_ring_cqe *cqes, u16_t num);
+err_t   netconn_ring_wait(struct netconn_ring *ring, u32_t timeout);
+void    netconn_ring_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
+#endif /* LWIP_TCP && LWIP_NETCONN_RING */
+
 #if LWIP_IGMP || (LWIP_IPV6 && LWIP_IPV6_MLD)
 err_t   netconn_join_leave_group(struct netconn *conn, const ip_addr_t *multiaddr,
                              const ip_addr_t *netif_addr, enum netconn_igmp join_or_leave);
@@ -294,6 +294,18 @@ typedef int ssize_t;
 #define LWIP_MEM_ALIGN(addr) ((void *)(((mem_ptr_t)(addr) + MEM_ALIGNMENT - 1) & ~(mem_ptr_t)(MEM_ALIGNMENT-1)))
 #endif
 
+/** Storage class specifier for thread-local variables (only needed for
+ * MEMP_THREAD_CACHE). Defined for GCC-compatible and C11 compilers, define
+ * it in your cc.h for other compilers.
+ */
+#ifndef LWIP_THREAD_LOCAL
+#if defined(__GNUC__)
+#define LWIP_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define LWIP_THREAD_LOCAL _Thread_local
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
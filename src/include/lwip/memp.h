@@ -147,6 +147,9 @@ void *memp_malloc_fn(memp_t type, const char* file, const int line);
 void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
+#if MEMP_THREAD_CACHE
+void  memp_thread_cache_flush(void);
+#endif /* MEMP_THREAD_CACHE */
 
 #ifdef __cplusplus
 }
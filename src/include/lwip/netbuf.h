@@ -68,6 +68,10 @@ struct netbuf {
   ip_addr_t toaddr;
 #endif /* LWIP_NETBUF_RECVINFO */
 #endif /* LWIP_NETBUF_RECVINFO || LWIP_CHECKSUM_ON_COPY */
+#if LWIP_UDP_GSO
+  /** segment size for sending (overrides the one of the pcb), 0 for none */
+  u16_t gso_size;
+#endif /* LWIP_UDP_GSO */
 };
 
 /* Network buffer functions: */
@@ -106,6 +110,10 @@ void              netbuf_first    (struct netbuf *buf);
 #define netbuf_set_chksum(buf, chksum) do { (buf)->flags = NETBUF_FLAG_CHKSUM; \
                                             (buf)->toport_chksum = chksum; } while(0)
 #endif /* LWIP_CHECKSUM_ON_COPY */
+#if LWIP_UDP_GSO
+/** Send the data of a netbuf as datagrams of 'size' bytes (UDP only) */
+#define netbuf_set_gso_size(buf, size) ((buf)->gso_size = (size))
+#endif /* LWIP_UDP_GSO */
 
 #ifdef __cplusplus
 }
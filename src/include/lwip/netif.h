@@ -105,6 +105,13 @@ extern "C" {
 /** If set, the netif has MLD6 capability.
  * Set by the netif driver in its init function. */
 #define NETIF_FLAG_MLD6         0x40U
+/** If set, the netif accepts TCP super-segments (pbufs with gso_size != 0)
+ * of up to gso_max_size bytes and cuts them into wire segments itself, in
+ * hardware or with tcp_gso_segment(). Like PBUF_REF data, a super-segment
+ * must not be referenced after linkoutput returns, so drivers that queue
+ * it must copy it.
+ * Set by the netif driver in its init function (needs LWIP_TCP_GSO). */
+#define NETIF_FLAG_GSO          0x80U
 
 /**
  * @}
@@ -342,6 +349,10 @@ struct netif {
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF*/
   /** maximum transfer unit (in bytes) */
   u16_t mtu;
+#if LWIP_TCP_GSO
+  /** maximum length of a super-segment IP packet (see NETIF_FLAG_GSO) */
+  u16_t gso_max_size;
+#endif /* LWIP_TCP_GSO */
 #if LWIP_IPV6 && LWIP_ND6_ALLOW_RA_UPDATES
   /** maximum transfer unit (in bytes), updated by RA */
   u16_t mtu6;
@@ -120,6 +120,29 @@
 #if !defined LWIP_TIMERS_CUSTOM || defined __DOXYGEN__
 #define LWIP_TIMERS_CUSTOM              0
 #endif
+
+/**
+ * LWIP_TIMERS_WHEEL==1: Keep timeouts in a hierarchical timing wheel instead
+ * of a list sorted by expiry time. sys_timeout() and sys_untimeout() then
+ * take constant time instead of walking the list, which pays off when there
+ * are many timeouts (e.g. per-connection application timers).
+ * This costs some more RAM: 226 list heads, SYS_TIMEOUT_HASH_SIZE hash
+ * buckets and 3 pointers more per timeout.
+ * Timeouts expiring at the same millisecond may be called in a different
+ * order than they were added.
+ */
+#if !defined LWIP_TIMERS_WHEEL || defined __DOXYGEN__
+#define LWIP_TIMERS_WHEEL               0
+#endif
+
+/**
+ * SYS_TIMEOUT_HASH_SIZE: Number of hash buckets used by LWIP_TIMERS_WHEEL
+ * to find timeouts by handler and argument in sys_untimeout().
+ * Must be a power of 2.
+ */
+#if !defined SYS_TIMEOUT_HASH_SIZE || defined __DOXYGEN__
+#define SYS_TIMEOUT_HASH_SIZE           64
+#endif
 /**
  * @}
  */
@@ -291,6 +314,39 @@
 #define MEMP_MEM_INIT                   0
 #endif
 
+/**
+ * MEMP_THREAD_CACHE==1: Keep a small cache ("magazine") of free elements per
+ * thread in front of every pool, so that memp_malloc() and memp_free() only
+ * take SYS_ARCH_PROTECT when a magazine has to be refilled or drained (which
+ * moves half a magazine at once). Useful if several threads allocate pbufs,
+ * netbufs etc. concurrently (e.g. through the socket API).
+ * MEMP_STATS only count the elements handed out, not the ones held in
+ * magazines (with MEMP_STATS, every call takes SYS_ARCH_PROTECT to update
+ * them). The magazines are thread local: with SYS_LIGHTWEIGHT_PROT, cached
+ * pools must not be used from interrupt context (e.g. pbuf_alloc() of
+ * PBUF_POOL pbufs in a driver interrupt handler), as an interrupt would use
+ * the magazine of the thread it interrupted. Threads must call
+ * memp_thread_cache_flush() before they exit to return them to the pools:
+ * ports should do this in the exit path of threads created by
+ * sys_thread_new() (the unix port does), other threads have to do it
+ * themselves.
+ * Only pools of memp_std.h are cached, not private pools. Each thread caches
+ * at most 1/8 of a pool, so small pools are not cached at all.
+ * Requires LWIP_THREAD_LOCAL (see arch.h), !MEMP_MEM_MALLOC and
+ * !MEMP_OVERFLOW_CHECK.
+ */
+#if !defined MEMP_THREAD_CACHE || defined __DOXYGEN__
+#define MEMP_THREAD_CACHE               0
+#endif
+
+/**
+ * MEMP_THREAD_CACHE_SIZE: the maximum number of elements per pool in the
+ * cache of one thread (see MEMP_THREAD_CACHE).
+ */
+#if !defined MEMP_THREAD_CACHE_SIZE || defined __DOXYGEN__
+#define MEMP_THREAD_CACHE_SIZE          16
+#endif
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> \#define MEM_ALIGNMENT 4
@@ -552,6 +608,14 @@
 #define MEMP_NUM_SELECT_CB              4
 #endif
 
+/**
+ * MEMP_NUM_EPOLL_ITEM: the number of sockets in the interest sets of all
+ * epoll instances together. (Only needed with LWIP_SOCKET_EPOLL==1.)
+ */
+#if !defined MEMP_NUM_EPOLL_ITEM || defined __DOXYGEN__
+#define MEMP_NUM_EPOLL_ITEM             MEMP_NUM_NETCONN
+#endif
+
 /**
  * MEMP_NUM_TCPIP_MSG_API: the number of struct tcpip_msg, which are used
  * for callback/timeout API communication.
@@ -570,6 +634,15 @@
 #define MEMP_NUM_TCPIP_MSG_INPKT        8
 #endif
 
+/**
+ * MEMP_NUM_TCPIP_MSG_INPKT_BATCH: the number of messages carrying up to
+ * TCPIP_INPUT_BATCH_SIZE incoming packets each (see LWIP_TCPIP_INPUT_BATCH).
+ * (only needed if you use tcpip.c)
+ */
+#if !defined MEMP_NUM_TCPIP_MSG_INPKT_BATCH || defined __DOXYGEN__
+#define MEMP_NUM_TCPIP_MSG_INPKT_BATCH  4
+#endif
+
 /**
  * MEMP_NUM_NETDB: the number of concurrently running lwip_addrinfo() calls
  * (before freeing the corresponding memory using lwip_freeaddrinfo()).
@@ -1254,6 +1327,57 @@
 #define UDP_TTL                         IP_DEFAULT_TTL
 #endif
 
+/**
+ * LWIP_UDP_PCB_HASH==1: Additionally index UDP PCBs by local port in a hash
+ * table shared by udp_input(), udp_bind() and udp_new_port(), so that they
+ * don't have to walk the whole udp_pcbs list.
+ */
+#if !defined LWIP_UDP_PCB_HASH || defined __DOXYGEN__
+#define LWIP_UDP_PCB_HASH               0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: Number of buckets in the UDP local port hash table.
+ * Must be a power of 2. Only used if LWIP_UDP_PCB_HASH==1.
+ */
+#if !defined UDP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define UDP_PCB_HASH_SIZE               32
+#endif
+
+/**
+ * LWIP_PORT_BITMAP==1: Keep a bitmap of the used local ports of the
+ * ephemeral port range for TCP and UDP. tcp_new_port() and udp_new_port()
+ * then find a free port without walking all pcbs; with LWIP_RAND, the search
+ * starts at a random port (RFC 6056, algorithm 1).
+ * Costs 2 bits per port of the range and protocol (4 KByte each for the
+ * default range of 16384 ports).
+ */
+#if !defined LWIP_PORT_BITMAP || defined __DOXYGEN__
+#define LWIP_PORT_BITMAP                0
+#endif
+
+/**
+ * LWIP_UDP_REUSEPORT==1: Enable the UDP_FLAGS_REUSEPORT pcb flag (and the
+ * SO_REUSEPORT socket option for UDP sockets). Unconnected PCBs having this
+ * flag set may bind to the same local address and port, and incoming
+ * datagrams are spread across them by hashing the source address and port.
+ */
+#if !defined LWIP_UDP_REUSEPORT || defined __DOXYGEN__
+#define LWIP_UDP_REUSEPORT              0
+#endif
+
+/**
+ * LWIP_UDP_GSO==1: Segmentation of large UDP sends. A pcb with a segment
+ * size set (udp_set_gso_size(), socket option UDP_SEGMENT or a UDP_SEGMENT
+ * cmsg per sendmsg) sends a pbuf larger than that as a train of datagrams
+ * of that size to the same destination: the route and source address are
+ * looked up once, and the datagrams reference the data of the pbuf instead
+ * of copying it. Adds 2 bytes to struct udp_pcb and struct netbuf.
+ */
+#if !defined LWIP_UDP_GSO || defined __DOXYGEN__
+#define LWIP_UDP_GSO                    0
+#endif
+
 /**
  * LWIP_NETBUF_RECVINFO==1: append destination addr and port to every netbuf.
  */
@@ -1321,6 +1445,19 @@
 #define TCP_QUEUE_OOSEQ                 LWIP_TCP
 #endif
 
+/**
+ * TCP_OOSEQ_RBTREE==1: Index the out-of-sequence queue with a red-black
+ * tree keyed by sequence number (and remember its last segment), so that
+ * placing a segment costs O(log n) instead of a walk over the queue. Byte
+ * and pbuf counts are kept up to date to enforce TCP_OOSEQ_MAX_BYTES and
+ * TCP_OOSEQ_MAX_PBUFS without a walk, too. Worth it with large windows
+ * (LWIP_WND_SCALE) and heavy reordering, where the queue can hold thousands
+ * of segments. Adds 3 pointers and a byte to struct tcp_seg.
+ */
+#if !defined TCP_OOSEQ_RBTREE || defined __DOXYGEN__
+#define TCP_OOSEQ_RBTREE                0
+#endif
+
 /**
  * LWIP_TCP_SACK_OUT==1: TCP will support sending selective acknowledgements (SACKs).
  */
@@ -1328,6 +1465,201 @@
 #define LWIP_TCP_SACK_OUT               0
 #endif
 
+/**
+ * LWIP_TCP_SACK_IN==1: TCP will process SACK blocks received from the remote
+ * host: SACKed segments are marked on the unacked queue (scoreboard) and loss
+ * recovery is done according to RFC 6675, retransmitting all holes in one
+ * window instead of one segment per RTT. Requires LWIP_TCP_SACK_OUT, as
+ * SACK_PERM must be negotiated in both directions.
+ */
+#if !defined LWIP_TCP_SACK_IN || defined __DOXYGEN__
+#define LWIP_TCP_SACK_IN                0
+#endif
+
+/**
+ * LWIP_TCP_CUBIC==1: Include the CUBIC congestion control module (RFC 8312).
+ * Its window growth does not depend on the RTT, which makes it reach the
+ * link speed much faster than Reno on paths with a high bandwidth-delay
+ * product. Select it per pcb with tcp_set_congestion() (or the TCP_CONGESTION
+ * socket option) or globally with TCP_CC_DEFAULT.
+ */
+#if !defined LWIP_TCP_CUBIC || defined __DOXYGEN__
+#define LWIP_TCP_CUBIC                  0
+#endif
+
+/**
+ * TCP_CC_DEFAULT: The congestion control module new TCP pcbs start with:
+ * tcp_cc_reno (RFC 5681) or tcp_cc_cubic (needs LWIP_TCP_CUBIC).
+ */
+#if !defined TCP_CC_DEFAULT || defined __DOXYGEN__
+#define TCP_CC_DEFAULT                  tcp_cc_reno
+#endif
+
+/**
+ * LWIP_TCP_GSO==1: Generic segmentation offload. On netifs that set
+ * NETIF_FLAG_GSO, tcp_output() passes runs of equally sized segments down
+ * as one super-segment of up to netif->gso_max_size bytes with a single
+ * header, which saves the header build, checksum and ip_output_if() per
+ * segment. The netif cuts it into wire segments, either in hardware (TSO)
+ * or by calling tcp_gso_segment() from its linkoutput function.
+ * Adds 2 bytes to struct pbuf.
+ */
+#if !defined LWIP_TCP_GSO || defined __DOXYGEN__
+#define LWIP_TCP_GSO                    0
+#endif
+
+/**
+ * LWIP_TCP_GRO==1: Generic receive offload. In-order data segments of the
+ * same connection that arrive in one receive batch are merged into one
+ * segment (a pbuf chain with one header) before tcp_input(), so that the
+ * receive path, the recv callback and the ACK decision run once per batch
+ * instead of once per segment. The batch ends when tcp_gro_flush() is
+ * called: the tcpip thread does this whenever its mailbox runs empty,
+ * NO_SYS drivers call it after their receive loop.
+ * Adds 2 bytes to struct pbuf.
+ */
+#if !defined LWIP_TCP_GRO || defined __DOXYGEN__
+#define LWIP_TCP_GRO                    0
+#endif
+
+/**
+ * TCP_GRO_FLOWS: Number of connections LWIP_TCP_GRO merges segments for
+ * at the same time.
+ */
+#if !defined TCP_GRO_FLOWS || defined __DOXYGEN__
+#define TCP_GRO_FLOWS                   2
+#endif
+
+/**
+ * TCP_GRO_MAX_SEGS: LWIP_TCP_GRO passes a merged segment on after this
+ * many segments (or 64 KByte, whichever comes first).
+ */
+#if !defined TCP_GRO_MAX_SEGS || defined __DOXYGEN__
+#define TCP_GRO_MAX_SEGS                16
+#endif
+
+/**
+ * LWIP_TCP_PACING==1: Support spreading the segments of a pcb over time
+ * instead of sending a whole window as one burst (see tcp_set_pacing_rate()
+ * and the SO_MAX_PACING_RATE socket option). The rate follows cwnd/RTT and
+ * can be capped per pcb; held back segments are released by sys_timeout(),
+ * so this needs LWIP_TIMERS. Pacing is off for a pcb until enabled.
+ */
+#if !defined LWIP_TCP_PACING || defined __DOXYGEN__
+#define LWIP_TCP_PACING                 0
+#endif
+
+/**
+ * TCP_PACING_BURST: Number of full-sized segments LWIP_TCP_PACING sends back
+ * to back. Since the timers have millisecond granularity, a burst is never
+ * smaller than the data of one millisecond at the current rate.
+ */
+#if !defined TCP_PACING_BURST || defined __DOXYGEN__
+#define TCP_PACING_BURST                2
+#endif
+
+/**
+ * LWIP_TCP_TIMER_WHEEL==1: Keep the next timer deadline of every active and
+ * TIME-WAIT pcb (retransmission, persist, keepalive, poll, FIN-WAIT-2,
+ * TIME-WAIT...) in a timer wheel so that tcp_slowtmr() only looks at the
+ * pcbs that have something to do in this tick and tcp_fasttmr() only at pcbs
+ * with a delayed ACK, a pending FIN or refused data. This saves CPU with many
+ * (mostly idle) connections. The stack reschedules a pcb whenever it changes
+ * one of its deadlines (including the socket options and altcp_keepalive()).
+ * Raw API code that sets SOF_KEEPALIVE, keep_idle, keep_intvl or keep_cnt of
+ * a pcb directly must call tcp_timer_update() afterwards: without it, the
+ * new deadline is noticed late and can fire up to TCP_TIMER_WHEEL_SIZE slow
+ * timer ticks after it is due.
+ */
+#if !defined LWIP_TCP_TIMER_WHEEL || defined __DOXYGEN__
+#define LWIP_TCP_TIMER_WHEEL            0
+#endif
+
+/**
+ * TCP_TIMER_WHEEL_SIZE: Number of slots of LWIP_TCP_TIMER_WHEEL (must be a
+ * power of 2). Deadlines further away than this many slow timer ticks are
+ * re-evaluated once per wheel revolution.
+ */
+#if !defined TCP_TIMER_WHEEL_SIZE || defined __DOXYGEN__
+#define TCP_TIMER_WHEEL_SIZE            64
+#endif
+
+/**
+ * LWIP_TCP_FASTOPEN==1: Support TCP Fast Open (RFC 7413): data carried in
+ * the SYN of connections to servers that handed out a cookie before. It has
+ * to be enabled per pcb with tcp_fastopen() (or the TCP_FASTOPEN and
+ * TCP_FASTOPEN_CONNECT socket options). Server cookies are derived from the
+ * client address with a secret key initialized from LWIP_RAND(), so this
+ * needs LWIP_RAND.
+ */
+#if !defined LWIP_TCP_FASTOPEN || defined __DOXYGEN__
+#define LWIP_TCP_FASTOPEN               0
+#endif
+
+/**
+ * TCP_FASTOPEN_CACHE_SIZE: Number of servers the LWIP_TCP_FASTOPEN client
+ * remembers a cookie for.
+ */
+#if !defined TCP_FASTOPEN_CACHE_SIZE || defined __DOXYGEN__
+#define TCP_FASTOPEN_CACHE_SIZE         8
+#endif
+
+/**
+ * LWIP_TCP_SYN_COOKIES==1: Allow listeners to answer connection requests
+ * without allocating a pcb (enabled per listener with tcp_syncookies()).
+ * The options of a request are kept in a small SYN queue of
+ * TCP_SYN_QUEUE_SIZE entries, the sequence number of the SYN|ACK is a SYN
+ * cookie. If the queue is full, only the cookie is left (and window scaling,
+ * SACK and timestamps are not offered). A pcb is allocated when the final
+ * ACK arrives. Cookies are derived with a secret key initialized from
+ * LWIP_RAND(), so this needs LWIP_RAND.
+ */
+#if !defined LWIP_TCP_SYN_COOKIES || defined __DOXYGEN__
+#define LWIP_TCP_SYN_COOKIES            0
+#endif
+
+/**
+ * TCP_SYN_QUEUE_SIZE: Number of connection requests LWIP_TCP_SYN_COOKIES
+ * keeps the options of (shared by all listeners).
+ */
+#if !defined TCP_SYN_QUEUE_SIZE || defined __DOXYGEN__
+#define TCP_SYN_QUEUE_SIZE              8
+#endif
+
+/**
+ * LWIP_TCP_ACK_POLICY==1: Make the acknowledgement of received data
+ * configurable per pcb instead of acknowledging every second segment: a pcb
+ * acknowledges once tcp_ack_every() full-sized segments (TCP_ACK_EVERY by
+ * default) are unacknowledged, less data is acknowledged by the delayed ACK
+ * of the fast timer. In quick-ack mode (at the start of a connection, after
+ * data arrived out of order and after tcp_quickack() or the TCP_QUICKACK
+ * socket option), the next TCP_QUICKACK_SEGS segments are acknowledged at
+ * once. With LWIP_TCP_GRO, a merged batch of segments is acknowledged with
+ * one (stretch) ACK.
+ */
+#if !defined LWIP_TCP_ACK_POLICY || defined __DOXYGEN__
+#define LWIP_TCP_ACK_POLICY             0
+#endif
+
+/**
+ * TCP_ACK_EVERY: Default number of full-sized segments LWIP_TCP_ACK_POLICY
+ * acknowledges with one ACK. RFC 5681 asks for at least every second one;
+ * larger values save ACKs (and work in the tcpip thread) on bulk receivers
+ * but slow down the sender's window growth.
+ */
+#if !defined TCP_ACK_EVERY || defined __DOXYGEN__
+#define TCP_ACK_EVERY                   2
+#endif
+
+/**
+ * TCP_QUICKACK_SEGS: Number of segments LWIP_TCP_ACK_POLICY acknowledges at
+ * once in quick-ack mode (to speed up slow start and loss recovery of the
+ * sender).
+ */
+#if !defined TCP_QUICKACK_SEGS || defined __DOXYGEN__
+#define TCP_QUICKACK_SEGS               8
+#endif
+
 /**
  * LWIP_TCP_MAX_SACK_NUM: The maximum number of SACK values to include in TCP segments.
  * Must be at least 1, but is only used if LWIP_TCP_SACK_OUT is enabled.
@@ -1548,6 +1880,33 @@
 #define LWIP_TCP_PCB_NUM_EXT_ARGS       0
 #endif
 
+/**
+ * LWIP_TCP_PCB_HASH==1: Additionally index active, TIME-WAIT and listening
+ * TCP PCBs in hash tables so that tcp_input() finds the PCB for an incoming
+ * segment without walking the PCB lists. The PCB lists are still maintained.
+ */
+#if !defined LWIP_TCP_PCB_HASH || defined __DOXYGEN__
+#define LWIP_TCP_PCB_HASH               0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: Number of buckets in the hash table for active and
+ * TIME-WAIT PCBs (keyed by 4-tuple). Must be a power of 2.
+ * Only used if LWIP_TCP_PCB_HASH==1.
+ */
+#if !defined TCP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define TCP_PCB_HASH_SIZE               64
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: Number of buckets in the hash table for listening
+ * PCBs (keyed by local port). Must be a power of 2.
+ * Only used if LWIP_TCP_PCB_HASH==1.
+ */
+#if !defined TCP_LISTEN_HASH_SIZE || defined __DOXYGEN__
+#define TCP_LISTEN_HASH_SIZE            16
+#endif
+
 /** LWIP_ALTCP==1: enable the altcp API.
  * altcp is an abstraction layer that prevents applications linking against the
  * tcp.h functions but provides the same functionality. It is used to e.g. add
@@ -1864,6 +2223,24 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * LWIP_TCPIP_INPUT_BATCH==1: Enable tcpip_input_batch() and tcpip_inpkt_batch()
+ * to pass several received packets to tcpip_thread with one message, e.g. all
+ * frames a driver has read in one wakeup. This saves one mbox post (and with
+ * LWIP_TCPIP_CORE_LOCKING_INPUT, one lock of the core) per packet.
+ */
+#if !defined LWIP_TCPIP_INPUT_BATCH || defined __DOXYGEN__
+#define LWIP_TCPIP_INPUT_BATCH          0
+#endif
+
+/**
+ * TCPIP_INPUT_BATCH_SIZE: The maximum number of packets passed with one
+ * message by tcpip_input_batch(). Larger batches are split.
+ */
+#if !defined TCPIP_INPUT_BATCH_SIZE || defined __DOXYGEN__
+#define TCPIP_INPUT_BATCH_SIZE          16
+#endif
+
 /**
  * Define this to something that triggers a watchdog. This is called from
  * tcpip_thread after processing a message.
@@ -2007,6 +2384,16 @@
 #if !defined LWIP_NETCONN_FULLDUPLEX || defined __DOXYGEN__
 #define LWIP_NETCONN_FULLDUPLEX         0
 #endif
+
+/** LWIP_NETCONN_RING==1: Enable netconn_ring_new() and friends: TCP
+ * operations (accept, connect, recv, send, close) are queued to a submission
+ * ring and processed by the tcpip_thread (or under the core lock) a whole
+ * batch at a time, results are reaped from a completion ring. This lets one
+ * application thread drive many TCP netconns without one API message per call.
+ */
+#if !defined LWIP_NETCONN_RING || defined __DOXYGEN__
+#define LWIP_NETCONN_RING               0
+#endif
 /**
  * @}
  */
@@ -2116,6 +2503,30 @@
 #define LWIP_SO_LINGER                  0
 #endif
 
+/**
+ * LWIP_SO_ZEROCOPY==1: Enable zero-copy sending for TCP: the netconn write
+ * flag NETCONN_ZEROCOPY and, for sockets, SO_ZEROCOPY/MSG_ZEROCOPY with
+ * completions read via recvmsg(MSG_ERRQUEUE) (like on Linux).
+ * Data written like that is not copied but referenced until it is
+ * acknowledged by the remote side (or the connection is gone), so the
+ * application must not change or free it until the write is reported as
+ * completed. Closing a connection completes its writes: data that is not
+ * acknowledged yet is copied (if memory is short, closing waits and retries
+ * like for a FIN that cannot be enqueued).
+ */
+#if !defined LWIP_SO_ZEROCOPY || defined __DOXYGEN__
+#define LWIP_SO_ZEROCOPY                0
+#endif
+
+/**
+ * LWIP_SO_ZEROCOPY_PENDING: Number of not yet completed zero-copy writes per
+ * netconn that are tracked individually. When more are pending, the newest
+ * ones are completed together (i.e. later than necessary).
+ */
+#if !defined LWIP_SO_ZEROCOPY_PENDING || defined __DOXYGEN__
+#define LWIP_SO_ZEROCOPY_PENDING        8
+#endif
+
 /**
  * If LWIP_SO_RCVBUF is used, this is the default value for recv_bufsize.
  */
@@ -2175,6 +2586,56 @@
 #if !defined LWIP_SOCKET_POLL || defined __DOXYGEN__
 #define LWIP_SOCKET_POLL                1
 #endif
+
+/**
+ * LWIP_SOCKET_EPOLL==1: enable lwip_epoll_create/ctl/wait() for sockets
+ * (like epoll on Linux, level- and edge-triggered). Interest sets persist
+ * between waits and each socket knows the epoll instances interested in it,
+ * so an event costs O(interested instances) instead of a check of every fd
+ * of every waiting select/poll. Needs LWIP_SOCKET_SELECT or LWIP_SOCKET_POLL
+ * (for the socket event callback).
+ */
+#if !defined LWIP_SOCKET_EPOLL || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_NUM: Number of epoll instances that can exist at the
+ * same time. They use the file descriptors after the sockets.
+ */
+#if !defined LWIP_SOCKET_EPOLL_NUM || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL_NUM           1
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG==1: enable lwip_recvmmsg() and lwip_sendmmsg() to receive
+ * or send many datagrams (UDP/RAW) with one call: the socket is looked up
+ * once per call, and the datagrams are handed to the tcpip thread with one
+ * API message (core lock) per batch of LWIP_SOCKET_MMSG_BATCH datagrams.
+ */
+#if !defined LWIP_SOCKET_MMSG || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG                0
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG_BATCH: Number of datagrams lwip_recvmmsg() and
+ * lwip_sendmmsg() pass to the netconn API at once. Each one costs a struct
+ * netbuf (sendmmsg) or a pointer (recvmmsg) on the stack of the caller.
+ */
+#if !defined LWIP_SOCKET_MMSG_BATCH || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG_BATCH          8
+#endif
+
+/**
+ * LWIP_SOCKET_ZEROCOPY_RECV==1: enable lwip_recvmsg_zerocopy() and
+ * lwip_recvmsg_release(): received data is not copied into buffers of the
+ * application but loaned to it as iovecs pointing into the pbufs until it is
+ * released. For TCP, the receive window is only opened on release, so data
+ * held by the application counts against the window like data not yet read.
+ */
+#if !defined LWIP_SOCKET_ZEROCOPY_RECV || defined __DOXYGEN__
+#define LWIP_SOCKET_ZEROCOPY_RECV       0
+#endif
 /**
  * @}
  */
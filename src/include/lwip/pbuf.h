@@ -220,6 +220,11 @@ struct pbuf {
   /** For incoming packets, this contains the input netif's index */
   u8_t if_idx;
 
+#if LWIP_TCP_GSO || LWIP_TCP_GRO
+  /** For TCP super-segments: payload bytes per wire segment, 0 otherwise */
+  u16_t gso_size;
+#endif /* LWIP_TCP_GSO || LWIP_TCP_GRO */
+
   /** In case the user needs to store data custom data on a pbuf */
   LWIP_PBUF_CUSTOM_DATA
 };
@@ -283,6 +288,11 @@ void pbuf_realloc(struct pbuf *p, u16_t size);
 #define pbuf_get_allocsrc(p)          ((p)->type_internal & PBUF_TYPE_ALLOC_SRC_MASK)
 #define pbuf_match_allocsrc(p, type)  (pbuf_get_allocsrc(p) == ((type) & PBUF_TYPE_ALLOC_SRC_MASK))
 #define pbuf_match_type(p, type)      pbuf_match_allocsrc(p, type)
+#if LWIP_TCP_GSO || LWIP_TCP_GRO
+#define pbuf_is_gso(p)                ((p)->gso_size != 0)
+#else /* LWIP_TCP_GSO || LWIP_TCP_GRO */
+#define pbuf_is_gso(p)                0
+#endif /* LWIP_TCP_GSO || LWIP_TCP_GRO */
 u8_t pbuf_header(struct pbuf *p, s16_t header_size);
 u8_t pbuf_header_force(struct pbuf *p, s16_t header_size);
 u8_t pbuf_add_header(struct pbuf *p, size_t header_size_increment);
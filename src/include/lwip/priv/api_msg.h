@@ -86,6 +86,14 @@ struct api_msg {
   union {
     /** used for lwip_netconn_do_send */
     struct netbuf *b;
+    /** used for lwip_netconn_do_send_multi */
+    struct {
+      struct netbuf **bufs;
+      /** number of netbufs to send */
+      u16_t num;
+      /** output of the number of netbufs sent */
+      u16_t sent;
+    } bm;
     /** used for lwip_netconn_do_newconn */
     struct {
       u8_t proto;
@@ -187,6 +195,61 @@ struct dns_api_msg {
 };
 #endif /* LWIP_DNS */
 
+#if LWIP_TCP && LWIP_NETCONN_RING
+/** A netconn_ring operation taken from the submission ring: it waits in
+    netconn->ring_ops until it can be completed */
+struct netconn_ring_op {
+  struct netconn_ring_op *next;
+  struct netconn_ring *ring;
+  struct netconn_ring_sqe sqe;
+  /** RECV/SEND: bytes received/sent */
+  size_t done;
+  /** ACCEPT: the new netconn */
+  struct netconn *newconn;
+  /** CONNECT: tcp_connect() has been called */
+  u8_t started;
+};
+
+/** Submission and completion rings shared by an application thread and the
+    tcpip_thread. The counters run freely, 'entries' is a power of 2.
+    The application thread owns sq_pending, cq_head and inflight; sq_tail is
+    written by the application thread and cq_tail by the tcpip_thread, both
+    under SYS_ARCH_PROTECT. sq_head and free_ops belong to the tcpip_thread. */
+struct netconn_ring {
+  struct netconn_ring_sqe *sq;
+  struct netconn_ring_cqe *cq;
+  /** operations not in use (there is one per entry, so taking the next
+      submission never fails) */
+  struct netconn_ring_op *free_ops;
+  /** signalled when a completion is added while the application waits */
+  sys_sem_t cq_sem;
+#if !LWIP_TCPIP_CORE_LOCKING
+  /** processes the submission ring in the tcpip_thread */
+  struct tcpip_callback_msg *submit_msg;
+#endif /* !LWIP_TCPIP_CORE_LOCKING */
+  u16_t entries;
+  u16_t sq_head;
+  u16_t sq_tail;
+  /** entries returned by netconn_ring_get_sqe() but not submitted yet */
+  u16_t sq_pending;
+  u16_t cq_head;
+  u16_t cq_tail;
+  /** entries taken by netconn_ring_get_sqe() and not reaped yet */
+  u16_t inflight;
+  /** the submission ring is being processed (or submit_msg is posted) */
+  u8_t scheduled;
+  /** the application waits in netconn_ring_wait() */
+  u8_t waiting;
+  /** netconn_ring_delete() has been called: lwip_netconn_do_ring_submit()
+      frees the ring when it is done */
+  u8_t deleted;
+};
+
+void lwip_netconn_do_ring_submit(void *arg);
+struct netconn_ring *netconn_ring_alloc(u16_t entries);
+void netconn_ring_free(struct netconn_ring *ring);
+#endif /* LWIP_TCP && LWIP_NETCONN_RING */
+
 #if LWIP_NETCONN_FULLDUPLEX
 int lwip_netconn_is_deallocated_msg(void *msg);
 #endif
@@ -199,6 +262,7 @@ void lwip_netconn_do_connect         (void *m);
 void lwip_netconn_do_disconnect      (void *m);
 void lwip_netconn_do_listen          (void *m);
 void lwip_netconn_do_send            (void *m);
+void lwip_netconn_do_send_multi      (void *m);
 void lwip_netconn_do_recv            (void *m);
 #if TCP_LISTEN_BACKLOG
 void lwip_netconn_do_accepted        (void *m);
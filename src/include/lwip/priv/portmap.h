@@ -0,0 +1,78 @@
+/**
+ * @file
+ * Local port usage bitmap (do not use in application code)
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_PORTMAP_H
+#define LWIP_HDR_PORTMAP_H
+
+#include "lwip/opt.h"
+
+#if LWIP_PORT_BITMAP /* don't build if not configured for use in lwipopts.h */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of u32_t words of one bitmap for the ports start..end */
+#define PORTMAP_WORDS(start, end) ((((end) - (start) + 1) + 31) / 32)
+
+/** Usage of the ports of an ephemeral port range. A 'used' bit is set while
+ * at least one pcb is bound to the port, a 'shared' bit if there may be more
+ * than one (the protocol has to count them when one is released). */
+struct portmap {
+  u32_t *used;
+  u32_t *shared;
+  /** first and last port of the range */
+  u16_t start;
+  u16_t end;
+  /** last port handed out by portmap_find() */
+  u16_t last;
+};
+
+/** Declare a static portmap and its bitmaps for the ports start..end */
+#define PORTMAP_DECLARE(name, start, end) \
+  static u32_t name##_bits[2][PORTMAP_WORDS(start, end)]; \
+  static struct portmap name = { name##_bits[0], name##_bits[1], (start), (end), (start) }
+
+void  portmap_acquire(struct portmap *map, u16_t port);
+u8_t  portmap_release(struct portmap *map, u16_t port);
+void  portmap_set_users(struct portmap *map, u16_t port, u32_t users);
+u16_t portmap_find(struct portmap *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_PORT_BITMAP */
+
+#endif /* LWIP_HDR_PORTMAP_H */
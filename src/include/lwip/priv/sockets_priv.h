@@ -69,6 +69,10 @@ struct lwip_sock {
   struct netconn *conn;
   /** data that was left from the previous read */
   union lwip_sock_lastdata lastdata;
+#if LWIP_TCP && LWIP_SO_ZEROCOPY
+  /** SO_ZEROCOPY: MSG_ZEROCOPY is allowed */
+  u8_t zerocopy;
+#endif /* LWIP_TCP && LWIP_SO_ZEROCOPY */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
   /** number of times data was received, set by event_callback(),
       tested by the receive and select functions */
@@ -81,6 +85,10 @@ struct lwip_sock {
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+  /** epoll instances interested in this socket (linked by sock_next) */
+  struct lwip_epoll_item *epoll_items;
+#endif /* LWIP_SOCKET_EPOLL */
 #if LWIP_NETCONN_FULLDUPLEX
   /* counter of how many threads are using a struct lwip_sock (not the 'int') */
   u8_t fd_used;
@@ -170,6 +178,46 @@ struct lwip_select_cb {
 };
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** A socket in the interest set of an epoll instance */
+struct lwip_epoll_item {
+  /** the epoll instance */
+  struct lwip_epoll *ep;
+  /** the socket */
+  struct lwip_sock *sock;
+  /** next item of the same socket */
+  struct lwip_epoll_item *sock_next;
+  /** list of all items of the epoll instance */
+  struct lwip_epoll_item *ep_prev, *ep_next;
+  /** ready list of the epoll instance (only valid if 'ready' is set) */
+  struct lwip_epoll_item *ready_prev, *ready_next;
+  /** events passed to epoll_ctl */
+  u32_t events;
+  /** data passed to epoll_ctl */
+  epoll_data_t data;
+  /** the socket file descriptor */
+  int fd;
+  /** 1 if on the ready list */
+  u8_t ready;
+};
+
+/** An epoll instance */
+struct lwip_epoll {
+  /** 1 if allocated by epoll_create */
+  u8_t used;
+  /** don't signal the semaphore twice: set to 1 when signalled */
+  u8_t sem_signalled;
+  /** number of tasks waiting in epoll_wait */
+  u16_t waiting;
+  /** the interest set */
+  struct lwip_epoll_item *items;
+  /** items that might be ready: checked by epoll_wait */
+  struct lwip_epoll_item *ready_head, *ready_tail;
+  /** semaphore to wake up tasks waiting in epoll_wait */
+  sys_sem_t sem;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 #endif /* LWIP_SOCKET */
 
 #endif /* LWIP_HDR_SOCKETS_PRIV_H */
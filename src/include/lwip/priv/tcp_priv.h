@@ -75,6 +75,9 @@ void             tcp_txnow   (void);
 
 /* Only used by IP to pass a TCP segment to TCP: */
 void             tcp_input   (struct pbuf *p, struct netif *inp);
+#if LWIP_TCP_GRO
+void             tcp_gro_input(struct pbuf *p, struct netif *inp);
+#endif /* LWIP_TCP_GRO */
 /* Used within the TCP code only: */
 struct tcp_pcb * tcp_alloc   (u8_t prio);
 void             tcp_free    (struct tcp_pcb *pcb);
@@ -87,6 +90,105 @@ void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 void             tcp_rexmit_fast (struct tcp_pcb *pcb);
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK_IN
+u32_t            tcp_sack_pipe   (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_PACING
+void             tcp_pace_stop   (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_PACING */
+#if LWIP_TCP_TIMER_WHEEL
+void             tcp_timer_fast  (struct tcp_pcb *pcb);
+/** Make sure tcp_fasttmr looks at a pcb (delayed ACK, pending FIN or refused data) */
+#define TCP_TIMER_FAST(pcb) tcp_timer_fast(pcb)
+#else /* LWIP_TCP_TIMER_WHEEL */
+#define TCP_TIMER_FAST(pcb)
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
+#if LWIP_TCP_FASTOPEN
+void             tcp_fastopen_cookie(const ip_addr_t *addr, u8_t *cookie);
+u8_t             tcp_fastopen_cookie_valid(const ip_addr_t *addr, const u8_t *cookie, u8_t len);
+u8_t             tcp_fastopen_cache_get(const ip_addr_t *addr, u8_t *cookie);
+void             tcp_fastopen_cache_set(const ip_addr_t *addr, const u8_t *cookie, u8_t len);
+err_t            tcp_fastopen_rexmit(struct tcp_pcb *pcb, const struct tcp_seg *seg, u16_t acked);
+#endif /* LWIP_TCP_FASTOPEN */
+#if LWIP_SO_ZEROCOPY
+err_t            tcp_copy_rom_data(struct tcp_pcb *pcb);
+#endif /* LWIP_SO_ZEROCOPY */
+#if LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES
+void             tcp_halfsiphash(const u32_t *key, const u8_t *data, u8_t len, u8_t *out);
+#endif /* LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_TCP_SYN_COOKIES
+/** A connection request answered without a pcb (LWIP_TCP_SYN_COOKIES) */
+struct tcp_syn_entry {
+  /** the listener the SYN arrived for, NULL if the entry is unused */
+  struct tcp_pcb_listen *listener;
+  ip_addr_t local_ip;
+  ip_addr_t remote_ip;
+  u16_t local_port;
+  u16_t remote_port;
+  /** sequence number of the SYN */
+  u32_t irs;
+  /** sequence number of the SYN|ACK (the cookie) */
+  u32_t iss;
+  /** tcp_ticks when the SYN arrived */
+  u32_t ticks;
+#if LWIP_TCP_TIMESTAMPS
+  u32_t ts_recent;
+#endif /* LWIP_TCP_TIMESTAMPS */
+  /** TF_WND_SCALE, TF_SACK and TF_TIMESTAMP as offered by the peer */
+  tcpflags_t flags;
+  /** send MSS */
+  u16_t mss;
+#if LWIP_WND_SCALE
+  u8_t snd_scale;
+#endif /* LWIP_WND_SCALE */
+};
+
+/* pcb flags of the options a SYN queue entry remembers */
+#if LWIP_WND_SCALE
+#define TCP_SYN_ENTRY_WS   TF_WND_SCALE
+#else
+#define TCP_SYN_ENTRY_WS   0
+#endif
+#if LWIP_TCP_TIMESTAMPS
+#define TCP_SYN_ENTRY_TS   TF_TIMESTAMP
+#else
+#define TCP_SYN_ENTRY_TS   0
+#endif
+#if LWIP_TCP_SACK_OUT
+#define TCP_SYN_ENTRY_SACK TF_SACK
+#else
+#define TCP_SYN_ENTRY_SACK 0
+#endif
+#define TCP_SYN_ENTRY_FLAGS (TCP_SYN_ENTRY_WS | TCP_SYN_ENTRY_TS | TCP_SYN_ENTRY_SACK)
+
+/* Return values of tcp_syncookie_check() */
+#define TCP_SYNCOOKIE_INVALID 0
+#define TCP_SYNCOOKIE_VALID   1
+/* valid, the options are in the SYN queue */
+#define TCP_SYNCOOKIE_QUEUED  2
+
+u32_t            tcp_syncookie_make(struct tcp_syn_entry *syn, u8_t queued);
+u8_t             tcp_syncookie_check(struct tcp_syn_entry *syn, u32_t iss);
+struct tcp_syn_entry *tcp_syn_queue_find(const struct tcp_syn_entry *syn);
+struct tcp_syn_entry *tcp_syn_queue_add(const struct tcp_syn_entry *syn);
+void             tcp_syn_queue_remove(struct tcp_syn_entry *entry);
+void             tcp_syn_queue_purge(const struct tcp_pcb_listen *lpcb);
+err_t            tcp_send_synack(struct tcp_pcb *pcb, u32_t iss);
+#endif /* LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_PORT_BITMAP
+void             tcp_port_acquire(u16_t port);
+void             tcp_port_release(struct tcp_pcb *pcb);
+/** Mark the local port of a pcb used in the port bitmap */
+#define TCP_PORT_ACQUIRE(port) tcp_port_acquire(port)
+/** Update the port bitmap before the local port of a pcb is reset */
+#define TCP_PORT_RELEASE(pcb)  tcp_port_release(pcb)
+#else /* LWIP_PORT_BITMAP */
+#define TCP_PORT_ACQUIRE(port)
+#define TCP_PORT_RELEASE(pcb)
+#endif /* LWIP_PORT_BITMAP */
 
 /**
  * This is the Nagle algorithm: try to combine user data to send as few TCP
@@ -130,6 +232,13 @@ err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 
 #define TCP_OOSEQ_TIMEOUT        6U /* x RTO */
 
+/* As initial send MSS, we use TCP_MSS but limit it to 536. */
+#if TCP_MSS > 536
+#define INITIAL_MSS 536
+#else
+#define INITIAL_MSS TCP_MSS
+#endif
+
 #ifndef TCP_MSL
 #define TCP_MSL 60000UL /* The maximum segment lifetime in milliseconds */
 #endif
@@ -267,7 +376,18 @@ struct tcp_seg {
                                                checksummed into 'chksum' */
 #define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include WND SCALE option (only used in SYN segments) */
 #define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK Permitted option (only used in SYN segments) */
+#if LWIP_TCP_SACK_IN
+#define TF_SEG_SACKED           (u8_t)0x20U /* Segment was SACKed by the remote host */
+#define TF_SEG_SACK_LOST        (u8_t)0x40U /* Segment is considered lost (RFC 6675 IsLost) */
+#define TF_SEG_SACK_REXMIT      (u8_t)0x80U /* Segment was retransmitted in the current loss recovery */
+#endif /* LWIP_TCP_SACK_IN */
   struct tcp_hdr *tcphdr;  /* the TCP header */
+#if TCP_OOSEQ_RBTREE
+  /* links in the pcb->ooseq_root tree (only used for segments on ooseq) */
+  struct tcp_seg *rb_parent;
+  struct tcp_seg *rb_child[2];
+  u8_t rb_red;
+#endif /* TCP_OOSEQ_RBTREE */
 };
 
 #define LWIP_TCP_OPT_EOL        0
@@ -275,7 +395,9 @@ struct tcp_seg {
 #define LWIP_TCP_OPT_MSS        2
 #define LWIP_TCP_OPT_WS         3
 #define LWIP_TCP_OPT_SACK_PERM  4
+#define LWIP_TCP_OPT_SACK       5
 #define LWIP_TCP_OPT_TS         8
+#define LWIP_TCP_OPT_FASTOPEN   34
 
 #define LWIP_TCP_OPT_LEN_MSS    4
 #if LWIP_TCP_TIMESTAMPS
@@ -298,12 +420,32 @@ struct tcp_seg {
 #define LWIP_TCP_OPT_LEN_SACK_PERM_OUT 0
 #endif
 
+#if LWIP_TCP_SACK_IN
+/* Maximum number of SACK blocks fitting into the TCP options */
+#define LWIP_TCP_SACK_IN_MAX_BLOCKS    4
+/* SACK based loss recovery is used if SACK_PERM was exchanged */
+#define TCP_SACK_IN_ENABLED(pcb)       (((pcb)->flags & TF_SACK) != 0)
+#endif /* LWIP_TCP_SACK_IN */
+
 #define LWIP_TCP_OPT_LENGTH(flags) \
   ((flags) & TF_SEG_OPTS_MSS       ? LWIP_TCP_OPT_LEN_MSS           : 0) + \
   ((flags) & TF_SEG_OPTS_TS        ? LWIP_TCP_OPT_LEN_TS_OUT        : 0) + \
   ((flags) & TF_SEG_OPTS_WND_SCALE ? LWIP_TCP_OPT_LEN_WS_OUT        : 0) + \
   ((flags) & TF_SEG_OPTS_SACK_PERM ? LWIP_TCP_OPT_LEN_SACK_PERM_OUT : 0)
 
+#if LWIP_TCP_FASTOPEN
+/* Length of our server cookies and limits for cookies of other servers (RFC 7413) */
+#define TCP_FASTOPEN_COOKIE_LEN 8
+#define TCP_FASTOPEN_COOKIE_MIN 4
+#define TCP_FASTOPEN_COOKIE_MAX 16
+/* Length of a fast open option carrying a cookie of len bytes, aligned for
+   output (includes NOP padding). len 0 is a cookie request. */
+#define TCP_FASTOPEN_OPT_LEN(len) ((u8_t)((2 + (len) + 3) & ~3))
+/* Space left for the fast open option if a SYN carries all other options */
+#define TCP_FASTOPEN_OPT_SPACE  (40 - (LWIP_TCP_OPT_LENGTH(TF_SEG_OPTS_MSS | TF_SEG_OPTS_TS | \
+                                                           TF_SEG_OPTS_WND_SCALE | TF_SEG_OPTS_SACK_PERM)))
+#endif /* LWIP_TCP_FASTOPEN */
+
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(mss) lwip_htonl(0x02040000 | ((mss) & 0xFFFF))
 
@@ -346,6 +488,24 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
    3) All PCBs in the tcp_listen_pcbs list is in LISTEN state.
    4) All PCBs in the tcp_tw_pcbs list is in TIME-WAIT state.
 */
+#if LWIP_TCP_PCB_HASH
+/* Hash index over the active, TIME-WAIT and listen lists (implemented in tcp.c).
+   The index is kept in sync by TCP_REG and TCP_RMV, so code manipulating the
+   lists directly has to call tcp_pcb_hash_remove() itself. */
+void tcp_pcb_hash_insert(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+struct tcp_pcb *tcp_pcb_hash_lookup(const ip_addr_t *local_ip, u16_t local_port,
+                                    const ip_addr_t *remote_ip, u16_t remote_port,
+                                    u8_t netif_idx);
+struct tcp_pcb_listen *tcp_listen_hash_lookup(const ip_addr_t *local_ip, u16_t local_port,
+                                              u8_t netif_idx);
+#define TCP_HASH_REG(pcbs, npcb) tcp_pcb_hash_insert(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb) tcp_pcb_hash_remove(pcbs, npcb)
+#else /* LWIP_TCP_PCB_HASH */
+#define TCP_HASH_REG(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb)
+#endif /* LWIP_TCP_PCB_HASH */
+
 /* Define two macros, TCP_REG and TCP_RMV that registers a TCP PCB
    with a PCB list or removes a PCB from a list, respectively. */
 #ifndef TCP_DEBUG_PCB_LISTS
@@ -364,7 +524,9 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             (npcb)->next = *(pcbs); \
                             LWIP_ASSERT("TCP_REG: npcb->next != npcb", (npcb)->next != (npcb)); \
                             *(pcbs) = (npcb); \
+                            TCP_HASH_REG(pcbs, npcb); \
                             LWIP_ASSERT("TCP_REG: tcp_pcbs sane", tcp_pcbs_sane()); \
+                            tcp_timer_update(npcb); \
               tcp_timer_needed(); \
                             } while(0)
 #define TCP_RMV(pcbs, npcb) do { \
@@ -380,6 +542,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                                } \
                             } \
                             (npcb)->next = NULL; \
+                            TCP_HASH_RMV(pcbs, npcb); \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removed %p from %p\n", (void *)(npcb), (void *)(*(pcbs)))); \
                             } while(0)
@@ -390,6 +553,8 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
   do {                                             \
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
+    TCP_HASH_REG(pcbs, npcb);                      \
+    tcp_timer_update(npcb);                        \
     tcp_timer_needed();                            \
   } while (0)
 
@@ -410,6 +575,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
       }                                            \
     }                                              \
     (npcb)->next = NULL;                           \
+    TCP_HASH_RMV(pcbs, npcb);                      \
   } while(0)
 
 #endif /* LWIP_DEBUG */
@@ -450,6 +616,7 @@ struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
     }                                              \
     else {                                         \
       tcp_set_flags(pcb, TF_ACK_DELAY);            \
+      TCP_TIMER_FAST(pcb);                         \
     }                                              \
   } while (0)
 
@@ -117,6 +117,9 @@ enum tcpip_msg_type {
 #endif /* !LWIP_TCPIP_CORE_LOCKING */
 #if !LWIP_TCPIP_CORE_LOCKING_INPUT
   TCPIP_MSG_INPKT,
+#if LWIP_TCPIP_INPUT_BATCH
+  TCPIP_MSG_INPKT_BATCH,
+#endif /* LWIP_TCPIP_INPUT_BATCH */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
   TCPIP_MSG_TIMEOUT,
@@ -167,6 +170,17 @@ struct tcpip_msg {
   } msg;
 };
 
+#if LWIP_TCPIP_INPUT_BATCH && !LWIP_TCPIP_CORE_LOCKING_INPUT
+/** A TCPIP_MSG_INPKT_BATCH message: msg.msg.inp holds netif and input_fn,
+ * the packets are in p[] */
+struct tcpip_msg_inpkt_batch {
+  /** must be the first member: passed through the mbox as struct tcpip_msg */
+  struct tcpip_msg msg;
+  u16_t num;
+  struct pbuf *p[TCPIP_INPUT_BATCH_SIZE];
+};
+#endif /* LWIP_TCPIP_INPUT_BATCH && !LWIP_TCPIP_CORE_LOCKING_INPUT */
+
 #ifdef __cplusplus
 }
 #endif
@@ -147,6 +147,14 @@ struct msghdr {
 #define MSG_TRUNC   0x04
 #define MSG_CTRUNC  0x08
 
+#if LWIP_SOCKET_MMSG
+/* one message of recvmmsg()/sendmmsg() */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len; /* number of bytes transmitted */
+};
+#endif /* LWIP_SOCKET_MMSG */
+
 /* RFC 3542, Section 20: Ancillary Data */
 struct cmsghdr {
   socklen_t  cmsg_len;   /* number of bytes, including header */
@@ -216,7 +224,7 @@ struct ifreq {
 #define SO_LINGER       0x0080 /* linger on close if data present */
 #define SO_DONTLINGER   ((int)(~SO_LINGER))
 #define SO_OOBINLINE    0x0100 /* Unimplemented: leave received OOB data in line */
-#define SO_REUSEPORT    0x0200 /* Unimplemented: allow local address & port reuse */
+#define SO_REUSEPORT    0x0200 /* allow local address & port reuse (UDP only, see LWIP_UDP_REUSEPORT) */
 #define SO_SNDBUF       0x1001 /* Unimplemented: send buffer size */
 #define SO_RCVBUF       0x1002 /* receive buffer size */
 #define SO_SNDLOWAT     0x1003 /* Unimplemented: send low-water mark */
@@ -228,6 +236,8 @@ struct ifreq {
 #define SO_CONTIMEO     0x1009 /* Unimplemented: connect timeout */
 #define SO_NO_CHECK     0x100a /* don't create UDP checksum */
 #define SO_BINDTODEVICE 0x100b /* bind to device */
+#define SO_ZEROCOPY     0x100c /* allow MSG_ZEROCOPY (TCP only, see LWIP_SO_ZEROCOPY) */
+#define SO_MAX_PACING_RATE 0x100d /* pacing rate limit in bytes/s (u32_t, TCP only, see LWIP_TCP_PACING) */
 
 /*
  * Structure used for manipulating linger option.
@@ -272,6 +282,10 @@ struct linger {
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
 #define MSG_NOSIGNAL   0x20    /* Uninmplemented: Requests not to send the SIGPIPE signal if an attempt to send is made on a stream-oriented socket that is no longer connected. */
+#define MSG_ERRQUEUE   0x40    /* Receive zero-copy completions (see LWIP_SO_ZEROCOPY) */
+#define MSG_ZEROCOPY   0x80    /* Don't copy the data, report completion via MSG_ERRQUEUE (needs SO_ZEROCOPY) */
+#define MSG_FASTOPEN   0x100   /* sendto() on an unconnected TCP socket: connect with TCP Fast Open (needs LWIP_TCP_FASTOPEN) */
+#define MSG_WAITFORONE 0x200   /* recvmmsg(): only block for the first message (needs LWIP_SOCKET_MMSG) */
 
 
 /*
@@ -280,6 +294,7 @@ struct linger {
 #define IP_TOS             1
 #define IP_TTL             2
 #define IP_PKTINFO         8
+#define IP_RECVERR         11 /* only used as cmsg_type for MSG_ERRQUEUE */
 
 #if LWIP_TCP
 /*
@@ -290,6 +305,10 @@ struct linger {
 #define TCP_KEEPIDLE   0x03    /* set pcb->keep_idle  - Same as TCP_KEEPALIVE, but use seconds for get/setsockopt */
 #define TCP_KEEPINTVL  0x04    /* set pcb->keep_intvl - Use seconds for get/setsockopt */
 #define TCP_KEEPCNT    0x05    /* set pcb->keep_cnt   - Use number of probes sent for get/setsockopt */
+#define TCP_QUICKACK   0x0c    /* acknowledge received data at once for a while (value != 0) or delay ACKs again (0) */
+#define TCP_CONGESTION 0x0d    /* get/set the congestion control module by name (char[]) */
+#define TCP_FASTOPEN   0x17    /* accept data in SYNs of clients with a fast open cookie (value > 0: on) */
+#define TCP_FASTOPEN_CONNECT 0x1e /* connect() with fast open: the SYN carries the first data written */
 #endif /* LWIP_TCP */
 
 #if LWIP_IPV6
@@ -298,8 +317,26 @@ struct linger {
  */
 #define IPV6_CHECKSUM       7  /* RFC3542: calculate and insert the ICMPv6 checksum for raw sockets. */
 #define IPV6_V6ONLY         27 /* RFC3493: boolean control to restrict AF_INET6 sockets to IPv6 communications only. */
+#define IPV6_RECVERR        25 /* only used as cmsg_type for MSG_ERRQUEUE */
 #endif /* LWIP_IPV6 */
 
+/*
+ * Completions read with MSG_ERRQUEUE (cmsg IP_RECVERR/IPV6_RECVERR), as on Linux:
+ * for zero-copy sends, ee_info and ee_data are the numbers of the first and the
+ * last completed send.
+ */
+struct sock_extended_err {
+  u32_t ee_errno;
+  u8_t  ee_origin;
+  u8_t  ee_type;
+  u8_t  ee_code;
+  u8_t  ee_pad;
+  u32_t ee_info;
+  u32_t ee_data;
+};
+#define SO_EE_ORIGIN_ZEROCOPY      5
+#define SO_EE_CODE_ZEROCOPY_COPIED 1 /* never set by lwIP */
+
 #if LWIP_UDP && LWIP_UDPLITE
 /*
  * Options for level IPPROTO_UDPLITE
@@ -308,6 +345,13 @@ struct linger {
 #define UDPLITE_RECV_CSCOV 0x02 /* minimal receiver checksum coverage */
 #endif /* LWIP_UDP && LWIP_UDPLITE*/
 
+#if LWIP_UDP && LWIP_UDP_GSO
+/*
+ * Options for level IPPROTO_UDP
+ */
+#define UDP_SEGMENT        103  /* int: payload bytes per datagram (also a u16_t cmsg for sendmsg) */
+#endif /* LWIP_UDP && LWIP_UDP_GSO */
+
 
 #if LWIP_MULTICAST_TX_OPTIONS
 /*
@@ -492,7 +536,7 @@ typedef struct fd_set
   unsigned char fd_bits [(FD_SETSIZE+7)/8];
 } fd_set;
 
-#elif FD_SETSIZE < (LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN)
+#elif LWIP_SOCKET_SELECT && (FD_SETSIZE < (LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN))
 #error "external FD_SETSIZE too small for number of sockets"
 #else
 #define LWIP_SELECT_MAXNFDS FD_SETSIZE
@@ -521,6 +565,33 @@ struct pollfd
 };
 #endif
 
+#if LWIP_SOCKET_EPOLL && !defined(EPOLLIN)
+/* epoll-related defines and types */
+#define EPOLLIN      0x001
+#define EPOLLOUT     0x004
+#define EPOLLERR     0x008
+#define EPOLLONESHOT (1U << 30)
+#define EPOLLET      (1U << 31)
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+typedef union epoll_data {
+  void *ptr;
+  int fd;
+  u32_t u32;
+#if LWIP_HAVE_INT64
+  u64_t u64;
+#endif /* LWIP_HAVE_INT64 */
+} epoll_data_t;
+
+struct epoll_event {
+  u32_t events;
+  epoll_data_t data;
+};
+#endif /* LWIP_SOCKET_EPOLL && !defined(EPOLLIN) */
+
 /** LWIP_TIMEVAL_PRIVATE: if you want to use the struct timeval provided
  * by your system, set this to 0 and include <sys/time.h> in cc.h */
 #ifndef LWIP_TIMEVAL_PRIVATE
@@ -566,6 +637,10 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #define lwip_send         send
 #define lwip_sendmsg      sendmsg
 #define lwip_sendto       sendto
+#if LWIP_SOCKET_MMSG
+#define lwip_recvmmsg     recvmmsg
+#define lwip_sendmmsg     sendmmsg
+#endif
 #define lwip_socket       socket
 #if LWIP_SOCKET_SELECT
 #define lwip_select       select
@@ -573,6 +648,11 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #if LWIP_SOCKET_POLL
 #define lwip_poll         poll
 #endif
+#if LWIP_SOCKET_EPOLL
+#define lwip_epoll_create epoll_create
+#define lwip_epoll_ctl    epoll_ctl
+#define lwip_epoll_wait   epoll_wait
+#endif
 #define lwip_ioctl        ioctlsocket
 #define lwip_inet_ntop    inet_ntop
 #define lwip_inet_pton    inet_pton
@@ -612,6 +692,15 @@ ssize_t lwip_send(int s, const void *dataptr, size_t size, int flags);
 ssize_t lwip_sendmsg(int s, const struct msghdr *message, int flags);
 ssize_t lwip_sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
+#if LWIP_SOCKET_MMSG
+struct timespec;
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout);
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
+#if LWIP_SOCKET_ZEROCOPY_RECV
+ssize_t lwip_recvmsg_zerocopy(int s, struct msghdr *message, int flags, void **loan);
+int lwip_recvmsg_release(int s, void *loan);
+#endif
 int lwip_socket(int domain, int type, int protocol);
 ssize_t lwip_write(int s, const void *dataptr, size_t size);
 ssize_t lwip_writev(int s, const struct iovec *iov, int iovcnt);
@@ -622,6 +711,11 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
 #if LWIP_SOCKET_POLL
 int lwip_poll(struct pollfd *fds, nfds_t nfds, int timeout);
 #endif
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+#endif
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
 const char *lwip_inet_ntop(int af, const void *src, char *dst, socklen_t size);
@@ -661,6 +755,12 @@ int lwip_inet_pton(int af, const char *src, void *dst);
 #define sendmsg(s,message,flags)                  lwip_sendmsg(s,message,flags)
 /** @ingroup socket */
 #define sendto(s,dataptr,size,flags,to,tolen)     lwip_sendto(s,dataptr,size,flags,to,tolen)
+#if LWIP_SOCKET_MMSG
+/** @ingroup socket */
+#define recvmmsg(s,msgvec,vlen,flags,timeout)     lwip_recvmmsg(s,msgvec,vlen,flags,timeout)
+/** @ingroup socket */
+#define sendmmsg(s,msgvec,vlen,flags)             lwip_sendmmsg(s,msgvec,vlen,flags)
+#endif
 /** @ingroup socket */
 #define socket(domain,type,protocol)              lwip_socket(domain,type,protocol)
 #if LWIP_SOCKET_SELECT
@@ -671,6 +771,14 @@ int lwip_inet_pton(int af, const char *src, void *dst);
 /** @ingroup socket */
 #define poll(fds,nfds,timeout)                    lwip_poll(fds,nfds,timeout)
 #endif
+#if LWIP_SOCKET_EPOLL
+/** @ingroup socket */
+#define epoll_create(size)                        lwip_epoll_create(size)
+/** @ingroup socket */
+#define epoll_ctl(epfd,op,fd,event)               lwip_epoll_ctl(epfd,op,fd,event)
+/** @ingroup socket */
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif
 /** @ingroup socket */
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl(s,cmd,argp)
 /** @ingroup socket */
@@ -153,6 +153,11 @@ struct stats_mib2 {
   u32_t tcpinsegs;
   u32_t tcpinerrs;
   u32_t tcpoutrsts;
+#if LWIP_TCP_PACING
+  /* not part of the MIB: segments sent paced and times a pcb had to wait */
+  u32_t tcppacedsegs;
+  u32_t tcppacingdelays;
+#endif /* LWIP_TCP_PACING */
 
   /* UDP */
   u32_t udpindatagrams;
@@ -96,6 +96,20 @@ typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb,
 typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb,
                               u16_t len);
 
+/** Function prototype for extended tcp sent callback functions (@see tcp_sent_ext()).
+ * Same as @ref tcp_sent_fn, but all bytes acknowledged by one ACK are reported
+ * in one call, even if they are more than 64 KByte (window scaling).
+ *
+ * @param arg Additional argument to pass to the callback function (@see tcp_arg())
+ * @param tpcb The connection pcb for which data has been acknowledged
+ * @param len The amount of bytes acknowledged
+ * @return ERR_OK: try to send some data by calling tcp_output
+ *            Only return ERR_ABRT if you have called tcp_abort from within the
+ *            callback function!
+ */
+typedef err_t (*tcp_sent_ext_fn)(void *arg, struct tcp_pcb *tpcb,
+                                  size_t len);
+
 /** Function prototype for tcp poll callback functions. Called periodically as
  * specified by @see tcp_poll.
  *
@@ -203,6 +217,23 @@ struct tcp_pcb_ext_args {
 #define TCP_PCB_EXTARGS
 #endif
 
+#if LWIP_TCP_PCB_HASH
+/* This is a helper define to only include the hash chain pointer if enabled */
+#define TCP_PCB_HASH_NEXT(type) type *hash_next; /* for the hash bucket chain */
+#else
+#define TCP_PCB_HASH_NEXT(type)
+#endif
+
+#if LWIP_TCP_FASTOPEN
+/* This is a helper define to only include the fast open state if enabled */
+#define TCP_PCB_FASTOPEN u8_t fastopen;
+#define TCP_FASTOPEN_ENABLED   0x01U /* tcp_fastopen() enabled fast open */
+#define TCP_FASTOPEN_SYN_DATA  0x02U /* the SYN is held back to carry the first data */
+#define TCP_FASTOPEN_ACCEPTED  0x04U /* data in the SYN was accepted, the listener's accept callback was called */
+#else
+#define TCP_PCB_FASTOPEN
+#endif
+
 typedef u16_t tcpflags_t;
 #define TCP_ALLFLAGS 0xffffU
 
@@ -211,14 +242,75 @@ typedef u16_t tcpflags_t;
  */
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  TCP_PCB_HASH_NEXT(type) \
   void *callback_arg; \
   TCP_PCB_EXTARGS \
   enum tcp_state state; /* TCP state */ \
   u8_t prio; \
+  TCP_PCB_FASTOPEN \
   /* ports are in host byte order */ \
   u16_t local_port
 
 
+/**
+ * @ingroup tcp_raw
+ * A congestion control module, see @ref tcp_set_congestion_ops.
+ * The core does loss detection and recovery (fast retransmit, SACK) and calls
+ * these hooks to adjust cwnd and ssthresh. Optional hooks may be NULL.
+ */
+struct tcp_cc_ops {
+  /** name used by @ref tcp_set_congestion and the TCP_CONGESTION socket option */
+  const char *name;
+  /** optional: reset the per-pcb state, called when the module is selected */
+  void (*init)(struct tcp_pcb *pcb);
+  /** new data was acknowledged outside of loss recovery: grow cwnd */
+  void (*on_ack)(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+  /** loss was detected by duplicate ACKs or SACK: set ssthresh
+   * (cwnd is derived from it by the core) */
+  void (*on_loss)(struct tcp_pcb *pcb);
+  /** retransmission timeout: set ssthresh (cwnd is set to 1 MSS by the core) */
+  void (*on_rto)(struct tcp_pcb *pcb);
+  /** optional: new data is sent after the connection was idle for an RTO */
+  void (*on_idle)(struct tcp_pcb *pcb);
+};
+
+#if LWIP_TCP_CUBIC
+/** Per-pcb state of the CUBIC congestion control module */
+struct tcp_cubic {
+  /** cwnd before the last reduction */
+  u32_t w_max;
+  /** w_max before the last reduction (for fast convergence) */
+  u32_t w_last_max;
+  /** sys_now() when the current congestion avoidance epoch started (0: none) */
+  u32_t epoch_start;
+  /** time in ms it takes the cubic function to reach origin */
+  u32_t k;
+  /** window at the plateau of the cubic function */
+  u32_t origin;
+  /** estimated window of standard TCP (TCP-friendly region) */
+  u32_t w_est;
+};
+#endif /* LWIP_TCP_CUBIC */
+
+#if LWIP_TCP_PACING
+/** tcp_set_pacing_rate(): pace at the rate derived from cwnd and RTT, without a cap */
+#define TCP_PACING_RATE_AUTO 0xffffffffUL
+
+/** Per-pcb state of LWIP_TCP_PACING */
+struct tcp_pace {
+  /** rate limit in bytes per second, 0: pacing off (@see tcp_set_pacing_rate) */
+  u32_t max_rate;
+  /** smoothed RTT in 1/8 milliseconds (0: no sample yet) */
+  u32_t srtt;
+  /** sys_now() when the segment timed by rttest/rtseq was sent */
+  u32_t rtt_start;
+  /** sys_now() when credit was last updated */
+  u32_t stamp;
+  /** bytes that may be sent before the next segment is held back */
+  s32_t credit;
+};
+#endif /* LWIP_TCP_PACING */
+
 /** the TCP protocol control block for listening pcbs */
 struct tcp_pcb_listen {
 /** Common members of all PCB types */
@@ -235,6 +327,11 @@ struct tcp_pcb_listen {
   u8_t backlog;
   u8_t accepts_pending;
 #endif /* TCP_LISTEN_BACKLOG */
+
+#if LWIP_TCP_SYN_COOKIES
+  /* answer SYNs without allocating a pcb (see tcp_syncookies()) */
+  u8_t syncookies;
+#endif /* LWIP_TCP_SYN_COOKIES */
 };
 
 
@@ -269,6 +366,9 @@ struct tcp_pcb {
 #define TF_RTO         0x0800U /* RTO timer has fired, in-flight data moved to unsent and being retransmitted */
 #if LWIP_TCP_SACK_OUT
 #define TF_SACK        0x1000U /* Selective ACKs enabled */
+#endif
+#if LWIP_TCP_PACING
+#define TF_PACE_TIMER  0x2000U /* unsent data is held back by pacing, tcp_pace_timeout is scheduled */
 #endif
 
   /* the rest of the fields are in host byte order
@@ -278,6 +378,17 @@ struct tcp_pcb {
   u8_t polltmr, pollinterval;
   u8_t last_timer;
   u32_t tmr;
+#if LWIP_TCP_TIMER_WHEEL
+  /* slot list of the timer wheel and the tick this pcb is due in */
+  struct tcp_pcb *tmr_next;
+  struct tcp_pcb **tmr_pprev;
+  u32_t tmr_due;
+  /* tcp_ticks polltmr was last brought up to date */
+  u32_t tmr_poll;
+  /* list of pcbs tcp_fasttmr has to look at */
+  struct tcp_pcb *fast_next;
+  struct tcp_pcb **fast_pprev;
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
@@ -315,6 +426,32 @@ struct tcp_pcb {
   /* first byte following last rto byte */
   u32_t rto_end;
 
+  /* congestion control module */
+  const struct tcp_cc_ops *cc;
+#if LWIP_TCP_CUBIC
+  struct tcp_cubic cubic;
+#endif /* LWIP_TCP_CUBIC */
+#if LWIP_TCP_PACING
+  struct tcp_pace pace;
+#endif /* LWIP_TCP_PACING */
+#if LWIP_TCP_FASTOPEN
+  /* length of the fast open option in SYN segments (0: none) */
+  u8_t fastopen_optlen;
+#endif /* LWIP_TCP_FASTOPEN */
+#if LWIP_TCP_ACK_POLICY
+  /* acknowledge when this many full-sized segments are unacknowledged */
+  u8_t ack_every;
+  /* number of segments still acknowledged at once (quick-ack mode) */
+  u8_t ack_quick;
+  /* bytes received since the last ACK was sent */
+  tcpwnd_size_t ack_pending;
+#endif /* LWIP_TCP_ACK_POLICY */
+
+#if LWIP_TCP_SACK_IN
+  /* snd_nxt when SACK based loss recovery was entered (RFC 6675 RecoveryPoint) */
+  u32_t recovery_point;
+#endif /* LWIP_TCP_SACK_IN */
+
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
@@ -339,6 +476,12 @@ struct tcp_pcb {
   struct tcp_seg *unacked;  /* Sent but unacknowledged segments. */
 #if TCP_QUEUE_OOSEQ
   struct tcp_seg *ooseq;    /* Received out of sequence segments. */
+#if TCP_OOSEQ_RBTREE
+  struct tcp_seg *ooseq_root; /* The same segments as a tree ordered by seqno */
+  struct tcp_seg *ooseq_tail; /* Last segment on ooseq */
+  u32_t ooseq_bytes;          /* Sum of p->tot_len on ooseq */
+  u16_t ooseq_pbufs;          /* Sum of pbuf_clen(p) on ooseq */
+#endif /* TCP_OOSEQ_RBTREE */
 #endif /* TCP_QUEUE_OOSEQ */
 
   struct pbuf *refused_data; /* Data previously received but not yet taken by upper layer */
@@ -350,6 +493,8 @@ struct tcp_pcb {
 #if LWIP_CALLBACK_API
   /* Function to be called when more send buffer space is available. */
   tcp_sent_fn sent;
+  /* Same as 'sent', but without the 16-bit length limit (only one of both is set) */
+  tcp_sent_ext_fn sent_ext;
   /* Function to be called when (in-sequence) data has arrived. */
   tcp_recv_fn recv;
   /* Function to be called when a connection has been set up. */
@@ -365,7 +510,9 @@ struct tcp_pcb {
   u32_t ts_recent;
 #endif /* LWIP_TCP_TIMESTAMPS */
 
-  /* idle time before KEEPALIVE is sent */
+  /* idle time before KEEPALIVE is sent
+     (with LWIP_TCP_TIMER_WHEEL, call tcp_timer_update() after changing
+     keep_idle, keep_intvl, keep_cnt or SOF_KEEPALIVE) */
   u32_t keep_idle;
 #if LWIP_TCP_KEEPALIVE
   u32_t keep_intvl;
@@ -415,6 +562,7 @@ void             tcp_arg     (struct tcp_pcb *pcb, void *arg);
 #if LWIP_CALLBACK_API
 void             tcp_recv    (struct tcp_pcb *pcb, tcp_recv_fn recv);
 void             tcp_sent    (struct tcp_pcb *pcb, tcp_sent_fn sent);
+void             tcp_sent_ext(struct tcp_pcb *pcb, tcp_sent_ext_fn sent);
 void             tcp_err     (struct tcp_pcb *pcb, tcp_err_fn err);
 void             tcp_accept  (struct tcp_pcb *pcb, tcp_accept_fn accept);
 #endif /* LWIP_CALLBACK_API */
@@ -432,6 +580,9 @@ void             tcp_poll    (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interv
 #endif /* LWIP_TCP_TIMESTAMPS */
 /** @ingroup tcp_raw */
 #define          tcp_sndbuf(pcb)          (TCPWND16((pcb)->snd_buf))
+/** @ingroup tcp_raw
+ * Like @ref tcp_sndbuf, but not limited to 16 bits (for @ref tcp_write_ext) */
+#define          tcp_sndbuf_ext(pcb)      ((size_t)(pcb)->snd_buf)
 /** @ingroup tcp_raw */
 #define          tcp_sndqueuelen(pcb)     ((pcb)->snd_queuelen)
 /** @ingroup tcp_raw */
@@ -455,6 +606,7 @@ void             tcp_backlog_accepted(struct tcp_pcb* pcb);
 #define          tcp_accepted(pcb) do { LWIP_UNUSED_ARG(pcb); } while(0) /* compatibility define, not needed any more */
 
 void             tcp_recved  (struct tcp_pcb *pcb, u16_t len);
+void             tcp_recved_ext(struct tcp_pcb *pcb, size_t len);
 err_t            tcp_bind    (struct tcp_pcb *pcb, const ip_addr_t *ipaddr,
                               u16_t port);
 void             tcp_bind_netif(struct tcp_pcb *pcb, const struct netif *netif);
@@ -472,11 +624,62 @@ err_t            tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
 
 err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t len,
                               u8_t apiflags);
+err_t            tcp_write_ext(struct tcp_pcb *pcb, const void *dataptr, size_t len,
+                               u8_t apiflags, size_t *written);
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
 err_t            tcp_output  (struct tcp_pcb *pcb);
 
+extern const struct tcp_cc_ops tcp_cc_reno;
+#if LWIP_TCP_CUBIC
+extern const struct tcp_cc_ops tcp_cc_cubic;
+#endif /* LWIP_TCP_CUBIC */
+void             tcp_set_congestion_ops(struct tcp_pcb *pcb, const struct tcp_cc_ops *ops);
+err_t            tcp_set_congestion(struct tcp_pcb *pcb, const char *name);
+/** @ingroup tcp_raw */
+#define          tcp_get_congestion(pcb) ((pcb)->cc->name)
+
+#if LWIP_TCP_PACING
+void             tcp_set_pacing_rate(struct tcp_pcb *pcb, u32_t max_rate);
+/** @ingroup tcp_raw */
+#define          tcp_get_pacing_rate(pcb) ((pcb)->pace.max_rate)
+#endif /* LWIP_TCP_PACING */
+
+#if LWIP_TCP_FASTOPEN
+void             tcp_fastopen(struct tcp_pcb *pcb, u8_t enable);
+void             tcp_fastopen_set_key(u32_t key0, u32_t key1);
+/** @ingroup tcp_raw */
+#define          tcp_fastopen_enabled(pcb) (((pcb)->fastopen & TCP_FASTOPEN_ENABLED) != 0)
+#endif /* LWIP_TCP_FASTOPEN */
+
+#if LWIP_TCP_ACK_POLICY
+void             tcp_ack_every(struct tcp_pcb *pcb, u8_t segs);
+void             tcp_quickack(struct tcp_pcb *pcb, u8_t enable);
+/** @ingroup tcp_raw */
+#define          tcp_get_ack_every(pcb) ((pcb)->ack_every)
+/** @ingroup tcp_raw */
+#define          tcp_quickack_enabled(pcb) ((pcb)->ack_quick != 0)
+#endif /* LWIP_TCP_ACK_POLICY */
+
+#if LWIP_TCP_SYN_COOKIES
+void             tcp_syncookies(struct tcp_pcb *pcb, u8_t enable);
+void             tcp_syncookies_set_key(u32_t key0, u32_t key1);
+#endif /* LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_TCP_TIMER_WHEEL
+void             tcp_timer_update(struct tcp_pcb *pcb);
+#else /* LWIP_TCP_TIMER_WHEEL */
+#define          tcp_timer_update(pcb)
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
+#if LWIP_TCP_GSO
+err_t            tcp_gso_segment(struct netif *netif, struct pbuf *p, u16_t link_hlen, netif_linkoutput_fn output);
+#endif /* LWIP_TCP_GSO */
+#if LWIP_TCP_GRO
+void             tcp_gro_flush(struct netif *netif);
+#endif /* LWIP_TCP_GRO */
+
 err_t            tcp_tcp_get_tcp_addrinfo(struct tcp_pcb *pcb, int local, ip_addr_t *addr, u16_t *port);
 
 #define tcp_dbg_get_tcp_state(pcb) ((pcb)->state)
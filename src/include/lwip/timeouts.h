@@ -98,6 +98,14 @@ struct sys_timeo {
 #if LWIP_DEBUG_TIMERNAMES
   const char* handler_name;
 #endif /* LWIP_DEBUG_TIMERNAMES */
+#if LWIP_TIMERS_WHEEL
+  /* the head's prev points to the tail of the list */
+  struct sys_timeo *prev;
+  struct sys_timeo *hash_next;
+  struct sys_timeo **hash_pprev;
+  /* the wheel slot (or other list) this timeout is on */
+  u8_t list;
+#endif /* LWIP_TIMERS_WHEEL */
 };
 
 void sys_timeouts_init(void);
@@ -115,7 +123,12 @@ void sys_check_timeouts(void);
 u32_t sys_timeouts_sleeptime(void);
 
 #if LWIP_TESTMODE
+#if LWIP_TIMERS_WHEEL
+struct sys_timeo* sys_timeouts_take_all(void);
+void sys_timeouts_put_all(struct sys_timeo *timeouts);
+#else /* LWIP_TIMERS_WHEEL */
 struct sys_timeo** sys_timeouts_get_next_timeout(void);
+#endif /* LWIP_TIMERS_WHEEL */
 void lwip_cyclic_timer(void *arg);
 #endif
 
@@ -57,6 +57,9 @@ extern "C" {
 #define UDP_FLAGS_UDPLITE        0x02U
 #define UDP_FLAGS_CONNECTED      0x04U
 #define UDP_FLAGS_MULTICAST_LOOP 0x08U
+#if LWIP_UDP_REUSEPORT
+#define UDP_FLAGS_REUSEPORT      0x10U
+#endif /* LWIP_UDP_REUSEPORT */
 
 struct udp_pcb;
 
@@ -85,6 +88,10 @@ struct udp_pcb {
 /* Protocol specific PCB members */
 
   struct udp_pcb *next;
+#if LWIP_UDP_PCB_HASH
+  /** next pcb in the same local port hash bucket */
+  struct udp_pcb *hash_next;
+#endif /* LWIP_UDP_PCB_HASH */
 
   u8_t flags;
   /** ports are in host byte order */
@@ -106,6 +113,11 @@ struct udp_pcb {
   u16_t chksum_len_rx, chksum_len_tx;
 #endif /* LWIP_UDPLITE */
 
+#if LWIP_UDP_GSO
+  /** payload bytes per datagram for segmented sends, 0 to send as is */
+  u16_t gso_size;
+#endif /* LWIP_UDP_GSO */
+
   /** receive callback function */
   udp_recv_fn recv;
   /** user-supplied argument for the recv callback */
@@ -178,6 +190,11 @@ void             udp_init       (void);
 #define udp_get_multicast_ttl(pcb)                 ((pcb)->mcast_ttl)
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 
+#if LWIP_UDP_GSO
+#define udp_set_gso_size(pcb, size)                ((pcb)->gso_size = (size))
+#define udp_get_gso_size(pcb)                      ((pcb)->gso_size)
+#endif /* LWIP_UDP_GSO */
+
 #if UDP_DEBUG
 void udp_debug_print(struct udp_hdr *udphdr);
 #else
@@ -828,6 +828,1005 @@ cleanup:
 }
 END_TEST
 
+#if LWIP_SO_ZEROCOPY
+static int
+test_sockets_zerocopy_completed(int s, u32_t *lo, u32_t *hi)
+{
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  struct sock_extended_err *serr;
+  u8_t cmsg_buf[CMSG_SPACE(sizeof(struct sock_extended_err))];
+  int ret;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = cmsg_buf;
+  msg.msg_controllen = sizeof(cmsg_buf);
+  ret = lwip_recvmsg(s, &msg, MSG_ERRQUEUE);
+  if (ret == 0) {
+    cmsg = CMSG_FIRSTHDR(&msg);
+    fail_unless(cmsg != NULL);
+    fail_unless((cmsg->cmsg_level == IPPROTO_IP) || (cmsg->cmsg_level == IPPROTO_IPV6));
+    fail_unless((cmsg->cmsg_type == IP_RECVERR) || (cmsg->cmsg_type == IPV6_RECVERR));
+    serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+    fail_unless(serr->ee_errno == 0);
+    fail_unless(serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY);
+    *lo = serr->ee_info;
+    *hi = serr->ee_data;
+  }
+  return ret;
+}
+
+/* returns 1 if a segment queued on the pcb references 'data' */
+static int
+test_sockets_pcb_references(struct tcp_pcb *pcb, const u8_t *data, size_t len)
+{
+  struct tcp_seg *seg;
+  struct pbuf *q;
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    for (seg = (i == 0) ? pcb->unacked : pcb->unsent; seg != NULL; seg = seg->next) {
+      for (q = seg->p; q != NULL; q = q->next) {
+        if (((const u8_t *)q->payload >= data) && ((const u8_t *)q->payload < data + len)) {
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/* create a connected pair of nonblocking TCP sockets without Nagle */
+static void
+test_sockets_zerocopy_pair(int domain, int *s1, int *s2)
+{
+  int listnr, ret, opt;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+
+  test_sockets_init_loopback_addr(domain, &addr_storage, &addr_size);
+
+  listnr = test_sockets_alloc_socket_nonblocking(domain, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  *s1 = test_sockets_alloc_socket_nonblocking(domain, SOCK_STREAM);
+  fail_unless(*s1 >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_connect(*s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == -1);
+  fail_unless(errno == EINPROGRESS);
+  while (tcpip_thread_poll_one());
+  *s2 = lwip_accept(listnr, NULL, NULL);
+  fail_unless(*s2 >= 0);
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+  opt = 1;
+  ret = lwip_setsockopt(*s1, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+}
+
+static void test_sockets_zerocopy_domain(int domain)
+{
+  int s1, s2, i, ret, opt;
+  socklen_t opt_size;
+  struct lwip_sock *sock;
+  struct tcp_pcb *pcb;
+  u8_t snd_buf[300];
+  u8_t rcv_buf[300];
+  u32_t lo, hi;
+  err_t err;
+
+  for (i = 0; i < (int)sizeof(snd_buf); i++) {
+    snd_buf[i] = (u8_t)i;
+  }
+  test_sockets_zerocopy_pair(domain, &s1, &s2);
+
+  sock = lwip_socket_dbg_get_socket(s1);
+  fail_unless(sock != NULL);
+  pcb = sock->conn->pcb.tcp;
+
+  /* without SO_ZEROCOPY, MSG_ZEROCOPY is ignored */
+  ret = lwip_send(s1, snd_buf, 10, MSG_ZEROCOPY);
+  fail_unless(ret == 10);
+  fail_unless(!test_sockets_pcb_references(pcb, snd_buf, sizeof(snd_buf)));
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s2, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 10);
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == -1);
+  fail_unless(errno == EAGAIN);
+
+  opt = 1;
+  ret = lwip_setsockopt(s1, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  opt = 0;
+  opt_size = sizeof(opt);
+  ret = lwip_getsockopt(s1, SOL_SOCKET, SO_ZEROCOPY, &opt, &opt_size);
+  fail_unless(ret == 0);
+  fail_unless(opt == 1);
+
+  /* 3 sends, more than LWIP_SO_ZEROCOPY_PENDING: the data is referenced */
+  for (i = 0; i < 3; i++) {
+    ret = lwip_send(s1, &snd_buf[i * 100], 100, MSG_ZEROCOPY);
+    fail_unless(ret == 100);
+  }
+  fail_unless(test_sockets_pcb_references(pcb, snd_buf, sizeof(snd_buf)));
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == -1);
+  fail_unless(errno == EAGAIN);
+
+  /* deliver, ACK (also a delayed one) and check completions */
+  while (tcpip_thread_poll_one());
+  tcp_fasttmr();
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s2, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == sizeof(rcv_buf));
+  fail_unless(!memcmp(rcv_buf, snd_buf, sizeof(rcv_buf)));
+  fail_unless(!test_sockets_pcb_references(pcb, snd_buf, sizeof(snd_buf)));
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == 0);
+  fail_unless(lo == 0);
+  fail_unless(hi == 2);
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == -1);
+  fail_unless(errno == EAGAIN);
+
+  /* a send that is not acknowledged is completed when the connection is aborted */
+  ret = lwip_send(s1, snd_buf, 100, MSG_ZEROCOPY);
+  fail_unless(ret == 100);
+  tcp_abort(pcb);
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == 0);
+  fail_unless(lo == 3);
+  fail_unless(hi == 3);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+
+  /* closing a connection copies the data of pending sends and completes them */
+  test_sockets_zerocopy_pair(domain, &s1, &s2);
+  opt = 1;
+  ret = lwip_setsockopt(s1, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  sock = lwip_socket_dbg_get_socket(s1);
+  fail_unless(sock != NULL);
+  pcb = sock->conn->pcb.tcp;
+  for (i = 0; i < 3; i++) {
+    ret = lwip_send(s1, &snd_buf[i * 100], 100, MSG_ZEROCOPY);
+    fail_unless(ret == 100);
+  }
+  fail_unless(test_sockets_pcb_references(pcb, snd_buf, sizeof(snd_buf)));
+  err = netconn_close(sock->conn);
+  fail_unless(err == ERR_OK);
+  fail_unless(!test_sockets_pcb_references(pcb, snd_buf, sizeof(snd_buf)));
+  ret = test_sockets_zerocopy_completed(s1, &lo, &hi);
+  fail_unless(ret == 0);
+  fail_unless(lo == 0);
+  fail_unless(hi == 2);
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  /* the copy is sent */
+  memset(snd_buf, 0, sizeof(snd_buf));
+  while (tcpip_thread_poll_one());
+  tcp_fasttmr();
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s2, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == sizeof(rcv_buf));
+  for (i = 0; i < (int)sizeof(rcv_buf); i++) {
+    fail_unless(rcv_buf[i] == (u8_t)i);
+  }
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+}
+#endif /* LWIP_SO_ZEROCOPY */
+
+/* Verify MSG_ZEROCOPY sends and their completions */
+START_TEST(test_sockets_zerocopy)
+{
+  LWIP_UNUSED_ARG(_i);
+#if LWIP_SO_ZEROCOPY
+#if LWIP_IPV4
+  test_sockets_zerocopy_domain(AF_INET);
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  test_sockets_zerocopy_domain(AF_INET6);
+#endif /* LWIP_IPV6 */
+#endif /* LWIP_SO_ZEROCOPY */
+}
+END_TEST
+
+#if LWIP_SOCKET_EPOLL
+/* send a datagram from s to 'addr' and deliver it */
+static void
+test_sockets_epoll_send(int s, const struct sockaddr_storage *addr, socklen_t addr_size)
+{
+  const u8_t snd_buf[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+  ssize_t ret = lwip_sendto(s, snd_buf, sizeof(snd_buf), 0, (const struct sockaddr*)addr, addr_size);
+  fail_unless(ret == sizeof(snd_buf));
+  while (tcpip_thread_poll_one());
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
+/* Verify level-triggered, edge-triggered and oneshot readiness of epoll */
+START_TEST(test_sockets_epoll)
+{
+#if LWIP_SOCKET_EPOLL && LWIP_IPV4
+  int ep, s1, s2, ret;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct epoll_event ev, events[4];
+  u8_t rcv_buf[4];
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  ep = lwip_epoll_create(1);
+  fail_unless(ep >= 0);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  /* invalid calls */
+  ret = lwip_epoll_wait(s1, events, 4, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+  ev.events = EPOLLIN;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == -1);
+  fail_unless(errno == ENOENT);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless(ret == -1);
+  fail_unless(errno == EEXIST);
+
+  /* edge-triggered: a UDP socket is writable at once, that is reported once */
+  ev.events = EPOLLOUT | EPOLLET;
+  ev.data.fd = s2;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLOUT);
+  fail_unless(events[0].data.fd == s2);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  /* level-triggered: reported until the data is read (s2 has no new event) */
+  test_sockets_epoll_send(s2, &addr_storage, addr_size);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLIN);
+  fail_unless(events[0].data.fd == s1);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].data.fd == s1);
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == sizeof(rcv_buf));
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless(ret == 0);
+
+  /* edge-triggered: reported once per datagram, though data is left */
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  test_sockets_epoll_send(s2, &addr_storage, addr_size);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLIN);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  test_sockets_epoll_send(s2, &addr_storage, addr_size);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == sizeof(rcv_buf));
+
+  /* oneshot: reported once until EPOLL_CTL_MOD re-arms it */
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  test_sockets_epoll_send(s2, &addr_storage, addr_size);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+
+  /* closing a socket removes it from the interest set */
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s1, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  /* closing the epoll instance frees what is left of its interest set */
+  ev.events = EPOLLOUT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_close(ep);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SOCKET_EPOLL && LWIP_IPV4 */
+}
+END_TEST
+
+/* Send and receive a batch of datagrams with sendmmsg/recvmmsg */
+START_TEST(test_sockets_mmsg)
+{
+#if LWIP_SOCKET_MMSG && LWIP_IPV4
+  int s1, s2, ret;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct mmsghdr msgs[4];
+  struct iovec snd_iovs[3], rcv_iovs[4];
+  u8_t snd_buf[6] = {0xDE, 0xAD, 0xBE, 0xEF, 0xCA, 0xFE};
+  u8_t rcv_bufs[4][8];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < 4; i++) {
+    rcv_iovs[i].iov_base = rcv_bufs[i];
+    rcv_iovs[i].iov_len = sizeof(rcv_bufs[i]);
+  }
+
+  /* nothing received yet */
+  for (i = 0; i < 4; i++) {
+    msgs[i].msg_hdr.msg_iov = &rcv_iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ret = lwip_recvmmsg(s1, msgs, 4, MSG_DONTWAIT, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+
+  /* two datagrams, the second one from two vectors */
+  snd_iovs[0].iov_base = snd_buf;
+  snd_iovs[0].iov_len = 4;
+  snd_iovs[1].iov_base = snd_buf;
+  snd_iovs[1].iov_len = 2;
+  snd_iovs[2].iov_base = &snd_buf[2];
+  snd_iovs[2].iov_len = 4;
+  memset(msgs, 0, sizeof(msgs));
+  msgs[0].msg_hdr.msg_name = &addr_storage;
+  msgs[0].msg_hdr.msg_namelen = addr_size;
+  msgs[0].msg_hdr.msg_iov = &snd_iovs[0];
+  msgs[0].msg_hdr.msg_iovlen = 1;
+  msgs[1].msg_hdr.msg_name = &addr_storage;
+  msgs[1].msg_hdr.msg_namelen = addr_size;
+  msgs[1].msg_hdr.msg_iov = &snd_iovs[1];
+  msgs[1].msg_hdr.msg_iovlen = 2;
+  ret = lwip_sendmmsg(s2, msgs, 2, 0);
+  fail_unless(ret == 2);
+  fail_unless(msgs[0].msg_len == 4);
+  fail_unless(msgs[1].msg_len == 6);
+  while (tcpip_thread_poll_one());
+
+  /* receive both with one call, the first message is too small */
+  memset(msgs, 0, sizeof(msgs));
+  rcv_iovs[0].iov_len = 2;
+  for (i = 0; i < 4; i++) {
+    msgs[i].msg_hdr.msg_iov = &rcv_iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ret = lwip_recvmmsg(s1, msgs, 4, MSG_WAITFORONE, NULL);
+  fail_unless(ret == 2);
+  fail_unless(msgs[0].msg_len == 4);
+  fail_unless(msgs[0].msg_hdr.msg_flags == MSG_TRUNC);
+  fail_unless(memcmp(rcv_bufs[0], snd_buf, 2) == 0);
+  fail_unless(msgs[1].msg_len == 6);
+  fail_unless(msgs[1].msg_hdr.msg_flags == 0);
+  fail_unless(memcmp(rcv_bufs[1], snd_buf, 6) == 0);
+
+  /* unsupported arguments */
+  ret = lwip_recvmmsg(s1, msgs, 4, MSG_OOB, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == EOPNOTSUPP);
+  msgs[0].msg_hdr.msg_iovlen = 0;
+  ret = lwip_sendmmsg(s2, msgs, 1, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EMSGSIZE);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SOCKET_MMSG && LWIP_IPV4 */
+}
+END_TEST
+
+/* Send segmented datagrams with the UDP_SEGMENT option and cmsg */
+START_TEST(test_sockets_udp_segment)
+{
+#if LWIP_UDP_GSO && LWIP_IPV4
+  int s1, s2, ret, val;
+  socklen_t len;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct msghdr msg;
+  struct iovec iov;
+  u8_t ctrl[CMSG_SPACE(sizeof(u16_t))];
+  struct cmsghdr *cmsg;
+  u16_t gso_size;
+  const u8_t snd_buf[6] = {0xDE, 0xAD, 0xBE, 0xEF, 0xCA, 0xFE};
+  u8_t rcv_buf[8];
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  /* socket option: 6 bytes are sent as 4 + 2 */
+  val = 4;
+  ret = lwip_setsockopt(s2, IPPROTO_UDP, UDP_SEGMENT, &val, sizeof(val));
+  fail_unless(ret == 0);
+  val = 0;
+  len = sizeof(val);
+  ret = lwip_getsockopt(s2, IPPROTO_UDP, UDP_SEGMENT, &val, &len);
+  fail_unless(ret == 0);
+  fail_unless(val == 4);
+  ret = lwip_sendto(s2, snd_buf, sizeof(snd_buf), 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == sizeof(snd_buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 4);
+  fail_unless(memcmp(rcv_buf, snd_buf, 4) == 0);
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 2);
+  fail_unless(memcmp(rcv_buf, &snd_buf[4], 2) == 0);
+
+  /* cmsg: overrides the option for one sendmsg, 6 bytes as 3 + 3 */
+  iov.iov_base = LWIP_CONST_CAST(u8_t *, snd_buf);
+  iov.iov_len = sizeof(snd_buf);
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &addr_storage;
+  msg.msg_namelen = addr_size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(u16_t));
+  gso_size = 3;
+  memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+  ret = lwip_sendmsg(s2, &msg, 0);
+  fail_unless(ret == sizeof(snd_buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 3);
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 3);
+  fail_unless(memcmp(rcv_buf, &snd_buf[3], 3) == 0);
+  ret = lwip_recv(s1, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == -1);
+  val = 0;
+  len = sizeof(val);
+  ret = lwip_getsockopt(s2, IPPROTO_UDP, UDP_SEGMENT, &val, &len);
+  fail_unless(ret == 0);
+  fail_unless(val == 4);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_UDP_GSO && LWIP_IPV4 */
+}
+END_TEST
+
+#if LWIP_NETCONN_RING
+static struct netconn_ring_sqe *
+test_netconn_ring_sqe(struct netconn_ring *ring, u8_t opcode, struct netconn *conn, uintptr_t user_data)
+{
+  struct netconn_ring_sqe *sqe = netconn_ring_get_sqe(ring);
+  fail_unless(sqe != NULL);
+  sqe->opcode = opcode;
+  sqe->conn = conn;
+  sqe->user_data = (void *)user_data;
+  return sqe;
+}
+
+static void
+test_netconn_ring_check_cqe(const struct netconn_ring_cqe *cqe, uintptr_t user_data, err_t err, size_t len)
+{
+  fail_unless(cqe->user_data == (void *)user_data);
+  fail_unless(cqe->err == err);
+  fail_unless(cqe->len == len);
+}
+#endif /* LWIP_NETCONN_RING */
+
+/* Accept, connect, send, receive and close TCP netconns through a netconn_ring */
+START_TEST(test_sockets_netconn_ring)
+{
+#if LWIP_NETCONN_RING && LWIP_IPV4
+  struct netconn_ring *ring;
+  struct netconn_ring_sqe *sqe;
+  struct netconn_ring_cqe cqes[4];
+  struct netconn *listener, *client, *server;
+  ip_addr_t addr;
+  u16_t port;
+  err_t err;
+  const u8_t snd_buf[6] = {'h', 'e', 'l', 'l', 'o', '!'};
+  u8_t rcv_buf[4];
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(netconn_ring_new(6) == NULL);
+  ring = netconn_ring_new(4);
+  fail_unless(ring != NULL);
+
+  listener = netconn_new_with_callback(NETCONN_TCP, netconn_ring_callback);
+  fail_unless(listener != NULL);
+  err = netconn_bind(listener, IP4_ADDR_ANY, 0);
+  fail_unless(err == ERR_OK);
+  err = netconn_listen(listener);
+  fail_unless(err == ERR_OK);
+  err = netconn_getaddr(listener, &addr, &port, 1);
+  fail_unless(err == ERR_OK);
+  client = netconn_new_with_callback(NETCONN_TCP, netconn_ring_callback);
+  fail_unless(client != NULL);
+
+  /* both wait for the handshake */
+  test_netconn_ring_sqe(ring, NETCONN_RING_ACCEPT, listener, 1);
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_CONNECT, client, 2);
+  ip_addr_set_loopback(0, &sqe->addr);
+  sqe->port = port;
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 0);
+  fail_unless(netconn_ring_wait(ring, 1) == ERR_TIMEOUT);
+  while (tcpip_thread_poll_one());
+  fail_unless(netconn_ring_wait(ring, 1) == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 2);
+  test_netconn_ring_check_cqe(&cqes[0], 2, ERR_OK, 0);
+  fail_unless(cqes[0].conn == client);
+  test_netconn_ring_check_cqe(&cqes[1], 1, ERR_OK, 0);
+  server = cqes[1].conn;
+  fail_unless(server != NULL);
+  fail_unless(server != listener);
+
+  /* the receive waits for data, the send completes at once */
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_RECV, server, 3);
+  sqe->buf = rcv_buf;
+  sqe->len = sizeof(rcv_buf);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_SEND, client, 4);
+  sqe->buf = LWIP_CONST_CAST(u8_t *, snd_buf);
+  sqe->len = sizeof(snd_buf);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 1);
+  test_netconn_ring_check_cqe(&cqes[0], 4, ERR_OK, sizeof(snd_buf));
+  while (tcpip_thread_poll_one());
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 1);
+  test_netconn_ring_check_cqe(&cqes[0], 3, ERR_OK, 4);
+  fail_unless(memcmp(rcv_buf, snd_buf, 4) == 0);
+  /* the rest is left over from the first receive */
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_RECV, server, 5);
+  sqe->buf = rcv_buf;
+  sqe->len = sizeof(rcv_buf);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 1);
+  test_netconn_ring_check_cqe(&cqes[0], 5, ERR_OK, 2);
+  fail_unless(memcmp(rcv_buf, &snd_buf[4], 2) == 0);
+
+  /* closing completes the receive still waiting first */
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_RECV, client, 6);
+  sqe->buf = rcv_buf;
+  sqe->len = sizeof(rcv_buf);
+  test_netconn_ring_sqe(ring, NETCONN_RING_CLOSE, client, 7);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 2);
+  test_netconn_ring_check_cqe(&cqes[0], 6, ERR_CLSD, 0);
+  test_netconn_ring_check_cqe(&cqes[1], 7, ERR_OK, 0);
+  while (tcpip_thread_poll_one());
+
+  /* the server sees the end of the connection (0 bytes), twice */
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_RECV, server, 8);
+  sqe->buf = rcv_buf;
+  sqe->len = sizeof(rcv_buf);
+  sqe = test_netconn_ring_sqe(ring, NETCONN_RING_RECV, server, 9);
+  sqe->buf = rcv_buf;
+  sqe->len = sizeof(rcv_buf);
+  test_netconn_ring_sqe(ring, NETCONN_RING_CLOSE, server, 10);
+  test_netconn_ring_sqe(ring, NETCONN_RING_CLOSE, listener, 11);
+  fail_unless(netconn_ring_get_sqe(ring) == NULL);
+  err = netconn_ring_delete(ring);
+  fail_unless(err == ERR_INPROGRESS);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 4);
+  test_netconn_ring_check_cqe(&cqes[0], 8, ERR_OK, 0);
+  test_netconn_ring_check_cqe(&cqes[1], 9, ERR_OK, 0);
+  test_netconn_ring_check_cqe(&cqes[2], 10, ERR_OK, 0);
+  test_netconn_ring_check_cqe(&cqes[3], 11, ERR_OK, 0);
+
+  /* netconns without netconn_ring_callback are refused */
+  client = netconn_new(NETCONN_TCP);
+  fail_unless(client != NULL);
+  test_netconn_ring_sqe(ring, NETCONN_RING_CLOSE, client, 12);
+  err = netconn_ring_submit(ring);
+  fail_unless(err == ERR_OK);
+  fail_unless(netconn_ring_reap(ring, cqes, 4) == 1);
+  test_netconn_ring_check_cqe(&cqes[0], 12, ERR_ARG, 0);
+  err = netconn_delete(client);
+  fail_unless(err == ERR_OK);
+
+  err = netconn_ring_delete(ring);
+  fail_unless(err == ERR_OK);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_NETCONN_RING && LWIP_IPV4 */
+}
+END_TEST
+
+#if LWIP_SOCKET_ZEROCOPY_RECV
+/* reorder the loopback netif: move the first queued packet behind the others */
+static void
+test_sockets_loop_delay_first(void)
+{
+  struct netif *loopif = netif_get_loopif();
+  struct pbuf *first = loopif->loop_first;
+
+  fail_unless(first != NULL);
+  fail_unless(first->len == first->tot_len);
+  fail_unless(first != loopif->loop_last);
+  loopif->loop_first = first->next;
+  first->next = NULL;
+  loopif->loop_last->next = first;
+  loopif->loop_last = first;
+}
+
+/* a chain of 'num' PBUF_RAM pbufs of 10 bytes each, filled with 'first', 'first' + 1, ... */
+static struct pbuf *
+test_sockets_zerocopy_chain(int num, u8_t first)
+{
+  struct pbuf *p = NULL, *q;
+  int i;
+
+  for (i = 0; i < num; i++) {
+    q = pbuf_alloc(PBUF_RAW, 10, PBUF_RAM);
+    fail_unless(q != NULL);
+    memset(q->payload, first + i, 10);
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  return p;
+}
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
+
+/* Verify data loaned by lwip_recvmsg_zerocopy() and the window update on release */
+START_TEST(test_sockets_zerocopy_recv)
+{
+#if LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4
+  int listnr, s1, s2, s3, i, ret, opt;
+  struct sockaddr_storage addr_storage, from;
+  socklen_t addr_size;
+  struct lwip_sock *sock;
+  struct tcp_pcb *pcb;
+  struct netbuf *buf;
+  struct msghdr msg;
+  struct iovec iov[4];
+  u8_t snd_buf[300];
+  u8_t rcv_buf[10];
+  void *loan, *loan2;
+  tcpwnd_size_t wnd;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < (int)sizeof(snd_buf); i++) {
+    snd_buf[i] = (u8_t)i;
+  }
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+
+  listnr = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_connect(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == -1);
+  fail_unless(errno == EINPROGRESS);
+  while (tcpip_thread_poll_one());
+  s2 = lwip_accept(listnr, NULL, NULL);
+  fail_unless(s2 >= 0);
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+  opt = 1;
+  ret = lwip_setsockopt(s1, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  sock = lwip_socket_dbg_get_socket(s2);
+  fail_unless(sock != NULL);
+  pcb = sock->conn->pcb.tcp;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 4;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, MSG_PEEK, &loan);
+  fail_unless(ret == -1);
+  fail_unless(errno == EOPNOTSUPP);
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, MSG_DONTWAIT, &loan);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+  fail_unless(loan == NULL);
+
+  /* 3 segments, one iovec: one is loaned per call */
+  for (i = 0; i < 3; i++) {
+    ret = lwip_send(s1, &snd_buf[i * 100], 100, 0);
+    fail_unless(ret == 100);
+  }
+  while (tcpip_thread_poll_one());
+  wnd = pcb->rcv_wnd;
+  msg.msg_iovlen = 1;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, MSG_DONTWAIT, &loan);
+  fail_unless(ret == 100);
+  fail_unless(msg.msg_iovlen == 1);
+  fail_unless(iov[0].iov_len == 100);
+  fail_unless(!memcmp(iov[0].iov_base, snd_buf, 100));
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, MSG_DONTWAIT, &loan2);
+  fail_unless(ret == 100);
+  fail_unless(!memcmp(iov[0].iov_base, &snd_buf[100], 100));
+  /* the window is only opened on release */
+  fail_unless(pcb->rcv_wnd == wnd);
+  ret = lwip_recvmsg_release(s2, loan2);
+  fail_unless(ret == 0);
+  fail_unless(pcb->rcv_wnd == wnd + 100);
+  ret = lwip_recvmsg_release(s2, loan);
+  fail_unless(ret == 0);
+  fail_unless(pcb->rcv_wnd == wnd + 200);
+
+  /* the rest is still received by lwip_recv() */
+  ret = (int)lwip_recv(s2, rcv_buf, sizeof(rcv_buf), 0);
+  fail_unless(ret == 10);
+  fail_unless(rcv_buf[0] == 200);
+  fail_unless(pcb->rcv_wnd == wnd + 210);
+
+  /* 3 segments arriving out of order are passed on as one chain of 3 pbufs
+     when the first one fills the hole */
+  for (i = 0; i < 3; i++) {
+    ret = lwip_send(s1, &snd_buf[i * 10], 10, 0);
+    fail_unless(ret == 10);
+  }
+  test_sockets_loop_delay_first();
+  while (tcpip_thread_poll_one());
+  /* the chain does not fit behind the rest of the segment read from above */
+  msg.msg_iovlen = 3;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, 0, &loan);
+  fail_unless(ret == 90);
+  fail_unless(msg.msg_iovlen == 1);
+  fail_unless(((u8_t *)iov[0].iov_base)[0] == 210);
+  fail_unless(sock->lastdata.pbuf != NULL);
+  fail_unless(pbuf_clen(sock->lastdata.pbuf) == 3);
+  /* a chain with more pbufs than iovecs is split */
+  msg.msg_iovlen = 2;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, 0, &loan2);
+  fail_unless(ret == 20);
+  fail_unless(msg.msg_iovlen == 2);
+  fail_unless(!memcmp(iov[0].iov_base, snd_buf, 10));
+  fail_unless(!memcmp(iov[1].iov_base, &snd_buf[10], 10));
+  fail_unless(sock->lastdata.pbuf != NULL);
+  fail_unless(sock->lastdata.pbuf->tot_len == 10);
+  ret = lwip_recvmsg_release(s2, loan);
+  fail_unless(ret == 0);
+  fail_unless(pcb->rcv_wnd == wnd + 300 - 30);
+  msg.msg_iovlen = 4;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, 0, &loan);
+  fail_unless(ret == 10);
+  fail_unless(!memcmp(iov[0].iov_base, &snd_buf[20], 10));
+  fail_unless(sock->lastdata.pbuf == NULL);
+  ret = lwip_recvmsg_release(s2, loan2);
+  fail_unless(ret == 0);
+  fail_unless(pcb->rcv_wnd == wnd + 300 - 10);
+
+  /* segments queued already are loaned together if the iovecs suffice */
+  for (i = 0; i < 2; i++) {
+    ret = lwip_send(s1, &snd_buf[i * 100], 100, 0);
+    fail_unless(ret == 100);
+  }
+  while (tcpip_thread_poll_one());
+  ret = lwip_recvmsg_release(s2, loan);
+  fail_unless(ret == 0);
+  msg.msg_iovlen = 4;
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, MSG_DONTWAIT, &loan2);
+  fail_unless(ret == 200);
+  fail_unless(msg.msg_iovlen == 2);
+  fail_unless(!memcmp(iov[1].iov_base, &snd_buf[100], 100));
+
+  /* end of stream, data released after close is freed nonetheless */
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+  ret = (int)lwip_recvmsg_zerocopy(s2, &msg, 0, &loan);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+  ret = lwip_recvmsg_release(s2, loan2);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+
+  /* UDP: one datagram with the sender address, the rest of a long chain is discarded */
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  s3 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s3 >= 0);
+  ret = lwip_bind(s3, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s3, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = (int)lwip_sendto(s3, snd_buf, 50, 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 50);
+  while (tcpip_thread_poll_one());
+  msg.msg_name = &from;
+  msg.msg_namelen = sizeof(from);
+  ret = (int)lwip_recvmsg_zerocopy(s3, &msg, 0, &loan);
+  fail_unless(ret == 50);
+  fail_unless(msg.msg_flags == 0);
+  fail_unless(!memcmp(iov[0].iov_base, snd_buf, 50));
+  fail_unless(msg.msg_namelen == addr_size);
+  fail_unless(!memcmp(&from, &addr_storage, addr_size));
+  ret = lwip_recvmsg_release(s3, loan);
+  fail_unless(ret == 0);
+
+  sock = lwip_socket_dbg_get_socket(s3);
+  fail_unless(sock != NULL);
+  buf = netbuf_new();
+  fail_unless(buf != NULL);
+  buf->p = buf->ptr = test_sockets_zerocopy_chain(3, 1);
+  sock->lastdata.netbuf = buf;
+  msg.msg_iovlen = 2;
+  ret = (int)lwip_recvmsg_zerocopy(s3, &msg, 0, &loan);
+  fail_unless(ret == 20);
+  fail_unless(msg.msg_iovlen == 2);
+  fail_unless(msg.msg_flags == MSG_TRUNC);
+  fail_unless(sock->lastdata.netbuf == NULL);
+  ret = lwip_recvmsg_release(s3, loan);
+  fail_unless(ret == 0);
+  ret = lwip_close(s3);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4 */
+}
+END_TEST
+
+/* Verify that idle keepalive connections are left alone by tcp_slowtmr
+   (once per timer wheel revolution) instead of being polled by the netconn
+   layer, and that setsockopt reschedules the keepalive timer */
+START_TEST(test_sockets_timer_wheel_idle)
+{
+#if LWIP_TCP_TIMER_WHEEL && LWIP_IPV4
+  int listnr, ret, opt, i;
+  int s[(NUM_SOCKETS - 1) & ~1];
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct lwip_sock *sock;
+  struct tcp_pcb *pcb;
+  u32_t visits, npcbs, ticks;
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  listnr = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(s); i += 2) {
+    s[i] = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+    fail_unless(s[i] >= 0);
+    ret = lwip_connect(s[i], (struct sockaddr*)&addr_storage, addr_size);
+    fail_unless(ret == -1);
+    fail_unless(errno == EINPROGRESS);
+    while (tcpip_thread_poll_one());
+    s[i + 1] = lwip_accept(listnr, NULL, NULL);
+    fail_unless(s[i + 1] >= 0);
+  }
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(s); i++) {
+    opt = 1;
+    ret = lwip_setsockopt(s[i], SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
+    fail_unless(ret == 0);
+  }
+  tcp_fasttmr();
+  while (tcpip_thread_poll_one());
+
+  /* every pcb is looked at once per revolution */
+  npcbs = 0;
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    fail_unless(pcb->poll == NULL);
+    npcbs++;
+  }
+  fail_unless(npcbs == LWIP_ARRAYSIZE(s));
+  visits = 0;
+  for (ticks = 0; ticks < 2 * TCP_TIMER_WHEEL_SIZE; ticks++) {
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+      if (pcb->tmr_due == tcp_ticks + 1) {
+        visits++;
+      }
+    }
+    tcp_slowtmr();
+    while (tcpip_thread_poll_one());
+  }
+  fail_unless(visits == 2 * npcbs);
+
+  /* a shorter keepalive time is scheduled right away */
+  sock = lwip_socket_dbg_get_socket(s[0]);
+  fail_unless(sock != NULL);
+  pcb = sock->conn->pcb.tcp;
+  opt = 2 * TCP_SLOW_INTERVAL;
+  ret = lwip_setsockopt(s[0], IPPROTO_TCP, TCP_KEEPALIVE, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  fail_unless(pcb->tmr_due - tcp_ticks <= 3);
+
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(s); i++) {
+    ret = lwip_close(s[i]);
+    fail_unless(ret == 0);
+    while (tcpip_thread_poll_one());
+  }
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_TIMER_WHEEL && LWIP_IPV4 */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 sockets_suite(void)
@@ -838,6 +1837,13 @@ sockets_suite(void)
     TESTFUNC(test_sockets_msgapis),
     TESTFUNC(test_sockets_select),
     TESTFUNC(test_sockets_recv_after_rst),
+    TESTFUNC(test_sockets_zerocopy),
+    TESTFUNC(test_sockets_epoll),
+    TESTFUNC(test_sockets_mmsg),
+    TESTFUNC(test_sockets_udp_segment),
+    TESTFUNC(test_sockets_netconn_ring),
+    TESTFUNC(test_sockets_zerocopy_recv),
+    TESTFUNC(test_sockets_timer_wheel_idle),
   };
   return create_suite("SOCKETS", tests, sizeof(tests)/sizeof(testfunc), sockets_setup, sockets_teardown);
 }
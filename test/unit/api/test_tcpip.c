@@ -0,0 +1,139 @@
+#include "test_tcpip.h"
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/tcpip.h"
+
+#if !LWIP_TCPIP_INPUT_BATCH || LWIP_TCPIP_CORE_LOCKING_INPUT
+#error "This tests needs LWIP_TCPIP_INPUT_BATCH and !LWIP_TCPIP_CORE_LOCKING_INPUT"
+#endif
+
+#define NUM_TEST_PKTS (2 * TCPIP_INPUT_BATCH_SIZE + 1)
+
+static struct netif test_netif;
+static int input_ctr;
+static int input_fail_odd;
+
+/* Setups/teardown functions */
+
+static void
+tcpip_setup(void)
+{
+  input_ctr = 0;
+  input_fail_odd = 0;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+tcpip_teardown(void)
+{
+  while (tcpip_thread_poll_one());
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* Helper functions */
+
+/** checks that packets arrive in order, frees them or fails every second one */
+static err_t
+test_input_fn(struct pbuf *p, struct netif *inp)
+{
+  fail_unless(inp == &test_netif);
+  fail_unless(p != NULL);
+  fail_unless(pbuf_get_at(p, 0) == (u8_t)input_ctr);
+  input_ctr++;
+  if (input_fail_odd && (input_ctr & 1)) {
+    /* tcpip_thread has to free the packet */
+    return ERR_VAL;
+  }
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static void
+test_alloc_pkts(struct pbuf **pkts, int num)
+{
+  int i;
+  for (i = 0; i < num; i++) {
+    pkts[i] = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+    fail_unless(pkts[i] != NULL);
+    pbuf_put_at(pkts[i], 0, (u8_t)i);
+  }
+}
+
+/* Test functions */
+
+START_TEST(test_tcpip_inpkt_batch)
+{
+  struct pbuf *pkts[NUM_TEST_PKTS];
+  err_t err;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_alloc_pkts(pkts, NUM_TEST_PKTS);
+  err = tcpip_inpkt_batch(pkts, NUM_TEST_PKTS, &test_netif, test_input_fn);
+  fail_unless(err == ERR_OK);
+  for (i = 0; i < NUM_TEST_PKTS; i++) {
+    fail_unless(pkts[i] == NULL);
+  }
+  fail_unless(input_ctr == 0);
+
+  /* packets are split into messages of TCPIP_INPUT_BATCH_SIZE packets */
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(input_ctr == TCPIP_INPUT_BATCH_SIZE);
+  while (tcpip_thread_poll_one());
+  fail_unless(input_ctr == NUM_TEST_PKTS);
+}
+END_TEST
+
+START_TEST(test_tcpip_inpkt_batch_input_err)
+{
+  struct pbuf *pkts[NUM_TEST_PKTS];
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  input_fail_odd = 1;
+  test_alloc_pkts(pkts, NUM_TEST_PKTS);
+  err = tcpip_inpkt_batch(pkts, NUM_TEST_PKTS, &test_netif, test_input_fn);
+  fail_unless(err == ERR_OK);
+  while (tcpip_thread_poll_one());
+  fail_unless(input_ctr == NUM_TEST_PKTS);
+  /* teardown checks that the failed packets have been freed */
+}
+END_TEST
+
+START_TEST(test_tcpip_inpkt_batch_nomem)
+{
+  struct pbuf *pkts[(MEMP_NUM_TCPIP_MSG_INPKT_BATCH + 1) * TCPIP_INPUT_BATCH_SIZE];
+  const int num = (int)LWIP_ARRAYSIZE(pkts);
+  const int queued = MEMP_NUM_TCPIP_MSG_INPKT_BATCH * TCPIP_INPUT_BATCH_SIZE;
+  err_t err;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_alloc_pkts(pkts, num);
+  err = tcpip_inpkt_batch(pkts, (u16_t)num, &test_netif, test_input_fn);
+  fail_unless(err == ERR_MEM);
+  /* queued packets are NULL, the caller still owns the others */
+  for (i = 0; i < num; i++) {
+    fail_unless((pkts[i] == NULL) == (i < queued));
+    if (pkts[i] != NULL) {
+      pbuf_free(pkts[i]);
+    }
+  }
+  while (tcpip_thread_poll_one());
+  fail_unless(input_ctr == queued);
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+tcpip_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_tcpip_inpkt_batch),
+    TESTFUNC(test_tcpip_inpkt_batch_input_err),
+    TESTFUNC(test_tcpip_inpkt_batch_nomem),
+  };
+  return create_suite("TCPIP", tests, sizeof(tests)/sizeof(testfunc), tcpip_setup, tcpip_teardown);
+}
@@ -0,0 +1,196 @@
+#include "test_chksum.h"
+
+#include "lwip/inet_chksum.h"
+#include "lwip/pbuf.h"
+#include "lwip/def.h"
+#include "lwip/prot/ip.h"
+
+#if defined(LWIP_UNIX_CHKSUM) && LWIP_UNIX_CHKSUM
+#include "arch/chksum.h"
+#endif
+
+#define TEST_CHKSUM_MAXLEN   300
+#define TEST_CHKSUM_OFFSETS  8
+#define TEST_CHKSUM_BUFSIZE  (TEST_CHKSUM_MAXLEN + TEST_CHKSUM_OFFSETS + 16)
+#define TEST_CHKSUM_GUARD    0x7a
+
+static u8_t chksum_src[0x10000 + TEST_CHKSUM_OFFSETS];
+static u8_t chksum_dst[TEST_CHKSUM_BUFSIZE];
+
+/* Setups/teardown functions */
+
+static void
+chksum_setup(void)
+{
+  size_t i;
+  u32_t x = 0x12345678;
+
+  /* pseudo random data */
+  for (i = 0; i < sizeof(chksum_src); i++) {
+    x = x * 1103515245UL + 12345UL;
+    chksum_src[i] = (u8_t)(x >> 16);
+  }
+}
+
+static void
+chksum_teardown(void)
+{
+}
+
+/** Reference: byte-wise, non-inverted Internet sum (like LWIP_CHKSUM_ALGORITHM 1) */
+static u16_t
+test_chksum_ref(const u8_t *data, u32_t len)
+{
+  u32_t acc = 0;
+  u32_t i;
+
+  for (i = 0; i + 1 < len; i += 2) {
+    acc += ((u32_t)data[i] << 8) | data[i + 1];
+  }
+  if (len & 1) {
+    acc += (u32_t)data[len - 1] << 8;
+  }
+  while (acc >> 16) {
+    acc = (acc & 0xffffUL) + (acc >> 16);
+  }
+  return lwip_htons((u16_t)acc);
+}
+
+/** Reference for inet_chksum (inverted sum) */
+static u16_t
+test_chksum_ref_inv(const u8_t *data, u32_t len)
+{
+  return (u16_t)~test_chksum_ref(data, len);
+}
+
+/* Test functions */
+
+START_TEST(test_chksum_lengths_and_alignments)
+{
+  u32_t len, off;
+  LWIP_UNUSED_ARG(_i);
+
+  for (off = 0; off < TEST_CHKSUM_OFFSETS; off++) {
+    for (len = 0; len <= TEST_CHKSUM_MAXLEN; len++) {
+      fail_unless(inet_chksum(&chksum_src[off], (u16_t)len) ==
+                  test_chksum_ref_inv(&chksum_src[off], len));
+    }
+  }
+  /* maximum length, and all ones to provoke as many carries as possible */
+  fail_unless(inet_chksum(&chksum_src[1], 0xffff) == test_chksum_ref_inv(&chksum_src[1], 0xffff));
+  memset(chksum_src, 0xff, sizeof(chksum_src));
+  fail_unless(inet_chksum(&chksum_src[0], 0xffff) == test_chksum_ref_inv(&chksum_src[0], 0xffff));
+  fail_unless(inet_chksum(&chksum_src[3], 0xfffe) == test_chksum_ref_inv(&chksum_src[3], 0xfffe));
+}
+END_TEST
+
+START_TEST(test_chksum_pbuf_chain)
+{
+  /* odd and even pbuf lengths to check the byte swapping between pbufs */
+  static const u16_t lens[] = { 1, 14, 3, 64, 7, 1, 128, 33 };
+  struct pbuf *p, *q, *single;
+  u16_t i, total = 0;
+  ip_addr_t src, dst;
+  LWIP_UNUSED_ARG(_i);
+
+  p = NULL;
+  for (i = 0; i < LWIP_ARRAYSIZE(lens); i++) {
+    q = pbuf_alloc(PBUF_RAW, lens[i], PBUF_RAM);
+    fail_unless(q != NULL);
+    memcpy(q->payload, &chksum_src[total], lens[i]);
+    total = (u16_t)(total + lens[i]);
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  fail_unless(p->tot_len == total);
+  fail_unless(inet_chksum_pbuf(p) == test_chksum_ref_inv(chksum_src, total));
+
+  /* the pseudo header checksum must not depend on how the data is split */
+  single = pbuf_alloc(PBUF_RAW, total, PBUF_RAM);
+  fail_unless(single != NULL);
+  memcpy(single->payload, chksum_src, total);
+  IP_ADDR4(&src, 192, 168, 0, 1);
+  IP_ADDR4(&dst, 10, 0, 0, 7);
+  fail_unless(ip_chksum_pseudo(p, IP_PROTO_UDP, total, &src, &dst) ==
+              ip_chksum_pseudo(single, IP_PROTO_UDP, total, &src, &dst));
+#if LWIP_IPV6
+  IP_ADDR6(&src, 0x20010db8, 0, 0, 1);
+  IP_ADDR6(&dst, 0x20010db8, 0, 0, 0x1234);
+  fail_unless(ip_chksum_pseudo(p, IP_PROTO_TCP, total, &src, &dst) ==
+              ip_chksum_pseudo(single, IP_PROTO_TCP, total, &src, &dst));
+#endif /* LWIP_IPV6 */
+  pbuf_free(single);
+  pbuf_free(p);
+}
+END_TEST
+
+START_TEST(test_chksum_copy)
+{
+#if LWIP_CHECKSUM_ON_COPY
+  u32_t len, off, doff, i;
+  u16_t chksum;
+  LWIP_UNUSED_ARG(_i);
+
+  for (off = 0; off < TEST_CHKSUM_OFFSETS; off++) {
+    for (doff = 0; doff < TEST_CHKSUM_OFFSETS; doff += 3) {
+      for (len = 0; len <= TEST_CHKSUM_MAXLEN; len++) {
+        memset(chksum_dst, TEST_CHKSUM_GUARD, sizeof(chksum_dst));
+        chksum = LWIP_CHKSUM_COPY(&chksum_dst[doff], &chksum_src[off], (u16_t)len);
+        fail_unless(chksum == test_chksum_ref(&chksum_src[off], len));
+        fail_unless(!memcmp(&chksum_dst[doff], &chksum_src[off], len));
+        for (i = 0; i < sizeof(chksum_dst); i++) {
+          if ((i < doff) || (i >= doff + len)) {
+            fail_unless(chksum_dst[i] == TEST_CHKSUM_GUARD);
+          }
+        }
+      }
+    }
+  }
+#else /* LWIP_CHECKSUM_ON_COPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+END_TEST
+
+/* check all checksum implementations of the port, not only the selected one */
+START_TEST(test_chksum_port_impls)
+{
+#if defined(LWIP_UNIX_CHKSUM) && LWIP_UNIX_CHKSUM
+  const struct lwip_unix_chksum_impl *impl;
+  u32_t len, off;
+  LWIP_UNUSED_ARG(_i);
+
+  for (impl = lwip_unix_chksum_impls; impl->name != NULL; impl++) {
+    if (!impl->supported()) {
+      continue;
+    }
+    for (off = 0; off < TEST_CHKSUM_OFFSETS; off++) {
+      for (len = 0; len <= TEST_CHKSUM_MAXLEN; len++) {
+        fail_unless(impl->chksum(&chksum_src[off], (int)len) == test_chksum_ref(&chksum_src[off], len));
+        fail_unless(impl->chksum_copy(&chksum_dst[off], &chksum_src[off], (u16_t)len) ==
+                    test_chksum_ref(&chksum_src[off], len));
+      }
+    }
+    fail_unless(impl->chksum(&chksum_src[5], 0x10000) == test_chksum_ref(&chksum_src[5], 0x10000));
+  }
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+chksum_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_chksum_lengths_and_alignments),
+    TESTFUNC(test_chksum_pbuf_chain),
+    TESTFUNC(test_chksum_copy),
+    TESTFUNC(test_chksum_port_impls)
+  };
+  return create_suite("CHKSUM", tests, sizeof(tests)/sizeof(testfunc), chksum_setup, chksum_teardown);
+}
@@ -0,0 +1,104 @@
+#include "test_memp.h"
+
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/priv/memp_priv.h"
+
+#if !LWIP_STATS || !MEMP_STATS
+#error "This tests needs MEMP-statistics enabled"
+#endif
+
+#if MEMP_THREAD_CACHE
+/** Number of free elements left in the pool itself (not in magazines) */
+static u16_t
+test_memp_pool_free(memp_t type)
+{
+  struct memp *memp;
+  u16_t num = 0;
+
+  for (memp = *memp_pools[type]->tab; memp != NULL; memp = memp->next) {
+    num++;
+  }
+  return num;
+}
+#endif /* MEMP_THREAD_CACHE */
+
+/* Setups/teardown functions */
+
+static void
+memp_setup(void)
+{
+#if MEMP_THREAD_CACHE
+  memp_thread_cache_flush();
+#endif /* MEMP_THREAD_CACHE */
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+memp_teardown(void)
+{
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+
+/* Test functions */
+
+/** Refill and drain the magazine of a pool: only the elements handed out
+ * count as used */
+START_TEST(test_memp_thread_cache)
+{
+#if MEMP_THREAD_CACHE
+#define TEST_MEMP_NUM 20
+  void *p[TEST_MEMP_NUM];
+  const memp_t type = MEMP_PBUF_POOL;
+  const u16_t num = memp_pools[type]->num;
+  const STAT_COUNTER err = lwip_stats.memp[type]->err;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* the test assumes a full magazine (MEMP_THREAD_CACHE_SIZE elements) */
+  fail_unless(num / 8 >= MEMP_THREAD_CACHE_SIZE);
+  fail_unless(test_memp_pool_free(type) == num);
+  lwip_stats.memp[type]->max = 0;
+
+  /* each refill takes half a magazine from the pool */
+  for (i = 0; i < TEST_MEMP_NUM; i++) {
+    p[i] = memp_malloc(type);
+    fail_unless(p[i] != NULL);
+    fail_unless(lwip_stats.memp[type]->used == i + 1);
+  }
+  fail_unless(test_memp_pool_free(type) ==
+              num - 3 * ((MEMP_THREAD_CACHE_SIZE + 1) / 2));
+  fail_unless(lwip_stats.memp[type]->max == TEST_MEMP_NUM);
+
+  /* a full magazine is drained down to half its size */
+  for (i = 0; i < TEST_MEMP_NUM; i++) {
+    memp_free(type, p[i]);
+    fail_unless(lwip_stats.memp[type]->used == TEST_MEMP_NUM - i - 1);
+  }
+  fail_unless(test_memp_pool_free(type) < num);
+  fail_unless(test_memp_pool_free(type) + MEMP_THREAD_CACHE_SIZE >= num);
+  fail_unless(lwip_stats.memp[type]->max == TEST_MEMP_NUM);
+
+  /* flushing returns the rest */
+  memp_thread_cache_flush();
+  fail_unless(test_memp_pool_free(type) == num);
+  fail_unless(lwip_stats.memp[type]->used == 0);
+  fail_unless(lwip_stats.memp[type]->err == err);
+#undef TEST_MEMP_NUM
+#else /* MEMP_THREAD_CACHE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_THREAD_CACHE */
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+memp_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_memp_thread_cache)
+  };
+  return create_suite("MEMP", tests, sizeof(tests)/sizeof(testfunc), memp_setup, memp_teardown);
+}
@@ -0,0 +1,8 @@
+#ifndef LWIP_HDR_TEST_MEMP_H
+#define LWIP_HDR_TEST_MEMP_H
+
+#include "../lwip_check.h"
+
+Suite *memp_suite(void);
+
+#endif
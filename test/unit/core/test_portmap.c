@@ -0,0 +1,112 @@
+#include "test_portmap.h"
+
+#include "lwip/priv/portmap.h"
+
+#if LWIP_PORT_BITMAP
+
+/* a range that does not fill its last bitmap word */
+#define TEST_PORT_START  1000
+#define TEST_PORT_END    1044
+#define TEST_PORT_NUM    (TEST_PORT_END - TEST_PORT_START + 1)
+
+PORTMAP_DECLARE(test_portmap, TEST_PORT_START, TEST_PORT_END);
+
+#endif /* LWIP_PORT_BITMAP */
+
+/* Setups/teardown functions */
+
+static void
+portmap_setup(void)
+{
+#if LWIP_PORT_BITMAP
+  memset(test_portmap_bits, 0, sizeof(test_portmap_bits));
+#endif /* LWIP_PORT_BITMAP */
+}
+
+static void
+portmap_teardown(void)
+{
+}
+
+/* Test functions */
+
+/* every port of the range is handed out exactly once, then the range is full */
+START_TEST(test_portmap_find_all)
+{
+#if LWIP_PORT_BITMAP
+  u8_t seen[TEST_PORT_NUM];
+  u16_t port;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(seen, 0, sizeof(seen));
+  for (i = 0; i < TEST_PORT_NUM; i++) {
+    port = portmap_find(&test_portmap);
+    fail_unless(port >= TEST_PORT_START);
+    fail_unless(port <= TEST_PORT_END);
+    fail_unless(seen[port - TEST_PORT_START] == 0);
+    seen[port - TEST_PORT_START] = 1;
+    portmap_acquire(&test_portmap, port);
+  }
+  fail_unless(portmap_find(&test_portmap) == 0);
+
+  /* a released port is found again */
+  fail_unless(portmap_release(&test_portmap, TEST_PORT_END) == 0);
+  fail_unless(portmap_find(&test_portmap) == TEST_PORT_END);
+  portmap_acquire(&test_portmap, TEST_PORT_END);
+  fail_unless(portmap_release(&test_portmap, TEST_PORT_START + 3) == 0);
+  fail_unless(portmap_find(&test_portmap) == TEST_PORT_START + 3);
+#else /* LWIP_PORT_BITMAP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_PORT_BITMAP */
+}
+END_TEST
+
+/* a port used by several pcbs stays used until the last one releases it */
+START_TEST(test_portmap_shared)
+{
+#if LWIP_PORT_BITMAP
+  const u16_t port = TEST_PORT_START + 33;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* fill the range except one port */
+  for (i = TEST_PORT_START; i <= TEST_PORT_END; i++) {
+    if (i != port) {
+      portmap_acquire(&test_portmap, (u16_t)i);
+    }
+  }
+  fail_unless(portmap_find(&test_portmap) == port);
+
+  portmap_acquire(&test_portmap, port);
+  portmap_acquire(&test_portmap, port);
+  fail_unless(portmap_find(&test_portmap) == 0);
+
+  /* shared: the caller has to count the remaining users */
+  fail_unless(portmap_release(&test_portmap, port) == 1);
+  portmap_set_users(&test_portmap, port, 1);
+  fail_unless(portmap_find(&test_portmap) == 0);
+  fail_unless(portmap_release(&test_portmap, port) == 0);
+  fail_unless(portmap_find(&test_portmap) == port);
+
+  /* ports outside the range are ignored */
+  portmap_acquire(&test_portmap, TEST_PORT_START - 1);
+  portmap_acquire(&test_portmap, TEST_PORT_END + 1);
+  fail_unless(portmap_release(&test_portmap, TEST_PORT_END + 1) == 0);
+  fail_unless(portmap_find(&test_portmap) == port);
+#else /* LWIP_PORT_BITMAP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_PORT_BITMAP */
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+portmap_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_portmap_find_all),
+    TESTFUNC(test_portmap_shared)
+  };
+  return create_suite("PORTMAP", tests, sizeof(tests)/sizeof(testfunc), portmap_setup, portmap_teardown);
+}
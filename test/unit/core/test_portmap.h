@@ -0,0 +1,8 @@
+#ifndef LWIP_HDR_TEST_PORTMAP_H
+#define LWIP_HDR_TEST_PORTMAP_H
+
+#include "../lwip_check.h"
+
+Suite *portmap_suite(void);
+
+#endif
@@ -11,16 +11,24 @@ static struct sys_timeo* old_list_head;
 static void
 timers_setup(void)
 {
+#if LWIP_TIMERS_WHEEL
+  old_list_head = sys_timeouts_take_all();
+#else
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
   old_list_head = *list_head;
   *list_head = NULL;
+#endif
 }
 
 static void
 timers_teardown(void)
 {
+#if LWIP_TIMERS_WHEEL
+  sys_timeouts_put_all(old_list_head);
+#else
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
   *list_head = old_list_head;
+#endif
   lwip_sys_now = 0;
 }
 
@@ -46,7 +54,9 @@ struct lwip_cyclic_timer test_cyclic = {10, dummy_cyclic_handler};
 static void
 do_test_cyclic_timers(u32_t offset)
 {
+#if !LWIP_TIMERS_WHEEL
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
+#endif
 
   /* verify normal timer expiration */
   lwip_sys_now = offset + 0;
@@ -60,7 +70,11 @@ do_test_cyclic_timers(u32_t offset)
   sys_check_timeouts();
   fail_unless(cyclic_fired == 1);
 
+#if LWIP_TIMERS_WHEEL
+  fail_unless(sys_timeouts_sleeptime() == test_cyclic.interval_ms - HANDLER_EXECUTION_TIME);
+#else
   fail_unless((*list_head)->time == (u32_t)(lwip_sys_now + test_cyclic.interval_ms - HANDLER_EXECUTION_TIME));
+#endif
   
   sys_untimeout(lwip_cyclic_timer, &test_cyclic);
 
@@ -77,7 +91,11 @@ do_test_cyclic_timers(u32_t offset)
   sys_check_timeouts();
   fail_unless(cyclic_fired == 1);
 
+#if LWIP_TIMERS_WHEEL
+  fail_unless(sys_timeouts_sleeptime() == test_cyclic.interval_ms);
+#else
   fail_unless((*list_head)->time == (u32_t)(lwip_sys_now + test_cyclic.interval_ms));
+#endif
 }
 
 START_TEST(test_cyclic_timers)
@@ -127,7 +145,9 @@ END_TEST
 static void
 do_test_timers(u32_t offset)
 {
+#if !LWIP_TIMERS_WHEEL
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
+#endif
   
   lwip_sys_now = offset + 0;
 
@@ -138,10 +158,12 @@ do_test_timers(u32_t offset)
   sys_timeout( 5, dummy_handler, LWIP_PTR_NUMERIC_CAST(void*, 2));
   fail_unless(sys_timeouts_sleeptime() == 5);
 
+#if !LWIP_TIMERS_WHEEL
   /* linked list correctly sorted? */
   fail_unless((*list_head)->time             == (u32_t)(lwip_sys_now + 5));
   fail_unless((*list_head)->next->time       == (u32_t)(lwip_sys_now + 10));
   fail_unless((*list_head)->next->next->time == (u32_t)(lwip_sys_now + 20));
+#endif
   
   /* check timers expire in correct order */
   memset(&fired, 0, sizeof(fired));
@@ -219,6 +241,69 @@ START_TEST(test_long_timer)
 }
 END_TEST
 
+static u32_t levels_fired_at[8];
+static int levels_fired_count;
+static void
+levels_handler(void* arg)
+{
+  int index = LWIP_PTR_NUMERIC_CAST(int, arg);
+  levels_fired_at[index] = lwip_sys_now;
+  levels_fired_count++;
+}
+
+static void
+do_test_timer_levels(u32_t offset)
+{
+  /* timeouts spread over a wide range, some at the same time */
+  static const u32_t timeouts[] = {3, 40, 1000, 33000, 2000000, 100000000, LWIP_UINT32_MAX / 4, 40};
+  u32_t sleeptime, last = 0;
+  int i, before;
+
+  memset(levels_fired_at, 0, sizeof(levels_fired_at));
+  levels_fired_count = 0;
+  lwip_sys_now = offset;
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(timeouts); i++) {
+    sys_timeout(timeouts[i], levels_handler, LWIP_PTR_NUMERIC_CAST(void*, i));
+  }
+  sys_untimeout(levels_handler, LWIP_PTR_NUMERIC_CAST(void*, 4));
+
+  /* sleep until the next timeout: it must not fire one tick earlier */
+  while ((sleeptime = sys_timeouts_sleeptime()) != SYS_TIMEOUTS_SLEEPTIME_INFINITE) {
+    before = levels_fired_count;
+    if (sleeptime > 0) {
+      lwip_sys_now += sleeptime - 1;
+      sys_check_timeouts();
+      fail_unless(levels_fired_count == before);
+      lwip_sys_now += 1;
+    }
+    sys_check_timeouts();
+    fail_unless(levels_fired_count > before);
+    fail_unless(lwip_sys_now - offset >= last);
+    last = lwip_sys_now - offset;
+  }
+
+  fail_unless(levels_fired_count == (int)LWIP_ARRAYSIZE(timeouts) - 1);
+  for (i = 0; i < (int)LWIP_ARRAYSIZE(timeouts); i++) {
+    if (i == 4) {
+      fail_unless(levels_fired_at[i] == 0);
+    } else {
+      fail_unless(levels_fired_at[i] == (u32_t)(offset + timeouts[i]));
+    }
+  }
+}
+
+START_TEST(test_timer_levels)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  do_test_timer_levels(0);
+  do_test_timer_levels(0x7ffffff0);
+  /* check with u32_t wraparound */
+  do_test_timer_levels(0xfffffff0);
+  do_test_timer_levels(0xf0000000);
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 timers_suite(void)
@@ -228,6 +313,7 @@ timers_suite(void)
     TESTFUNC(test_cyclic_timers),
     TESTFUNC(test_timers),
     TESTFUNC(test_long_timer),
+    TESTFUNC(test_timer_levels),
   };
   return create_suite("TIMERS", tests, LWIP_ARRAYSIZE(tests), timers_setup, timers_teardown);
 }
@@ -6,17 +6,21 @@
 #include "tcp/test_tcp.h"
 #include "tcp/test_tcp_oos.h"
 #include "tcp/test_tcp_state.h"
+#include "core/test_chksum.h"
 #include "core/test_def.h"
 #include "core/test_dns.h"
 #include "core/test_mem.h"
+#include "core/test_memp.h"
 #include "core/test_netif.h"
 #include "core/test_pbuf.h"
+#include "core/test_portmap.h"
 #include "core/test_timers.h"
 #include "etharp/test_etharp.h"
 #include "dhcp/test_dhcp.h"
 #include "mdns/test_mdns.h"
 #include "mqtt/test_mqtt.h"
 #include "api/test_sockets.h"
+#include "api/test_tcpip.h"
 #include "ppp/test_pppos.h"
 
 #include "lwip/init.h"
@@ -87,17 +91,21 @@ int main(void)
     tcp_suite,
     tcp_oos_suite,
     tcp_state_suite,
+    chksum_suite,
     def_suite,
     dns_suite,
     mem_suite,
+    memp_suite,
     netif_suite,
     pbuf_suite,
+    portmap_suite,
     timers_suite,
     etharp_suite,
     dhcp_suite,
     mdns_suite,
     mqtt_suite,
-    sockets_suite
+    sockets_suite,
+    tcpip_suite
 #if PPP_SUPPORT && PPPOS_SUPPORT
     , pppos_suite
 #endif /* PPP_SUPPORT && PPPOS_SUPPORT */
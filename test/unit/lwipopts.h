@@ -39,6 +39,12 @@
 #define LWIP_CHECKSUM_ON_COPY           1
 #define TCP_CHECKSUM_ON_COPY_SANITY_CHECK 1
 #define TCP_CHECKSUM_ON_COPY_SANITY_CHECK_FAIL(printfmsg) LWIP_ASSERT("TCP_CHECKSUM_ON_COPY_SANITY_CHECK_FAIL", 0)
+/* Use the word-at-a-time/SIMD checksum routines of the unix port */
+#define LWIP_UNIX_CHKSUM                1
+
+/* Use the timing wheel for timeouts */
+#define LWIP_TIMERS_WHEEL               1
+#define SYS_TIMEOUT_HASH_SIZE           8
 
 /* We link to special sys_arch.c (for basic non-waiting API layers unit tests) */
 #define NO_SYS                          0
@@ -46,10 +52,24 @@
 #define LWIP_NETCONN                    !NO_SYS
 #define LWIP_SOCKET                     !NO_SYS
 #define LWIP_NETCONN_FULLDUPLEX         LWIP_SOCKET
+#define LWIP_NETCONN_RING               1
 #define LWIP_NETCONN_SEM_PER_THREAD     1
 #define LWIP_NETBUF_RECVINFO            1
+#define LWIP_UDP_PCB_HASH               1
+#define UDP_PCB_HASH_SIZE               4
+#define LWIP_UDP_REUSEPORT              1
+#define LWIP_UDP_GSO                    1
+#define LWIP_PORT_BITMAP                1
 #define LWIP_HAVE_LOOPIF                1
 #define TCPIP_THREAD_TEST
+#define LWIP_SO_ZEROCOPY                1
+#define LWIP_SO_ZEROCOPY_PENDING        2
+#define LWIP_SOCKET_EPOLL               1
+#define LWIP_SOCKET_MMSG                1
+#define LWIP_SOCKET_ZEROCOPY_RECV       1
+#define LWIP_TCPIP_INPUT_BATCH          1
+#define TCPIP_INPUT_BATCH_SIZE          4
+#define MEMP_NUM_TCPIP_MSG_INPKT_BATCH  3
 
 /* Enable DHCP to test it */
 #define LWIP_DHCP                       1
@@ -66,7 +86,34 @@
 #define TCP_WND                         (10 * TCP_MSS)
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
+#define LWIP_TCP_SACK_OUT               1
+#define LWIP_TCP_SACK_IN                1
+#define LWIP_TCP_CUBIC                  1
+#define LWIP_TCP_GSO                    1
+#define LWIP_TCP_GRO                    1
+#define TCP_OOSEQ_RBTREE                1
+/* ooseq limits set by the tests (test_tcp_oos.c), no limit by default */
+extern unsigned long lwip_test_tcp_oos_max_bytes;
+extern unsigned short lwip_test_tcp_oos_max_pbufs;
+#define TCP_OOSEQ_BYTES_LIMIT(pcb)      lwip_test_tcp_oos_max_bytes
+#define TCP_OOSEQ_PBUFS_LIMIT(pcb)      lwip_test_tcp_oos_max_pbufs
+#define LWIP_TCP_PACING                 1
+/* use a small wheel so that long timeouts need several revolutions */
+#define LWIP_TCP_TIMER_WHEEL            1
+#define TCP_TIMER_WHEEL_SIZE            8
+/* enough for a listener and a few idle socket connections on the wheel */
+#define MEMP_NUM_NETCONN                8
+#define MEMP_NUM_TCP_PCB                8
+#define LWIP_TCP_FASTOPEN               1
+#define LWIP_TCP_SYN_COOKIES            1
+#define LWIP_TCP_ACK_POLICY             1
+/* use tiny hash tables to provoke bucket collisions */
+#define LWIP_TCP_PCB_HASH               1
+#define TCP_PCB_HASH_SIZE               4
+#define TCP_LISTEN_HASH_SIZE            2
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
+/* per-thread caches in front of the big pools */
+#define MEMP_THREAD_CACHE               1
 
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
@@ -146,6 +146,44 @@ struct pbuf* tcp_create_rx_segment_wnd(struct tcp_pcb* pcb, void* data, size_t d
     data, data_len, pcb->rcv_nxt + seqno_offset, pcb->lastack + ackno_offset, headerflags, wnd);
 }
 
+/** Create an ACK segment carrying a SACK option usable for passing to tcp_input
+ * - IP-addresses, ports, seqno and ackno are taken from pcb
+ * - ackno can be altered with an offset
+ * - sacks holds num_sacks pairs of left and right edges, relative to pcb->lastack
+ */
+struct pbuf* tcp_create_rx_sack(struct tcp_pcb* pcb, u32_t ackno_offset,
+                   const u32_t* sacks, u8_t num_sacks)
+{
+  struct pbuf *p;
+  struct tcp_hdr *tcphdr;
+  u8_t opts[4 + 4 * 8];
+  u16_t optlen = (u16_t)(4 + num_sacks * 8);
+  u32_t edge;
+  int i;
+  LWIP_ASSERT("too many SACKs", (num_sacks > 0) && (num_sacks <= 4));
+
+  opts[0] = LWIP_TCP_OPT_NOP;
+  opts[1] = LWIP_TCP_OPT_NOP;
+  opts[2] = LWIP_TCP_OPT_SACK;
+  opts[3] = (u8_t)(2 + num_sacks * 8);
+  for (i = 0; i < 2 * num_sacks; i++) {
+    edge = htonl(pcb->lastack + sacks[i]);
+    memcpy(&opts[4 + 4 * i], &edge, sizeof(edge));
+  }
+  /* create the segment with the option as data, then move it into the header */
+  p = tcp_create_segment(&pcb->remote_ip, &pcb->local_ip, pcb->remote_port, pcb->local_port,
+    opts, optlen, pcb->rcv_nxt, pcb->lastack + ackno_offset, TCP_ACK);
+  EXPECT_RETNULL(p != NULL);
+  pbuf_header(p, -(s16_t)sizeof(struct ip_hdr));
+  tcphdr = (struct tcp_hdr*)p->payload;
+  TCPH_HDRLEN_SET(tcphdr, (sizeof(struct tcp_hdr) + optlen) / 4);
+  tcphdr->chksum = 0;
+  tcphdr->chksum = ip_chksum_pseudo(p,
+          IP_PROTO_TCP, p->tot_len, &pcb->remote_ip, &pcb->local_ip);
+  pbuf_header(p, sizeof(struct ip_hdr));
+  return p;
+}
+
 /** Safely bring a tcp_pcb into the requested state */
 void
 tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, const ip_addr_t* local_ip,
@@ -163,22 +201,23 @@ tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, const ip_addr_t* local_
   pcb->lastack = iss;
   pcb->snd_lbb = iss;
   
+  /* set the addresses before registering: TCP_REG may hash them */
   if (state == ESTABLISHED) {
-    TCP_REG(&tcp_active_pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
     ip_addr_copy(pcb->remote_ip, *remote_ip);
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_active_pcbs, pcb);
   } else if(state == LISTEN) {
-    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
+    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
   } else if(state == TIME_WAIT) {
-    TCP_REG(&tcp_tw_pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
     ip_addr_copy(pcb->remote_ip, *remote_ip);
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_tw_pcbs, pcb);
   } else {
     fail();
   }
@@ -5,6 +5,9 @@
 #include "lwip/inet.h"
 #include "tcp_helper.h"
 #include "lwip/inet_chksum.h"
+#include "arch/sys_arch.h"
+#include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4307) /* we explicitly wrap around TCP seqnos */
@@ -1669,6 +1672,1487 @@ START_TEST(test_tcp_persist_split)
 }
 END_TEST
 
+static u32_t write_ext_sent_calls;
+static size_t write_ext_sent_len;
+
+static err_t
+test_tcp_write_ext_sent(void *arg, struct tcp_pcb *tpcb, size_t len)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(tpcb);
+  write_ext_sent_calls++;
+  write_ext_sent_len += len;
+  return ERR_OK;
+}
+
+/** large writes: all-or-nothing vs. partial tcp_write_ext, queue length
+ * limit, extended sent callback and tcp_recved_ext */
+START_TEST(test_tcp_write_ext)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct tcp_seg *seg;
+  struct pbuf *p;
+  size_t written, i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  write_ext_sent_calls = 0;
+  write_ext_sent_len = 0;
+
+  tcp_ticks = SEQNO1 - ISS;
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = TCP_SND_BUF;
+  pcb->snd_wnd = TCP_SND_BUF;
+  pcb->snd_wnd_max = TCP_SND_BUF;
+  tcp_sent_ext(pcb, test_tcp_write_ext_sent);
+  EXPECT(sizeof(tx_data) > TCP_SND_BUF);
+
+  /* without 'written', it's all or nothing like tcp_write */
+  err = tcp_write_ext(pcb, tx_data, TCP_SND_BUF + 1, TCP_WRITE_FLAG_COPY, NULL);
+  EXPECT(err == ERR_MEM);
+  EXPECT(pcb->unsent == NULL);
+
+  /* with 'written', everything that fits into snd_buf is enqueued at once */
+  err = tcp_write_ext(pcb, tx_data, sizeof(tx_data), TCP_WRITE_FLAG_COPY, &written);
+  EXPECT(err == ERR_OK);
+  EXPECT(written == TCP_SND_BUF);
+  EXPECT(tcp_sndbuf_ext(pcb) == 0);
+  EXPECT_RET(pcb->unsent != NULL);
+  for (seg = pcb->unsent; seg->next != NULL; seg = seg->next);
+  /* not all data was taken: no PSH */
+  EXPECT((TCPH_FLAGS(seg->tcphdr) & TCP_PSH) == 0);
+  err = tcp_write_ext(pcb, tx_data, 1, TCP_WRITE_FLAG_COPY, &written);
+  EXPECT(err == ERR_MEM);
+  EXPECT(written == 0);
+
+  /* one ACK for everything results in one sent_ext call */
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->unsent == NULL);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_SND_BUF, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(write_ext_sent_calls == 1);
+  EXPECT(write_ext_sent_len == TCP_SND_BUF);
+  EXPECT(tcp_sndbuf_ext(pcb) == TCP_SND_BUF);
+
+  /* small segments (1 pbuf each): the queue length limits the write */
+  pcb->mss = 100;
+  err = tcp_write_ext(pcb, tx_data, sizeof(tx_data), TCP_WRITE_FLAG_COPY, &written);
+  EXPECT(err == ERR_OK);
+  EXPECT(written == 100 * TCP_SND_QUEUELEN);
+  EXPECT(pcb->snd_queuelen == TCP_SND_QUEUELEN);
+  err = tcp_write_ext(pcb, tx_data, 1, 0, &written);
+  EXPECT(err == ERR_MEM);
+
+  /* tcp_recved_ext takes more than 64 KByte and clamps the window */
+  pcb->rcv_wnd = 0;
+  tcp_recved_ext(pcb, 1000);
+  EXPECT(pcb->rcv_wnd == 1000);
+  tcp_recved_ext(pcb, 0x20000);
+  EXPECT(pcb->rcv_wnd == TCP_WND_MAX(pcb));
+
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+#if LWIP_TCP_SACK_IN
+/** create a pcb with SACK enabled and send num_segs mss-sized segments */
+static struct tcp_pcb *
+test_tcp_sack_pcb_send(struct test_tcp_counters *counters, struct test_tcp_txcounters *txcounters, int num_segs)
+{
+  struct tcp_pcb *pcb;
+  err_t err;
+  int i;
+
+  for (i = 0; i < (int)sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  pcb = test_tcp_new_counters_pcb(counters);
+  EXPECT_RETNULL(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  tcp_set_flags(pcb, TF_SACK);
+  pcb->cwnd = (tcpwnd_size_t)(num_segs * TCP_MSS);
+  pcb->ssthresh = pcb->cwnd;
+
+  for (i = 0; i < num_segs; i++) {
+    err = tcp_write(pcb, &tx_data[i * TCP_MSS], TCP_MSS, TCP_WRITE_FLAG_COPY);
+    EXPECT_RETNULL(err == ERR_OK);
+  }
+  err = tcp_output(pcb);
+  EXPECT_RETNULL(err == ERR_OK);
+  EXPECT(txcounters->num_tx_calls == (u32_t)num_segs);
+  memset(txcounters, 0, sizeof(*txcounters));
+  return pcb;
+}
+
+/** return the segment with the given seqno on the unacked queue */
+static struct tcp_seg *
+test_tcp_find_unacked(struct tcp_pcb *pcb, u32_t seqno)
+{
+  struct tcp_seg *seg;
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (lwip_ntohl(seg->tcphdr->seqno) == seqno) {
+      return seg;
+    }
+  }
+  return NULL;
+}
+
+/** Lose 3 segments of one window: all holes must be retransmitted within
+ * the first RTT of loss recovery, as SACK blocks arrive (RFC 6675). */
+START_TEST(test_tcp_sack_rexmit_holes)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  struct tcp_seg *seg;
+  u32_t base;
+  int i;
+  /* SACK blocks relative to the seqno of segment 1, segments 1, 3 and 5 are lost */
+  const u32_t sacks2[] = {1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks4[] = {3 * TCP_MSS, 4 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks6[] = {5 * TCP_MSS, 6 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks7[] = {5 * TCP_MSS, 7 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks8[] = {5 * TCP_MSS, 8 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks9[] = {5 * TCP_MSS, 9 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  const u32_t sacks_partial[] = {3 * TCP_MSS, 4 * TCP_MSS, 5 * TCP_MSS, 9 * TCP_MSS};
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_sack_pcb_send(&counters, &txcounters, 10);
+  EXPECT_RET(pcb != NULL);
+
+  /* ACK segment 0 */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  base = pcb->lastack;
+
+  /* segments 2, 4 and 6 arrive: 3rd dupack -> fast retransmit of segment 1 only */
+  p = tcp_create_rx_sack(pcb, 0, sacks2, 1);
+  test_tcp_input(p, &netif);
+  p = tcp_create_rx_sack(pcb, 0, sacks4, 2);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->dupacks == 2);
+  p = tcp_create_rx_sack(pcb, 0, sacks6, 3);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->cwnd == 5 * TCP_MSS);
+  EXPECT(pcb->recovery_point == base + 9 * TCP_MSS);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* segment 7: now segment 3 has DupThresh SACKed segments above it */
+  p = tcp_create_rx_sack(pcb, 0, sacks7, 3);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  /* segment 8: segment 5 is lost, too */
+  p = tcp_create_rx_sack(pcb, 0, sacks8, 3);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 2);
+  /* segment 9: nothing left to retransmit */
+  p = tcp_create_rx_sack(pcb, 0, sacks9, 3);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(txcounters.num_tx_bytes == 2 * (TCP_MSS + 40U));
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* the holes (and only those) were retransmitted, queues are still sorted */
+  EXPECT(pcb->unsent == NULL);
+  for (i = 0, seg = pcb->unacked; i < 9; i++, seg = seg->next) {
+    EXPECT_RET(seg != NULL);
+    EXPECT(lwip_ntohl(seg->tcphdr->seqno) == base + (u32_t)i * TCP_MSS);
+    EXPECT(((seg->flags & TF_SEG_SACK_REXMIT) != 0) == ((i == 0) || (i == 2) || (i == 4)));
+    EXPECT(((seg->flags & TF_SEG_SACKED) != 0) == ((i & 1) || (i > 4)));
+  }
+  EXPECT(seg == NULL);
+
+  /* partial ACK (up to segment 3): stay in loss recovery */
+  p = tcp_create_rx_sack(pcb, 2 * TCP_MSS, sacks_partial, 2);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(test_tcp_find_unacked(pcb, base) == NULL);
+  EXPECT(test_tcp_find_unacked(pcb, base + 2 * TCP_MSS) != NULL);
+
+  /* ACK of all data ends loss recovery */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 7 * TCP_MSS, TCP_ACK);
+  test_tcp_input(p, &netif);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(pcb->lastack == pcb->snd_nxt);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+/** A single ACK SACKing DupThresh segments starts loss recovery; an RTO
+ * ends it and discards the scoreboard. */
+START_TEST(test_tcp_sack_lost_rto)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  struct tcp_seg *seg;
+  u32_t base;
+  /* segment 0 is lost, 1-3 arrive, but only the last dupack makes it */
+  const u32_t sacks[] = {1 * TCP_MSS, 4 * TCP_MSS};
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_sack_pcb_send(&counters, &txcounters, 6);
+  EXPECT_RET(pcb != NULL);
+  base = pcb->lastack;
+
+  p = tcp_create_rx_sack(pcb, 0, sacks, 1);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(txcounters.num_tx_bytes == TCP_MSS + 40U);
+  EXPECT(pcb->flags & TF_INFR);
+  seg = test_tcp_find_unacked(pcb, base);
+  EXPECT_RET(seg != NULL);
+  EXPECT(seg->flags & TF_SEG_SACK_REXMIT);
+  seg = test_tcp_find_unacked(pcb, base + TCP_MSS);
+  EXPECT_RET(seg != NULL);
+  EXPECT(seg->flags & TF_SEG_SACKED);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* RTO: SACKed segments are sent again, too */
+  tcp_rexmit_rto(pcb);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->flags & TF_RTO);
+  EXPECT(txcounters.num_tx_calls == pcb->cwnd / TCP_MSS);
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    EXPECT((seg->flags & (TF_SEG_SACKED | TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT)) == 0);
+  }
+  EXPECT(test_tcp_find_unacked(pcb, base + TCP_MSS) != NULL);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+/** Data sent in one loss recovery is lost again in the next one: the end of
+ * the first recovery must discard its lost/retransmitted marks so that the
+ * second one retransmits all holes again. */
+START_TEST(test_tcp_sack_recovery_twice)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  struct tcp_seg *seg;
+  err_t err;
+  u32_t base;
+  int i;
+  /* relative to base: segment 0 is lost */
+  const u32_t sacks1[] = {1 * TCP_MSS, 4 * TCP_MSS};
+  /* relative to base: segments 4 and 6 (sent in loss recovery) are lost, too */
+  const u32_t sacks2[] = {7 * TCP_MSS, 10 * TCP_MSS, 5 * TCP_MSS, 6 * TCP_MSS, 1 * TCP_MSS, 4 * TCP_MSS};
+  /* relative to base + 4 * TCP_MSS: the retransmissions of 4 and 6 are lost */
+  const u32_t sacks3[] = {3 * TCP_MSS, 6 * TCP_MSS, 1 * TCP_MSS, 2 * TCP_MSS};
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_sack_pcb_send(&counters, &txcounters, 4);
+  EXPECT_RET(pcb != NULL);
+  base = pcb->lastack;
+
+  /* first loss recovery: segment 0 is retransmitted */
+  p = tcp_create_rx_sack(pcb, 0, sacks1, 1);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->recovery_point == base + 4 * TCP_MSS);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* new data in loss recovery */
+  pcb->cwnd = 10 * TCP_MSS;
+  for (i = 4; i < 10; i++) {
+    err = tcp_write(pcb, &tx_data[i * TCP_MSS], TCP_MSS, TCP_WRITE_FLAG_COPY);
+    EXPECT_RET(err == ERR_OK);
+  }
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 6);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* segments 4 and 6 are lost, too, and retransmitted */
+  p = tcp_create_rx_sack(pcb, 0, sacks2, 3);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 2);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* the ACK of segments 0-3 ends the first loss recovery */
+  p = tcp_create_rx_sack(pcb, 4 * TCP_MSS, sacks2, 2);
+  test_tcp_input(p, &netif);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->lastack == base + 4 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 0);
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    EXPECT((seg->flags & (TF_SEG_SACK_LOST | TF_SEG_SACK_REXMIT)) == 0);
+  }
+
+  /* second loss recovery: both holes are retransmitted again */
+  pcb->cwnd = 10 * TCP_MSS;
+  p = tcp_create_rx_sack(pcb, 0, sacks3, 2);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(txcounters.num_tx_calls == 2);
+  seg = test_tcp_find_unacked(pcb, base + 4 * TCP_MSS);
+  EXPECT_RET(seg != NULL);
+  EXPECT(seg->flags & TF_SEG_SACK_REXMIT);
+  seg = test_tcp_find_unacked(pcb, base + 6 * TCP_MSS);
+  EXPECT_RET(seg != NULL);
+  EXPECT(seg->flags & TF_SEG_SACK_REXMIT);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+#endif /* LWIP_TCP_SACK_IN */
+
+#if LWIP_TCP_PCB_HASH
+/* reference implementation of the list search done by tcp_input() without LWIP_TCP_PCB_HASH */
+static struct tcp_pcb *
+test_tcp_list_lookup(const ip_addr_t *local_ip, u16_t local_port, const ip_addr_t *remote_ip, u16_t remote_port)
+{
+  struct tcp_pcb *cur;
+  for (cur = tcp_active_pcbs; cur != NULL; cur = cur->next) {
+    if ((cur->local_port == local_port) && (cur->remote_port == remote_port) &&
+        ip_addr_eq(&cur->local_ip, local_ip) && ip_addr_eq(&cur->remote_ip, remote_ip)) {
+      return cur;
+    }
+  }
+  for (cur = tcp_tw_pcbs; cur != NULL; cur = cur->next) {
+    if ((cur->local_port == local_port) && (cur->remote_port == remote_port) &&
+        ip_addr_eq(&cur->local_ip, local_ip) && ip_addr_eq(&cur->remote_ip, remote_ip)) {
+      return cur;
+    }
+  }
+  return NULL;
+}
+
+static struct tcp_pcb_listen *
+test_tcp_listen_list_lookup(const ip_addr_t *local_ip, u16_t local_port)
+{
+  struct tcp_pcb_listen *cur;
+  for (cur = tcp_listen_pcbs.listen_pcbs; cur != NULL; cur = cur->next) {
+    if ((cur->local_port == local_port) &&
+        (ip_addr_isany(&cur->local_ip) || ip_addr_eq(&cur->local_ip, local_ip))) {
+      return cur;
+    }
+  }
+  return NULL;
+}
+#endif /* LWIP_TCP_PCB_HASH */
+
+/** Check that the hashed PCB lookup finds the same PCBs as the list search */
+START_TEST(test_tcp_pcb_hash_lookup)
+{
+#if LWIP_TCP_PCB_HASH
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcbs[MEMP_NUM_TCP_PCB];
+  struct tcp_pcb *pcbl[3];
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct pbuf *p;
+  ip_addr_t other_ip;
+  char data[] = {1, 2, 3, 4};
+  u16_t local_port, remote_port;
+  int i, ip_idx;
+  u8_t netif_idx;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  netif_idx = netif_get_index(&netif);
+  memset(&counters, 0, sizeof(counters));
+  IP_ADDR4(&other_ip, 192, 168, 1, 3);
+
+  /* listeners sharing one bucket, one bound to a specific address
+     (created first since tcp_new() would otherwise kill the TIME-WAIT pcb) */
+  for (i = 0; i < 3; i++) {
+    struct tcp_pcb *pcb = tcp_new();
+    EXPECT_RET(pcb != NULL);
+    EXPECT(tcp_bind(pcb, (i == 0) ? &test_local_ip : IP4_ADDR_ANY, (u16_t)(1000 + 2 * i)) == ERR_OK);
+    pcbl[i] = tcp_listen(pcb);
+    EXPECT_RET(pcbl[i] != NULL);
+  }
+
+  /* active connections with colliding 4-tuples (the unit tests use 4 buckets),
+     the last one is a TIME-WAIT duplicate of the first one */
+  for (i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+    pcbs[i] = test_tcp_new_counters_pcb(&counters);
+    EXPECT_RET(pcbs[i] != NULL);
+    if (i == MEMP_NUM_TCP_PCB - 1) {
+      tcp_set_state(pcbs[i], TIME_WAIT, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+    } else {
+      tcp_set_state(pcbs[i], ESTABLISHED, &test_local_ip, (i & 1) ? &other_ip : &test_remote_ip,
+                    TEST_LOCAL_PORT, (u16_t)(TEST_REMOTE_PORT + i));
+    }
+  }
+  /* compare both lookups for all combinations (repeated to exercise move-to-front) */
+  for (i = 0; i < 2; i++) {
+    for (ip_idx = 0; ip_idx < 2; ip_idx++) {
+      const ip_addr_t *remote_ip = ip_idx ? &other_ip : &test_remote_ip;
+      for (remote_port = TEST_REMOTE_PORT; remote_port < TEST_REMOTE_PORT + MEMP_NUM_TCP_PCB + 1; remote_port++) {
+        for (local_port = TEST_LOCAL_PORT; local_port < TEST_LOCAL_PORT + 2; local_port++) {
+          struct tcp_pcb *found = tcp_pcb_hash_lookup(&test_local_ip, local_port, remote_ip, remote_port, netif_idx);
+          EXPECT(found == test_tcp_list_lookup(&test_local_ip, local_port, remote_ip, remote_port));
+        }
+      }
+    }
+    for (local_port = 998; local_port < 1008; local_port++) {
+      EXPECT(tcp_listen_hash_lookup(&test_local_ip, local_port, netif_idx) ==
+             test_tcp_listen_list_lookup(&test_local_ip, local_port));
+      EXPECT(tcp_listen_hash_lookup(&other_ip, local_port, netif_idx) ==
+             test_tcp_listen_list_lookup(&other_ip, local_port));
+    }
+  }
+  /* the active connection is preferred over its TIME-WAIT duplicate */
+  EXPECT(tcp_pcb_hash_lookup(&test_local_ip, TEST_LOCAL_PORT, &test_remote_ip, TEST_REMOTE_PORT, netif_idx) == pcbs[0]);
+
+  /* segments are still delivered to the right pcb */
+  p = tcp_create_rx_segment(pcbs[2], data, sizeof(data), 0, 0, 0);
+  EXPECT(p != NULL);
+  if (p != NULL) {
+    test_tcp_input(p, &netif);
+    EXPECT(counters.recv_calls == 1);
+    EXPECT(counters.recved_bytes == sizeof(data));
+    EXPECT(pcbs[2]->rcv_nxt == pcbs[1]->rcv_nxt + sizeof(data));
+  }
+
+  /* removed pcbs cannot be found any more */
+  tcp_abort(pcbs[0]);
+  EXPECT(tcp_pcb_hash_lookup(&test_local_ip, TEST_LOCAL_PORT, &test_remote_ip, TEST_REMOTE_PORT, netif_idx) == pcbs[MEMP_NUM_TCP_PCB - 1]);
+  tcp_abort(pcbs[MEMP_NUM_TCP_PCB - 1]);
+  EXPECT(tcp_pcb_hash_lookup(&test_local_ip, TEST_LOCAL_PORT, &test_remote_ip, TEST_REMOTE_PORT, netif_idx) == NULL);
+  tcp_close(pcbl[0]);
+  EXPECT(tcp_listen_hash_lookup(&test_local_ip, 1000, netif_idx) == NULL);
+  tcp_close(pcbl[1]);
+  tcp_close(pcbl[2]);
+  for (i = 1; i < MEMP_NUM_TCP_PCB - 1; i++) {
+    tcp_abort(pcbs[i]);
+  }
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_PCB_HASH */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_PCB_HASH */
+}
+END_TEST
+
+#if LWIP_TCP_CUBIC
+/** Select CUBIC by name and check its reaction to loss and ACKs */
+START_TEST(test_tcp_cc_cubic)
+{
+  struct tcp_pcb *pcb;
+  tcpwnd_size_t cwnd;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(!strcmp(tcp_get_congestion(pcb), "reno"));
+  EXPECT(tcp_set_congestion(pcb, "vegas") == ERR_ARG);
+  EXPECT(pcb->cc == &tcp_cc_reno);
+  EXPECT(tcp_set_congestion(pcb, "cubic") == ERR_OK);
+  EXPECT(!strcmp(tcp_get_congestion(pcb), "cubic"));
+
+  /* multiplicative decrease by 0.7 instead of 0.5 */
+  pcb->mss = 1000;
+  pcb->cwnd = 20000;
+  pcb->snd_wnd = 10000;
+  pcb->state = ESTABLISHED;
+  pcb->cc->on_loss(pcb);
+  EXPECT(pcb->ssthresh == 14003);
+  EXPECT(pcb->cubic.w_max == 20000);
+
+  /* concave growth back towards w_max, never beyond 1.5 * cwnd per RTT */
+  pcb->cwnd = pcb->ssthresh;
+  lwip_sys_now = 1000;
+  pcb->cc->on_ack(pcb, pcb->mss);
+  EXPECT(pcb->cubic.epoch_start == 1000);
+  lwip_sys_now += 1000;
+  for (i = 0; i < 14; i++) {
+    cwnd = pcb->cwnd;
+    pcb->cc->on_ack(pcb, pcb->mss);
+    EXPECT(pcb->cwnd >= cwnd);
+  }
+  EXPECT(pcb->cwnd > pcb->ssthresh);
+  EXPECT(pcb->cwnd <= pcb->cubic.w_max);
+
+  /* plateau reached quickly after K */
+  lwip_sys_now += 10000;
+  for (i = 0; i < 100; i++) {
+    pcb->cc->on_ack(pcb, pcb->mss);
+  }
+  EXPECT(pcb->cwnd > pcb->cubic.w_max);
+
+  /* a second loss below the last maximum triggers fast convergence */
+  pcb->cwnd = 15000;
+  pcb->cc->on_rto(pcb);
+  EXPECT(pcb->cubic.w_max < 15000);
+  EXPECT(pcb->cubic.epoch_start == 0);
+
+  /* switching back resets to reno */
+  EXPECT(tcp_set_congestion(pcb, "reno") == ERR_OK);
+  pcb->cwnd = 20000;
+  pcb->cc->on_loss(pcb);
+  EXPECT(pcb->ssthresh == 5000);
+  tcp_abort(pcb);
+}
+END_TEST
+#endif /* LWIP_TCP_CUBIC */
+
+#if LWIP_TCP_GSO
+static u32_t gso_wire_segs;
+static u32_t gso_wire_seqno;
+static u16_t gso_size_seen;
+static u16_t gso_wire_last_flags;
+static u16_t gso_wire_ip_id;
+
+static err_t
+test_tcp_gso_wire_output(struct netif *netif, struct pbuf *p)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+  struct tcp_hdr *tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  LWIP_UNUSED_ARG(netif);
+
+  EXPECT(p->gso_size == 0);
+  EXPECT(p->tot_len <= IP_HLEN + TCP_HLEN + TCP_MSS);
+  EXPECT(lwip_ntohs(IPH_LEN(iphdr)) == p->tot_len);
+  EXPECT(inet_chksum(iphdr, IP_HLEN) == 0);
+  EXPECT(lwip_ntohl(tcphdr->seqno) == gso_wire_seqno);
+  /* IP IDs are unique, also across super-segments */
+  EXPECT((gso_wire_segs == 0) || (lwip_ntohs(IPH_ID(iphdr)) == gso_wire_ip_id));
+  gso_wire_ip_id = (u16_t)(lwip_ntohs(IPH_ID(iphdr)) + 1);
+  EXPECT(pbuf_remove_header(p, IP_HLEN) == 0);
+  EXPECT(ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len, &test_local_ip, &test_remote_ip) == 0);
+  EXPECT(pbuf_add_header(p, IP_HLEN) == 0);
+
+  gso_wire_seqno += p->tot_len - IP_HLEN - TCP_HLEN;
+  gso_wire_last_flags = TCPH_FLAGS(tcphdr);
+  gso_wire_segs++;
+  return ERR_OK;
+}
+
+static err_t
+test_tcp_gso_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  struct test_tcp_txcounters *txcounters = (struct test_tcp_txcounters *)netif->state;
+  LWIP_UNUSED_ARG(ipaddr);
+
+  txcounters->num_tx_calls++;
+  txcounters->num_tx_bytes += p->tot_len;
+  gso_size_seen = p->gso_size;
+  if (p->gso_size != 0) {
+    return tcp_gso_segment(netif, p, 0, test_tcp_gso_wire_output);
+  }
+  return test_tcp_gso_wire_output(netif, p);
+}
+
+/** Send runs of segments as super-segments and cut them with software GSO */
+START_TEST(test_tcp_gso)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  err_t err;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  netif.output = test_tcp_gso_netif_output;
+  netif.flags |= NETIF_FLAG_GSO;
+  netif.gso_max_size = 0xffff;
+  memset(&counters, 0, sizeof(counters));
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = TCP_WND;
+  pcb->snd_wnd = 3 * TCP_MSS;
+  gso_wire_segs = 0;
+  gso_wire_seqno = pcb->snd_nxt;
+
+  /* 5 full segments and a small one, the window allows 3 of them */
+  err = tcp_write(pcb, tx_data, 5 * TCP_MSS + 100, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(txcounters.num_tx_bytes == IP_HLEN + TCP_HLEN + 3 * TCP_MSS);
+  EXPECT(gso_size_seen == TCP_MSS);
+  EXPECT(gso_wire_segs == 3);
+  EXPECT(pcb->unacked != NULL && pcb->unacked->next != NULL &&
+         pcb->unacked->next->next != NULL && pcb->unacked->next->next->next == NULL);
+  EXPECT(pcb->snd_nxt == pcb->lastack + 3 * TCP_MSS);
+  EXPECT((gso_wire_last_flags & TCP_PSH) == 0);
+
+  /* the ACK opens the window: 2 more in one super-segment, nagle holds back the last */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 3 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(gso_size_seen == TCP_MSS);
+  EXPECT(gso_wire_segs == 5);
+  EXPECT(pcb->unsent != NULL && pcb->unsent->next == NULL && pcb->unsent->len == 100);
+
+  /* without nagle, the small segment goes out alone */
+  memset(&txcounters, 0, sizeof(txcounters));
+  tcp_nagle_disable(pcb);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(gso_size_seen == 0);
+  EXPECT(gso_wire_segs == 6);
+  EXPECT(gso_wire_last_flags & TCP_PSH);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT(pcb->snd_nxt == pcb->lastack + 2 * TCP_MSS + 100);
+
+  /* everything acked, no pbufs left over */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS + 100, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_SEG) == 0);
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF) == 0);
+  tcp_abort(pcb);
+}
+END_TEST
+
+#if ENABLE_LOOPBACK
+static struct tcp_pcb *test_tcp_gso_server;
+
+static err_t
+test_tcp_gso_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  EXPECT_RETX(err == ERR_OK, ERR_OK);
+  test_tcp_gso_server = newpcb;
+  tcp_arg(newpcb, arg);
+  tcp_recv(newpcb, test_tcp_counters_recv);
+  tcp_err(newpcb, test_tcp_counters_err);
+  return ERR_OK;
+}
+
+/** Traffic to the netif's own address is looped back: no super-segments */
+START_TEST(test_tcp_gso_loopback)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters client_counters, server_counters;
+  struct tcp_pcb *lpcb, *client;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  netif.output = test_tcp_gso_netif_output;
+  netif.flags |= NETIF_FLAG_GSO;
+  netif.gso_max_size = 0xffff;
+  netif.mtu = IP_HLEN + TCP_HLEN + TCP_MSS;
+  memset(&client_counters, 0, sizeof(client_counters));
+  memset(&server_counters, 0, sizeof(server_counters));
+  server_counters.expected_data = (char *)tx_data;
+  server_counters.expected_data_len = 3 * TCP_MSS;
+  gso_size_seen = 0;
+
+  lpcb = tcp_new();
+  EXPECT_RET(lpcb != NULL);
+  EXPECT(tcp_bind(lpcb, &test_local_ip, TEST_LOCAL_PORT) == ERR_OK);
+  lpcb = tcp_listen(lpcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_arg(lpcb, &server_counters);
+  tcp_accept(lpcb, test_tcp_gso_accept);
+
+  test_tcp_gso_server = NULL;
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_connect(client, &test_local_ip, TEST_LOCAL_PORT, NULL) == ERR_OK);
+  while (tcpip_thread_poll_one()) {
+    /* netif_poll() runs from the tcpip thread */
+  }
+  EXPECT_RET(test_tcp_gso_server != NULL);
+  EXPECT(client->state == ESTABLISHED);
+  EXPECT(client->mss == TCP_MSS);
+
+  /* more than one MSS arrives complete and checksummed */
+  EXPECT(tcp_write(client, tx_data, 3 * TCP_MSS, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(client) == ERR_OK);
+  while (tcpip_thread_poll_one()) {
+  }
+  EXPECT(server_counters.recved_bytes == 3 * TCP_MSS);
+  EXPECT(client->unsent == NULL);
+  EXPECT(client->unacked == NULL);
+  EXPECT(client_counters.err_calls == 0);
+  EXPECT(server_counters.err_calls == 0);
+  /* nothing went through the driver */
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(gso_size_seen == 0);
+
+  tcp_abort(client);
+  tcp_remove_all();
+  while (tcpip_thread_poll_one()) {
+  }
+}
+END_TEST
+#endif /* ENABLE_LOOPBACK */
+#endif /* LWIP_TCP_GSO */
+
+#if LWIP_TCP_GRO
+/* like test_tcp_input(), but through the GRO stage */
+static void
+test_tcp_gro_input(struct pbuf *p, struct netif *inp)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr*)p->payload;
+  ip_addr_copy_from_ip4(*ip_current_dest_addr(), iphdr->dest);
+  ip_addr_copy_from_ip4(*ip_current_src_addr(), iphdr->src);
+  ip_current_netif() = inp;
+  ip_data.current_ip4_header = iphdr;
+  ip_data.current_input_netif = inp;
+  pbuf_remove_header(p, sizeof(struct ip_hdr));
+
+  tcp_gro_input(p, inp);
+
+  ip_addr_set_zero(ip_current_dest_addr());
+  ip_addr_set_zero(ip_current_src_addr());
+  ip_current_netif() = NULL;
+  ip_data.current_ip4_header = NULL;
+}
+
+START_TEST(test_tcp_gro)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data = (char *)tx_data;
+  counters.expected_data_len = sizeof(tx_data);
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+#if LWIP_TCP_ACK_POLICY
+  /* not at the start of a connection any more */
+  tcp_quickack(pcb, 0);
+#endif /* LWIP_TCP_ACK_POLICY */
+
+  /* 3 in-order segments are held back until the end of the batch */
+  for (i = 0; i < 3; i++) {
+    p = tcp_create_rx_segment(pcb, &tx_data[i * TCP_MSS], TCP_MSS, i * TCP_MSS, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_gro_input(p, &netif);
+  }
+  EXPECT(counters.recv_calls == 0);
+  EXPECT(txcounters.num_tx_calls == 0);
+  tcp_gro_flush(&netif);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == 3 * TCP_MSS);
+  /* 3 segments are ACKed at once, not delayed */
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT((pcb->flags & TF_ACK_DELAY) == 0);
+
+  /* PSH ends the merged segment */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, &tx_data[3 * TCP_MSS], TCP_MSS, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_gro_input(p, &netif);
+  p = tcp_create_rx_segment(pcb, &tx_data[4 * TCP_MSS], TCP_MSS, TCP_MSS, 0, TCP_ACK | TCP_PSH);
+  EXPECT_RET(p != NULL);
+  test_tcp_gro_input(p, &netif);
+  EXPECT(counters.recv_calls == 2);
+  EXPECT(counters.recved_bytes == 5 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  /* a single segment is ACKed with delay as before */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, &tx_data[5 * TCP_MSS], TCP_MSS, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_gro_input(p, &netif);
+  EXPECT(counters.recv_calls == 2);
+  /* a gap: the held segment goes first, the next one waits for the flush */
+  p = tcp_create_rx_segment(pcb, &tx_data[7 * TCP_MSS], TCP_MSS, 2 * TCP_MSS, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_gro_input(p, &netif);
+  EXPECT(counters.recv_calls == 3);
+  EXPECT(counters.recved_bytes == 6 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->flags & TF_ACK_DELAY);
+  tcp_gro_flush(NULL);
+  EXPECT(counters.recved_bytes == 6 * TCP_MSS);
+  EXPECT(pcb->ooseq != NULL);
+  /* the out-of-order segment triggered a duplicate ACK */
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == 0);
+}
+END_TEST
+#endif /* LWIP_TCP_GRO */
+
+#if LWIP_TCP_PACING
+/** Spread the segments of a window over time, released by sys_timeout */
+START_TEST(test_tcp_pacing)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u32_t delays;
+  err_t err;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  lwip_sys_now = 1000;
+  delays = STATS_GET(mib2.tcppacingdelays);
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = TCP_WND;
+  pcb->snd_wnd = TCP_WND;
+  tcp_nagle_disable(pcb);
+
+  /* 100 bytes/ms: a burst of 2 segments, then one every few ms */
+  tcp_set_pacing_rate(pcb, 100000);
+  EXPECT(tcp_get_pacing_rate(pcb) == 100000);
+  err = tcp_write(pcb, tx_data, 5 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(tcp_is_flag_set(pcb, TF_PACE_TIMER));
+  EXPECT(STATS_GET(mib2.tcppacingdelays) == delays + 1);
+
+  /* the burst used up the credit exactly: 1 ms until the next segment */
+  lwip_sys_now += 1;
+  sys_check_timeouts();
+  EXPECT(txcounters.num_tx_calls == 3);
+  /* that one leaves a debt of TCP_MSS - 100 bytes, paid after 5 ms */
+  lwip_sys_now += 4;
+  sys_check_timeouts();
+  EXPECT(txcounters.num_tx_calls == 3);
+  lwip_sys_now += 1;
+  sys_check_timeouts();
+  EXPECT(txcounters.num_tx_calls == 4);
+
+  /* turning pacing off sends the rest at once */
+  tcp_set_pacing_rate(pcb, 0);
+  EXPECT(txcounters.num_tx_calls == 5);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT(!tcp_is_flag_set(pcb, TF_PACE_TIMER));
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 5 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+
+  /* without an RTT sample, the automatic rate does not pace */
+  memset(&txcounters, 0, sizeof(txcounters));
+  tcp_set_pacing_rate(pcb, TCP_PACING_RATE_AUTO);
+  pcb->pace.srtt = 0;
+  pcb->cwnd = TCP_WND;
+  pcb->snd_wnd = TCP_WND;
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 4);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 4 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+
+  /* slow start, RTT 10 ms: 2 * cwnd / RTT = 4 * TCP_MSS / 5 bytes per ms */
+  memset(&txcounters, 0, sizeof(txcounters));
+  pcb->pace.srtt = 10 << 3;
+  pcb->cwnd = 4 * TCP_MSS;
+  pcb->ssthresh = TCP_WND;
+  pcb->snd_wnd = TCP_WND;
+  lwip_sys_now += 1000;
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 2);
+  lwip_sys_now += 1;
+  sys_check_timeouts();
+  EXPECT(txcounters.num_tx_calls == 3);
+  lwip_sys_now += 1;
+  sys_check_timeouts();
+  EXPECT(txcounters.num_tx_calls == 4);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT(STATS_GET(mib2.tcppacingdelays) == delays + 5);
+
+  /* a pending release is cancelled when the pcb goes away */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 4 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(tcp_is_flag_set(pcb, TF_PACE_TIMER));
+  tcp_abort(pcb);
+  lwip_sys_now = 0;
+}
+END_TEST
+#endif /* LWIP_TCP_PACING */
+
+#if LWIP_TCP_TIMER_WHEEL
+static u32_t test_tcp_polls;
+
+static err_t
+test_tcp_count_poll(void *arg, struct tcp_pcb *pcb)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  test_tcp_polls++;
+  return ERR_OK;
+}
+
+/** Check that tcp_slowtmr looks at idle pcbs once per wheel revolution only
+ * while poll and keepalive timers still expire in the same tick as without
+ * the wheel */
+START_TEST(test_tcp_timer_wheel)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *idle, *poll, *keep;
+  u32_t keep_idle, keep_intvl, keep_cnt, n;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  test_tcp_polls = 0;
+
+  idle = tcp_new();
+  EXPECT_RET(idle != NULL);
+  tcp_set_state(idle, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  EXPECT(idle->tmr_due == tcp_ticks + TCP_TIMER_WHEEL_SIZE);
+
+  poll = tcp_new();
+  EXPECT_RET(poll != NULL);
+  tcp_set_state(poll, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT + 1, TEST_REMOTE_PORT);
+  tcp_poll(poll, test_tcp_count_poll, 3);
+  EXPECT(poll->tmr_due == tcp_ticks + 3);
+
+  keep = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(keep != NULL);
+  tcp_set_state(keep, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT + 2, TEST_REMOTE_PORT);
+  ip_set_option(keep, SOF_KEEPALIVE);
+  keep->keep_idle = keep_idle = 20 * TCP_SLOW_INTERVAL;
+#if LWIP_TCP_KEEPALIVE
+  keep->keep_intvl = keep_intvl = 2 * TCP_SLOW_INTERVAL;
+  keep->keep_cnt = keep_cnt = 2;
+#else /* LWIP_TCP_KEEPALIVE */
+  keep_intvl = TCP_KEEPINTVL_DEFAULT;
+  keep_cnt = TCP_KEEPCNT_DEFAULT;
+#endif /* LWIP_TCP_KEEPALIVE */
+  tcp_timer_update(keep);
+  /* too far away for the wheel */
+  EXPECT(keep->tmr_due == tcp_ticks + TCP_TIMER_WHEEL_SIZE);
+
+  /* keepalives once idle for more than keep_idle, then every keep_intvl,
+     a RST instead of the last one */
+  for (n = 0; n <= keep_cnt; n++) {
+    u32_t due = (keep_idle + n * keep_intvl) / TCP_SLOW_INTERVAL + 1;
+    while (tcp_ticks + 1 < due) {
+      tcp_slowtmr();
+      EXPECT(txcounters.num_tx_calls == n);
+      EXPECT(idle->tmr_due == (tcp_ticks / TCP_TIMER_WHEEL_SIZE + 1) * TCP_TIMER_WHEEL_SIZE);
+    }
+    EXPECT(counters.err_calls == 0);
+    tcp_slowtmr();
+    EXPECT(txcounters.num_tx_calls == n + 1);
+  }
+  EXPECT(counters.err_calls == 1);
+  EXPECT(counters.last_err == ERR_ABRT);
+  EXPECT(test_tcp_polls == tcp_ticks / 3);
+
+  tcp_abort(idle);
+  tcp_abort(poll);
+}
+END_TEST
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
+#if LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES
+/** Take the packets sent since the last call */
+static struct pbuf *
+test_tcp_take_tx(struct test_tcp_txcounters *txcounters)
+{
+  struct pbuf *p = txcounters->tx_packets;
+  txcounters->tx_packets = NULL;
+  return p;
+}
+#endif /* LWIP_TCP_FASTOPEN || LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_TCP_FASTOPEN
+static struct tcp_pcb *test_tcp_fastopen_server;
+
+static err_t
+test_tcp_fastopen_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  EXPECT_RETX(err == ERR_OK, ERR_OK);
+  EXPECT_RETX(arg != NULL, ERR_OK);
+  tcp_recv(newpcb, test_tcp_counters_recv);
+  tcp_err(newpcb, test_tcp_counters_err);
+  test_tcp_fastopen_server = newpcb;
+  return ERR_OK;
+}
+
+/** Length of the fast open option of a packet, 0 if there is none */
+static u8_t
+test_tcp_fastopen_optlen(struct pbuf *p)
+{
+  const u8_t *opts = (const u8_t *)p->payload + IP_HLEN + TCP_HLEN;
+  const struct tcp_hdr *tcphdr = (const struct tcp_hdr *)((const u8_t *)p->payload + IP_HLEN);
+  u16_t optlen = (u16_t)(TCPH_HDRLEN_BYTES(tcphdr) - TCP_HLEN);
+  u16_t i = 0;
+
+  while (i < optlen) {
+    if (opts[i] == LWIP_TCP_OPT_EOL) {
+      break;
+    } else if (opts[i] == LWIP_TCP_OPT_NOP) {
+      i++;
+    } else if (opts[i] == LWIP_TCP_OPT_FASTOPEN) {
+      return opts[i + 1];
+    } else {
+      i = (u16_t)(i + opts[i + 1]);
+    }
+  }
+  return 0;
+}
+
+START_TEST(test_tcp_fastopen)
+{
+  struct test_tcp_counters client_counters, server_counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb *lpcb, *client;
+  struct pbuf *p;
+  ip_addr_t client_ip;
+  char data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  LWIP_UNUSED_ARG(_i);
+
+  /* client and server talk to each other through the captured packets (the
+     client is not bound to the address of the netif, that would be looped) */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  IP_ADDR4(&client_ip, 192, 168, 1, 3);
+  txcounters.copy_tx_packets = 1;
+  memset(&client_counters, 0, sizeof(client_counters));
+  memset(&server_counters, 0, sizeof(server_counters));
+  server_counters.expected_data = data;
+  server_counters.expected_data_len = sizeof(data);
+  tcp_fastopen_cache_set(&test_remote_ip, NULL, 0);
+
+  lpcb = tcp_new();
+  EXPECT_RET(lpcb != NULL);
+  EXPECT(tcp_bind(lpcb, IP4_ADDR_ANY, TEST_REMOTE_PORT) == ERR_OK);
+  tcp_fastopen(lpcb, 1);
+  lpcb = tcp_listen(lpcb);
+  EXPECT_RET(lpcb != NULL);
+  EXPECT(tcp_fastopen_enabled(lpcb));
+  tcp_arg(lpcb, &server_counters);
+  tcp_accept(lpcb, test_tcp_fastopen_accept);
+
+  /* first connection: the SYN asks for a cookie, the SYN|ACK carries one */
+  test_tcp_fastopen_server = NULL;
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_bind(client, &client_ip, 0) == ERR_OK);
+  tcp_fastopen(client, 1);
+  EXPECT(tcp_connect(client, &test_remote_ip, TEST_REMOTE_PORT, NULL) == ERR_OK);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_fastopen_optlen(p) == 2);
+  test_tcp_input(p, &netif);
+  EXPECT(test_tcp_fastopen_server == NULL);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_fastopen_optlen(p) == 2 + TCP_FASTOPEN_COOKIE_LEN);
+  test_tcp_input(p, &netif);
+  EXPECT(client->state == ESTABLISHED);
+  EXPECT(tcp_fastopen_cache_get(&test_remote_ip, NULL) == TCP_FASTOPEN_COOKIE_LEN);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(test_tcp_fastopen_server != NULL);
+  EXPECT(test_tcp_fastopen_server->state == ESTABLISHED);
+  tcp_abort(client);
+  tcp_abort(test_tcp_fastopen_server);
+  pbuf_free(test_tcp_take_tx(&txcounters));
+
+  /* second connection: the SYN waits for the data and carries the cookie */
+  test_tcp_fastopen_server = NULL;
+  memset(&client_counters, 0, sizeof(client_counters));
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_bind(client, &client_ip, 0) == ERR_OK);
+  tcp_fastopen(client, 1);
+  EXPECT(tcp_connect(client, &test_remote_ip, TEST_REMOTE_PORT, NULL) == ERR_OK);
+  EXPECT(txcounters.tx_packets == NULL);
+  EXPECT(tcp_write(client, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(client->snd_buf == TCP_SND_BUF - sizeof(data));
+  EXPECT(tcp_output(client) == ERR_OK);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_fastopen_optlen(p) == 2 + TCP_FASTOPEN_COOKIE_LEN);
+  EXPECT(client->unsent == NULL);
+  /* the server accepts the connection and passes the data on at once */
+  test_tcp_input(p, &netif);
+  EXPECT_RET(test_tcp_fastopen_server != NULL);
+  EXPECT(test_tcp_fastopen_server->state == SYN_RCVD);
+  EXPECT(server_counters.recv_calls == 1);
+  EXPECT(server_counters.recved_bytes == sizeof(data));
+  /* the SYN|ACK acknowledges the data */
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_fastopen_optlen(p) == 0);
+  test_tcp_input(p, &netif);
+  EXPECT(client->state == ESTABLISHED);
+  EXPECT(client->unacked == NULL);
+  EXPECT(client->snd_buf == TCP_SND_BUF);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(test_tcp_fastopen_server->state == ESTABLISHED);
+  EXPECT(server_counters.recved_bytes == sizeof(data));
+  EXPECT(client_counters.err_calls == 0);
+
+  tcp_remove_all();
+  pbuf_free(test_tcp_take_tx(&txcounters));
+}
+END_TEST
+#endif /* LWIP_TCP_FASTOPEN */
+
+#if LWIP_TCP_SYN_COOKIES
+static struct tcp_pcb *test_tcp_syncookies_server;
+static u16_t test_tcp_syncookies_accept_errs;
+
+static err_t
+test_tcp_syncookies_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  if (err != ERR_OK) {
+    /* out of pcbs */
+    EXPECT(newpcb == NULL);
+    test_tcp_syncookies_accept_errs++;
+    return ERR_OK;
+  }
+  test_tcp_syncookies_server = newpcb;
+  return ERR_OK;
+}
+
+static u8_t
+test_tcp_syncookies_flags(struct pbuf *p)
+{
+  return (u8_t)TCPH_FLAGS((struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN));
+}
+
+START_TEST(test_tcp_syncookies)
+{
+  struct test_tcp_counters client_counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb *lpcb, *client;
+  struct tcp_pcb *fill_pcbs[MEMP_NUM_TCP_PCB];
+  struct pbuf *p;
+  ip_addr_t client_ip, flood_ip, server_ip;
+  u16_t i, synack_len;
+  LWIP_UNUSED_ARG(_i);
+
+  /* client and server talk to each other through the captured packets */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  IP_ADDR4(&client_ip, 192, 168, 1, 3);
+  IP_ADDR4(&flood_ip, 192, 168, 1, 4);
+  ip_addr_copy(server_ip, test_remote_ip);
+  txcounters.copy_tx_packets = 1;
+  memset(&client_counters, 0, sizeof(client_counters));
+
+  lpcb = tcp_new();
+  EXPECT_RET(lpcb != NULL);
+  EXPECT(tcp_bind(lpcb, IP4_ADDR_ANY, TEST_REMOTE_PORT) == ERR_OK);
+  lpcb = tcp_listen(lpcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_syncookies(lpcb, 1);
+  tcp_accept(lpcb, test_tcp_syncookies_accept);
+
+  /* the SYN is answered without allocating a pcb */
+  test_tcp_syncookies_server = NULL;
+  test_tcp_syncookies_accept_errs = 0;
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_bind(client, &client_ip, 0) == ERR_OK);
+  EXPECT(tcp_connect(client, &test_remote_ip, TEST_REMOTE_PORT, NULL) == ERR_OK);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_syncookies_flags(p) == (TCP_SYN | TCP_ACK));
+  synack_len = p->tot_len;
+  test_tcp_input(p, &netif);
+  EXPECT(client->state == ESTABLISHED);
+  /* the ACK sets up the connection with the options of the SYN */
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(test_tcp_syncookies_server != NULL);
+  EXPECT(test_tcp_syncookies_server->state == ESTABLISHED);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 2);
+#if LWIP_WND_SCALE
+  EXPECT(test_tcp_syncookies_server->flags & TF_WND_SCALE);
+#endif /* LWIP_WND_SCALE */
+  tcp_abort(client);
+  tcp_abort(test_tcp_syncookies_server);
+  pbuf_free(test_tcp_take_tx(&txcounters));
+
+  /* fill the SYN queue */
+  for (i = 0; i < TCP_SYN_QUEUE_SIZE; i++) {
+    p = tcp_create_segment(&flood_ip, &server_ip, (u16_t)(1000 + i), TEST_REMOTE_PORT,
+                           NULL, 0, 12345, 0, TCP_SYN);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    p = test_tcp_take_tx(&txcounters);
+    EXPECT_RET(p != NULL);
+    EXPECT(test_tcp_syncookies_flags(p) == (TCP_SYN | TCP_ACK));
+    pbuf_free(p);
+  }
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+
+  /* with the queue full, the cookie alone carries the connection */
+  test_tcp_syncookies_server = NULL;
+  memset(&client_counters, 0, sizeof(client_counters));
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_bind(client, &client_ip, 0) == ERR_OK);
+  EXPECT(tcp_connect(client, &test_remote_ip, TEST_REMOTE_PORT, NULL) == ERR_OK);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+#if LWIP_WND_SCALE || LWIP_TCP_SACK_OUT || LWIP_TCP_TIMESTAMPS
+  EXPECT(p->tot_len < synack_len);
+#else
+  LWIP_UNUSED_ARG(synack_len);
+#endif
+  test_tcp_input(p, &netif);
+  EXPECT(client->state == ESTABLISHED);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(test_tcp_syncookies_server != NULL);
+  EXPECT(test_tcp_syncookies_server->state == ESTABLISHED);
+  EXPECT(test_tcp_syncookies_server->mss == client->mss);
+#if LWIP_WND_SCALE
+  EXPECT(!(test_tcp_syncookies_server->flags & TF_WND_SCALE));
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK_OUT
+  EXPECT(!(test_tcp_syncookies_server->flags & TF_SACK));
+#endif /* LWIP_TCP_SACK_OUT */
+
+  /* an ACK without a valid cookie is answered with a RST */
+  p = tcp_create_segment(&flood_ip, &server_ip, 2000, TEST_REMOTE_PORT,
+                         NULL, 0, 1000, 4711, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_syncookies_flags(p) & TCP_RST);
+  pbuf_free(p);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 2);
+  EXPECT(client_counters.err_calls == 0);
+  tcp_abort(client);
+  tcp_abort(test_tcp_syncookies_server);
+  pbuf_free(test_tcp_take_tx(&txcounters));
+
+  /* an ACK that cannot be accepted is refused with a RST: the client
+     considers the connection established and does not retransmit it */
+  test_tcp_syncookies_server = NULL;
+  memset(&client_counters, 0, sizeof(client_counters));
+  client = test_tcp_new_counters_pcb(&client_counters);
+  EXPECT_RET(client != NULL);
+  EXPECT(tcp_bind(client, &client_ip, 0) == ERR_OK);
+  EXPECT(tcp_connect(client, &test_remote_ip, TEST_REMOTE_PORT, NULL) == ERR_OK);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(client->state == ESTABLISHED);
+  for (i = 0; i < LWIP_ARRAYSIZE(fill_pcbs); i++) {
+    fill_pcbs[i] = tcp_new();
+  }
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == MEMP_NUM_TCP_PCB);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(test_tcp_syncookies_server == NULL);
+  EXPECT(test_tcp_syncookies_accept_errs == 1);
+  p = test_tcp_take_tx(&txcounters);
+  EXPECT_RET(p != NULL);
+  EXPECT(test_tcp_syncookies_flags(p) & TCP_RST);
+  test_tcp_input(p, &netif);
+  EXPECT(client_counters.err_calls == 1);
+  EXPECT(client_counters.last_err == ERR_RST);
+  for (i = 0; i < LWIP_ARRAYSIZE(fill_pcbs); i++) {
+    if (fill_pcbs[i] != NULL) {
+      EXPECT(tcp_close(fill_pcbs[i]) == ERR_OK);
+    }
+  }
+  EXPECT(test_tcp_take_tx(&txcounters) == NULL);
+
+  tcp_remove_all();
+}
+END_TEST
+#endif /* LWIP_TCP_SYN_COOKIES */
+
+#if LWIP_TCP_ACK_POLICY
+START_TEST(test_tcp_ack_policy)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u32_t off = 0;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data = (char *)tx_data;
+  counters.expected_data_len = sizeof(tx_data);
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+
+  /* quick-ack mode at the start of the connection */
+  for (i = 0; i < TCP_QUICKACK_SEGS; i++) {
+    p = tcp_create_rx_segment(pcb, &tx_data[off], 10, 0, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    off += 10;
+    EXPECT(txcounters.num_tx_calls == i + 1U);
+  }
+  EXPECT(!tcp_quickack_enabled(pcb));
+
+  /* one ACK for 4 full-sized segments */
+  tcp_ack_every(pcb, 4);
+  memset(&txcounters, 0, sizeof(txcounters));
+  for (i = 0; i < 4; i++) {
+    p = tcp_create_rx_segment(pcb, &tx_data[off], TCP_MSS, 0, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    off += TCP_MSS;
+    EXPECT(txcounters.num_tx_calls == ((i == 3) ? 1U : 0U));
+  }
+  EXPECT((pcb->flags & TF_ACK_DELAY) == 0);
+
+  /* less data is left to the delayed ACK */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, &tx_data[off], 10, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  off += 10;
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->flags & TF_ACK_DELAY);
+  tcp_fasttmr();
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  /* out-of-order data is ACKed at once and enters quick-ack mode */
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, &tx_data[off + TCP_MSS], TCP_MSS, TCP_MSS, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(tcp_quickack_enabled(pcb));
+  p = tcp_create_rx_segment(pcb, &tx_data[off], TCP_MSS, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  off += 2 * TCP_MSS;
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(counters.recved_bytes == off);
+
+  /* leaving quick-ack mode delays ACKs again */
+  tcp_quickack(pcb, 0);
+  memset(&txcounters, 0, sizeof(txcounters));
+  p = tcp_create_rx_segment(pcb, &tx_data[off], TCP_MSS, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->flags & TF_ACK_DELAY);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == 0);
+}
+END_TEST
+#endif /* LWIP_TCP_ACK_POLICY */
+
 /** Create the suite including all tests for this module */
 Suite *
 tcp_suite(void)
@@ -1694,7 +3178,41 @@ tcp_suite(void)
     TESTFUNC(test_tcp_rto_timeout_syn_sent_link_down),
     TESTFUNC(test_tcp_zwp_timeout),
     TESTFUNC(test_tcp_zwp_timeout_link_down),
-    TESTFUNC(test_tcp_persist_split)
+    TESTFUNC(test_tcp_persist_split),
+    TESTFUNC(test_tcp_write_ext),
+#if LWIP_TCP_SACK_IN
+    TESTFUNC(test_tcp_sack_rexmit_holes),
+    TESTFUNC(test_tcp_sack_lost_rto),
+    TESTFUNC(test_tcp_sack_recovery_twice),
+#endif /* LWIP_TCP_SACK_IN */
+#if LWIP_TCP_CUBIC
+    TESTFUNC(test_tcp_cc_cubic),
+#endif /* LWIP_TCP_CUBIC */
+#if LWIP_TCP_GSO
+    TESTFUNC(test_tcp_gso),
+#if ENABLE_LOOPBACK
+    TESTFUNC(test_tcp_gso_loopback),
+#endif /* ENABLE_LOOPBACK */
+#endif /* LWIP_TCP_GSO */
+#if LWIP_TCP_GRO
+    TESTFUNC(test_tcp_gro),
+#endif /* LWIP_TCP_GRO */
+#if LWIP_TCP_PACING
+    TESTFUNC(test_tcp_pacing),
+#endif /* LWIP_TCP_PACING */
+#if LWIP_TCP_TIMER_WHEEL
+    TESTFUNC(test_tcp_timer_wheel),
+#endif /* LWIP_TCP_TIMER_WHEEL */
+#if LWIP_TCP_FASTOPEN
+    TESTFUNC(test_tcp_fastopen),
+#endif /* LWIP_TCP_FASTOPEN */
+#if LWIP_TCP_SYN_COOKIES
+    TESTFUNC(test_tcp_syncookies),
+#endif /* LWIP_TCP_SYN_COOKIES */
+#if LWIP_TCP_ACK_POLICY
+    TESTFUNC(test_tcp_ack_policy),
+#endif /* LWIP_TCP_ACK_POLICY */
+    TESTFUNC(test_tcp_pcb_hash_lookup)
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(testfunc), tcp_setup, tcp_teardown);
 }
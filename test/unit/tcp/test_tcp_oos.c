@@ -22,6 +22,10 @@
 #define EXPECT_OOSEQ(x)
 #endif
 
+/* TCP_OOSEQ_BYTES_LIMIT and TCP_OOSEQ_PBUFS_LIMIT (see lwipopts.h) */
+unsigned long lwip_test_tcp_oos_max_bytes = 0xffffffffUL;
+unsigned short lwip_test_tcp_oos_max_pbufs = 0xffff;
+
 /* helper functions */
 
 /** Get the numbers of segments on the ooseq list */
@@ -135,6 +139,8 @@ tcp_oos_setup(void)
 static void
 tcp_oos_teardown(void)
 {
+  lwip_test_tcp_oos_max_bytes = 0xffffffffUL;
+  lwip_test_tcp_oos_max_pbufs = 0xffff;
   netif_list = NULL;
   netif_default = NULL;
   tcp_remove_all();
@@ -803,6 +809,228 @@ check_rx_counters(struct tcp_pcb *pcb, struct test_tcp_counters *counters, u32_t
  *
  * the parameter 'delay_packet' is a bitmask that choses which on these packets is ooseq
  */
+#if TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS
+/** Check the ooseq tree against the ooseq list: same order, red-black
+ * properties hold and the cached tail/counters match.
+ * Returns the black height of the subtree or -1 on error. */
+static int
+tcp_oos_rb_check(struct tcp_seg *seg, struct tcp_seg *parent, struct tcp_seg **inorder)
+{
+  int left, right;
+  if (seg == NULL) {
+    return 1;
+  }
+  if (seg->rb_parent != parent) {
+    return -1;
+  }
+  if (seg->rb_red && ((seg->rb_child[0] != NULL && seg->rb_child[0]->rb_red) ||
+                      (seg->rb_child[1] != NULL && seg->rb_child[1]->rb_red))) {
+    return -1;
+  }
+  left = tcp_oos_rb_check(seg->rb_child[0], seg, inorder);
+  if ((left < 0) || (*inorder != seg)) {
+    return -1;
+  }
+  *inorder = seg->next;
+  right = tcp_oos_rb_check(seg->rb_child[1], seg, inorder);
+  if (left != right) {
+    return -1;
+  }
+  return left + (seg->rb_red ? 0 : 1);
+}
+
+static void
+tcp_oos_check_index(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg, *inorder = pcb->ooseq;
+  u32_t bytes = 0;
+  u16_t pbufs = 0;
+
+  EXPECT(tcp_oos_rb_check(pcb->ooseq_root, NULL, &inorder) > 0);
+  EXPECT(inorder == NULL);
+  EXPECT((pcb->ooseq_root == NULL) || !pcb->ooseq_root->rb_red);
+  for (seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+    bytes += seg->p->tot_len;
+    pbufs = (u16_t)(pbufs + pbuf_clen(seg->p));
+    if (seg->next == NULL) {
+      EXPECT(pcb->ooseq_tail == seg);
+    }
+  }
+  EXPECT((pcb->ooseq != NULL) || (pcb->ooseq_tail == NULL));
+  EXPECT(pcb->ooseq_bytes == bytes);
+  EXPECT(pcb->ooseq_pbufs == pbufs);
+}
+#endif /* TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS */
+
+/** pass many small segments in scrambled order (some of them overlapping)
+ * and check that the ooseq index stays consistent with the ooseq list */
+START_TEST(test_tcp_recv_ooseq_rbtree)
+{
+#if TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS
+#define OOS_RB_SEGS    30
+#define OOS_RB_SEGLEN  100
+  int i, k;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  struct netif netif;
+
+  for(i = 0; i < (int)sizeof(data_full_wnd); i++) {
+    data_full_wnd[i] = (char)i;
+  }
+
+  test_tcp_init_netif(&netif, NULL, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = (OOS_RB_SEGS + 1) * OOS_RB_SEGLEN;
+  counters.expected_data = data_full_wnd;
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->rcv_nxt = 0x8000;
+
+  /* segments 1..OOS_RB_SEGS in scrambled order (7 is coprime to 30),
+     every 4th one preceded by a segment overlapping it and its predecessor */
+  for(i = 0; i < OOS_RB_SEGS; i++) {
+    k = 1 + ((i * 7) % OOS_RB_SEGS);
+    if ((i % 4) == 3) {
+      int off = k * OOS_RB_SEGLEN - OOS_RB_SEGLEN / 2;
+      p = tcp_create_rx_segment(pcb, &data_full_wnd[off], OOS_RB_SEGLEN, (u32_t)off, 0, TCP_ACK);
+      EXPECT_RET(p != NULL);
+      test_tcp_input(p, &netif);
+      tcp_oos_check_index(pcb);
+    }
+    p = tcp_create_rx_segment(pcb, &data_full_wnd[k * OOS_RB_SEGLEN], OOS_RB_SEGLEN,
+                              (u32_t)(k * OOS_RB_SEGLEN), 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    tcp_oos_check_index(pcb);
+    EXPECT(counters.recv_calls == 0);
+  }
+  /* all of 1..OOS_RB_SEGS is covered by one contiguous run now */
+  EXPECT_OOSEQ(tcp_oos_tcplen(pcb) == OOS_RB_SEGS * OOS_RB_SEGLEN);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == 0x8000 + OOS_RB_SEGLEN);
+
+  /* fill the hole: everything must be delivered in order */
+  p = tcp_create_rx_segment(pcb, &data_full_wnd[0], OOS_RB_SEGLEN, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->ooseq == NULL);
+  tcp_oos_check_index(pcb);
+  EXPECT(counters.recved_bytes == (OOS_RB_SEGS + 1) * OOS_RB_SEGLEN);
+  EXPECT(counters.err_calls == 0);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#endif /* TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS */
+  LWIP_UNUSED_ARG(_i);
+}
+END_TEST
+
+#if TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS && \
+    defined(TCP_OOSEQ_BYTES_LIMIT) && defined(TCP_OOSEQ_PBUFS_LIMIT)
+#define OOS_LIM_SEGS   10
+/* odd segments take 2 pbufs from the pool, even ones 1 */
+#define OOS_LIM_SEGLEN(k) (((k) & 1) ? (TCP_MSS + 64) : 200)
+
+/** pass segments 1..OOS_LIM_SEGS-1 in scrambled order with a limit set,
+ * then fill the hole. 'kept' is the bitmask of the segments left on ooseq. */
+static void
+test_tcp_recv_ooseq_rbtree_limit_run(u32_t max_bytes, u16_t max_pbufs, u16_t kept)
+{
+  int i, k, n;
+  u32_t off[OOS_LIM_SEGS + 1];
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  struct netif netif;
+  struct tcp_seg *seg;
+
+  off[0] = 0;
+  for(k = 0; k < OOS_LIM_SEGS; k++) {
+    off[k + 1] = off[k] + OOS_LIM_SEGLEN(k);
+  }
+  lwip_test_tcp_oos_max_bytes = max_bytes;
+  lwip_test_tcp_oos_max_pbufs = max_pbufs;
+
+  test_tcp_init_netif(&netif, NULL, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = off[OOS_LIM_SEGS];
+  counters.expected_data = data_full_wnd;
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->rcv_nxt = 0x8000;
+
+  /* 1..OOS_LIM_SEGS-1 in scrambled order (4 is coprime to 9): segments
+     queued above the limit are dropped from the tail of the tree */
+  for(i = 0; i < OOS_LIM_SEGS - 1; i++) {
+    k = 1 + ((i * 4) % (OOS_LIM_SEGS - 1));
+    p = tcp_create_rx_segment(pcb, &data_full_wnd[off[k]], OOS_LIM_SEGLEN(k), off[k], 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    tcp_oos_check_index(pcb);
+    EXPECT(pcb->ooseq_bytes <= max_bytes);
+    EXPECT(pcb->ooseq_pbufs <= max_pbufs);
+    EXPECT(counters.recv_calls == 0);
+  }
+  /* the segments left are complete and in order */
+  seg = pcb->ooseq;
+  for(k = 1; k < OOS_LIM_SEGS; k++) {
+    if (kept & (1 << k)) {
+      EXPECT_RET(seg != NULL);
+      EXPECT(seg->tcphdr->seqno == 0x8000 + off[k]);
+      EXPECT(seg->len == OOS_LIM_SEGLEN(k));
+      EXPECT(pbuf_clen(seg->p) == ((k & 1) ? 2 : 1));
+      seg = seg->next;
+    }
+  }
+  EXPECT(seg == NULL);
+
+  /* fill the hole: the run following it is delivered, the rest stays */
+  p = tcp_create_rx_segment(pcb, &data_full_wnd[0], OOS_LIM_SEGLEN(0), 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  tcp_oos_check_index(pcb);
+  for(n = 1; kept & (1 << n); n++) {
+    kept &= ~(1 << n);
+  }
+  EXPECT(counters.recved_bytes == off[n]);
+  for(k = 0; kept != 0; kept &= kept - 1) {
+    k++;
+  }
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == k);
+  EXPECT(counters.err_calls == 0);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == 0);
+}
+#endif /* TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS && TCP_OOSEQ_BYTES_LIMIT && TCP_OOSEQ_PBUFS_LIMIT */
+
+/** like test_tcp_recv_ooseq_rbtree, with ooseq limits forcing tail drops */
+START_TEST(test_tcp_recv_ooseq_rbtree_limit)
+{
+#if TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS && \
+    defined(TCP_OOSEQ_BYTES_LIMIT) && defined(TCP_OOSEQ_PBUFS_LIMIT)
+  int i;
+
+  for(i = 0; i < (int)sizeof(data_full_wnd); i++) {
+    data_full_wnd[i] = (char)i;
+  }
+  /* arrival order: 1, 5, 9, 4, 8, 3, 7, 2, 6 */
+  /* 6 pbufs: 1..4 (2 + 1 + 2 + 1 pbufs), higher ones are pushed out */
+  test_tcp_recv_ooseq_rbtree_limit_run(0xffffffffUL, 6, 0x1e);
+  /* 4 pbufs: 3 is pushed out by 2, 6 arrives last and fits behind it */
+  test_tcp_recv_ooseq_rbtree_limit_run(0xffffffffUL, 4, 0x46);
+  /* bytes: the limit ends in the middle of segment 3 */
+  test_tcp_recv_ooseq_rbtree_limit_run((TCP_MSS + 64) + 200 + 100, 0xffff, 0x06);
+#endif /* TCP_OOSEQ_RBTREE && !TCP_OOSEQ_MAX_BYTES && !TCP_OOSEQ_MAX_PBUFS && TCP_OOSEQ_BYTES_LIMIT && TCP_OOSEQ_PBUFS_LIMIT */
+  LWIP_UNUSED_ARG(_i);
+}
+END_TEST
+
 static void test_tcp_recv_ooseq_double_FINs(int delay_packet)
 {
   int i, k;
@@ -997,6 +1225,8 @@ tcp_oos_suite(void)
     TESTFUNC(test_tcp_recv_ooseq_overrun_rxwin_edge),
     TESTFUNC(test_tcp_recv_ooseq_max_bytes),
     TESTFUNC(test_tcp_recv_ooseq_max_pbufs),
+    TESTFUNC(test_tcp_recv_ooseq_rbtree),
+    TESTFUNC(test_tcp_recv_ooseq_rbtree_limit),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_0),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_1),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_2),
@@ -169,7 +169,7 @@ static void test_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
 }
 
 static struct pbuf *
-test_udp_create_test_packet(u16_t length, u16_t port, u32_t dst_addr)
+test_udp_create_test_packet_from(u16_t length, u32_t src_addr, u16_t src_port, u16_t port, u32_t dst_addr)
 {
   err_t err;
   u8_t ret;
@@ -192,7 +192,8 @@ test_udp_create_test_packet(u16_t length, u16_t port, u32_t dst_addr)
   fail_unless(!ret);
   uh = (struct udp_hdr *)p->payload;
   uh->chksum = 0;
-  uh->dest = uh->src = lwip_htons(port);
+  uh->dest = lwip_htons(port);
+  uh->src = lwip_htons(src_port);
   uh->len = lwip_htons(p->tot_len);
   /* add IPv4 header */
   ret = pbuf_add_header(p, sizeof(struct ip_hdr));
@@ -200,6 +201,7 @@ test_udp_create_test_packet(u16_t length, u16_t port, u32_t dst_addr)
   ih = (struct ip_hdr *)p->payload;
   memset(ih, 0, sizeof(*ih));
   ih->dest.addr = dst_addr;
+  ih->src.addr = src_addr;
   ih->_len = lwip_htons(p->tot_len);
   ih->_ttl = 32;
   ih->_proto = IP_PROTO_UDP;
@@ -208,6 +210,12 @@ test_udp_create_test_packet(u16_t length, u16_t port, u32_t dst_addr)
   return p;
 }
 
+static struct pbuf *
+test_udp_create_test_packet(u16_t length, u16_t port, u32_t dst_addr)
+{
+  return test_udp_create_test_packet_from(length, 0, port, port, dst_addr);
+}
+
 /* bind 2 pcbs to specific netif IP and test which one gets broadcasts */
 START_TEST(test_udp_broadcast_rx_with_2_netifs)
 {
@@ -459,6 +467,238 @@ START_TEST(test_udp_bind)
 }
 END_TEST
 
+/* pcbs bound to port 0 get different ports of the ephemeral range */
+START_TEST(test_udp_new_port)
+{
+  struct udp_pcb *pcbs[MEMP_NUM_UDP_PCB];
+  u16_t port;
+  err_t err;
+  int i, j;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+    pcbs[i] = udp_new();
+    fail_unless(pcbs[i] != NULL);
+    err = udp_bind(pcbs[i], IP_ANY_TYPE, 0);
+    fail_unless(err == ERR_OK);
+    fail_unless(pcbs[i]->local_port >= 0xc000);
+    for (j = 0; j < i; j++) {
+      fail_unless(pcbs[i]->local_port != pcbs[j]->local_port);
+    }
+  }
+  /* rebinding releases the old port */
+  port = pcbs[0]->local_port;
+  err = udp_bind(pcbs[0], IP_ANY_TYPE, 0);
+  fail_unless(err == ERR_OK);
+  udp_remove(pcbs[1]);
+  pcbs[1] = udp_new();
+  fail_unless(pcbs[1] != NULL);
+  err = udp_bind(pcbs[1], IP_ANY_TYPE, port);
+  fail_unless(err == ERR_OK);
+  for (i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+    udp_remove(pcbs[i]);
+  }
+}
+END_TEST
+
+/* bind several pcbs to one port with UDP_FLAGS_REUSEPORT and check that
+   flows are spread across them and stick to their pcb */
+START_TEST(test_udp_reuseport)
+{
+#if LWIP_UDP_REUSEPORT
+#define TEST_UDP_REUSEPORT_PCBS  3
+#define TEST_UDP_REUSEPORT_FLOWS 32
+  struct udp_pcb *pcbs[TEST_UDP_REUSEPORT_PCBS];
+  struct udp_pcb *other;
+  struct test_udp_rxdata ctr[TEST_UDP_REUSEPORT_PCBS];
+  int flow_pcb[TEST_UDP_REUSEPORT_FLOWS];
+  const u16_t port = 5353;
+  ip4_addr_t src_addr;
+  struct pbuf *p;
+  err_t err;
+  int i, j, used;
+  LWIP_UNUSED_ARG(_i);
+
+  IP4_ADDR(&src_addr, 192,168,0,2);
+  for (i = 0; i < TEST_UDP_REUSEPORT_PCBS; i++) {
+    pcbs[i] = udp_new();
+    fail_unless(pcbs[i] != NULL);
+    udp_set_flags(pcbs[i], UDP_FLAGS_REUSEPORT);
+    err = udp_bind(pcbs[i], &test_netif1.ip_addr, port);
+    fail_unless(err == ERR_OK);
+    memset(&ctr[i], 0, sizeof(ctr[i]));
+    ctr[i].pcb = pcbs[i];
+    udp_recv(pcbs[i], test_recv, &ctr[i]);
+  }
+  /* a pcb without the flag cannot join the group */
+  other = udp_new();
+  fail_unless(other != NULL);
+  err = udp_bind(other, &test_netif1.ip_addr, port);
+  fail_unless(err == ERR_USE);
+  udp_remove(other);
+
+  /* each flow is delivered to exactly one pcb, and always to the same */
+  for (j = 0; j < 2; j++) {
+    for (i = 0; i < TEST_UDP_REUSEPORT_FLOWS; i++) {
+      int k, got = -1;
+      p = test_udp_create_test_packet_from(16, src_addr.addr, (u16_t)(40000 + i), port, test_ipaddr1.addr);
+      EXPECT_RET(p != NULL);
+      err = ip4_input(p, &test_netif1);
+      fail_unless(err == ERR_OK);
+      for (k = 0; k < TEST_UDP_REUSEPORT_PCBS; k++) {
+        if (ctr[k].rx_cnt != 0) {
+          fail_unless(got == -1);
+          fail_unless(ctr[k].rx_cnt == 1);
+          got = k;
+          ctr[k].rx_cnt = 0;
+        }
+      }
+      fail_unless(got != -1);
+      if (j == 0) {
+        flow_pcb[i] = got;
+      } else {
+        fail_unless(flow_pcb[i] == got);
+      }
+    }
+  }
+  /* the flows are spread over more than one pcb */
+  used = 0;
+  for (i = 0; i < TEST_UDP_REUSEPORT_PCBS; i++) {
+    for (j = 0; j < TEST_UDP_REUSEPORT_FLOWS; j++) {
+      if (flow_pcb[j] == i) {
+        used++;
+        break;
+      }
+    }
+  }
+  fail_unless(used > 1);
+
+  /* removing one pcb does not move the flows of the others */
+  udp_remove(pcbs[0]);
+  for (i = 0; i < TEST_UDP_REUSEPORT_FLOWS; i++) {
+    int k, got = -1;
+    p = test_udp_create_test_packet_from(16, src_addr.addr, (u16_t)(40000 + i), port, test_ipaddr1.addr);
+    EXPECT_RET(p != NULL);
+    err = ip4_input(p, &test_netif1);
+    fail_unless(err == ERR_OK);
+    for (k = 1; k < TEST_UDP_REUSEPORT_PCBS; k++) {
+      if (ctr[k].rx_cnt != 0) {
+        got = k;
+        ctr[k].rx_cnt = 0;
+      }
+    }
+    fail_unless(got > 0);
+    if (flow_pcb[i] != 0) {
+      fail_unless(flow_pcb[i] == got);
+    }
+  }
+#else /* LWIP_UDP_REUSEPORT */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_UDP_REUSEPORT */
+}
+END_TEST
+
+#if LWIP_UDP_GSO
+#define TEST_UDP_GSO_MAX 4
+static u16_t gso_tx_len[TEST_UDP_GSO_MAX];
+static u8_t gso_tx_first[TEST_UDP_GSO_MAX];
+static int gso_tx_cnt;
+
+/* netif->output recording the datagrams sent */
+static err_t
+gso_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  struct udp_hdr udphdr;
+  u16_t chksum;
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+
+  fail_unless(gso_tx_cnt < TEST_UDP_GSO_MAX);
+  fail_unless(p->tot_len > IP_HLEN + UDP_HLEN);
+  fail_unless(pbuf_copy_partial(p, &udphdr, UDP_HLEN, IP_HLEN) == UDP_HLEN);
+  fail_unless(lwip_ntohs(udphdr.len) == p->tot_len - IP_HLEN);
+  /* the checksum over the datagram and the pseudo header must be valid */
+  fail_unless(pbuf_remove_header(p, IP_HLEN) == 0);
+  chksum = inet_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len, &test_ipaddr1, ipaddr);
+  fail_unless(pbuf_add_header(p, IP_HLEN) == 0);
+  fail_unless(chksum == 0);
+  gso_tx_len[gso_tx_cnt] = (u16_t)(p->tot_len - IP_HLEN - UDP_HLEN);
+  gso_tx_first[gso_tx_cnt] = pbuf_get_at(p, IP_HLEN + UDP_HLEN);
+  gso_tx_cnt++;
+  return ERR_OK;
+}
+#endif /* LWIP_UDP_GSO */
+
+/* send a pbuf chain with a segment size set and check the datagrams */
+START_TEST(test_udp_gso)
+{
+#if LWIP_UDP_GSO
+  struct udp_pcb *pcb;
+  struct pbuf *p, *p2;
+  ip_addr_t dst;
+  err_t err;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  IP_ADDR4(&dst, 192,168,0,2);
+  test_netif1.output = gso_netif_output;
+  gso_tx_cnt = 0;
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+
+  /* 250 bytes in two pbufs, the second datagram spans both */
+  p = pbuf_alloc(PBUF_TRANSPORT, 130, PBUF_RAM);
+  p2 = pbuf_alloc(PBUF_RAW, 120, PBUF_RAM);
+  fail_unless((p != NULL) && (p2 != NULL));
+  pbuf_cat(p, p2);
+  for (i = 0; i < p->tot_len; i++) {
+    pbuf_put_at(p, i, (u8_t)i);
+  }
+
+  udp_set_gso_size(pcb, 100);
+  err = udp_sendto(pcb, p, &dst, 5000);
+  fail_unless(err == ERR_OK);
+  fail_unless(gso_tx_cnt == 3);
+  fail_unless(gso_tx_len[0] == 100);
+  fail_unless(gso_tx_len[1] == 100);
+  fail_unless(gso_tx_len[2] == 50);
+  fail_unless(gso_tx_first[0] == 0);
+  fail_unless(gso_tx_first[1] == 100);
+  fail_unless(gso_tx_first[2] == 200);
+  /* the pbuf is left to the caller as it was */
+  fail_unless(p->tot_len == 250);
+  fail_unless(p->ref == 1);
+
+  /* datagrams larger than the MTU are refused */
+  gso_tx_cnt = 0;
+  udp_set_gso_size(pcb, (u16_t)(test_netif1.mtu - IP_HLEN - UDP_HLEN + 1));
+  pbuf_realloc(p, 130);
+  p2 = pbuf_alloc(PBUF_RAW, 1500, PBUF_RAM);
+  fail_unless(p2 != NULL);
+  pbuf_cat(p, p2);
+  err = udp_sendto(pcb, p, &dst, 5000);
+  fail_unless(err == ERR_VAL);
+  fail_unless(gso_tx_cnt == 0);
+  pbuf_free(p);
+
+  /* not larger than the segment size: sent as is */
+  p = pbuf_alloc(PBUF_TRANSPORT, 100, PBUF_RAM);
+  fail_unless(p != NULL);
+  udp_set_gso_size(pcb, 100);
+  err = udp_sendto(pcb, p, &dst, 5000);
+  fail_unless(err == ERR_OK);
+  fail_unless(gso_tx_cnt == 1);
+  fail_unless(gso_tx_len[0] == 100);
+  pbuf_free(p);
+
+  udp_remove(pcb);
+  test_netif1.output = default_netif_output;
+#else /* LWIP_UDP_GSO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_UDP_GSO */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 udp_suite(void)
@@ -466,7 +706,10 @@ udp_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_udp_new_remove),
     TESTFUNC(test_udp_broadcast_rx_with_2_netifs),
-    TESTFUNC(test_udp_bind)
+    TESTFUNC(test_udp_bind),
+    TESTFUNC(test_udp_new_port),
+    TESTFUNC(test_udp_reuseport),
+    TESTFUNC(test_udp_gso)
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(testfunc), udp_setup, udp_teardown);
 }